@@ -46,6 +46,7 @@ public class HierarchicalTaskNetworkEditor : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
+				"AssetRegistry",
 				"Slate",
 				"SlateCore", 
 				// ... add private dependencies that you statically link with here ...	
@@ -0,0 +1,53 @@
+#include "HTNBuildWarmPlanCacheCommandlet.h"
+#include "HTNDomainAsset.h"
+#include "HTNEditorLogging.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "FileHelpers.h"
+
+UHTNBuildWarmPlanCacheCommandlet::UHTNBuildWarmPlanCacheCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UHTNBuildWarmPlanCacheCommandlet::Main(const FString& Params)
+{
+	FString SearchPath = TEXT("/Game");
+	FParse::Value(*Params, TEXT("Path="), SearchPath);
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.ClassPaths.Add(UHTNDomainAsset::StaticClass()->GetClassPathName());
+	Filter.PackagePaths.Add(FName(*SearchPath));
+	Filter.bRecursiveClasses = true;
+	Filter.bRecursivePaths = true;
+
+	TArray<FAssetData> DomainAssets;
+	AssetRegistry.GetAssets(Filter, DomainAssets);
+
+	TArray<UPackage*> PackagesToSave;
+	for (const FAssetData& AssetData : DomainAssets)
+	{
+		UHTNDomainAsset* Domain = Cast<UHTNDomainAsset>(AssetData.GetAsset());
+		if (!Domain || Domain->ArchetypeStartStates.Num() == 0)
+		{
+			continue;
+		}
+
+		Domain->BuildWarmPlanCache();
+		PackagesToSave.Add(Domain->GetPackage());
+	}
+
+	if (PackagesToSave.Num() > 0 && !UEditorLoadingAndSavingUtils::SavePackages(PackagesToSave, false))
+	{
+		UE_LOG(LogHTNPlannerEditorPlugin, Error, TEXT("Failed to save HTN domains with their warm plan caches"));
+		return 1;
+	}
+
+	UE_LOG(LogHTNPlannerEditorPlugin, Display, TEXT("Built warm plan caches for %d HTN domains"), PackagesToSave.Num());
+	return 0;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "HTNBuildWarmPlanCacheCommandlet.generated.h"
+
+/**
+ * Commandlet precomputing the warm plan cache of every HTN domain asset and saving the domains, run before cooking.
+ * Usage: UnrealEditor-Cmd <Project> -run=HTNBuildWarmPlanCache [-Path=/Game/AI]
+ */
+UCLASS()
+class HIERARCHICALTASKNETWORKEDITOR_API UHTNBuildWarmPlanCacheCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UHTNBuildWarmPlanCacheCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
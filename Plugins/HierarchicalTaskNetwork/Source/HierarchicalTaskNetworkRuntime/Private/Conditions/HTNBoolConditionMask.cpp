@@ -0,0 +1,78 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Conditions/HTNBoolConditionMask.h"
+
+#include "Conditions/HTNCondition.h"
+#include "HTNWorldStateStruct.h"
+
+bool FHTNBoolConditionMask::CheckConditions(const TArray<UHTNCondition*>& Conditions, const UHTNWorldState* WorldState) const
+{
+	if (!bCompiled)
+	{
+		for (const UHTNCondition* Condition : Conditions)
+		{
+			if (IsValid(Condition) && !Condition->CheckCondition(WorldState))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	if (RequiredBits.Num() > 0 && (!WorldState || !WorldState->MatchesBoolBits(RequiredBits, ExpectedTrueBits)))
+	{
+		return false;
+	}
+
+	for (const UHTNCondition* Condition : RemainingConditions)
+	{
+		if (IsValid(Condition) && !Condition->CheckCondition(WorldState))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FHTNBoolConditionMask::Compile(const TArray<UHTNCondition*>& Conditions)
+{
+	RequiredBits.Reset();
+	ExpectedTrueBits.Reset();
+	RemainingConditions.Reset();
+	bCompiled = true;
+
+	for (const UHTNCondition* Condition : Conditions)
+	{
+		if (!IsValid(Condition))
+		{
+			continue;
+		}
+
+		FName Key;
+		bool bExpectedValue = false;
+		if (!Condition->GetRequiredBoolValue(Key, bExpectedValue))
+		{
+			RemainingConditions.Add(Condition);
+			continue;
+		}
+
+		const int32 Slot = FHTNKeySlots::FindOrAdd(Key);
+		const int32 WordIndex = Slot / 64;
+		const uint64 Bit = uint64(1) << (Slot % 64);
+		if (!RequiredBits.IsValidIndex(WordIndex))
+		{
+			RequiredBits.SetNumZeroed(WordIndex + 1);
+			ExpectedTrueBits.SetNumZeroed(WordIndex + 1);
+		}
+
+		// Contradicting requirements on one key can't share a bit, leave the second one to the slow path
+		if ((RequiredBits[WordIndex] & Bit) && ((ExpectedTrueBits[WordIndex] & Bit) != 0) != bExpectedValue)
+		{
+			RemainingConditions.Add(Condition);
+			continue;
+		}
+
+		RequiredBits[WordIndex] |= Bit;
+		ExpectedTrueBits[WordIndex] |= bExpectedValue ? Bit : 0;
+	}
+}
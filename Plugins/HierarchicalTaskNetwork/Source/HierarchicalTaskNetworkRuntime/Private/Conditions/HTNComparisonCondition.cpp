@@ -183,5 +183,21 @@ bool UHTNComparisonCondition::ValidateCondition_Implementation() const
         return false;
     }
     
+    return true;
+}
+
+bool UHTNComparisonCondition::GetReadKeys(TArray<FName>& OutKeys) const
+{
+    // A Blueprint override of the check may read anything
+    if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UHTNCondition, CheckCondition)))
+    {
+        return false;
+    }
+    
+    OutKeys.Add(LeftPropertyKey);
+    if (!bUseFixedRightValue)
+    {
+        OutKeys.Add(RightPropertyKey);
+    }
     return true;
 }
\ No newline at end of file
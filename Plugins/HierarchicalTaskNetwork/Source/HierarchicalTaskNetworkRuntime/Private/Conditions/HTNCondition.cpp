@@ -26,4 +26,30 @@ bool UHTNCondition::ValidateCondition_Implementation() const
 {
 	// Base validation just checks if the object is valid
 	return IsValid(this);
+}
+
+bool UHTNCondition::GetReadKeys(TArray<FName>& OutKeys) const
+{
+	// Unknown by default, derived classes that read fixed keys should report them
+	return false;
+}
+
+bool UHTNCondition::GetRequiredBoolValue(FName& OutKey, bool& bOutExpectedValue) const
+{
+	return false;
+}
+
+int32 UHTNCondition::GetNumConditions() const
+{
+	return 1;
+}
+
+int32 UHTNCondition::FindFailedCondition(const UHTNWorldState* WorldState) const
+{
+	return CheckCondition(WorldState) ? INDEX_NONE : 0;
+}
+
+FString UHTNCondition::DescribeCondition(int32 ConditionIndex) const
+{
+	return GetDescription();
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Conditions/HTNCookedConditions.h"
+
+#include "HTNDomainBlob.h"
+
+void UHTNCookedConditions::Initialize(TSharedRef<const FHTNDomainBlob, ESPMode::ThreadSafe> InBlob, int32 InFirstCondition, int32 InNumConditions)
+{
+    Blob = InBlob;
+    FirstCondition = InFirstCondition;
+    NumConditions = InNumConditions;
+}
+
+bool UHTNCookedConditions::CheckCondition_Implementation(const UHTNWorldState* WorldState) const
+{
+    if (!Blob.IsValid())
+    {
+        return false;
+    }
+    
+    for (int32 ConditionIndex = FirstCondition; ConditionIndex < FirstCondition + NumConditions; ++ConditionIndex)
+    {
+        if (!Blob->CheckCondition(ConditionIndex, WorldState))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int32 UHTNCookedConditions::FindFailedCondition(const UHTNWorldState* WorldState) const
+{
+    if (!Blob.IsValid())
+    {
+        return 0;
+    }
+    
+    for (int32 ConditionIndex = 0; ConditionIndex < NumConditions; ++ConditionIndex)
+    {
+        if (!Blob->CheckCondition(FirstCondition + ConditionIndex, WorldState))
+        {
+            return ConditionIndex;
+        }
+    }
+    return INDEX_NONE;
+}
+
+FString UHTNCookedConditions::DescribeCondition(int32 ConditionIndex) const
+{
+    return Blob.IsValid() && ConditionIndex >= 0 && ConditionIndex < NumConditions ? Blob->DescribeCondition(FirstCondition + ConditionIndex) : FString();
+}
+
+FString UHTNCookedConditions::GetDescription_Implementation() const
+{
+    TArray<FString> Descriptions;
+    for (int32 ConditionIndex = FirstCondition; Blob.IsValid() && ConditionIndex < FirstCondition + NumConditions; ++ConditionIndex)
+    {
+        Descriptions.Add(Blob->DescribeCondition(ConditionIndex));
+    }
+    return FString::Printf(TEXT("Property Conditions: %s"), *FString::Join(Descriptions, TEXT(" and ")));
+}
+
+bool UHTNCookedConditions::GetReadKeys(TArray<FName>& OutKeys) const
+{
+    for (int32 ConditionIndex = FirstCondition; Blob.IsValid() && ConditionIndex < FirstCondition + NumConditions; ++ConditionIndex)
+    {
+        OutKeys.Add(Blob->GetConditionKey(ConditionIndex));
+    }
+    return true;
+}
+
+bool UHTNCookedConditions::GetRequiredBoolValue(FName& OutKey, bool& bOutExpectedValue) const
+{
+    // A mask entry stands for a single key, so only single checks qualify
+    if (!Blob.IsValid() || NumConditions != 1 || !Blob->GetConditionRequiredBoolValue(FirstCondition, bOutExpectedValue))
+    {
+        return false;
+    }
+    
+    OutKey = Blob->GetConditionKey(FirstCondition);
+    return true;
+}
@@ -14,6 +14,11 @@ UHTNPropertyCondition::UHTNPropertyCondition()
 }
 
 bool UHTNPropertyCondition::CheckCondition_Implementation(const UHTNWorldState* WorldState) const
+{
+    return CheckProperty(WorldState, PropertyKey, CheckType, CompareValue);
+}
+
+bool UHTNPropertyCondition::CheckProperty(const UHTNWorldState* WorldState, FName Key, EHTNPropertyCheckType InCheckType, const FHTNProperty& InCompareValue)
 {
     if (!WorldState)
     {
@@ -23,10 +28,10 @@ bool UHTNPropertyCondition::CheckCondition_Implementation(const UHTNWorldState*
 
     // Get the property if it exists
     FHTNProperty PropertyValue;
-    bool bPropertyExists = WorldState->GetProperty(PropertyKey, PropertyValue);
+    bool bPropertyExists = WorldState->GetProperty(Key, PropertyValue);
 
     // Check based on the check type
-    switch (CheckType)
+    switch (InCheckType)
     {
         case EHTNPropertyCheckType::Exists:
             return bPropertyExists;
@@ -51,20 +56,20 @@ bool UHTNPropertyCondition::CheckCondition_Implementation(const UHTNWorldState*
         case EHTNPropertyCheckType::Equals:
             if (bPropertyExists)
             {
-                return PropertyValue == CompareValue;
+                return PropertyValue == InCompareValue;
             }
             return false;
 
         case EHTNPropertyCheckType::NotEquals:
             if (bPropertyExists)
             {
-                return PropertyValue != CompareValue;
+                return PropertyValue != InCompareValue;
             }
             return true; // Non-existent properties are not equal to anything
 
         default:
             UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("PropertyCondition: Unknown check type %d"), 
-                   static_cast<int32>(CheckType));
+                   static_cast<int32>(InCheckType));
             return false;
     }
 }
@@ -132,5 +137,47 @@ bool UHTNPropertyCondition::ValidateCondition_Implementation() const
     
     // For boolean checks, no additional validation needed
     
+    return true;
+}
+
+bool UHTNPropertyCondition::GetReadKeys(TArray<FName>& OutKeys) const
+{
+    // A Blueprint override of the check may read anything
+    if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UHTNCondition, CheckCondition)))
+    {
+        return false;
+    }
+    
+    OutKeys.Add(PropertyKey);
+    return true;
+}
+
+bool UHTNPropertyCondition::GetRequiredBoolValue(FName& OutKey, bool& bOutExpectedValue) const
+{
+    if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UHTNCondition, CheckCondition)))
+    {
+        return false;
+    }
+    
+    switch (CheckType)
+    {
+        case EHTNPropertyCheckType::IsTrue:
+        case EHTNPropertyCheckType::IsFalse:
+            bOutExpectedValue = CheckType == EHTNPropertyCheckType::IsTrue;
+            break;
+            
+        case EHTNPropertyCheckType::Equals:
+            if (CompareValue.GetType() != EHTNPropertyType::Boolean)
+            {
+                return false;
+            }
+            bOutExpectedValue = CompareValue.GetBoolValue();
+            break;
+            
+        default:
+            return false;
+    }
+    
+    OutKey = PropertyKey;
     return true;
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Effects/HTNCookedEffects.h"
+
+#include "HTNDomainBlob.h"
+
+void UHTNCookedEffects::Initialize(TSharedRef<const FHTNDomainBlob, ESPMode::ThreadSafe> InBlob, int32 InFirstEffect, int32 InNumEffects)
+{
+    Blob = InBlob;
+    FirstEffect = InFirstEffect;
+    NumEffects = InNumEffects;
+}
+
+void UHTNCookedEffects::ApplyEffect_Implementation(UHTNWorldState* WorldState) const
+{
+    for (int32 EffectIndex = FirstEffect; Blob.IsValid() && EffectIndex < FirstEffect + NumEffects; ++EffectIndex)
+    {
+        Blob->ApplyEffect(EffectIndex, WorldState);
+    }
+}
+
+FString UHTNCookedEffects::GetDescription_Implementation() const
+{
+    TArray<FString> Descriptions;
+    for (int32 EffectIndex = FirstEffect; Blob.IsValid() && EffectIndex < FirstEffect + NumEffects; ++EffectIndex)
+    {
+        Descriptions.Add(Blob->DescribeEffect(EffectIndex));
+    }
+    return FString::Join(Descriptions, TEXT(", "));
+}
+
+bool UHTNCookedEffects::GetWriteKeys(TArray<FName>& OutKeys) const
+{
+    for (int32 EffectIndex = FirstEffect; Blob.IsValid() && EffectIndex < FirstEffect + NumEffects; ++EffectIndex)
+    {
+        OutKeys.Add(Blob->GetEffectKey(EffectIndex));
+    }
+    return true;
+}
+
+bool UHTNCookedEffects::GetReadKeys(TArray<FName>& OutKeys) const
+{
+    for (int32 EffectIndex = FirstEffect; Blob.IsValid() && EffectIndex < FirstEffect + NumEffects; ++EffectIndex)
+    {
+        const FName ReadKey = Blob->GetEffectReadKey(EffectIndex);
+        if (!ReadKey.IsNone())
+        {
+            OutKeys.Add(ReadKey);
+        }
+    }
+    return true;
+}
@@ -25,4 +25,16 @@ bool UHTNEffect::ValidateEffect_Implementation() const
 {
 	// Base validation just checks if the object is valid
 	return IsValid(this);
+}
+
+bool UHTNEffect::GetWriteKeys(TArray<FName>& OutKeys) const
+{
+	// Unknown by default, derived classes that write fixed keys should report them
+	return false;
+}
+
+bool UHTNEffect::GetReadKeys(TArray<FName>& OutKeys) const
+{
+	// Unknown by default, derived classes that read fixed keys should report them
+	return false;
 }
\ No newline at end of file
@@ -95,5 +95,32 @@ bool UHTNSetPropertyEffect::ValidateEffect_Implementation() const
         return false;
     }
     
+    return true;
+}
+
+bool UHTNSetPropertyEffect::GetWriteKeys(TArray<FName>& OutKeys) const
+{
+    // A Blueprint override of the effect may write anything
+    if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UHTNEffect, ApplyEffect)))
+    {
+        return false;
+    }
+    
+    OutKeys.Add(PropertyKey);
+    return true;
+}
+
+bool UHTNSetPropertyEffect::GetReadKeys(TArray<FName>& OutKeys) const
+{
+    // A Blueprint override of the effect may read anything
+    if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UHTNEffect, ApplyEffect)))
+    {
+        return false;
+    }
+    
+    if (bUseSourceProperty && !bRemoveProperty)
+    {
+        OutKeys.Add(SourcePropertyKey);
+    }
     return true;
 }
\ No newline at end of file
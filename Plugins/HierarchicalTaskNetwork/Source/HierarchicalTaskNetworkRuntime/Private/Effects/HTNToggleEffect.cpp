@@ -16,6 +16,11 @@ UHTNToggleEffect::UHTNToggleEffect()
 }
 
 void UHTNToggleEffect::ApplyEffect_Implementation(UHTNWorldState* WorldState) const
+{
+    ToggleProperty(WorldState, PropertyKey, bSetTrueIfMissing, bForceValue, ForcedValue);
+}
+
+void UHTNToggleEffect::ToggleProperty(UHTNWorldState* WorldState, FName Key, bool bInSetTrueIfMissing, bool bInForceValue, bool InForcedValue)
 {
     if (!WorldState)
     {
@@ -25,7 +30,7 @@ void UHTNToggleEffect::ApplyEffect_Implementation(UHTNWorldState* WorldState) co
 
     // Get the current value if it exists
     FHTNProperty PropertyValue;
-    bool bExists = WorldState->GetProperty(PropertyKey, PropertyValue);
+    bool bExists = WorldState->GetProperty(Key, PropertyValue);
     
     // If the property exists and is a boolean
     if (bExists && PropertyValue.GetType() == EHTNPropertyType::Boolean)
@@ -33,33 +38,33 @@ void UHTNToggleEffect::ApplyEffect_Implementation(UHTNWorldState* WorldState) co
         bool CurrentValue = PropertyValue.GetBoolValue();
         
         // If forcing a value, use that
-        if (bForceValue)
+        if (bInForceValue)
         {
-            WorldState->SetProperty(PropertyKey, FHTNProperty(ForcedValue));
+            WorldState->SetProperty(Key, FHTNProperty(InForcedValue));
         }
         else
         {
             // Otherwise toggle the current value
-            WorldState->SetProperty(PropertyKey, FHTNProperty(!CurrentValue));
+            WorldState->SetProperty(Key, FHTNProperty(!CurrentValue));
         }
     }
     else
     {
         // Property doesn't exist or isn't a boolean
-        if (bForceValue)
+        if (bInForceValue)
         {
             // Use the forced value
-            WorldState->SetProperty(PropertyKey, FHTNProperty(ForcedValue));
+            WorldState->SetProperty(Key, FHTNProperty(InForcedValue));
         }
-        else if (bSetTrueIfMissing)
+        else if (bInSetTrueIfMissing)
         {
             // Create with true value
-            WorldState->SetProperty(PropertyKey, FHTNProperty(true));
+            WorldState->SetProperty(Key, FHTNProperty(true));
         }
         else
         {
             // Create with false value
-            WorldState->SetProperty(PropertyKey, FHTNProperty(false));
+            WorldState->SetProperty(Key, FHTNProperty(false));
         }
     }
 }
@@ -91,5 +96,30 @@ bool UHTNToggleEffect::ValidateEffect_Implementation() const
         return false;
     }
     
+    return true;
+}
+
+bool UHTNToggleEffect::GetWriteKeys(TArray<FName>& OutKeys) const
+{
+    // A Blueprint override of the effect may write anything
+    if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UHTNEffect, ApplyEffect)))
+    {
+        return false;
+    }
+    
+    OutKeys.Add(PropertyKey);
+    return true;
+}
+
+bool UHTNToggleEffect::GetReadKeys(TArray<FName>& OutKeys) const
+{
+    // A Blueprint override of the effect may read anything
+    if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UHTNEffect, ApplyEffect)))
+    {
+        return false;
+    }
+    
+    // The toggled value depends on the current one
+    OutKeys.Add(PropertyKey);
     return true;
 }
\ No newline at end of file
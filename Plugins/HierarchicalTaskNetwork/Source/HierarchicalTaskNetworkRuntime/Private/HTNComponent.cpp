@@ -3,15 +3,36 @@
 #include "HTNDebugVisualizationComponent.h"
 #include "HTNLogging.h"
 #include "Tasks/HTNTask.h"
+#include "Tasks/HTNCompoundTask.h"
+#include "Tasks/HTNPrimitiveTask.h"
+#include "HTNMethod.h"
+#include "HTNPlanCacheSubsystem.h"
 #include "HTNPlanExecutor.h"
 #include "HTNDFSPlanner.h"
+#include "HTNSensorScheduler.h"
+#include "HTNWorldStateLayerSubsystem.h"
 
 UHTNComponent::UHTNComponent()
     : bDebugOutput(false)
+    , bUseSharedWorldStateLayers(true)
     , bAutoReplanEnabled(true)
     , ReplanCheckInterval(0.5f)
+    , PlanAheadTaskCount(0)
+    , ReplanBackoffDelay(0.5f)
+    , ReplanBackoffMultiplier(2.0f)
+    , MaxReplanBackoffDelay(8.0f)
+    , NegativePlanCacheSize(16)
+    , bUseSharedPlanCache(true)
+    , MaxConsecutivePlanRepairs(0)
     , LastReplanCheckTime(0.0f)
+    , NextReplanTime(0.0f)
+    , bReplanRequested(false)
+    , bWatchingAllKeys(false)
+    , SubscribedExecutionId(0)
+    , PlannedAheadExecutionId(0)
+    , PlanAheadWorldState(nullptr)
     , ConsecutivePlanFailures(0)
+    , ConsecutivePlanRepairs(0)
 {
     // Set this component to be initialized when the game starts, and to be ticked every frame
     PrimaryComponentTick.bCanEverTick = true;
@@ -29,6 +50,7 @@ void UHTNComponent::BeginPlay()
     
     // Initialize the component
     Initialize();
+    RegisterSensors();
 }
 
 void UHTNComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
@@ -39,6 +61,9 @@ void UHTNComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
         PlanExecutor->AbortPlan(false);
     }
     
+    UnregisterSensors();
+    ClearKeySubscriptions();
+    
     Super::EndPlay(EndPlayReason);
 }
 
@@ -55,16 +80,42 @@ void UHTNComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorCo
         // Check if we need to replan
         if (bAutoReplanEnabled)
         {
+            // Follow plan changes: a new plan reads other keys, and an ended plan needs a replacement
+            const uint32 ExecutionId = PlanExecutor->IsExecutingPlan() ? PlanExecutor->GetPlanExecutionId() : 0;
+            if (ExecutionId != SubscribedExecutionId || SubscribedWorldState.Get() != WorldState)
+            {
+                if (SubscribedExecutionId != 0 && ExecutionId == 0)
+                {
+                    bReplanRequested = true;
+                }
+                UpdateKeySubscriptions();
+            }
+            
+            // Key changes only raise a flag, so any number of them result in one check
             float CurrentTime = GetWorld()->GetTimeSeconds();
-            if (CurrentTime - LastReplanCheckTime >= ReplanCheckInterval)
+            if (bReplanRequested && CurrentTime - LastReplanCheckTime >= ReplanCheckInterval && CurrentTime >= NextReplanTime)
             {
                 LastReplanCheckTime = CurrentTime;
+                bReplanRequested = false;
                 
                 // Try to replan if needed
                 AutoReplan();
             }
         }
         
+        // Compute the follow-up plan while the last tasks run, so the agent doesn't idle between plans.
+        // Planning is synchronous, so wait until the plan has progressed; planning ahead as soon as a short plan
+        // starts would only double the planning cost.
+        if (bAutoReplanEnabled && PlanAheadTaskCount > 0 && PlanExecutor->IsExecutingPlan() &&
+            PlannedAheadExecutionId != PlanExecutor->GetPlanExecutionId())
+        {
+            const int32 NumRemainingTasks = PlanExecutor->GetNumRemainingTasks();
+            if (NumRemainingTasks <= PlanAheadTaskCount && NumRemainingTasks < PlanExecutor->GetCurrentPlan().Tasks.Num())
+            {
+                PlanAhead();
+            }
+        }
+        
         // Debug output
         if (bDebugOutput && PlanExecutor->IsExecutingPlan())
         {
@@ -112,26 +163,67 @@ bool UHTNComponent::GeneratePlan(const TArray<UHTNTask*>& GoalTasks)
         WorldState->SetOwner(GetOwner());
     }
 
-    //Create the execution context for this plan.
-    ExecutionContext = NewObject<UHTNExecutionContext>();
+    // Reuse the execution context for this plan, so replanning allocates no objects
+    if (!ExecutionContext)
+    {
+        ExecutionContext = NewObject<UHTNExecutionContext>(this);
+    }
+    ExecutionContext->Reset();
     ExecutionContext->SetWorldState(WorldState);
     
-    // Configure the planner
-    FHTNPlanningConfig PlanConfig;
-    PlanConfig.MaxSearchDepth = 20;
-    PlanConfig.PlanningTimeout = 0.5f;
-    PlanConfig.bDetailedDebugging = bDebugOutput;
+    // Don't repeat a search that already came up empty for this exact world state and goals
+    const uint32 RequestFingerprint = NegativePlanCacheSize > 0 ? GetPlanRequestFingerprint(GoalTasks) : 0;
+    if (NegativePlanCacheSize > 0 && NegativePlanCache.Contains(RequestFingerprint))
+    {
+        DebugMessage(TEXT("Skipping plan generation: Same request failed before"));
+        ConsecutivePlanFailures++;
+        BackOffReplanning(true);
+        return false;
+    }
     
-    // Generate the plan
-    FHTNPlannerResult PlanResult = Planner->GeneratePlan(WorldState, GoalTasks, PlanConfig);
+    // Agents in the same situation get the same plan, so reuse one found before or precomputed for the domain;
+    // fingerprints can collide, so a cached plan is only used if it is valid here. Cached plans are only their tasks,
+    // so a request that needs the decomposition always searches.
+    const FHTNPlanningConfig PlanConfig = GetPlanningConfig();
+    UHTNPlanCacheSubsystem* SharedPlanCache = bUseSharedPlanCache && !PlanConfig.bRecordDecomposition ? UHTNPlanCacheSubsystem::Get() : nullptr;
+    const uint32 SharedPlanFingerprint = SharedPlanCache ? UHTNPlanCacheSubsystem::GetRequestFingerprint(WorldState, GoalTasks) : 0;
+    FHTNPlannerResult& PlanResult = PlannerResult;
+    if (SharedPlanCache && SharedPlanCache->FindPlan(SharedPlanFingerprint, PlanResult.Plan) && Planner->ValidatePlan(PlanResult.Plan, WorldState))
+    {
+        // Finish the cached plan the way the planner finishes the plans it finds
+        if (PlanConfig.bInferTaskDependencies)
+        {
+            PlanResult.Plan.InferTaskDependencies();
+        }
+        
+        PlanResult.bSuccess = true;
+        PlanResult.FailReason = EHTNPlannerFailReason::None;
+        PlanResult.NodesExplored = 0;
+        PlanResult.PlansGenerated = 0;
+        PlanResult.MaxDepthReached = 0;
+        PlanResult.PlanningTime = 0.0f;
+        PlanResult.DebugInfo.Reset();
+        DebugMessage(TEXT("Using shared cached plan"));
+    }
+    else
+    {
+        // Generate the plan
+        Planner->GeneratePlanInto(WorldState, GoalTasks, PlanConfig, PlanResult);
+        if (SharedPlanCache && PlanResult.bSuccess)
+        {
+            SharedPlanCache->AddPlan(SharedPlanFingerprint, PlanResult.Plan);
+        }
+    }
     
     if (PlanResult.bSuccess)
     {
         // Save the goal tasks for potential replanning
         CurrentGoalTasks = GoalTasks;
         
-        // Reset failure counter on successful planning
+        // Reset failure counter and backoff on successful planning
         ConsecutivePlanFailures = 0;
+        ConsecutivePlanRepairs = 0;
+        NextReplanTime = 0.0f;
         
         DebugMessage(FString::Printf(TEXT("Plan generated successfully with %d tasks"), PlanResult.Plan.Tasks.Num()));
         
@@ -154,6 +246,19 @@ bool UHTNComponent::GeneratePlan(const TArray<UHTNTask*>& GoalTasks)
         // Increment failure counter
         ConsecutivePlanFailures++;
         
+        // Failures that are not down to the time budget will fail the same way for the same input
+        const bool bHopeless = PlanResult.FailReason != EHTNPlannerFailReason::Timeout &&
+            PlanResult.FailReason != EHTNPlannerFailReason::UnexpectedError;
+        if (bHopeless && NegativePlanCacheSize > 0)
+        {
+            if (NegativePlanCache.Num() >= NegativePlanCacheSize)
+            {
+                NegativePlanCache.RemoveAt(0, NegativePlanCache.Num() - NegativePlanCacheSize + 1);
+            }
+            NegativePlanCache.Add(RequestFingerprint);
+        }
+        BackOffReplanning(bHopeless);
+        
         // Handle plan failure if we've failed multiple times
         if (ConsecutivePlanFailures >= 3)
         {
@@ -176,6 +281,12 @@ bool UHTNComponent::IsPlanValid() const
         return false;
     }
     
+    // The executor only revalidates the steps affected by world state changes since the last check
+    if (PlanExecutor && PlanExecutor->IsExecutingPlan() && PlanExecutor->GetWorldState() == WorldState)
+    {
+        return PlanExecutor->ValidateRemainingPlan();
+    }
+    
     if (!Planner)
     {
         return false;
@@ -192,6 +303,12 @@ bool UHTNComponent::TryReplan(const TArray<UHTNTask*>& GoalTasks)
         return true;
     }
     
+    // After a task failure, try to fix only the part of the plan around it
+    if (RepairFailedPlan())
+    {
+        return true;
+    }
+    
     // Otherwise, generate a new plan
     return GeneratePlan(GoalTasks);
 }
@@ -208,6 +325,13 @@ UHTNWorldState* UHTNComponent::GetWorldState() const
 
 void UHTNComponent::SetWorldState(UHTNWorldState* InWorldState)
 {
+    // Sensors follow the world state they write to
+    const bool bMoveSensors = HasBegunPlay() && InWorldState != WorldState;
+    if (bMoveSensors)
+    {
+        UnregisterSensors();
+    }
+    
     WorldState = InWorldState;
     
     // Make sure the world state has the owner set
@@ -215,12 +339,18 @@ void UHTNComponent::SetWorldState(UHTNWorldState* InWorldState)
     {
         WorldState->SetOwner(GetOwner());
     }
+    AttachSharedWorldStateLayers();
     
     // Update the execution context
     if (WorldState && ExecutionContext)
     {
         ExecutionContext->SetWorldState(WorldState);
     }
+    
+    if (bMoveSensors)
+    {
+        RegisterSensors();
+    }
 }
 
 const FHTNPlan& UHTNComponent::GetCurrentPlan() const
@@ -302,6 +432,176 @@ FString UHTNComponent::GetDebugInfo() const
     return Result;
 }
 
+void UHTNComponent::AttachSharedWorldStateLayers()
+{
+    if (!bUseSharedWorldStateLayers || !WorldState || WorldState->GetParentLayer())
+    {
+        return;
+    }
+    
+    if (UHTNWorldStateLayerSubsystem* Layers = UHTNWorldStateLayerSubsystem::Get(this))
+    {
+        // Agents write shared facts where they are stored, so every agent sees the update
+        WorldState->SetParentLayer(Layers->GetSquadLayer(SquadName), true);
+    }
+}
+
+void UHTNComponent::RegisterSensors()
+{
+    UHTNSensorScheduler* Scheduler = UHTNSensorScheduler::Get(this);
+    if (!Scheduler || !WorldState)
+    {
+        return;
+    }
+    
+    for (UHTNSensor* Sensor : Sensors)
+    {
+        if (Sensor && !Scheduler->RegisterSensor(Sensor, WorldState, GetOwner()))
+        {
+            DebugMessage(FString::Printf(TEXT("Failed to register sensor: %s"), *Sensor->GetDescription()));
+        }
+    }
+}
+
+void UHTNComponent::UnregisterSensors()
+{
+    if (UHTNSensorScheduler* Scheduler = UHTNSensorScheduler::Get(this))
+    {
+        if (WorldState)
+        {
+            Scheduler->UnregisterSensors(WorldState);
+        }
+    }
+}
+
+void UHTNComponent::UpdateKeySubscriptions()
+{
+    ClearKeySubscriptions();
+    
+    SubscribedExecutionId = PlanExecutor && PlanExecutor->IsExecutingPlan() ? PlanExecutor->GetPlanExecutionId() : 0;
+    SubscribedWorldState = WorldState;
+    if (!WorldState)
+    {
+        return;
+    }
+    
+    // The goals cover every condition a new plan depends on, the remaining plan covers plans started without goals
+    TSet<FName> ReadKeys;
+    TSet<const UHTNTask*> VisitedTasks;
+    bool bKeysKnown = true;
+    
+    for (const UHTNTask* GoalTask : CurrentGoalTasks)
+    {
+        bKeysKnown &= GatherTaskReadKeys(GoalTask, VisitedTasks, ReadKeys);
+    }
+    
+    if (SubscribedExecutionId != 0)
+    {
+        for (const UHTNPrimitiveTask* PlanTask : PlanExecutor->GetCurrentPlan().Tasks)
+        {
+            bKeysKnown &= GatherTaskReadKeys(PlanTask, VisitedTasks, ReadKeys);
+        }
+    }
+    
+    // Shared facts change in the layer that holds them, so watch every layer
+    bWatchingAllKeys = !bKeysKnown;
+    for (UHTNWorldState* Layer = WorldState; Layer; Layer = Layer->GetParentLayer())
+    {
+        if (bWatchingAllKeys)
+        {
+            KeySubscriptions.Add({ Layer, NAME_None, Layer->OnAnyKeyChanged().AddUObject(this, &UHTNComponent::OnWatchedKeyChanged) });
+            continue;
+        }
+        
+        for (const FName& Key : ReadKeys)
+        {
+            KeySubscriptions.Add({ Layer, Key, Layer->OnKeyChanged(Key).AddUObject(this, &UHTNComponent::OnWatchedKeyChanged) });
+        }
+    }
+}
+
+void UHTNComponent::ClearKeySubscriptions()
+{
+    for (const FKeySubscription& Subscription : KeySubscriptions)
+    {
+        if (UHTNWorldState* Layer = Subscription.Layer.Get())
+        {
+            FHTNWorldStateKeyChangedDelegate& Delegate = Subscription.Key.IsNone() ? Layer->OnAnyKeyChanged() : Layer->OnKeyChanged(Subscription.Key);
+            Delegate.Remove(Subscription.Handle);
+        }
+    }
+    
+    KeySubscriptions.Reset();
+    bWatchingAllKeys = false;
+    SubscribedWorldState.Reset();
+    SubscribedExecutionId = 0;
+}
+
+void UHTNComponent::OnWatchedKeyChanged(FName Key)
+{
+    bReplanRequested = true;
+    
+    // A change to a key the goals read may have made planning possible again, so start the backoff over;
+    // any-key subscriptions can't tell
+    if (!bWatchingAllKeys)
+    {
+        NextReplanTime = 0.0f;
+        ConsecutivePlanFailures = 0;
+    }
+}
+
+bool UHTNComponent::GatherTaskReadKeys(const UHTNTask* Task, TSet<const UHTNTask*>& VisitedTasks, TSet<FName>& OutKeys)
+{
+    bool bAlreadyVisited = false;
+    VisitedTasks.Add(Task, &bAlreadyVisited);
+    if (!Task || bAlreadyVisited)
+    {
+        return true;
+    }
+    
+    TArray<FName> Keys;
+    bool bKeysKnown = true;
+    
+    if (const UHTNPrimitiveTask* PrimitiveTask = Cast<UHTNPrimitiveTask>(Task))
+    {
+        bKeysKnown = PrimitiveTask->GetPreconditionReadKeys(Keys);
+        
+        // Effects that copy other keys pass those keys on to the conditions of later steps
+        bKeysKnown &= PrimitiveTask->GetEffectReadKeys(Keys);
+    }
+    else if (const UHTNCompoundTask* CompoundTask = Cast<UHTNCompoundTask>(Task))
+    {
+        for (const UHTNMethod* Method : CompoundTask->GetMethods())
+        {
+            if (!Method)
+            {
+                continue;
+            }
+            
+            for (const UHTNCondition* Condition : Method->Conditions)
+            {
+                if (Condition)
+                {
+                    bKeysKnown &= Condition->GetReadKeys(Keys);
+                }
+            }
+            
+            for (const UHTNTask* Subtask : Method->GetSubtasks())
+            {
+                bKeysKnown &= GatherTaskReadKeys(Subtask, VisitedTasks, OutKeys);
+            }
+        }
+    }
+    else
+    {
+        // Other task types decide applicability in ways we cannot see
+        bKeysKnown = false;
+    }
+    
+    OutKeys.Append(Keys);
+    return bKeysKnown;
+}
+
 void UHTNComponent::Initialize()
 {
     // Create a world state if we don't have one
@@ -316,6 +616,7 @@ void UHTNComponent::Initialize()
         // Ensure owner is set
         WorldState->SetOwner(GetOwner());
     }
+    AttachSharedWorldStateLayers();
     
     // Set up the execution context
     if (!ExecutionContext)
@@ -383,12 +684,132 @@ bool UHTNComponent::AutoReplan()
 void UHTNComponent::SetAutoReplanEnabled(bool bEnable, float CheckInterval)
 {
     bAutoReplanEnabled = bEnable;
-    ReplanCheckInterval = FMath::Max(0.1f, CheckInterval); // Minimum interval of 0.1 seconds
+    ReplanCheckInterval = FMath::Max(0.0f, CheckInterval);
+    
+    // Changes made while disabled were not watched, so check once on enabling
+    if (bEnable)
+    {
+        bReplanRequested = true;
+    }
+    else
+    {
+        ClearKeySubscriptions();
+    }
     
     DebugMessage(FString::Printf(TEXT("Auto-replanning %s (interval: %.2f seconds)"), 
         bEnable ? TEXT("enabled") : TEXT("disabled"), ReplanCheckInterval));
 }
 
+bool UHTNComponent::PlanAhead()
+{
+    if (!PlanExecutor || !PlanExecutor->IsExecutingPlan() || !Planner || CurrentGoalTasks.Num() == 0)
+    {
+        return false;
+    }
+    
+    const FHTNWorldStateSnapshot* PredictedFinalState = PlanExecutor->GetPredictedFinalWorldState();
+    if (!PredictedFinalState)
+    {
+        return false;
+    }
+    
+    // Attempt once per plan, whether or not planning succeeds
+    PlannedAheadExecutionId = PlanExecutor->GetPlanExecutionId();
+    
+    if (!PlanAheadWorldState)
+    {
+        PlanAheadWorldState = NewObject<UHTNWorldState>(this);
+    }
+    FHTNWorldStateStruct PredictedState(GetOwner(), TMap<FName, FHTNProperty>());
+    PredictedFinalState->ToWorldState(PredictedState);
+    PlanAheadWorldState->SetWorldState(PredictedState);
+    
+    FHTNPlannerResult& PlanResult = PlannerResult;
+    if (!Planner->GeneratePlanInto(PlanAheadWorldState, CurrentGoalTasks, GetPlanningConfig(), PlanResult))
+    {
+        DebugMessage(TEXT("Could not plan ahead from the predicted end state, will replan when the plan ends"));
+        return false;
+    }
+    
+    DebugMessage(FString::Printf(TEXT("Planned ahead: follow-up plan with %d tasks queued"), PlanResult.Plan.Tasks.Num()));
+    return PlanExecutor->QueueNextPlan(PlanResult.Plan);
+}
+
+FHTNPlanningConfig UHTNComponent::GetPlanningConfig() const
+{
+    FHTNPlanningConfig PlanConfig;
+    PlanConfig.MaxSearchDepth = 20;
+    PlanConfig.PlanningTimeout = 0.5f;
+    PlanConfig.bDetailedDebugging = bDebugOutput;
+    PlanConfig.bRecordDecomposition = MaxConsecutivePlanRepairs > 0;
+    PlanConfig.bInferTaskDependencies = PlanExecutor && PlanExecutor->GetExecutionMode() == EHTNPlanExecutorMode::DependencyBased;
+    return PlanConfig;
+}
+
+bool UHTNComponent::RepairFailedPlan()
+{
+    if (!Planner || !PlanExecutor || !WorldState || !ExecutionContext || PlanExecutor->IsExecutingPlan() ||
+        ConsecutivePlanRepairs >= MaxConsecutivePlanRepairs)
+    {
+        return false;
+    }
+    
+    // The executor keeps the aborted plan and which of its tasks failed; outside of sequential execution,
+    // that isn't the plan's current task
+    const FHTNPlan& FailedPlan = PlanExecutor->GetCurrentPlan();
+    const int32 FailedTaskIndex = PlanExecutor->GetFailedTaskIndex();
+    if (!FailedPlan.bFailed || FailedPlan.Decomposition.Num() == 0 || !FailedPlan.Tasks.IsValidIndex(FailedTaskIndex))
+    {
+        return false;
+    }
+    
+    FHTNPlannerResult& PlanResult = PlannerResult;
+    if (!Planner->RepairPlan(FailedPlan, FailedTaskIndex, WorldState, GetPlanningConfig(), PlanResult, PlanExecutor->GetSucceededTaskIndices()))
+    {
+        DebugMessage(TEXT("Could not repair the failed plan, replanning from the goals"));
+        return false;
+    }
+    
+    ConsecutivePlanRepairs++;
+    DebugMessage(FString::Printf(TEXT("Repaired plan at task %d, %d tasks remaining"), FailedTaskIndex, PlanResult.Plan.Tasks.Num() - FailedTaskIndex));
+    
+    // Execution starts at the first task, so only hand over the tasks that haven't run yet; the repair already
+    // left out the ones that ran after the failed task
+    ExecutionContext->Reset();
+    ExecutionContext->SetWorldState(WorldState);
+    return PlanExecutor->StartPlan(PlanResult.Plan.ExtractSubplan(FailedTaskIndex, PlanResult.Plan.Tasks.Num() - 1), ExecutionContext, GetOwner());
+}
+
+uint32 UHTNComponent::GetPlanRequestFingerprint(const TArray<UHTNTask*>& GoalTasks) const
+{
+    uint32 Fingerprint = WorldState ? WorldState->GetFingerprint() : 0;
+    for (const UHTNTask* GoalTask : GoalTasks)
+    {
+        Fingerprint = HashCombine(Fingerprint, GetTypeHash(GoalTask));
+    }
+    return Fingerprint;
+}
+
+void UHTNComponent::BackOffReplanning(bool bHopeless)
+{
+    const UWorld* World = GetWorld();
+    if (!World || ReplanBackoffDelay <= 0.0f)
+    {
+        return;
+    }
+    
+    const float Delay = FMath::Min(ReplanBackoffDelay * FMath::Pow(ReplanBackoffMultiplier, static_cast<float>(FMath::Max(ConsecutivePlanFailures - 1, 0))), MaxReplanBackoffDelay);
+    NextReplanTime = World->GetTimeSeconds() + Delay;
+    
+    // A hopeless request is only worth retrying once a watched key changes; otherwise retry when the delay is up
+    if (!bHopeless && bAutoReplanEnabled)
+    {
+        bReplanRequested = true;
+    }
+    
+    DebugMessage(FString::Printf(TEXT("Backing off replanning for %.2f seconds"), Delay));
+}
+
 void UHTNComponent::HandlePlanFailure()
 {
     // Log the failure
@@ -0,0 +1,503 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNCrowdSubsystem.h"
+
+#include "Async/ParallelFor.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HTNComponent.h"
+#include "HTNDFSPlanner.h"
+#include "HTNExecutionContext.h"
+#include "HTNLogging.h"
+#include "HTNWorldStateStruct.h"
+#include "Tasks/HTNPrimitiveTask.h"
+
+int32 FHTNCrowdDomain::FindOrAddTask(UHTNPrimitiveTask* Task)
+{
+    if (const uint16* ExistingIndex = TaskIndices.Find(Task))
+    {
+        return *ExistingIndex;
+    }
+    
+    if (Tasks.Num() > MAX_uint16)
+    {
+        return INDEX_NONE;
+    }
+    
+    const uint16 NewIndex = static_cast<uint16>(Tasks.Add(Task));
+    TaskIndices.Add(Task, NewIndex);
+    return NewIndex;
+}
+
+UHTNCrowdSubsystem::UHTNCrowdSubsystem()
+    : ChunkSize(64)
+    , MaxPlansPerTick(64)
+    , ReplanDelay(1.0f)
+    , bBatchPlanning(true)
+    , Planner(nullptr)
+    , AdapterWorldState(nullptr)
+    , AdapterContext(nullptr)
+{
+}
+
+void UHTNCrowdSubsystem::Deinitialize()
+{
+    for (int32 AgentIndex = 0; AgentIndex < AgentDomains.Num(); ++AgentIndex)
+    {
+        if (AgentDomains[AgentIndex] != INDEX_NONE)
+        {
+            StopCurrentTask(AgentIndex);
+        }
+    }
+    
+    Super::Deinitialize();
+}
+
+void UHTNCrowdSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+    
+    if (NumAgents == 0)
+    {
+        return;
+    }
+    
+    PlanAgents(DeltaTime);
+    ExecuteAgents(DeltaTime);
+}
+
+TStatId UHTNCrowdSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UHTNCrowdSubsystem, STATGROUP_Tickables);
+}
+
+UHTNCrowdSubsystem* UHTNCrowdSubsystem::Get(const UObject* WorldContextObject)
+{
+    const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+    return World ? World->GetSubsystem<UHTNCrowdSubsystem>() : nullptr;
+}
+
+int32 UHTNCrowdSubsystem::RegisterDomain(const TArray<UHTNTask*>& GoalTasks)
+{
+    FHTNCrowdDomain& Domain = Domains.AddDefaulted_GetRef();
+    Domain.GoalTasks = GoalTasks;
+    
+    TSet<const UHTNTask*> VisitedTasks;
+    TSet<FName> ReadKeys;
+    bool bKeysKnown = true;
+    for (const UHTNTask* GoalTask : GoalTasks)
+    {
+        bKeysKnown &= UHTNComponent::GatherTaskReadKeys(GoalTask, VisitedTasks, ReadKeys);
+    }
+    
+    // Sorted, so fingerprints don't depend on set order
+    Domain.ReadKeys = ReadKeys.Array();
+    Domain.ReadKeys.Sort(FNameLexicalLess());
+    Domain.bReadsAnyKey = !bKeysKnown;
+    Domain.TaskIndex.AddDomain(GoalTasks);
+    return Domains.Num() - 1;
+}
+
+FHTNCrowdAgentHandle UHTNCrowdSubsystem::AddAgent(int32 DomainIndex, const UHTNWorldState* InitialWorldState, AActor* Owner)
+{
+    if (!Domains.IsValidIndex(DomainIndex))
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNCrowdSubsystem: Cannot add an agent to unknown domain %d"), DomainIndex);
+        return FHTNCrowdAgentHandle();
+    }
+    
+    int32 AgentIndex;
+    if (FreeIndices.Num() > 0)
+    {
+        AgentIndex = FreeIndices.Pop();
+    }
+    else
+    {
+        AgentIndex = AgentDomains.Add(INDEX_NONE);
+        AgentSerials.Add(0);
+        AgentOwners.AddDefaulted();
+        Plans.AddDefaulted();
+        Executions.AddDefaulted();
+        WorldStates.SetNumAgents(AgentDomains.Num());
+    }
+    
+    AgentDomains[AgentIndex] = DomainIndex;
+    AgentOwners[AgentIndex] = Owner;
+    Plans[AgentIndex] = FHTNCrowdPlanFragment();
+    Executions[AgentIndex] = FHTNCrowdExecutionFragment();
+    WorldStates.CopyFromWorldState(AgentIndex, InitialWorldState);
+    ++NumAgents;
+    
+    FHTNCrowdAgentHandle Handle;
+    Handle.Index = AgentIndex;
+    Handle.Serial = AgentSerials[AgentIndex];
+    return Handle;
+}
+
+void UHTNCrowdSubsystem::RemoveAgent(FHTNCrowdAgentHandle Agent)
+{
+    if (!IsValidAgent(Agent))
+    {
+        return;
+    }
+    
+    StopCurrentTask(Agent.Index);
+    WorldStates.CopyFromWorldState(Agent.Index, nullptr);
+    AgentDomains[Agent.Index] = INDEX_NONE;
+    AgentOwners[Agent.Index].Reset();
+    Plans[Agent.Index] = FHTNCrowdPlanFragment();
+    ++AgentSerials[Agent.Index];
+    FreeIndices.Add(Agent.Index);
+    --NumAgents;
+}
+
+bool UHTNCrowdSubsystem::IsValidAgent(FHTNCrowdAgentHandle Agent) const
+{
+    return AgentDomains.IsValidIndex(Agent.Index) && AgentDomains[Agent.Index] != INDEX_NONE && AgentSerials[Agent.Index] == Agent.Serial;
+}
+
+const FHTNCrowdPlanFragment* UHTNCrowdSubsystem::GetPlan(FHTNCrowdAgentHandle Agent) const
+{
+    return IsValidAgent(Agent) ? &Plans[Agent.Index] : nullptr;
+}
+
+void UHTNCrowdSubsystem::ResetPlan(FHTNCrowdAgentHandle Agent)
+{
+    if (IsValidAgent(Agent))
+    {
+        StopCurrentTask(Agent.Index);
+        Plans[Agent.Index] = FHTNCrowdPlanFragment();
+        Executions[Agent.Index].PlanCooldown = 0.0f;
+    }
+}
+
+void UHTNCrowdSubsystem::PlanAgents(float DeltaTime)
+{
+    const int32 NumRows = AgentDomains.Num();
+    const int32 PlanBudget = MaxPlansPerTick > 0 ? MaxPlansPerTick : NumRows;
+    int32 NumPlanned = 0;
+    
+    for (int32 AgentIndex = 0; AgentIndex < NumRows; ++AgentIndex)
+    {
+        if (AgentDomains[AgentIndex] != INDEX_NONE)
+        {
+            float& Cooldown = Executions[AgentIndex].PlanCooldown;
+            Cooldown = FMath::Max(Cooldown - DeltaTime, 0.0f);
+        }
+    }
+    
+    if (!bBatchPlanning)
+    {
+        // Round robin, so agents beyond the budget get their turn on the next ticks
+        for (int32 Offset = 0; Offset < NumRows && NumPlanned < PlanBudget; ++Offset)
+        {
+            const int32 AgentIndex = (NextPlanIndex + Offset) % NumRows;
+            if (AgentDomains[AgentIndex] == INDEX_NONE || Plans[AgentIndex].HasPlan() || Executions[AgentIndex].PlanCooldown > 0.0f)
+            {
+                continue;
+            }
+            
+            PlanAgent(AgentIndex);
+            ++NumPlanned;
+            NextPlanIndex = (AgentIndex + 1) % NumRows;
+        }
+        return;
+    }
+    
+    // Group every waiting agent by domain and the values its domain reads; each group costs one planner run
+    TMap<TPair<int32, uint32>, TArray<int32>> Groups;
+    TArray<TPair<int32, uint32>> GroupOrder;
+    for (int32 Offset = 0; Offset < NumRows; ++Offset)
+    {
+        const int32 AgentIndex = (NextPlanIndex + Offset) % NumRows;
+        const int32 DomainIndex = AgentDomains[AgentIndex];
+        if (DomainIndex == INDEX_NONE || Plans[AgentIndex].HasPlan() || Executions[AgentIndex].PlanCooldown > 0.0f)
+        {
+            continue;
+        }
+        
+        // Agents whose domain may read anything get a group of their own
+        const FHTNCrowdDomain& Domain = Domains[DomainIndex];
+        const uint32 Fingerprint = Domain.bReadsAnyKey ? static_cast<uint32>(AgentIndex) : WorldStates.GetFingerprint(AgentIndex, Domain.ReadKeys);
+        const TPair<int32, uint32> GroupKey(Domain.bReadsAnyKey ? -1 - DomainIndex : DomainIndex, Fingerprint);
+        
+        TArray<int32>* Group = Groups.Find(GroupKey);
+        if (!Group)
+        {
+            if (GroupOrder.Num() >= PlanBudget)
+            {
+                continue;
+            }
+            GroupOrder.Add(GroupKey);
+            Group = &Groups.Add(GroupKey);
+        }
+        Group->Add(AgentIndex);
+    }
+    
+    for (const TPair<int32, uint32>& GroupKey : GroupOrder)
+    {
+        TArray<int32>& Group = Groups[GroupKey];
+        NextPlanIndex = (Group.Last() + 1) % NumRows;
+        
+        // Fingerprints can collide; agents that don't really match wait for a later tick
+        const FHTNCrowdDomain& Domain = Domains[AgentDomains[Group[0]]];
+        for (int32 MemberIndex = Group.Num() - 1; MemberIndex > 0; --MemberIndex)
+        {
+            if (!WorldStates.HasEqualProperties(Group[0], Group[MemberIndex], Domain.ReadKeys))
+            {
+                Group.RemoveAtSwap(MemberIndex);
+            }
+        }
+        
+        PlanAgentGroup(Group);
+    }
+}
+
+void UHTNCrowdSubsystem::PlanAgentGroup(TConstArrayView<int32> AgentIndices)
+{
+    if (AgentIndices.Num() == 0)
+    {
+        return;
+    }
+    
+    const int32 LeaderIndex = AgentIndices[0];
+    PlanAgent(LeaderIndex);
+    
+    // Plans hold no agent data: owners and world states are bound per agent when the steps run
+    for (int32 MemberIndex = 1; MemberIndex < AgentIndices.Num(); ++MemberIndex)
+    {
+        const int32 AgentIndex = AgentIndices[MemberIndex];
+        Plans[AgentIndex] = Plans[LeaderIndex];
+        Executions[AgentIndex].PlanCooldown = Executions[LeaderIndex].PlanCooldown;
+    }
+}
+
+void UHTNCrowdSubsystem::PlanAgent(int32 AgentIndex)
+{
+    if (!Planner)
+    {
+        Planner = NewObject<UHTNDFSPlanner>(this);
+    }
+    
+    FHTNCrowdDomain& Domain = Domains[AgentDomains[AgentIndex]];
+    FHTNCrowdPlanFragment& Plan = Plans[AgentIndex];
+    Plan = FHTNCrowdPlanFragment();
+    
+    LoadAdapter(AgentIndex);
+    if (Planner->GeneratePlanInto(AdapterWorldState, Domain.GoalTasks, PlanningConfig, PlannerResult))
+    {
+        Plan.TaskIndices.Reserve(PlannerResult.Plan.Tasks.Num());
+        for (UHTNPrimitiveTask* Task : PlannerResult.Plan.Tasks)
+        {
+            const int32 TaskIndex = Task ? Domain.FindOrAddTask(Task) : INDEX_NONE;
+            if (TaskIndex == INDEX_NONE)
+            {
+                Plan.TaskIndices.Reset();
+                break;
+            }
+            Plan.TaskIndices.Add(static_cast<uint16>(TaskIndex));
+        }
+    }
+    
+    if (Plan.TaskIndices.Num() > 0)
+    {
+        Plan.CurrentStep = 0;
+    }
+    else
+    {
+        Executions[AgentIndex].PlanCooldown = ReplanDelay;
+    }
+}
+
+void UHTNCrowdSubsystem::ExecuteAgents(float DeltaTime)
+{
+    const int32 NumRows = AgentDomains.Num();
+    const int32 EffectiveChunkSize = FMath::Max(ChunkSize, 1);
+    const int32 NumChunks = FMath::DivideAndRoundUp(NumRows, EffectiveChunkSize);
+    
+    // Worker threads read world states through their own chunk's object, created here on the game thread
+    while (ChunkWorldStates.Num() < NumChunks)
+    {
+        ChunkWorldStates.Add(NewObject<UHTNWorldState>(this));
+    }
+    
+    // Thread-safe ticks of every chunk run in parallel; each only touches its own agents' fragments
+    ParallelFor(NumChunks, [this, DeltaTime, EffectiveChunkSize, NumRows](int32 ChunkIndex)
+    {
+        UHTNWorldState* ChunkWorldState = ChunkWorldStates[ChunkIndex];
+        const int32 EndIndex = FMath::Min((ChunkIndex + 1) * EffectiveChunkSize, NumRows);
+        for (int32 AgentIndex = ChunkIndex * EffectiveChunkSize; AgentIndex < EndIndex; ++AgentIndex)
+        {
+            FHTNCrowdExecutionFragment& Execution = Executions[AgentIndex];
+            Execution.PendingStatus = EHTNTaskStatus::Invalid;
+            
+            const UHTNPrimitiveTask* Task = GetCurrentTask(AgentIndex);
+            if (!Task || !Task->HasThreadSafeTick() || !Execution.bTaskStarted || Task->GetStatus(Execution.TaskMemory.GetData()) != EHTNTaskStatus::InProgress)
+            {
+                continue;
+            }
+            
+            WorldStates.CopyToWorldState(AgentIndex, ChunkWorldState);
+            Execution.PendingStatus = Task->TickTaskThreadSafe(ChunkWorldState, Execution.TaskMemory.GetData(), DeltaTime);
+        }
+    }, NumChunks < 2 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+    
+    // Everything else runs on the game thread, in agent order
+    for (int32 AgentIndex = 0; AgentIndex < NumRows; ++AgentIndex)
+    {
+        UHTNPrimitiveTask* Task = GetCurrentTask(AgentIndex);
+        if (!Task)
+        {
+            continue;
+        }
+        
+        FHTNCrowdExecutionFragment& Execution = Executions[AgentIndex];
+        uint8* TaskMemory = Execution.TaskMemory.GetData();
+        if (!Execution.bTaskStarted)
+        {
+            LoadAdapter(AgentIndex);
+            Execution.TaskMemory.SetNumUninitialized(Align(static_cast<int32>(Task->GetInstanceMemorySize()), 16));
+            TaskMemory = Execution.TaskMemory.GetData();
+            Task->InitializeMemory(TaskMemory);
+            Execution.bTaskStarted = true;
+            
+            // The agent's state may have changed since it planned, so a step only starts while it still applies
+            if (!Task->IsApplicable(AdapterWorldState) || !Task->Execute(AdapterContext, TaskMemory))
+            {
+                CompleteStep(AgentIndex, EHTNTaskStatus::Failed);
+            }
+            else if (Task->IsComplete(TaskMemory))
+            {
+                CompleteStep(AgentIndex, Task->GetStatus(TaskMemory));
+            }
+            else
+            {
+                StoreAdapter(AgentIndex);
+            }
+            continue;
+        }
+        
+        if (Task->GetStatus(TaskMemory) != EHTNTaskStatus::InProgress)
+        {
+            continue;
+        }
+        
+        EHTNTaskStatus NewStatus;
+        if (Task->HasThreadSafeTick())
+        {
+            NewStatus = Execution.PendingStatus;
+            if (NewStatus == EHTNTaskStatus::Invalid)
+            {
+                continue;
+            }
+            Task->SetStatus(TaskMemory, NewStatus);
+            if (NewStatus != EHTNTaskStatus::InProgress)
+            {
+                LoadAdapter(AgentIndex);
+            }
+        }
+        else
+        {
+            LoadAdapter(AgentIndex);
+            NewStatus = Task->Tick(AdapterContext, TaskMemory, DeltaTime);
+        }
+        
+        if (NewStatus != EHTNTaskStatus::InProgress)
+        {
+            CompleteStep(AgentIndex, NewStatus);
+        }
+        else if (!Task->HasThreadSafeTick())
+        {
+            StoreAdapter(AgentIndex);
+        }
+    }
+}
+
+void UHTNCrowdSubsystem::CompleteStep(int32 AgentIndex, EHTNTaskStatus Status)
+{
+    UHTNPrimitiveTask* Task = GetCurrentTask(AgentIndex);
+    FHTNCrowdExecutionFragment& Execution = Executions[AgentIndex];
+    uint8* TaskMemory = Execution.TaskMemory.GetData();
+    
+    // Finishing applies the task's effects to the adapter world state on success
+    Task->Finish(AdapterContext, TaskMemory, Status);
+    Task->SetStatus(TaskMemory, Status);
+    StoreAdapter(AgentIndex);
+    
+    Task->CleanupMemory(TaskMemory);
+    Execution.TaskMemory.Reset();
+    Execution.bTaskStarted = false;
+    
+    // Finished and failed plans alike are dropped; the agent plans again on a later tick, after a delay on failure
+    FHTNCrowdPlanFragment& Plan = Plans[AgentIndex];
+    if (Status == EHTNTaskStatus::Succeeded)
+    {
+        ++Plan.CurrentStep;
+        if (!Plan.HasPlan())
+        {
+            Plan = FHTNCrowdPlanFragment();
+        }
+    }
+    else
+    {
+        Plan = FHTNCrowdPlanFragment();
+        Execution.PlanCooldown = ReplanDelay;
+    }
+}
+
+void UHTNCrowdSubsystem::StopCurrentTask(int32 AgentIndex)
+{
+    UHTNPrimitiveTask* Task = GetCurrentTask(AgentIndex);
+    FHTNCrowdExecutionFragment& Execution = Executions[AgentIndex];
+    if (!Task || !Execution.bTaskStarted)
+    {
+        return;
+    }
+    
+    LoadAdapter(AgentIndex);
+    Task->AbortTask(AdapterContext, Execution.TaskMemory.GetData());
+    StoreAdapter(AgentIndex);
+    
+    Task->CleanupMemory(Execution.TaskMemory.GetData());
+    Execution.TaskMemory.Reset();
+    Execution.bTaskStarted = false;
+}
+
+void UHTNCrowdSubsystem::LoadAdapter(int32 AgentIndex)
+{
+    if (!AdapterWorldState)
+    {
+        AdapterWorldState = NewObject<UHTNWorldState>(this);
+        AdapterContext = NewObject<UHTNExecutionContext>(this);
+    }
+    
+    AdapterWorldState->SetOwner(AgentOwners[AgentIndex].Get());
+    WorldStates.CopyToWorldState(AgentIndex, AdapterWorldState);
+    LoadedAdapterVersion = AdapterWorldState->GetVersion();
+    
+    AdapterContext->Reset();
+    AdapterContext->SetWorldState(AdapterWorldState);
+}
+
+void UHTNCrowdSubsystem::StoreAdapter(int32 AgentIndex)
+{
+    if (AdapterWorldState && AdapterWorldState->GetVersion() != LoadedAdapterVersion)
+    {
+        WorldStates.CopyFromWorldState(AgentIndex, AdapterWorldState);
+        LoadedAdapterVersion = AdapterWorldState->GetVersion();
+    }
+}
+
+UHTNPrimitiveTask* UHTNCrowdSubsystem::GetCurrentTask(int32 AgentIndex) const
+{
+    const int32 DomainIndex = AgentDomains[AgentIndex];
+    const FHTNCrowdPlanFragment& Plan = Plans[AgentIndex];
+    if (DomainIndex == INDEX_NONE || !Plan.HasPlan())
+    {
+        return nullptr;
+    }
+    
+    const TArray<UHTNPrimitiveTask*>& Tasks = Domains[DomainIndex].Tasks;
+    const uint16 TaskIndex = Plan.TaskIndices[Plan.CurrentStep];
+    return Tasks.IsValidIndex(TaskIndex) ? Tasks[TaskIndex] : nullptr;
+}
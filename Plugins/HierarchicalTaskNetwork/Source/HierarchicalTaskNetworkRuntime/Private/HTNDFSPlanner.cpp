@@ -3,6 +3,7 @@
 #include "HTNDFSPlanner.h"
 
 #include "Tasks/HTNCompoundTask.h"
+#include "Conditions/HTNCondition.h"
 #include "HTNLogging.h"
 #include "HTNWorldStateStruct.h"
 
@@ -21,43 +22,53 @@ FHTNPlannerResult UHTNDFSPlanner::GeneratePlan(
     const UHTNWorldState* WorldState,
     const TArray<UHTNTask*>& GoalTasks,
     const FHTNPlanningConfig& Config)
+{
+    FHTNPlannerResult Result;
+    GeneratePlanInto(WorldState, GoalTasks, Config, Result);
+    return Result;
+}
+
+bool UHTNDFSPlanner::GeneratePlanInto(
+    const UHTNWorldState* WorldState,
+    const TArray<UHTNTask*>& GoalTasks,
+    const FHTNPlanningConfig& Config,
+    FHTNPlannerResult& OutResult)
 {
     // Start with empty plan
-    FHTNPlan ResultPlan;
+    OutResult.Plan = FHTNPlan();
     
     // Validate inputs
     if (!WorldState)
     {
         UE_LOG(LogHTNPlannerPlugin, Error, TEXT("HTNDFSPlanner: Invalid world state provided"));
-        return CreatePlannerResult(false, ResultPlan, EHTNPlannerFailReason::UnexpectedError);
+        return FillPlannerResult(false, EHTNPlannerFailReason::UnexpectedError, OutResult);
     }
     
     if (GoalTasks.Num() == 0)
     {
         UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNDFSPlanner: No goal tasks provided"));
-        return CreatePlannerResult(true, ResultPlan, EHTNPlannerFailReason::None);
+        return FillPlannerResult(true, EHTNPlannerFailReason::None, OutResult);
     }
     
     // Set up configuration and metrics
     Configuration = Config;
     Metrics.Reset();
+    Trace.Reset();
     
     if (Configuration.bDetailedDebugging)
     {
         UE_LOG(LogHTNPlannerPlugin, Log, TEXT("HTNDFSPlanner: Starting plan generation for %d goal tasks"), GoalTasks.Num());
-        Metrics.AppendDebugInfo(FString::Printf(TEXT("Starting plan generation for %d goal tasks"), GoalTasks.Num()), Configuration.bDetailedDebugging);
-        Metrics.AppendDebugInfo(TEXT("Initial world state:"), Configuration.bDetailedDebugging);
-        Metrics.AppendDebugInfo(WorldState->ToString(), Configuration.bDetailedDebugging);
     }
     
-    // Clone the world state to avoid modifying the original
-    UHTNWorldState* WorkingState = WorldState->Clone();
+    // Copy the world state to avoid modifying the original
+    UHTNWorldState* WorkingState = GetWorkingState(0, WorldState);
     
-    // Set up empty plan
-    TArray<UHTNPrimitiveTask*> CurrentPlan;
+    // Start from an empty plan, with the goal tasks as the roots of the decomposition tree
+    DecompositionTrail.Reset();
+    BeginSearch(GoalTasks, INDEX_NONE, TArray<UHTNPrimitiveTask*>());
     
     // Start recursive search
-    bool bSuccess = FindPlanDFS(WorkingState, GoalTasks, CurrentPlan, 0, ResultPlan);
+    bool bSuccess = FindPlanDFS(WorkingState, 0, OutResult.Plan);
     
     // Finalize metrics
     Metrics.Finish();
@@ -66,13 +77,10 @@ FHTNPlannerResult UHTNDFSPlanner::GeneratePlan(
     {
         if (Configuration.bDetailedDebugging)
         {
-            UE_LOG(LogHTNPlannerPlugin, Log, TEXT("HTNDFSPlanner: Plan generation successful with %d tasks"), ResultPlan.Tasks.Num());
-            Metrics.AppendDebugInfo(FString::Printf(TEXT("Plan generation successful with %d tasks"), ResultPlan.Tasks.Num()), Configuration.bDetailedDebugging);
-            Metrics.AppendDebugInfo(TEXT("Final plan:"), Configuration.bDetailedDebugging);
-            Metrics.AppendDebugInfo(ResultPlan.ToString(), Configuration.bDetailedDebugging);
+            UE_LOG(LogHTNPlannerPlugin, Log, TEXT("HTNDFSPlanner: Plan generation successful with %d tasks"), OutResult.Plan.Tasks.Num());
         }
         
-        return CreatePlannerResult(true, ResultPlan, EHTNPlannerFailReason::None);
+        return FillPlannerResult(true, EHTNPlannerFailReason::None, OutResult);
     }
     else
     {
@@ -94,11 +102,9 @@ FHTNPlannerResult UHTNDFSPlanner::GeneratePlan(
         {
             UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNDFSPlanner: Plan generation failed: %s"), 
                    *StaticEnum<EHTNPlannerFailReason>()->GetNameStringByValue(static_cast<int64>(FailReason)));
-            Metrics.AppendDebugInfo(FString::Printf(TEXT("Plan generation failed: %s"), 
-                   *StaticEnum<EHTNPlannerFailReason>()->GetNameStringByValue(static_cast<int64>(FailReason))), Configuration.bDetailedDebugging);
         }
         
-        return CreatePlannerResult(false, ResultPlan, FailReason);
+        return FillPlannerResult(false, FailReason, OutResult);
     }
 }
 
@@ -120,7 +126,7 @@ bool UHTNDFSPlanner::ValidatePlan(
     }
     
     // Create a working copy of the world state
-    UHTNWorldState* WorkingState = WorldState->Clone();
+    UHTNWorldState* WorkingState = GetWorkingState(0, WorldState);
     
     // Check each task in sequence
     for (UHTNPrimitiveTask* Task : Plan.Tasks)
@@ -158,35 +164,37 @@ FHTNPlannerResult UHTNDFSPlanner::GeneratePartialPlan(
     const FHTNPlanningConfig& Config)
 {
     // Start with the existing plan
-    FHTNPlan ResultPlan = ExistingPlan;
+    FHTNPlannerResult Result;
+    Result.Plan = ExistingPlan;
     
     // Validate inputs
     if (!WorldState)
     {
         UE_LOG(LogHTNPlannerPlugin, Error, TEXT("HTNDFSPlanner: Invalid world state provided for partial planning"));
-        return CreatePlannerResult(false, ResultPlan, EHTNPlannerFailReason::UnexpectedError);
+        FillPlannerResult(false, EHTNPlannerFailReason::UnexpectedError, Result);
+        return Result;
     }
     
     if (GoalTasks.Num() == 0)
     {
         UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNDFSPlanner: No goal tasks provided for partial planning"));
-        return CreatePlannerResult(true, ResultPlan, EHTNPlannerFailReason::None);
+        FillPlannerResult(true, EHTNPlannerFailReason::None, Result);
+        return Result;
     }
     
     // Set up configuration and metrics
     Configuration = Config;
     Metrics.Reset();
+    Trace.Reset();
     
     if (Configuration.bDetailedDebugging)
     {
         UE_LOG(LogHTNPlannerPlugin, Log, TEXT("HTNDFSPlanner: Starting partial plan generation from existing plan with %d tasks"), 
                ExistingPlan.Tasks.Num());
-        Metrics.AppendDebugInfo(FString::Printf(TEXT("Starting partial plan generation from existing plan with %d tasks"), 
-               ExistingPlan.Tasks.Num()), Configuration.bDetailedDebugging);
     }
     
-    // Clone the world state to avoid modifying the original
-    UHTNWorldState* WorkingState = WorldState->Clone();
+    // Copy the world state to avoid modifying the original
+    UHTNWorldState* WorkingState = GetWorkingState(0, WorldState);
     
     // Apply the effects of all tasks in the existing plan to get the updated world state
     for (UHTNPrimitiveTask* Task : ExistingPlan.Tasks)
@@ -197,11 +205,16 @@ FHTNPlannerResult UHTNDFSPlanner::GeneratePartialPlan(
         }
     }
     
-    // Set up current plan with existing tasks
-    TArray<UHTNPrimitiveTask*> CurrentPlan = ExistingPlan.Tasks;
+    // Continue the existing plan, with the new goal tasks as further roots of its tree
+    DecompositionTrail.Reset();
+    if (Configuration.bRecordDecomposition)
+    {
+        DecompositionTrail = ExistingPlan.Decomposition;
+    }
+    BeginSearch(GoalTasks, INDEX_NONE, ExistingPlan.Tasks);
     
     // Start recursive search to extend the plan
-    bool bSuccess = FindPlanDFS(WorkingState, GoalTasks, CurrentPlan, 0, ResultPlan);
+    bool bSuccess = FindPlanDFS(WorkingState, 0, Result.Plan);
     
     // Finalize metrics
     Metrics.Finish();
@@ -211,12 +224,11 @@ FHTNPlannerResult UHTNDFSPlanner::GeneratePartialPlan(
         if (Configuration.bDetailedDebugging)
         {
             UE_LOG(LogHTNPlannerPlugin, Log, TEXT("HTNDFSPlanner: Partial plan generation successful with %d total tasks"), 
-                   ResultPlan.Tasks.Num());
-            Metrics.AppendDebugInfo(FString::Printf(TEXT("Partial plan generation successful with %d total tasks"), 
-                   ResultPlan.Tasks.Num()), Configuration.bDetailedDebugging);
+                   Result.Plan.Tasks.Num());
         }
         
-        return CreatePlannerResult(true, ResultPlan, EHTNPlannerFailReason::None);
+        FillPlannerResult(true, EHTNPlannerFailReason::None, Result);
+        return Result;
     }
     else
     {
@@ -238,12 +250,162 @@ FHTNPlannerResult UHTNDFSPlanner::GeneratePartialPlan(
         {
             UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNDFSPlanner: Partial plan generation failed: %s"), 
                    *StaticEnum<EHTNPlannerFailReason>()->GetNameStringByValue(static_cast<int64>(FailReason)));
-            Metrics.AppendDebugInfo(FString::Printf(TEXT("Partial plan generation failed: %s"), 
-                   *StaticEnum<EHTNPlannerFailReason>()->GetNameStringByValue(static_cast<int64>(FailReason))), Configuration.bDetailedDebugging);
         }
         
-        return CreatePlannerResult(false, ResultPlan, FailReason);
+        FillPlannerResult(false, FailReason, Result);
+        return Result;
+    }
+}
+
+bool UHTNDFSPlanner::RepairPlan(
+    const FHTNPlan& Plan,
+    int32 FailedTaskIndex,
+    const UHTNWorldState* WorldState,
+    const FHTNPlanningConfig& Config,
+    FHTNPlannerResult& OutResult,
+    TConstArrayView<int32> CompletedTaskIndices)
+{
+    OutResult.Plan = FHTNPlan();
+    
+    // Validate inputs
+    if (!WorldState)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("HTNDFSPlanner: Invalid world state provided for plan repair"));
+        return FillPlannerResult(false, EHTNPlannerFailReason::UnexpectedError, OutResult);
+    }
+    
+    const TArray<FHTNDecompositionNode>& Nodes = Plan.Decomposition;
+    const int32 FailedNodeIndex = Plan.FindDecompositionNode(FailedTaskIndex);
+    if (FailedNodeIndex == INDEX_NONE)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNDFSPlanner: Cannot repair task %d of a plan without its decomposition"), FailedTaskIndex);
+        return FillPlannerResult(false, EHTNPlannerFailReason::UnexpectedError, OutResult);
+    }
+    
+    // Set up configuration and metrics; the new subtree is told apart from the kept tasks by its decomposition
+    Configuration = Config;
+    Configuration.bRecordDecomposition = true;
+    Metrics.Reset();
+    Trace.Reset();
+    
+    // Try the nearest enclosing compound task first, and move up while it has no applicable decomposition
+    FHTNPlan Repair;
+    for (int32 NodeIndex = Nodes[FailedNodeIndex].ParentIndex; Nodes.IsValidIndex(NodeIndex) && !ShouldAbortPlanning(0); NodeIndex = Nodes[NodeIndex].ParentIndex)
+    {
+        const FHTNDecompositionNode& Node = Nodes[NodeIndex];
+        const int32 NodeEndIndex = Node.FirstTaskIndex + Node.NumTasks;
+        if (!Node.Task)
+        {
+            continue;
+        }
+        
+        // Decompose the task again, followed by the tasks after its span so they are checked against the new effects;
+        // tasks that already ran have their effects in the world state, and won't run again
+        TArray<UHTNTask*> RepairTasks;
+        RepairTasks.Add(Node.Task);
+        for (int32 TaskIndex = NodeEndIndex; TaskIndex < Plan.Tasks.Num(); ++TaskIndex)
+        {
+            if (!CompletedTaskIndices.Contains(TaskIndex))
+            {
+                RepairTasks.Add(Plan.Tasks[TaskIndex]);
+            }
+        }
+        
+        DecompositionTrail.Reset();
+        BeginSearch(RepairTasks, INDEX_NONE, TArray<UHTNPrimitiveTask*>());
+        if (!FindPlanDFS(GetWorkingState(0, WorldState), 0, Repair))
+        {
+            continue;
+        }
+        
+        // ReplaceSection cannot splice in an empty section, so a method without subtasks widens the repair too
+        const int32 NumNewTasks = Repair.Decomposition[0].NumTasks;
+        if (NumNewTasks == 0)
+        {
+            continue;
+        }
+        
+        // Replace the failed task and the rest of the node's span with the new decomposition
+        OutResult.Plan = Plan;
+        const FHTNPlan Replacement(TArray<UHTNPrimitiveTask*>(Repair.Tasks.GetData(), NumNewTasks));
+        if (!OutResult.Plan.ReplaceSection(FailedTaskIndex, NodeEndIndex - 1, Replacement))
+        {
+            Metrics.Finish();
+            return FillPlannerResult(false, EHTNPlannerFailReason::UnexpectedError, OutResult);
+        }
+        
+        // The new subtree is the first root of the repair; the kept tasks follow it as roots of their own
+        int32 NumNewNodes = 1;
+        while (NumNewNodes < Repair.Decomposition.Num() && Repair.Decomposition[NumNewNodes].ParentIndex != INDEX_NONE)
+        {
+            ++NumNewNodes;
+        }
+        
+        // In pre-order the old subtree is contiguous: it ends at the first node whose parent comes before it
+        int32 SubtreeEndIndex = NodeIndex + 1;
+        while (SubtreeEndIndex < Nodes.Num() && Nodes[SubtreeEndIndex].ParentIndex >= NodeIndex)
+        {
+            ++SubtreeEndIndex;
+        }
+        
+        // Splice the new subtree in place of the old one; nodes of tasks that already ran in the old subtree are dropped
+        const int32 TaskShift = NumNewTasks - (NodeEndIndex - FailedTaskIndex);
+        const int32 NodeShift = NumNewNodes - (SubtreeEndIndex - NodeIndex);
+        TArray<FHTNDecompositionNode>& RepairedNodes = OutResult.Plan.Decomposition;
+        RepairedNodes.Reset(Nodes.Num() + NodeShift);
+        RepairedNodes.Append(Nodes.GetData(), NodeIndex);
+        for (int32 AncestorIndex = Node.ParentIndex; RepairedNodes.IsValidIndex(AncestorIndex); AncestorIndex = RepairedNodes[AncestorIndex].ParentIndex)
+        {
+            RepairedNodes[AncestorIndex].NumTasks += TaskShift;
+        }
+        for (int32 RepairNodeIndex = 0; RepairNodeIndex < NumNewNodes; ++RepairNodeIndex)
+        {
+            FHTNDecompositionNode& NewNode = RepairedNodes.Add_GetRef(Repair.Decomposition[RepairNodeIndex]);
+            NewNode.ParentIndex = RepairNodeIndex == 0 ? Node.ParentIndex : NewNode.ParentIndex + NodeIndex;
+            NewNode.FirstTaskIndex += FailedTaskIndex;
+        }
+        for (int32 OldNodeIndex = SubtreeEndIndex; OldNodeIndex < Nodes.Num(); ++OldNodeIndex)
+        {
+            FHTNDecompositionNode& OldNode = RepairedNodes.Add_GetRef(Nodes[OldNodeIndex]);
+            if (OldNode.ParentIndex >= SubtreeEndIndex)
+            {
+                OldNode.ParentIndex += NodeShift;
+            }
+            OldNode.FirstTaskIndex += TaskShift;
+        }
+        
+        // Leave out the kept tasks that already ran
+        TArray<int32> RanTaskIndices;
+        for (int32 TaskIndex : CompletedTaskIndices)
+        {
+            if (TaskIndex >= NodeEndIndex && TaskIndex < Plan.Tasks.Num())
+            {
+                RanTaskIndices.Add(TaskIndex + TaskShift);
+            }
+        }
+        OutResult.Plan.RemoveTasks(RanTaskIndices);
+        
+        // The repaired plan is a new plan that resumes where the failed one stopped
+        OutResult.Plan.CurrentTaskIndex = FailedTaskIndex;
+        OutResult.Plan.bIsExecuting = false;
+        OutResult.Plan.bIsComplete = false;
+        OutResult.Plan.bFailed = false;
+        OutResult.Plan.Status = EHTNPlanStatus::NotStarted;
+        
+        Metrics.Finish();
+        
+        if (Configuration.bDetailedDebugging)
+        {
+            UE_LOG(LogHTNPlannerPlugin, Log, TEXT("HTNDFSPlanner: Repaired plan at task %s with %d new tasks"), *Node.Task->ToString(), NumNewTasks);
+        }
+        
+        return FillPlannerResult(true, EHTNPlannerFailReason::None, OutResult);
     }
+    
+    Metrics.Finish();
+    
+    const bool bTimedOut = Configuration.PlanningTimeout > 0.0f && FPlatformTime::Seconds() - Metrics.StartTime >= Configuration.PlanningTimeout;
+    return FillPlannerResult(false, bTimedOut ? EHTNPlannerFailReason::Timeout : EHTNPlannerFailReason::NoValidPlan, OutResult);
 }
 
 void UHTNDFSPlanner::ConfigurePlanner(const FHTNPlanningConfig& NewConfig)
@@ -257,16 +419,37 @@ void UHTNDFSPlanner::ConfigurePlanner(const FHTNPlanningConfig& NewConfig)
     }
 }
 
+void UHTNDFSPlanner::BeginSearch(const TArray<UHTNTask*>& Tasks, int32 ParentNodeIndex, const TArray<UHTNPrimitiveTask*>& InitialPlan)
+{
+    // Refill the trails rather than assigning them, so they keep their allocations across searches
+    PlanTrail.Reset();
+    PlanTrail.Append(InitialPlan);
+    
+    // The agenda is a stack, so the first task goes on top
+    TaskAgenda.Reset();
+    AgendaParents.Reset();
+    for (int32 TaskIndex = Tasks.Num() - 1; TaskIndex >= 0; --TaskIndex)
+    {
+        TaskAgenda.Add(Tasks[TaskIndex]);
+    }
+    if (Configuration.bRecordDecomposition)
+    {
+        AgendaParents.Init(ParentNodeIndex, Tasks.Num());
+    }
+}
+
 bool UHTNDFSPlanner::FindPlanDFS(
     const UHTNWorldState* WorldState,
-    const TArray<UHTNTask*>& RemainingTasks,
-    const TArray<UHTNPrimitiveTask*>& CurrentPlan,
     int32 CurrentDepth,
     FHTNPlan& OutPlan)
 {
     // Check for timeout or max depth
     if (ShouldAbortPlanning(CurrentDepth))
     {
+        if (IsTracing())
+        {
+            Trace.Add(EHTNPlannerTraceEventType::Abort, nullptr, CurrentDepth);
+        }
         return false;
     }
     
@@ -275,36 +458,59 @@ bool UHTNDFSPlanner::FindPlanDFS(
     Metrics.MaxDepthReached = FMath::Max(Metrics.MaxDepthReached, CurrentDepth);
     
     // If there are no more tasks to process, we've found a valid plan
-    if (RemainingTasks.Num() == 0)
+    if (TaskAgenda.Num() == 0)
     {
         Metrics.PlansGenerated++;
-        OutPlan = FHTNPlan(CurrentPlan);
+        OutPlan = FHTNPlan(PlanTrail);
+        if (Configuration.bRecordDecomposition)
+        {
+            OutPlan.Decomposition = DecompositionTrail;
+            
+            // Children follow their parents, so walking backwards extends every span before its parent's is read
+            for (int32 NodeIndex = OutPlan.Decomposition.Num() - 1; NodeIndex >= 0; --NodeIndex)
+            {
+                const FHTNDecompositionNode& Node = OutPlan.Decomposition[NodeIndex];
+                if (OutPlan.Decomposition.IsValidIndex(Node.ParentIndex))
+                {
+                    FHTNDecompositionNode& Parent = OutPlan.Decomposition[Node.ParentIndex];
+                    Parent.NumTasks = FMath::Max(Parent.NumTasks, Node.FirstTaskIndex + Node.NumTasks - Parent.FirstTaskIndex);
+                }
+            }
+        }
         
-        if (Configuration.bDetailedDebugging)
+        if (IsTracing())
         {
-            UE_LOG(LogHTNPlannerPlugin, Verbose, TEXT("HTNDFSPlanner: Found valid plan with %d tasks"), OutPlan.Tasks.Num());
-            Metrics.AppendDebugInfo(FString::Printf(TEXT("Found valid plan with %d tasks at depth %d"), OutPlan.Tasks.Num(), CurrentDepth), Configuration.bDetailedDebugging);
+            Trace.Add(EHTNPlannerTraceEventType::PlanFound, nullptr, CurrentDepth, OutPlan.Tasks.Num());
         }
         
         return true;
     }
     
-    // Process the first task in the list
-    UHTNTask* CurrentTask = RemainingTasks[0];
+    // Take the next task off the agenda
+    UHTNTask* CurrentTask = TaskAgenda.Pop(EAllowShrinking::No);
     
-    // Create remaining tasks list (everything except the current task)
-    TArray<UHTNTask*> NewRemainingTasks = RemainingTasks;
-    NewRemainingTasks.RemoveAt(0);
+    // Parents are tracked alongside the tasks only when the decomposition is recorded
+    const int32 ParentNodeIndex = Configuration.bRecordDecomposition ? AgendaParents.Pop(EAllowShrinking::No) : INDEX_NONE;
     
     // Process the current task
-    return ProcessTask(WorldState, CurrentTask, NewRemainingTasks, CurrentPlan, CurrentDepth, OutPlan);
+    if (ProcessTask(WorldState, CurrentTask, ParentNodeIndex, CurrentDepth, OutPlan))
+    {
+        return true;
+    }
+    
+    // Backtrack: the caller tries its next alternative with the agenda it had
+    TaskAgenda.Add(CurrentTask);
+    if (Configuration.bRecordDecomposition)
+    {
+        AgendaParents.Add(ParentNodeIndex);
+    }
+    return false;
 }
 
 bool UHTNDFSPlanner::ProcessTask(
     const UHTNWorldState* WorldState,
     UHTNTask* Task,
-    const TArray<UHTNTask*>& RemainingTasks,
-    const TArray<UHTNPrimitiveTask*>& CurrentPlan,
+    int32 ParentNodeIndex,
     int32 CurrentDepth,
     FHTNPlan& OutPlan)
 {
@@ -314,19 +520,35 @@ bool UHTNDFSPlanner::ProcessTask(
         return false;
     }
     
-    if (Configuration.bDetailedDebugging)
+    const bool bTracing = IsTracing();
+    if (bTracing)
     {
-        UE_LOG(LogHTNPlannerPlugin, Verbose, TEXT("HTNDFSPlanner: Processing task %s at depth %d"), *Task->ToString(), CurrentDepth);
-        Metrics.AppendDebugInfo(FString::Printf(TEXT("Processing task %s at depth %d"), *Task->ToString(), CurrentDepth), Configuration.bDetailedDebugging);
+        Trace.Add(EHTNPlannerTraceEventType::NodeEnter, Task, CurrentDepth);
     }
     
     // Check if the task is applicable in the current world state
     if (!Task->IsApplicable(WorldState))
     {
-        if (Configuration.bDetailedDebugging)
+        if (bTracing)
         {
-            UE_LOG(LogHTNPlannerPlugin, Verbose, TEXT("HTNDFSPlanner: Task %s is not applicable"), *Task->ToString());
-            Metrics.AppendDebugInfo(FString::Printf(TEXT("Task %s is not applicable in current world state"), *Task->ToString()), Configuration.bDetailedDebugging);
+            // Preconditions are checked together, so only a failure pays for finding the one that failed.
+            // The index counts authored conditions, so cooked domains trace the same indices as their source.
+            int32 FailedConditionIndex = INDEX_NONE;
+            if (const UHTNPrimitiveTask* PrimitiveTask = Cast<UHTNPrimitiveTask>(Task))
+            {
+                int32 ConditionIndex = 0;
+                for (const UHTNCondition* Condition : PrimitiveTask->Preconditions)
+                {
+                    const int32 FailedIndex = Condition ? Condition->FindFailedCondition(WorldState) : INDEX_NONE;
+                    if (FailedIndex != INDEX_NONE)
+                    {
+                        FailedConditionIndex = ConditionIndex + FailedIndex;
+                        break;
+                    }
+                    ConditionIndex += Condition ? Condition->GetNumConditions() : 1;
+                }
+            }
+            Trace.Add(EHTNPlannerTraceEventType::ConditionFail, Task, CurrentDepth, FailedConditionIndex);
         }
         
         return false;
@@ -335,8 +557,8 @@ bool UHTNDFSPlanner::ProcessTask(
     // Handle primitive tasks
     if (UHTNPrimitiveTask* PrimitiveTask = Cast<UHTNPrimitiveTask>(Task))
     {
-        // Clone the world state to avoid modifying the original
-        UHTNWorldState* NewWorldState = WorldState->Clone();
+        // Copy the world state to avoid modifying the original
+        UHTNWorldState* NewWorldState = GetWorkingState(CurrentDepth + 1, WorldState);
         
         // Apply the primitive task's effects to the world state
         if (!ApplyTaskEffects(NewWorldState, PrimitiveTask))
@@ -344,12 +566,28 @@ bool UHTNDFSPlanner::ProcessTask(
             return false;
         }
         
+        const int32 NodeIndex = DecompositionTrail.Num();
+        if (Configuration.bRecordDecomposition)
+        {
+            DecompositionTrail.Emplace(PrimitiveTask, ParentNodeIndex, PlanTrail.Num(), 1);
+        }
+        
         // Add the primitive task to the plan
-        TArray<UHTNPrimitiveTask*> NewPlan = CurrentPlan;
-        NewPlan.Add(PrimitiveTask);
+        PlanTrail.Add(PrimitiveTask);
         
         // Continue planning with the next task
-        return FindPlanDFS(NewWorldState, RemainingTasks, NewPlan, CurrentDepth + 1, OutPlan);
+        if (FindPlanDFS(NewWorldState, CurrentDepth + 1, OutPlan))
+        {
+            return true;
+        }
+        
+        PlanTrail.Pop(EAllowShrinking::No);
+        DecompositionTrail.SetNum(NodeIndex, EAllowShrinking::No);
+        if (bTracing)
+        {
+            Trace.Add(EHTNPlannerTraceEventType::Backtrack, Task, CurrentDepth);
+        }
+        return false;
     }
     // Handle compound tasks
     else if (UHTNCompoundTask* CompoundTask = Cast<UHTNCompoundTask>(Task))
@@ -358,61 +596,73 @@ bool UHTNDFSPlanner::ProcessTask(
         TArray<UHTNMethod*> AvailableMethods;
         if (!CompoundTask->GetAvailableMethods(WorldState, AvailableMethods) || AvailableMethods.Num() == 0)
         {
-            if (Configuration.bDetailedDebugging)
+            if (bTracing)
             {
-                UE_LOG(LogHTNPlannerPlugin, Verbose, TEXT("HTNDFSPlanner: No applicable methods for compound task %s"), 
-                       *CompoundTask->ToString());
-                Metrics.AppendDebugInfo(FString::Printf(TEXT("No applicable methods for compound task %s"), 
-                       *CompoundTask->ToString()), Configuration.bDetailedDebugging);
+                Trace.Add(EHTNPlannerTraceEventType::ConditionFail, Task, CurrentDepth);
             }
             
             return false;
         }
         
+        // One node stands for the compound task; each method tried replaces the branch below it
+        const int32 NodeIndex = DecompositionTrail.Num();
+        if (Configuration.bRecordDecomposition)
+        {
+            DecompositionTrail.Emplace(CompoundTask, ParentNodeIndex, PlanTrail.Num(), 0);
+        }
+        
         // Try each method in order of priority (already sorted by GetAvailableMethods)
         for (UHTNMethod* Method : AvailableMethods)
         {
-            if (Configuration.bDetailedDebugging)
+            if (bTracing)
             {
-                UE_LOG(LogHTNPlannerPlugin, Verbose, TEXT("HTNDFSPlanner: Trying method %s for task %s"), 
-                       *Method->GetDescription(), *CompoundTask->ToString());
-                Metrics.AppendDebugInfo(FString::Printf(TEXT("Trying method %s for task %s"), 
-                       *Method->GetDescription(), *CompoundTask->ToString()), Configuration.bDetailedDebugging);
+                Trace.Add(EHTNPlannerTraceEventType::MethodTry, Task, CurrentDepth, CompoundTask->GetMethods().Find(Method));
             }
             
-            // Apply the method to get subtasks
-            TArray<UHTNTask*> Subtasks;
-            if (!CompoundTask->ApplyMethod(Method, WorldState, Subtasks))
+            // Apply the method to get subtasks; the buffer is free again once they are on the agenda
+            MethodSubtasks.Reset();
+            if (!CompoundTask->ApplyMethod(Method, WorldState, MethodSubtasks))
             {
-                if (Configuration.bDetailedDebugging)
-                {
-                    UE_LOG(LogHTNPlannerPlugin, Verbose, TEXT("HTNDFSPlanner: Failed to apply method %s"), 
-                           *Method->GetDescription());
-                    Metrics.AppendDebugInfo(FString::Printf(TEXT("Failed to apply method %s"), 
-                           *Method->GetDescription()), Configuration.bDetailedDebugging);
-                }
-                
                 continue;
             }
             
-            // Create a new task list with the subtasks followed by the remaining tasks
-            TArray<UHTNTask*> NewTaskList = Subtasks;
-            NewTaskList.Append(RemainingTasks);
+            // The subtasks go on top of the agenda, first subtask on top
+            const int32 AgendaSize = TaskAgenda.Num();
+            for (int32 SubtaskIndex = MethodSubtasks.Num() - 1; SubtaskIndex >= 0; --SubtaskIndex)
+            {
+                TaskAgenda.Add(MethodSubtasks[SubtaskIndex]);
+            }
+            
+            if (Configuration.bRecordDecomposition)
+            {
+                DecompositionTrail.SetNum(NodeIndex + 1, EAllowShrinking::No);
+                DecompositionTrail[NodeIndex].Method = Method;
+                AgendaParents.SetNum(AgendaSize + MethodSubtasks.Num(), EAllowShrinking::No);
+                for (int32 AgendaIndex = AgendaSize; AgendaIndex < AgendaParents.Num(); ++AgendaIndex)
+                {
+                    AgendaParents[AgendaIndex] = NodeIndex;
+                }
+            }
             
-            // Recursively plan with the new task list
-            if (FindPlanDFS(WorldState, NewTaskList, CurrentPlan, CurrentDepth + 1, OutPlan))
+            // Recursively plan with the new agenda
+            if (FindPlanDFS(WorldState, CurrentDepth + 1, OutPlan))
             {
                 return true;
             }
+            
+            TaskAgenda.SetNum(AgendaSize, EAllowShrinking::No);
+            if (Configuration.bRecordDecomposition)
+            {
+                AgendaParents.SetNum(AgendaSize, EAllowShrinking::No);
+            }
         }
         
+        DecompositionTrail.SetNum(NodeIndex, EAllowShrinking::No);
+        
         // If we've tried all methods and none worked, this branch fails
-        if (Configuration.bDetailedDebugging)
+        if (bTracing)
         {
-            UE_LOG(LogHTNPlannerPlugin, Verbose, TEXT("HTNDFSPlanner: All methods failed for compound task %s"), 
-                   *CompoundTask->ToString());
-            Metrics.AppendDebugInfo(FString::Printf(TEXT("All methods failed for compound task %s"), 
-                   *CompoundTask->ToString()), Configuration.bDetailedDebugging);
+            Trace.Add(EHTNPlannerTraceEventType::Backtrack, Task, CurrentDepth);
         }
         
         return false;
@@ -435,31 +685,8 @@ bool UHTNDFSPlanner::ApplyTaskEffects(
         return false;
     }
     
-    if (Configuration.bDetailedDebugging)
-    {
-        UE_LOG(LogHTNPlannerPlugin, Verbose, TEXT("HTNDFSPlanner: Applying effects for task %s"), *Task->ToString());
-        Metrics.AppendDebugInfo(FString::Printf(TEXT("Applying effects for task %s"), *Task->ToString()), Configuration.bDetailedDebugging);
-    }
-    
-    // Get the task's expected effects
-    UHTNWorldState* Effects = Task->GetExpectedEffects(WorldState);
-    
-    if (!Effects)
-    {
-        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("HTNDFSPlanner: Failed to get expected effects for task %s"), *Task->ToString());
-        return false;
-    }
-    
-    // For each property in the effects, apply it to the world state
-    TArray<FName> EffectPropertyNames = Effects->GetPropertyNames();
-    for (const FName& PropertyName : EffectPropertyNames)
-    {
-        FHTNProperty PropertyValue;
-        if (Effects->GetProperty(PropertyName, PropertyValue))
-        {
-            WorldState->SetProperty(PropertyName, PropertyValue);
-        }
-    }
+    // Apply the task's expected effects in place
+    Task->ApplyExpectedEffects(WorldState);
     
     return true;
 }
@@ -506,17 +733,34 @@ bool UHTNDFSPlanner::ShouldAbortPlanning(int32 CurrentDepth) const
     return false;
 }
 
-FHTNPlannerResult UHTNDFSPlanner::CreatePlannerResult(bool Success, const FHTNPlan& Plan, EHTNPlannerFailReason FailReason)
+UHTNWorldState* UHTNDFSPlanner::GetWorkingState(int32 Depth, const UHTNWorldState* Source)
 {
-    FHTNPlannerResult Result;
-    Result.bSuccess = Success;
-    Result.Plan = Plan;
-    Result.FailReason = FailReason;
-    Result.NodesExplored = Metrics.NodesExplored;
-    Result.PlansGenerated = Metrics.PlansGenerated;
-    Result.MaxDepthReached = Metrics.MaxDepthReached;
-    Result.PlanningTime = Metrics.GetElapsedTime();
-    Result.DebugInfo = Metrics.DebugInfo;
+    while (WorkingStates.Num() <= Depth)
+    {
+        WorkingStates.Add(NewObject<UHTNWorldState>(this));
+    }
     
-    return Result;
+    UHTNWorldState* WorkingState = WorkingStates[Depth];
+    WorkingState->CopyFrom(Source);
+    return WorkingState;
+}
+
+bool UHTNDFSPlanner::FillPlannerResult(bool Success, EHTNPlannerFailReason FailReason, FHTNPlannerResult& OutResult)
+{
+    if (Success && Configuration.bInferTaskDependencies)
+    {
+        OutResult.Plan.InferTaskDependencies();
+    }
+    
+    OutResult.bSuccess = Success;
+    OutResult.FailReason = FailReason;
+    OutResult.NodesExplored = Metrics.NodesExplored;
+    OutResult.PlansGenerated = Metrics.PlansGenerated;
+    OutResult.MaxDepthReached = Metrics.MaxDepthReached;
+    OutResult.PlanningTime = Metrics.GetElapsedTime();
+    
+    // The trace is only formatted when the text is asked for
+    OutResult.DebugInfo = Configuration.bDetailedDebugging ? Trace.ToString() : FString();
+    
+    return Success;
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNDomainAsset.h"
+
+#include "HTNDFSPlanner.h"
+#include "HTNDomainBlob.h"
+#include "HTNLogging.h"
+#include "HTNPlanCacheSubsystem.h"
+#include "Tasks/HTNPrimitiveTask.h"
+
+const TArray<UHTNTask*>& UHTNDomainAsset::GetGoalTasks() const
+{
+#if WITH_EDITORONLY_DATA
+    if (!CookedBlob.IsValid())
+    {
+        return GoalTasks;
+    }
+#endif
+    return CookedGoalTasks;
+}
+
+void UHTNDomainAsset::Serialize(FArchive& Ar)
+{
+    Super::Serialize(Ar);
+    
+    // Cooked assets carry the domain as one blob; editor-only goal tasks aren't cooked
+    if (!Ar.IsFilterEditorOnly())
+    {
+        return;
+    }
+    
+    TArray<uint8> BlobData;
+#if WITH_EDITORONLY_DATA
+    if (Ar.IsSaving())
+    {
+        FHTNDomainBlob::Compile(GoalTasks, BlobData);
+    }
+#endif
+    Ar << BlobData;
+    
+    if (Ar.IsLoading())
+    {
+        CookedBlob = MakeShared<FHTNDomainBlob, ESPMode::ThreadSafe>();
+        if (!CookedBlob->Initialize(MoveTemp(BlobData)))
+        {
+            UE_LOG(LogHTNPlannerPlugin, Error, TEXT("HTNDomainAsset: Invalid domain blob in %s"), *GetPathName());
+            CookedBlob.Reset();
+        }
+    }
+}
+
+void UHTNDomainAsset::PostLoad()
+{
+    Super::PostLoad();
+    
+    if (CookedBlob.IsValid())
+    {
+        CookedGoalTasks.Reset();
+        CookedBlob->CreateTasks(this, CookedGoalTasks);
+    }
+    
+    TaskIndex.Reset();
+    TaskIndex.AddDomain(GetGoalTasks());
+    
+    if (UHTNPlanCacheSubsystem* PlanCache = UHTNPlanCacheSubsystem::Get())
+    {
+        PlanCache->SeedFromDomain(this);
+    }
+}
+
+#if WITH_EDITOR
+int32 UHTNDomainAsset::BuildWarmPlanCache()
+{
+    Modify();
+    WarmPlans.Reset();
+    
+    UHTNDFSPlanner* Planner = NewObject<UHTNDFSPlanner>(GetTransientPackage());
+    UHTNWorldState* StartState = NewObject<UHTNWorldState>(GetTransientPackage());
+    const FHTNPlanningConfig Config;
+    for (int32 StateIndex = 0; StateIndex < ArchetypeStartStates.Num(); ++StateIndex)
+    {
+        StartState->SetWorldState(ArchetypeStartStates[StateIndex]);
+        const FHTNPlannerResult Result = Planner->GeneratePlan(StartState, GoalTasks, Config);
+        if (!Result.bSuccess)
+        {
+            UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNDomainAsset: No plan found for archetype start state %d of %s"), StateIndex, *GetPathName());
+            continue;
+        }
+        
+        FHTNWarmPlan& WarmPlan = WarmPlans.AddDefaulted_GetRef();
+        WarmPlan.Fingerprint = UHTNPlanCacheSubsystem::GetRequestFingerprint(ArchetypeStartStates[StateIndex], GoalTasks);
+        WarmPlan.Cost = Result.Plan.TotalCost;
+        WarmPlan.TaskIDs.Reserve(Result.Plan.Tasks.Num());
+        for (const UHTNPrimitiveTask* Task : Result.Plan.Tasks)
+        {
+            WarmPlan.TaskIDs.Add(Task ? Task->GetTaskID() : FGuid());
+        }
+    }
+    
+    UE_LOG(LogHTNPlannerPlugin, Log, TEXT("HTNDomainAsset: Stored %d of %d warm plans for %s"), WarmPlans.Num(), ArchetypeStartStates.Num(), *GetPathName());
+    return WarmPlans.Num();
+}
+#endif
@@ -0,0 +1,868 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNDomainBlob.h"
+
+#include "Conditions/HTNCookedConditions.h"
+#include "Conditions/HTNPropertyCondition.h"
+#include "Effects/HTNCookedEffects.h"
+#include "Effects/HTNSetPropertyEffect.h"
+#include "Effects/HTNToggleEffect.h"
+#include "HTNLogging.h"
+#include "HTNMethod.h"
+#include "HTNPlanBinaryFormat.h"
+#include "HTNWorldStateStruct.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "Tasks/HTNCompoundTask.h"
+#include "Tasks/HTNPrimitiveTask.h"
+
+/**
+ * Layout, all multi-byte values little-endian:
+ *   uint32  Magic ("HTND")
+ *   int32   Version
+ *   uint32  CRC32 of everything after this field
+ *   Table of contents: uint32 offset and uint32 element count of each section, in ESection order
+ *   Strings:    each as varint UTF-8 byte count and bytes
+ *   Tables:     fixed-size records of uint32 fields (see RecordFields); references are table indices,
+ *               0xFFFFFFFF for none
+ *   ObjectData: tagged property data of object records
+ */
+namespace HTNDomainBlobFormat
+{
+    constexpr uint32 Magic = 0x444E5448;
+    constexpr int32 HeaderSize = 12;
+    constexpr uint32 NoIndex = 0xFFFFFFFF;
+
+    /** Fields per record of each section; 0 for sections that aren't record tables */
+    constexpr int32 RecordFields[] =
+    {
+        0,  // Strings
+        1,  // Schema: key string
+        1,  // Goals: task
+        6,  // Tasks: object, kind, first and count of conditions or methods, first and count of effects
+        5,  // Methods: object, first and count of conditions, first and count of task refs
+        1,  // TaskRefs: task
+        10, // Conditions: kind, key or object, check type, value (type and 6 payload fields)
+        10, // Effects: kind, key or object, argument, value (type and 6 payload fields)
+        3,  // Objects: class path string, data offset, data size
+        0,  // ObjectData
+    };
+
+    /** Field index of the value in condition and effect records */
+    constexpr int32 ValueField = 3;
+
+    enum ETaskKind : uint32
+    {
+        TaskKind_Primitive,
+        TaskKind_Compound,
+        TaskKind_Other,
+    };
+
+    enum EConditionKind : uint32
+    {
+        ConditionKind_Object,
+        ConditionKind_Property,
+    };
+
+    enum EEffectKind : uint32
+    {
+        EffectKind_Object,
+        EffectKind_Set,
+        EffectKind_Remove,
+        EffectKind_Copy,
+        EffectKind_Toggle,
+    };
+
+    /** Argument bits of toggle effect records */
+    enum EToggleFlags : uint32
+    {
+        Toggle_SetTrueIfMissing = 1 << 0,
+        Toggle_ForceValue = 1 << 1,
+        Toggle_ForcedValue = 1 << 2,
+    };
+
+    /**
+     * Serializes the non-default properties of a domain node.
+     * Links to subobjects are stored as table indices, and runtime state isn't part of the domain, so both are skipped.
+     */
+    class FNodePropertyArchive : public FObjectAndNameAsStringProxyArchive
+    {
+    public:
+        explicit FNodePropertyArchive(FArchive& InInnerArchive)
+            : FObjectAndNameAsStringProxyArchive(InInnerArchive, false)
+        {
+        }
+
+        virtual bool ShouldSkipProperty(const FProperty* InProperty) const override
+        {
+            return InProperty->HasAnyPropertyFlags(CPF_Transient | CPF_InstancedReference | CPF_ContainsInstancedReference | CPF_BlueprintAssignable)
+                || FObjectAndNameAsStringProxyArchive::ShouldSkipProperty(InProperty);
+        }
+    };
+
+    /** Case-sensitive string keys, so string values differing only in case keep their own entries */
+    struct FStringKeyFuncs : BaseKeyFuncs<TPair<FString, int32>, FString, false>
+    {
+        static const FString& GetSetKey(const TPair<FString, int32>& Element) { return Element.Key; }
+        static bool Matches(const FString& A, const FString& B) { return A.Equals(B, ESearchCase::CaseSensitive); }
+        static uint32 GetKeyHash(const FString& Key) { return FCrc::StrCrc32(*Key); }
+    };
+}
+
+/**
+ * Builds the tables of a domain blob by walking the task hierarchy.
+ */
+struct FHTNDomainBlobCompiler
+{
+    int32 AddString(const FString& String)
+    {
+        if (const int32* Existing = StringIndices.Find(String))
+        {
+            return *Existing;
+        }
+        return StringIndices.Add(String, Strings.Add(String));
+    }
+
+    int32 AddKey(FName Key)
+    {
+        if (const int32* Existing = SchemaIndices.Find(Key))
+        {
+            return *Existing;
+        }
+        Tables[FHTNDomainBlob::Section_Schema].Add(AddString(Key.ToString()));
+        return SchemaIndices.Add(Key, SchemaIndices.Num());
+    }
+
+    uint32 AddObject(const UObject* Object)
+    {
+        if (!Object)
+        {
+            return HTNDomainBlobFormat::NoIndex;
+        }
+
+        UClass* Class = Object->GetClass();
+        const int32 DataOffset = ObjectData.Num();
+        FMemoryWriter Writer(ObjectData, true, true);
+        HTNDomainBlobFormat::FNodePropertyArchive Archive(Writer);
+        Class->SerializeTaggedProperties(Archive, reinterpret_cast<uint8*>(const_cast<UObject*>(Object)), Class, reinterpret_cast<uint8*>(Class->GetDefaultObject()));
+
+        TArray<uint32>& Objects = Tables[FHTNDomainBlob::Section_Objects];
+        const uint32 ObjectIndex = Objects.Num() / HTNDomainBlobFormat::RecordFields[FHTNDomainBlob::Section_Objects];
+        Objects.Add(AddString(Class->GetPathName()));
+        Objects.Add(DataOffset);
+        Objects.Add(ObjectData.Num() - DataOffset);
+        return ObjectIndex;
+    }
+
+    void AddValue(TArray<uint32>& Table, const FHTNProperty& Value)
+    {
+        uint32 Payload[6] = {};
+        switch (Value.GetType())
+        {
+        case EHTNPropertyType::Boolean:
+            Payload[0] = Value.GetBoolValue() ? 1 : 0;
+            break;
+        case EHTNPropertyType::Integer:
+            Payload[0] = static_cast<uint32>(Value.GetIntValue());
+            break;
+        case EHTNPropertyType::Float:
+            {
+                const float FloatValue = Value.GetFloatValue();
+                FMemory::Memcpy(&Payload[0], &FloatValue, sizeof(float));
+                break;
+            }
+        case EHTNPropertyType::String:
+            Payload[0] = AddString(Value.GetStringValue());
+            break;
+        case EHTNPropertyType::Name:
+            Payload[0] = AddString(Value.GetNameValue().ToString());
+            break;
+        case EHTNPropertyType::Vector:
+            {
+                const FVector Vector = Value.GetVectorValue();
+                const double Components[3] = { Vector.X, Vector.Y, Vector.Z };
+                FMemory::Memcpy(Payload, Components, sizeof(Components));
+                break;
+            }
+        default:
+            // Object references can't be cooked into a blob and are loaded as null, like in serialized plans
+            break;
+        }
+
+        Table.Add(static_cast<uint32>(Value.GetType()));
+        Table.Append(Payload, UE_ARRAY_COUNT(Payload));
+    }
+
+    void AddConditions(TConstArrayView<UHTNCondition*> Conditions, uint32& OutFirst, uint32& OutNum)
+    {
+        TArray<uint32>& Table = Tables[FHTNDomainBlob::Section_Conditions];
+        const int32 NumFields = HTNDomainBlobFormat::RecordFields[FHTNDomainBlob::Section_Conditions];
+        OutFirst = Table.Num() / NumFields;
+
+        // Conditions keep their authored order, so precondition indices in traces match the source domain
+        for (const UHTNCondition* Condition : Conditions)
+        {
+            if (!Condition)
+            {
+                continue;
+            }
+
+            if (Condition->GetClass() == UHTNPropertyCondition::StaticClass())
+            {
+                const UHTNPropertyCondition* PropertyCondition = CastChecked<UHTNPropertyCondition>(Condition);
+                Table.Add(HTNDomainBlobFormat::ConditionKind_Property);
+                Table.Add(AddKey(PropertyCondition->PropertyKey));
+                Table.Add(static_cast<uint32>(PropertyCondition->CheckType));
+                AddValue(Table, PropertyCondition->CompareValue);
+            }
+            else
+            {
+                Table.Add(HTNDomainBlobFormat::ConditionKind_Object);
+                Table.Add(AddObject(Condition));
+                Table.Add(0);
+                AddValue(Table, FHTNProperty::Invalid());
+            }
+        }
+
+        OutNum = Table.Num() / NumFields - OutFirst;
+    }
+
+    void AddEffects(TConstArrayView<UHTNEffect*> Effects, uint32& OutFirst, uint32& OutNum)
+    {
+        using namespace HTNDomainBlobFormat;
+
+        TArray<uint32>& Table = Tables[FHTNDomainBlob::Section_Effects];
+        const int32 NumFields = RecordFields[FHTNDomainBlob::Section_Effects];
+        OutFirst = Table.Num() / NumFields;
+
+        // Effects can depend on each other, so they keep their order
+        for (const UHTNEffect* Effect : Effects)
+        {
+            if (!Effect)
+            {
+                continue;
+            }
+
+            if (Effect->GetClass() == UHTNSetPropertyEffect::StaticClass())
+            {
+                const UHTNSetPropertyEffect* SetEffect = CastChecked<UHTNSetPropertyEffect>(Effect);
+                Table.Add(SetEffect->bRemoveProperty ? EffectKind_Remove : (SetEffect->bUseSourceProperty ? EffectKind_Copy : EffectKind_Set));
+                Table.Add(AddKey(SetEffect->PropertyKey));
+                Table.Add(SetEffect->bUseSourceProperty && !SetEffect->bRemoveProperty ? AddKey(SetEffect->SourcePropertyKey) : 0);
+                AddValue(Table, SetEffect->bUseSourceProperty || SetEffect->bRemoveProperty ? FHTNProperty::Invalid() : SetEffect->PropertyValue);
+            }
+            else if (Effect->GetClass() == UHTNToggleEffect::StaticClass())
+            {
+                const UHTNToggleEffect* ToggleEffect = CastChecked<UHTNToggleEffect>(Effect);
+                Table.Add(EffectKind_Toggle);
+                Table.Add(AddKey(ToggleEffect->PropertyKey));
+                Table.Add((ToggleEffect->bSetTrueIfMissing ? Toggle_SetTrueIfMissing : 0)
+                    | (ToggleEffect->bForceValue ? Toggle_ForceValue : 0)
+                    | (ToggleEffect->ForcedValue ? Toggle_ForcedValue : 0));
+                AddValue(Table, FHTNProperty::Invalid());
+            }
+            else
+            {
+                Table.Add(EffectKind_Object);
+                Table.Add(AddObject(Effect));
+                Table.Add(0);
+                AddValue(Table, FHTNProperty::Invalid());
+            }
+        }
+
+        OutNum = Table.Num() / NumFields - OutFirst;
+    }
+
+    uint32 AddTask(const UHTNTask* Task)
+    {
+        using namespace HTNDomainBlobFormat;
+
+        if (!Task)
+        {
+            return NoIndex;
+        }
+
+        if (const int32* Existing = TaskIndices.Find(Task))
+        {
+            return *Existing;
+        }
+
+        // Reserve the record first, so tasks reached again through their own subtasks find it
+        const int32 TaskFields = RecordFields[FHTNDomainBlob::Section_Tasks];
+        const int32 TaskIndex = Tables[FHTNDomainBlob::Section_Tasks].Num() / TaskFields;
+        TaskIndices.Add(Task, TaskIndex);
+        Tables[FHTNDomainBlob::Section_Tasks].AddZeroed(TaskFields);
+
+        uint32 Record[6] = { AddObject(Task), TaskKind_Other, 0, 0, 0, 0 };
+        if (const UHTNPrimitiveTask* PrimitiveTask = Cast<UHTNPrimitiveTask>(Task))
+        {
+            Record[1] = TaskKind_Primitive;
+            AddConditions(PrimitiveTask->Preconditions, Record[2], Record[3]);
+            AddEffects(PrimitiveTask->Effects, Record[4], Record[5]);
+        }
+        else if (const UHTNCompoundTask* CompoundTask = Cast<UHTNCompoundTask>(Task))
+        {
+            const int32 MethodFields = RecordFields[FHTNDomainBlob::Section_Methods];
+            const TArray<UHTNMethod*>& Methods = CompoundTask->GetMethods();
+            Record[1] = TaskKind_Compound;
+            Record[2] = Tables[FHTNDomainBlob::Section_Methods].Num() / MethodFields;
+            Record[3] = Methods.Num();
+            Tables[FHTNDomainBlob::Section_Methods].AddZeroed(Methods.Num() * MethodFields);
+
+            for (int32 MethodIndex = 0; MethodIndex < Methods.Num(); ++MethodIndex)
+            {
+                const UHTNMethod* Method = Methods[MethodIndex];
+                uint32 MethodRecord[5] = { AddObject(Method), 0, 0, 0, 0 };
+                if (Method)
+                {
+                    AddConditions(Method->Conditions, MethodRecord[1], MethodRecord[2]);
+
+                    // Reserve the subtask range before adding subtasks, which add ranges of their own
+                    const TArray<UHTNTask*>& Subtasks = Method->GetSubtasks();
+                    MethodRecord[3] = Tables[FHTNDomainBlob::Section_TaskRefs].Num();
+                    MethodRecord[4] = Subtasks.Num();
+                    Tables[FHTNDomainBlob::Section_TaskRefs].AddZeroed(Subtasks.Num());
+                    for (int32 SubtaskIndex = 0; SubtaskIndex < Subtasks.Num(); ++SubtaskIndex)
+                    {
+                        const uint32 SubtaskTaskIndex = AddTask(Subtasks[SubtaskIndex]);
+                        Tables[FHTNDomainBlob::Section_TaskRefs][MethodRecord[3] + SubtaskIndex] = SubtaskTaskIndex;
+                    }
+                }
+
+                FMemory::Memcpy(&Tables[FHTNDomainBlob::Section_Methods][(Record[2] + MethodIndex) * MethodFields], MethodRecord, sizeof(MethodRecord));
+            }
+        }
+        else
+        {
+            UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNDomainBlob: Task %s is neither primitive nor compound; only its own properties are kept"), *Task->GetName());
+        }
+
+        FMemory::Memcpy(&Tables[FHTNDomainBlob::Section_Tasks][TaskIndex * TaskFields], Record, sizeof(Record));
+        return TaskIndex;
+    }
+
+    void Write(TArray<uint8>& OutData) const
+    {
+        using namespace HTNDomainBlobFormat;
+
+        OutData.Reset();
+        HTNPlanBinary::FWriter Writer(OutData);
+        Writer.WriteFixed(Magic, 4);
+        Writer.WriteFixed(FHTNDomainBlob::Version, 4);
+        Writer.WriteFixed(0, 4);
+        OutData.AddZeroed(FHTNDomainBlob::Section_Count * 8);
+
+        auto PatchFixed = [&OutData](int32 Offset, uint32 Value)
+        {
+            for (int32 ByteIndex = 0; ByteIndex < 4; ++ByteIndex)
+            {
+                OutData[Offset + ByteIndex] = static_cast<uint8>(Value >> (8 * ByteIndex));
+            }
+        };
+
+        for (int32 Section = 0; Section < FHTNDomainBlob::Section_Count; ++Section)
+        {
+            const int32 SectionOffset = OutData.Num();
+            int32 SectionNum = 0;
+            if (Section == FHTNDomainBlob::Section_Strings)
+            {
+                for (const FString& String : Strings)
+                {
+                    const FTCHARToUTF8 Converted(*String);
+                    Writer.WriteVarInt(Converted.Length());
+                    Writer.WriteBytes(TConstArrayView<uint8>(reinterpret_cast<const uint8*>(Converted.Get()), Converted.Length()));
+                }
+                SectionNum = Strings.Num();
+            }
+            else if (Section == FHTNDomainBlob::Section_ObjectData)
+            {
+                Writer.WriteBytes(ObjectData);
+                SectionNum = ObjectData.Num();
+            }
+            else
+            {
+                for (const uint32 Field : Tables[Section])
+                {
+                    Writer.WriteFixed(Field, 4);
+                }
+                SectionNum = Tables[Section].Num() / RecordFields[Section];
+            }
+
+            PatchFixed(HeaderSize + Section * 8, SectionOffset);
+            PatchFixed(HeaderSize + Section * 8 + 4, SectionNum);
+        }
+
+        PatchFixed(8, FCrc::MemCrc32(OutData.GetData() + HeaderSize, OutData.Num() - HeaderSize));
+    }
+
+    TArray<FString> Strings;
+    TMap<FString, int32, FDefaultSetAllocator, HTNDomainBlobFormat::FStringKeyFuncs> StringIndices;
+    TMap<FName, int32> SchemaIndices;
+    TMap<const UHTNTask*, int32> TaskIndices;
+    TArray<uint32> Tables[FHTNDomainBlob::Section_Count];
+    TArray<uint8> ObjectData;
+};
+
+bool FHTNDomainBlob::Compile(TConstArrayView<UHTNTask*> GoalTasks, TArray<uint8>& OutData)
+{
+    FHTNDomainBlobCompiler Compiler;
+    for (const UHTNTask* GoalTask : GoalTasks)
+    {
+        const uint32 TaskIndex = Compiler.AddTask(GoalTask);
+        if (TaskIndex != HTNDomainBlobFormat::NoIndex)
+        {
+            Compiler.Tables[Section_Goals].Add(TaskIndex);
+        }
+    }
+
+    Compiler.Write(OutData);
+    return true;
+}
+
+bool FHTNDomainBlob::Initialize(TArray<uint8>&& InData)
+{
+    OwnedData = MoveTemp(InData);
+    Data = OwnedData;
+    return FixUp();
+}
+
+bool FHTNDomainBlob::InitializeView(TConstArrayView<uint8> InData)
+{
+    OwnedData.Empty();
+    Data = InData;
+    return FixUp();
+}
+
+bool FHTNDomainBlob::FixUp()
+{
+    using namespace HTNDomainBlobFormat;
+
+    bValid = false;
+    Names.Reset();
+    StringOffsets.Reset();
+    SchemaKeys.Reset();
+    SchemaSlots.Reset();
+
+    HTNPlanBinary::FReader Reader(Data);
+    const uint32 BlobMagic = Reader.ReadFixed(4);
+    const int32 BlobVersion = static_cast<int32>(Reader.ReadFixed(4));
+    const uint32 Checksum = Reader.ReadFixed(4);
+    if (Reader.HasError() || BlobMagic != Magic || BlobVersion != Version)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("HTNDomainBlob: Not a version %d domain blob"), Version);
+        return false;
+    }
+
+    if (Checksum != FCrc::MemCrc32(Data.GetData() + HeaderSize, Data.Num() - HeaderSize))
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("HTNDomainBlob: Checksum mismatch"));
+        return false;
+    }
+
+    for (int32 Section = 0; Section < Section_Count; ++Section)
+    {
+        Sections[Section].Offset = static_cast<int32>(Reader.ReadFixed(4));
+        Sections[Section].Num = static_cast<int32>(Reader.ReadFixed(4));
+
+        const int64 Stride = RecordFields[Section] > 0 ? RecordFields[Section] * 4 : (Section == Section_ObjectData ? 1 : 0);
+        if (Sections[Section].Offset < 0 || Sections[Section].Num < 0
+            || Sections[Section].Offset + Stride * Sections[Section].Num > Data.Num())
+        {
+            UE_LOG(LogHTNPlannerPlugin, Error, TEXT("HTNDomainBlob: Section %d is out of bounds"), Section);
+            return false;
+        }
+    }
+
+    // Names are the only fix-up strings need; string values are read from the blob when needed
+    Reader.Offset = Sections[Section_Strings].Offset;
+    StringOffsets.Reserve(Sections[Section_Strings].Num);
+    Names.Reserve(Sections[Section_Strings].Num);
+    for (int32 StringIndex = 0; StringIndex < Sections[Section_Strings].Num; ++StringIndex)
+    {
+        StringOffsets.Add(Reader.GetOffset());
+        Names.Add(FName(*HTNPlanBinary::BytesToString(HTNPlanBinary::ReadStringBytes(Reader))));
+    }
+
+    if (Reader.HasError())
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("HTNDomainBlob: Truncated string table"));
+        return false;
+    }
+
+    // The schema maps the domain's keys to global slots once, rather than per world state access
+    bValid = true;
+    SchemaKeys.Reserve(Sections[Section_Schema].Num);
+    SchemaSlots.Reserve(Sections[Section_Schema].Num);
+    for (int32 KeyIndex = 0; KeyIndex < Sections[Section_Schema].Num; ++KeyIndex)
+    {
+        const uint32 StringIndex = ReadField(Section_Schema, KeyIndex, 0);
+        const FName Key = Names.IsValidIndex(StringIndex) ? Names[StringIndex] : NAME_None;
+        SchemaKeys.Add(Key);
+        SchemaSlots.Add(FHTNKeySlots::FindOrAdd(Key));
+    }
+    return true;
+}
+
+uint32 FHTNDomainBlob::ReadField(ESection Section, int32 RecordIndex, int32 FieldIndex) const
+{
+    const int32 NumFields = HTNDomainBlobFormat::RecordFields[Section];
+    if (!bValid || RecordIndex < 0 || RecordIndex >= Sections[Section].Num || FieldIndex >= NumFields)
+    {
+        return HTNDomainBlobFormat::NoIndex;
+    }
+
+    const uint8* Field = Data.GetData() + Sections[Section].Offset + (RecordIndex * NumFields + FieldIndex) * 4;
+    return uint32(Field[0]) | (uint32(Field[1]) << 8) | (uint32(Field[2]) << 16) | (uint32(Field[3]) << 24);
+}
+
+FHTNProperty FHTNDomainBlob::ReadValue(ESection Section, int32 RecordIndex) const
+{
+    using namespace HTNDomainBlobFormat;
+
+    const uint32 Payload = ReadField(Section, RecordIndex, ValueField + 1);
+    switch (static_cast<EHTNPropertyType>(ReadField(Section, RecordIndex, ValueField)))
+    {
+    case EHTNPropertyType::Boolean:
+        return FHTNProperty(Payload != 0);
+    case EHTNPropertyType::Integer:
+        return FHTNProperty(static_cast<int32>(Payload));
+    case EHTNPropertyType::Float:
+        {
+            float FloatValue;
+            FMemory::Memcpy(&FloatValue, &Payload, sizeof(float));
+            return FHTNProperty(FloatValue);
+        }
+    case EHTNPropertyType::String:
+        return FHTNProperty(ReadString(Payload));
+    case EHTNPropertyType::Name:
+        return FHTNProperty(Names.IsValidIndex(Payload) ? Names[Payload] : NAME_None);
+    case EHTNPropertyType::Vector:
+        {
+            double Components[3];
+            for (int32 ComponentIndex = 0; ComponentIndex < 3; ++ComponentIndex)
+            {
+                const uint64 Low = ReadField(Section, RecordIndex, ValueField + 1 + ComponentIndex * 2);
+                const uint64 Bits = Low | (uint64(ReadField(Section, RecordIndex, ValueField + 2 + ComponentIndex * 2)) << 32);
+                FMemory::Memcpy(&Components[ComponentIndex], &Bits, sizeof(double));
+            }
+            return FHTNProperty(FVector(Components[0], Components[1], Components[2]));
+        }
+    case EHTNPropertyType::Object:
+        return FHTNProperty(static_cast<UObject*>(nullptr));
+    default:
+        return FHTNProperty::Invalid();
+    }
+}
+
+FString FHTNDomainBlob::ReadString(uint32 StringIndex) const
+{
+    if (!StringOffsets.IsValidIndex(StringIndex))
+    {
+        return FString();
+    }
+
+    HTNPlanBinary::FReader Reader(Data);
+    Reader.Offset = StringOffsets[StringIndex];
+    return HTNPlanBinary::BytesToString(HTNPlanBinary::ReadStringBytes(Reader));
+}
+
+UObject* FHTNDomainBlob::CreateObject(int32 ObjectIndex, UObject* Outer) const
+{
+    const uint32 ClassString = ReadField(Section_Objects, ObjectIndex, 0);
+    if (!Names.IsValidIndex(ClassString))
+    {
+        return nullptr;
+    }
+
+    UClass* Class = FSoftClassPath(Names[ClassString].ToString()).TryLoadClass<UObject>();
+    if (!Class)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("HTNDomainBlob: Missing node class %s"), *Names[ClassString].ToString());
+        return nullptr;
+    }
+
+    const int32 DataOffset = static_cast<int32>(ReadField(Section_Objects, ObjectIndex, 1));
+    const int32 DataSize = static_cast<int32>(ReadField(Section_Objects, ObjectIndex, 2));
+    if (DataOffset < 0 || DataSize < 0 || DataOffset + DataSize > Sections[Section_ObjectData].Num)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("HTNDomainBlob: Object %d data is out of bounds"), ObjectIndex);
+        return nullptr;
+    }
+
+    UObject* Object = NewObject<UObject>(Outer, Class);
+    FMemoryReaderView Reader(Data.Slice(Sections[Section_ObjectData].Offset + DataOffset, DataSize), true);
+    HTNDomainBlobFormat::FNodePropertyArchive Archive(Reader);
+    Class->SerializeTaggedProperties(Archive, reinterpret_cast<uint8*>(Object), Class, reinterpret_cast<uint8*>(Class->GetDefaultObject()));
+    return Object;
+}
+
+bool FHTNDomainBlob::CreateTasks(UObject* Outer, TArray<UHTNTask*>& OutGoalTasks) const
+{
+    using namespace HTNDomainBlobFormat;
+
+    if (!bValid)
+    {
+        return false;
+    }
+
+    const TSharedRef<const FHTNDomainBlob, ESPMode::ThreadSafe> SharedThis = AsShared();
+    bool bAllCreated = true;
+
+    auto CreateConditions = [&](uint32 First, uint32 Num, TArray<UHTNCondition*>& OutConditions)
+    {
+        for (uint32 ConditionIndex = First; ConditionIndex < First + Num; )
+        {
+            if (ReadField(Section_Conditions, ConditionIndex, 0) != ConditionKind_Property)
+            {
+                UHTNCondition* Condition = Cast<UHTNCondition>(CreateObject(ReadField(Section_Conditions, ConditionIndex, 1), Outer));
+                bAllCreated &= Condition != nullptr;
+                if (Condition)
+                {
+                    OutConditions.Add(Condition);
+                }
+                ++ConditionIndex;
+                continue;
+            }
+
+            // Consecutive property conditions share one object, keeping their order relative to object conditions
+            uint32 RunEnd = ConditionIndex + 1;
+            while (RunEnd < First + Num && ReadField(Section_Conditions, RunEnd, 0) == ConditionKind_Property)
+            {
+                ++RunEnd;
+            }
+
+            UHTNCookedConditions* CookedConditions = NewObject<UHTNCookedConditions>(Outer);
+            CookedConditions->Initialize(SharedThis, ConditionIndex, RunEnd - ConditionIndex);
+            OutConditions.Add(CookedConditions);
+            ConditionIndex = RunEnd;
+        }
+    };
+
+    auto CreateEffects = [&](uint32 First, uint32 Num, TArray<UHTNEffect*>& OutEffects)
+    {
+        for (uint32 EffectIndex = First; EffectIndex < First + Num; )
+        {
+            if (ReadField(Section_Effects, EffectIndex, 0) == EffectKind_Object)
+            {
+                UHTNEffect* Effect = Cast<UHTNEffect>(CreateObject(ReadField(Section_Effects, EffectIndex, 1), Outer));
+                bAllCreated &= Effect != nullptr;
+                if (Effect)
+                {
+                    OutEffects.Add(Effect);
+                }
+                ++EffectIndex;
+                continue;
+            }
+
+            // Consecutive cooked effects share one object, keeping their order relative to object effects
+            uint32 RunEnd = EffectIndex + 1;
+            while (RunEnd < First + Num && ReadField(Section_Effects, RunEnd, 0) != EffectKind_Object)
+            {
+                ++RunEnd;
+            }
+
+            UHTNCookedEffects* CookedEffects = NewObject<UHTNCookedEffects>(Outer);
+            CookedEffects->Initialize(SharedThis, EffectIndex, RunEnd - EffectIndex);
+            OutEffects.Add(CookedEffects);
+            EffectIndex = RunEnd;
+        }
+    };
+
+    // Create every task before linking, since subtasks can refer back to their ancestors
+    TArray<UHTNTask*> Tasks;
+    Tasks.SetNumZeroed(Sections[Section_Tasks].Num);
+    for (int32 TaskIndex = 0; TaskIndex < Tasks.Num(); ++TaskIndex)
+    {
+        Tasks[TaskIndex] = Cast<UHTNTask>(CreateObject(ReadField(Section_Tasks, TaskIndex, 0), Outer));
+        bAllCreated &= Tasks[TaskIndex] != nullptr;
+    }
+
+    for (int32 TaskIndex = 0; TaskIndex < Tasks.Num(); ++TaskIndex)
+    {
+        if (UHTNPrimitiveTask* PrimitiveTask = Cast<UHTNPrimitiveTask>(Tasks[TaskIndex]))
+        {
+            CreateConditions(ReadField(Section_Tasks, TaskIndex, 2), ReadField(Section_Tasks, TaskIndex, 3), PrimitiveTask->Preconditions);
+            PrimitiveTask->CompilePreconditions();
+            CreateEffects(ReadField(Section_Tasks, TaskIndex, 4), ReadField(Section_Tasks, TaskIndex, 5), PrimitiveTask->Effects);
+        }
+        else if (UHTNCompoundTask* CompoundTask = Cast<UHTNCompoundTask>(Tasks[TaskIndex]))
+        {
+            const uint32 FirstMethod = ReadField(Section_Tasks, TaskIndex, 2);
+            const uint32 NumMethods = ReadField(Section_Tasks, TaskIndex, 3);
+            for (uint32 MethodIndex = FirstMethod; MethodIndex < FirstMethod + NumMethods; ++MethodIndex)
+            {
+                UHTNMethod* Method = Cast<UHTNMethod>(CreateObject(ReadField(Section_Methods, MethodIndex, 0), Outer));
+                if (!Method)
+                {
+                    continue;
+                }
+
+                CreateConditions(ReadField(Section_Methods, MethodIndex, 1), ReadField(Section_Methods, MethodIndex, 2), Method->Conditions);
+                Method->CompileConditions();
+
+                const uint32 FirstRef = ReadField(Section_Methods, MethodIndex, 3);
+                const uint32 NumRefs = ReadField(Section_Methods, MethodIndex, 4);
+                for (uint32 RefIndex = FirstRef; RefIndex < FirstRef + NumRefs; ++RefIndex)
+                {
+                    const uint32 SubtaskIndex = ReadField(Section_TaskRefs, RefIndex, 0);
+                    if (Tasks.IsValidIndex(SubtaskIndex) && Tasks[SubtaskIndex])
+                    {
+                        Method->Subtasks.Add(Tasks[SubtaskIndex]);
+                    }
+                }
+                CompoundTask->Methods.Add(Method);
+            }
+        }
+    }
+
+    for (int32 GoalIndex = 0; GoalIndex < Sections[Section_Goals].Num; ++GoalIndex)
+    {
+        const uint32 TaskIndex = ReadField(Section_Goals, GoalIndex, 0);
+        if (Tasks.IsValidIndex(TaskIndex) && Tasks[TaskIndex])
+        {
+            OutGoalTasks.Add(Tasks[TaskIndex]);
+        }
+    }
+
+    if (!bAllCreated)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNDomainBlob: Some domain nodes could not be recreated"));
+    }
+    return bAllCreated;
+}
+
+bool FHTNDomainBlob::CheckCondition(int32 ConditionIndex, const UHTNWorldState* WorldState) const
+{
+    const EHTNPropertyCheckType CheckType = static_cast<EHTNPropertyCheckType>(ReadField(Section_Conditions, ConditionIndex, 2));
+    return UHTNPropertyCondition::CheckProperty(WorldState, GetConditionKey(ConditionIndex), CheckType, ReadValue(Section_Conditions, ConditionIndex));
+}
+
+void FHTNDomainBlob::ApplyEffect(int32 EffectIndex, UHTNWorldState* WorldState) const
+{
+    using namespace HTNDomainBlobFormat;
+
+    if (!WorldState)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNDomainBlob: World state is null"));
+        return;
+    }
+
+    const FName Key = GetEffectKey(EffectIndex);
+    const uint32 Argument = ReadField(Section_Effects, EffectIndex, 2);
+    switch (ReadField(Section_Effects, EffectIndex, 0))
+    {
+    case EffectKind_Set:
+        WorldState->SetProperty(Key, ReadValue(Section_Effects, EffectIndex));
+        break;
+
+    case EffectKind_Remove:
+        WorldState->RemoveProperty(Key);
+        break;
+
+    case EffectKind_Copy:
+        {
+            FHTNProperty SourceValue;
+            if (SchemaKeys.IsValidIndex(Argument) && WorldState->GetProperty(SchemaKeys[Argument], SourceValue))
+            {
+                WorldState->SetProperty(Key, SourceValue);
+            }
+            break;
+        }
+
+    case EffectKind_Toggle:
+        UHTNToggleEffect::ToggleProperty(WorldState, Key, (Argument & Toggle_SetTrueIfMissing) != 0,
+            (Argument & Toggle_ForceValue) != 0, (Argument & Toggle_ForcedValue) != 0);
+        break;
+
+    default:
+        break;
+    }
+}
+
+FName FHTNDomainBlob::GetConditionKey(int32 ConditionIndex) const
+{
+    const uint32 KeyIndex = ReadField(Section_Conditions, ConditionIndex, 1);
+    return SchemaKeys.IsValidIndex(KeyIndex) ? SchemaKeys[KeyIndex] : NAME_None;
+}
+
+bool FHTNDomainBlob::GetConditionRequiredBoolValue(int32 ConditionIndex, bool& bOutExpectedValue) const
+{
+    switch (static_cast<EHTNPropertyCheckType>(ReadField(Section_Conditions, ConditionIndex, 2)))
+    {
+    case EHTNPropertyCheckType::IsTrue:
+        bOutExpectedValue = true;
+        return true;
+
+    case EHTNPropertyCheckType::IsFalse:
+        bOutExpectedValue = false;
+        return true;
+
+    case EHTNPropertyCheckType::Equals:
+        if (static_cast<EHTNPropertyType>(ReadField(Section_Conditions, ConditionIndex, HTNDomainBlobFormat::ValueField)) != EHTNPropertyType::Boolean)
+        {
+            return false;
+        }
+        bOutExpectedValue = ReadField(Section_Conditions, ConditionIndex, HTNDomainBlobFormat::ValueField + 1) != 0;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+FName FHTNDomainBlob::GetEffectKey(int32 EffectIndex) const
+{
+    const uint32 KeyIndex = ReadField(Section_Effects, EffectIndex, 1);
+    return SchemaKeys.IsValidIndex(KeyIndex) ? SchemaKeys[KeyIndex] : NAME_None;
+}
+
+FName FHTNDomainBlob::GetEffectReadKey(int32 EffectIndex) const
+{
+    using namespace HTNDomainBlobFormat;
+
+    switch (ReadField(Section_Effects, EffectIndex, 0))
+    {
+    case EffectKind_Copy:
+        {
+            const uint32 SourceKeyIndex = ReadField(Section_Effects, EffectIndex, 2);
+            return SchemaKeys.IsValidIndex(SourceKeyIndex) ? SchemaKeys[SourceKeyIndex] : NAME_None;
+        }
+
+    case EffectKind_Toggle:
+        return GetEffectKey(EffectIndex);
+
+    default:
+        return NAME_None;
+    }
+}
+
+FString FHTNDomainBlob::DescribeCondition(int32 ConditionIndex) const
+{
+    const int64 CheckType = ReadField(Section_Conditions, ConditionIndex, 2);
+    return FString::Printf(TEXT("%s %s %s"), *GetConditionKey(ConditionIndex).ToString(),
+        *StaticEnum<EHTNPropertyCheckType>()->GetNameStringByValue(CheckType), *ReadValue(Section_Conditions, ConditionIndex).ToString());
+}
+
+FString FHTNDomainBlob::DescribeEffect(int32 EffectIndex) const
+{
+    using namespace HTNDomainBlobFormat;
+
+    const FString Key = GetEffectKey(EffectIndex).ToString();
+    const uint32 Argument = ReadField(Section_Effects, EffectIndex, 2);
+    switch (ReadField(Section_Effects, EffectIndex, 0))
+    {
+    case EffectKind_Set:
+        return FString::Printf(TEXT("Set %s = %s"), *Key, *ReadValue(Section_Effects, EffectIndex).ToString());
+    case EffectKind_Remove:
+        return FString::Printf(TEXT("Remove property: %s"), *Key);
+    case EffectKind_Copy:
+        return FString::Printf(TEXT("Set %s = %s (from property)"), *Key, SchemaKeys.IsValidIndex(Argument) ? *SchemaKeys[Argument].ToString() : TEXT("None"));
+    case EffectKind_Toggle:
+        return (Argument & Toggle_ForceValue) != 0
+            ? FString::Printf(TEXT("Set %s = %s"), *Key, (Argument & Toggle_ForcedValue) != 0 ? TEXT("true") : TEXT("false"))
+            : FString::Printf(TEXT("Toggle %s"), *Key);
+    default:
+        return FString();
+    }
+}
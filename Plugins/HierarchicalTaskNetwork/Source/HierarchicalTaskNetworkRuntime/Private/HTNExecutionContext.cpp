@@ -1,14 +1,17 @@
 #include "HTNExecutionContext.h"
 #include "HTNProperty.h"
 #include "HTNLogging.h"
+#include "HTNPlanExecutor.h"
 
 UHTNExecutionContext::UHTNExecutionContext()
     : WorldState(nullptr)
+    , ActiveTaskMemory(nullptr)
 {
 }
 
 UHTNExecutionContext::UHTNExecutionContext(const UHTNExecutionContext* Other)
     : Parameters(Other->Parameters)
+    , ActiveTaskMemory(nullptr)
 {
     // Deep copy the world state if it exists
     if (Other->WorldState)
@@ -26,6 +29,12 @@ void UHTNExecutionContext::SetWorldState(UHTNWorldState* InWorldState)
     WorldState = InWorldState;
 }
 
+FHTNTaskCompletionHandle UHTNExecutionContext::MakeCompletionHandle() const
+{
+    const UHTNPlanExecutor* CurrentExecutor = Executor.Get();
+    return CurrentExecutor ? CurrentExecutor->MakeCompletionHandle(ActiveTaskMemory) : FHTNTaskCompletionHandle();
+}
+
 bool UHTNExecutionContext::GetParameter(FName Key, FHTNProperty& OutValue) const
 {
     if (const FHTNProperty* Property = Parameters.Find(Key))
@@ -63,6 +72,13 @@ void UHTNExecutionContext::ClearParameters()
     Parameters.Empty();
 }
 
+void UHTNExecutionContext::Reset()
+{
+    Parameters.Reset();
+    ActiveTaskMemory = nullptr;
+    Executor.Reset();
+}
+
 FString UHTNExecutionContext::ToString() const
 {
     FString Result = TEXT("HTN Execution Context:\n");
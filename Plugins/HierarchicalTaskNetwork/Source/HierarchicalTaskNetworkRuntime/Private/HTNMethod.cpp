@@ -13,20 +13,35 @@ UHTNMethod::UHTNMethod()
     }
 }
 
-bool UHTNMethod::IsApplicable_Implementation(const UHTNWorldState* WorldState) const
+void UHTNMethod::PostLoad()
 {
-    // Check all conditions
-    for (const UHTNCondition* Condition : Conditions)
+    Super::PostLoad();
+
+    CompileConditions();
+}
+
+#if WITH_EDITOR
+void UHTNMethod::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+    Super::PostEditChangeProperty(PropertyChangedEvent);
+
+    // Edits to the conditions themselves report the owning array as the member property
+    if (PropertyChangedEvent.GetMemberPropertyName() == GET_MEMBER_NAME_CHECKED(UHTNMethod, Conditions))
     {
-        if (Condition && !Condition->CheckCondition(WorldState))
-        {
-            // If any condition fails, this method is not applicable
-            return false;
-        }
+        CompileConditions();
     }
-    
-    // If there are no conditions or all conditions pass, the method is applicable
-    return true;
+}
+#endif
+
+void UHTNMethod::CompileConditions()
+{
+    ConditionMask.Compile(Conditions);
+}
+
+bool UHTNMethod::IsApplicable_Implementation(const UHTNWorldState* WorldState) const
+{
+    // Boolean conditions are checked together as bit masks, the rest one by one
+    return ConditionMask.CheckConditions(Conditions, WorldState);
 }
 
 FString UHTNMethod::GetDescription_Implementation() const
@@ -1,6 +1,10 @@
 #include "HTNPlan.h"
 
 #include "HTNLogging.h"
+#include "HTNMethod.h"
+#include "HTNPlanBinaryFormat.h"
+#include "HTNTaskIndex.h"
+#include "Serialization/JsonReader.h"
 #include "Tasks/HTNPrimitiveTask.h"
 
 FHTNPlan::FHTNPlan()
@@ -55,6 +59,7 @@ FHTNPlan::FHTNPlan(const FHTNPlan& Other)
     , TaskParameters(Other.TaskParameters)
     , TaskResults(Other.TaskResults)
     , TaskDependencies(Other.TaskDependencies)
+    , Decomposition(Other.Decomposition)
 {
 }
 
@@ -72,6 +77,7 @@ FHTNPlan::FHTNPlan(FHTNPlan&& Other) noexcept
     , TaskParameters(MoveTemp(Other.TaskParameters))
     , TaskResults(MoveTemp(Other.TaskResults))
     , TaskDependencies(MoveTemp(Other.TaskDependencies))
+    , Decomposition(MoveTemp(Other.Decomposition))
 {
     // Reset the moved-from object to a valid state
     Other.TotalCost = 0.0f;
@@ -102,6 +108,7 @@ FHTNPlan& FHTNPlan::operator=(const FHTNPlan& Other)
         TaskParameters = Other.TaskParameters;
         TaskResults = Other.TaskResults;
         TaskDependencies = Other.TaskDependencies;
+        Decomposition = Other.Decomposition;
     }
     return *this;
 }
@@ -123,6 +130,7 @@ FHTNPlan& FHTNPlan::operator=(FHTNPlan&& Other) noexcept
         TaskParameters = MoveTemp(Other.TaskParameters);
         TaskResults = MoveTemp(Other.TaskResults);
         TaskDependencies = MoveTemp(Other.TaskDependencies);
+        Decomposition = MoveTemp(Other.Decomposition);
         
         // Reset the moved-from object to a valid state
         Other.TotalCost = 0.0f;
@@ -183,6 +191,7 @@ void FHTNPlan::Clear()
     TaskParameters.Empty();
     TaskResults.Empty();
     TaskDependencies.Empty();
+    Decomposition.Empty();
 }
 
 bool FHTNPlan::IsEmpty() const
@@ -467,30 +476,30 @@ bool FHTNPlan::AddTaskDependency(int32 TaskIndex, int32 DependsOnTaskIndex)
         return false;
     }
     
-    // Check for circular dependencies
-    TArray<int32> VisitedIndices;
-    VisitedIndices.Add(TaskIndex);
+    // Check for circular dependencies: the task must not already be a transitive dependency of the one it depends on
+    TBitArray<> VisitedIndices(false, Tasks.Num());
+    TArray<int32, TInlineAllocator<16>> Stack;
+    Stack.Add(DependsOnTaskIndex);
     
-    TArray<int32> Queue;
-    Queue.Add(DependsOnTaskIndex);
-    
-    while (Queue.Num() > 0)
+    while (Stack.Num() > 0)
     {
-        int32 CurrentIndex = Queue[0];
-        Queue.RemoveAt(0);
-        
-        if (VisitedIndices.Contains(CurrentIndex))
+        const int32 CurrentIndex = Stack.Pop(EAllowShrinking::No);
+        if (CurrentIndex == TaskIndex)
         {
             UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Adding dependency would create a circular reference"));
             return false;
         }
         
-        VisitedIndices.Add(CurrentIndex);
+        // Diamonds reach a task more than once, which is not a cycle
+        if (!Tasks.IsValidIndex(CurrentIndex) || VisitedIndices[CurrentIndex])
+        {
+            continue;
+        }
+        VisitedIndices[CurrentIndex] = true;
         
-        TArray<int32>* Dependencies = TaskDependencies.Find(CurrentIndex);
-        if (Dependencies)
+        if (const TArray<int32>* Dependencies = TaskDependencies.Find(CurrentIndex))
         {
-            Queue.Append(*Dependencies);
+            Stack.Append(*Dependencies);
         }
     }
     
@@ -532,6 +541,163 @@ bool FHTNPlan::AreTaskDependenciesSatisfied(int32 TaskIndex) const
     return true;
 }
 
+void FHTNPlan::InferTaskDependencies()
+{
+    TaskDependencies.Reset();
+    
+    // The last task that wrote each key, and the tasks that read it since
+    struct FKeyAccesses
+    {
+        int32 LastWriter = INDEX_NONE;
+        TArray<int32> Readers;
+    };
+    TMap<FName, FKeyAccesses> KeyAccesses;
+    
+    // A task with unknown keys orders everything around it, so the tasks after it only need to depend on it
+    int32 LastBarrier = INDEX_NONE;
+    
+    // For each task, the set of tasks it transitively depends on; tasks only depend on earlier tasks
+    TArray<TBitArray<>> TransitiveDependencies;
+    TransitiveDependencies.Reserve(Tasks.Num());
+    
+    TArray<FName> ReadKeys;
+    TArray<FName> WriteKeys;
+    TArray<int32> DirectDependencies;
+    for (int32 TaskIndex = 0; TaskIndex < Tasks.Num(); ++TaskIndex)
+    {
+        const UHTNPrimitiveTask* Task = Tasks[TaskIndex];
+        ReadKeys.Reset();
+        WriteKeys.Reset();
+        const bool bKeysKnown = Task && Task->GetPreconditionReadKeys(ReadKeys) && Task->GetEffectReadKeys(ReadKeys) && Task->GetEffectWriteKeys(WriteKeys);
+        
+        DirectDependencies.Reset();
+        if (LastBarrier != INDEX_NONE)
+        {
+            DirectDependencies.Add(LastBarrier);
+        }
+        
+        if (!bKeysKnown)
+        {
+            for (int32 PreviousIndex = LastBarrier + 1; PreviousIndex < TaskIndex; ++PreviousIndex)
+            {
+                DirectDependencies.Add(PreviousIndex);
+            }
+            KeyAccesses.Reset();
+        }
+        else
+        {
+            // A read needs the value written before it
+            for (const FName& Key : ReadKeys)
+            {
+                const FKeyAccesses* Accesses = KeyAccesses.Find(Key);
+                if (Accesses && Accesses->LastWriter != INDEX_NONE)
+                {
+                    DirectDependencies.Add(Accesses->LastWriter);
+                }
+            }
+            
+            // A write must keep the final value, and not change a value earlier tasks still read
+            for (const FName& Key : WriteKeys)
+            {
+                if (const FKeyAccesses* Accesses = KeyAccesses.Find(Key))
+                {
+                    if (Accesses->LastWriter != INDEX_NONE)
+                    {
+                        DirectDependencies.Add(Accesses->LastWriter);
+                    }
+                    DirectDependencies.Append(Accesses->Readers);
+                }
+            }
+            
+            for (const FName& Key : ReadKeys)
+            {
+                KeyAccesses.FindOrAdd(Key).Readers.Add(TaskIndex);
+            }
+            for (const FName& Key : WriteKeys)
+            {
+                FKeyAccesses& Accesses = KeyAccesses.FindOrAdd(Key);
+                Accesses.LastWriter = TaskIndex;
+                Accesses.Readers.Reset();
+            }
+        }
+        
+        // Transitive reduction: going from the latest dependency down, every dependency implied by a later one is
+        // already in the set, since a task can only be reached through tasks after it
+        DirectDependencies.Sort(TGreater<int32>());
+        TBitArray<>& Reachable = TransitiveDependencies.Emplace_GetRef(false, TaskIndex);
+        for (int32 DependencyIndex : DirectDependencies)
+        {
+            if (Reachable[DependencyIndex])
+            {
+                continue;
+            }
+            
+            Reachable.CombineWithBitwiseOR(TransitiveDependencies[DependencyIndex], EBitwiseOperatorFlags::MaxSize);
+            Reachable[DependencyIndex] = true;
+            TaskDependencies.FindOrAdd(TaskIndex).Add(DependencyIndex);
+        }
+        
+        if (!bKeysKnown)
+        {
+            LastBarrier = TaskIndex;
+        }
+    }
+}
+
+int32 FHTNPlan::FindDecompositionNode(int32 TaskIndex) const
+{
+    // Primitive task nodes are the only ones without a method, and come in plan order
+    for (int32 NodeIndex = 0; NodeIndex < Decomposition.Num(); ++NodeIndex)
+    {
+        const FHTNDecompositionNode& Node = Decomposition[NodeIndex];
+        if (!Node.Method && Node.FirstTaskIndex == TaskIndex)
+        {
+            return NodeIndex;
+        }
+    }
+    return INDEX_NONE;
+}
+
+float FHTNPlan::GetDecompositionNodeCost(int32 NodeIndex) const
+{
+    if (!Decomposition.IsValidIndex(NodeIndex))
+    {
+        return 0.0f;
+    }
+    
+    const FHTNDecompositionNode& Node = Decomposition[NodeIndex];
+    float Cost = 0.0f;
+    for (int32 TaskIndex = Node.FirstTaskIndex; TaskIndex < Node.FirstTaskIndex + Node.NumTasks; ++TaskIndex)
+    {
+        if (Tasks.IsValidIndex(TaskIndex) && Tasks[TaskIndex])
+        {
+            Cost += Tasks[TaskIndex]->GetCost();
+        }
+    }
+    return Cost;
+}
+
+FString FHTNPlan::GetDecompositionString() const
+{
+    FString Result;
+    TArray<int32> Depths;
+    Depths.Reserve(Decomposition.Num());
+    for (const FHTNDecompositionNode& Node : Decomposition)
+    {
+        const int32 Depth = Decomposition.IsValidIndex(Node.ParentIndex) ? Depths[Node.ParentIndex] + 1 : 0;
+        Depths.Add(Depth);
+        
+        Result += FString::ChrN(Depth * 2, TEXT(' '));
+        Result += Node.Task ? Node.Task->ToString() : TEXT("NULL");
+        if (Node.Method)
+        {
+            Result += FString::Printf(TEXT(" via %s"), *Node.Method->GetDescription());
+        }
+        Result += FString::Printf(TEXT(" [tasks %d-%d]\n"), Node.FirstTaskIndex, Node.FirstTaskIndex + Node.NumTasks - 1);
+    }
+    return Result;
+}
+
 TArray<int32> FHTNPlan::FindTasksByName(FName TaskName) const
 {
     TArray<int32> FoundIndices;
@@ -735,6 +901,25 @@ FHTNPlan FHTNPlan::ExtractSubplan(int32 StartIndex, int32 EndIndex) const
         }
     }
     
+    // Keep the decomposition nodes that produced any of the extracted tasks, with their spans clipped;
+    // a parent's span contains its children's, so the parent of a kept node is always kept too
+    TArray<int32> NodeRemap;
+    NodeRemap.Init(INDEX_NONE, Decomposition.Num());
+    for (int32 NodeIndex = 0; NodeIndex < Decomposition.Num(); ++NodeIndex)
+    {
+        const FHTNDecompositionNode& Node = Decomposition[NodeIndex];
+        const int32 FirstTaskIndex = FMath::Max(Node.FirstTaskIndex, StartIndex);
+        const int32 EndTaskIndex = FMath::Min(Node.FirstTaskIndex + Node.NumTasks, EndIndex + 1);
+        if (FirstTaskIndex < EndTaskIndex)
+        {
+            NodeRemap[NodeIndex] = Subplan.Decomposition.Num();
+            FHTNDecompositionNode& SubplanNode = Subplan.Decomposition.Add_GetRef(Node);
+            SubplanNode.ParentIndex = Decomposition.IsValidIndex(Node.ParentIndex) ? NodeRemap[Node.ParentIndex] : INDEX_NONE;
+            SubplanNode.FirstTaskIndex = FirstTaskIndex - StartIndex;
+            SubplanNode.NumTasks = EndTaskIndex - FirstTaskIndex;
+        }
+    }
+    
     return Subplan;
 }
 
@@ -986,233 +1171,277 @@ bool FHTNPlan::ReplaceSection(int32 StartIndex, int32 EndIndex, const FHTNPlan&
     // Replace the dependencies map
     TaskDependencies = NewDependencies;
     
+    // The tree doesn't say which of its nodes the replacement stands for, so it no longer describes the plan
+    Decomposition.Reset();
+    
     return true;
 }
 
-bool FHTNPlan::ToBinary(TArray<uint8>& OutData)
+void FHTNPlan::RemoveTasks(TConstArrayView<int32> TaskIndices)
 {
-    // Create a memory writer to serialize the data
-    FMemoryWriter MemWriter(OutData);
-    
-    // Write a version number for backward compatibility
-    int32 SerializationVersion = 1;
-    MemWriter << SerializationVersion;
-    
-    // Write basic plan data
-    float TotalCostCopy = TotalCost;
-    MemWriter << TotalCostCopy;
-
-    int32 CurrentTaskIndexCopy = CurrentTaskIndex;
-    MemWriter << CurrentTaskIndexCopy;
-
-    // Convert bit fields to bool for serialization
-    bool IsExecutingCopy = bIsExecuting;
-    MemWriter << IsExecutingCopy;
-
-    bool IsCompleteCopy = bIsComplete;
-    MemWriter << IsCompleteCopy;
-
-    bool FailedCopy = bFailed;
-    MemWriter << FailedCopy;
-
-    bool IsPausedCopy = bIsPaused;
-    MemWriter << IsPausedCopy;
-
-    float StartTimeCopy = StartTime;
-    MemWriter << StartTimeCopy;
-
-    float EndTimeCopy = EndTime;
-    MemWriter << EndTimeCopy;
-    
-    // Write the status as an integer
-    int32 StatusInt = static_cast<int32>(Status);
-    MemWriter << StatusInt;
+    TBitArray<> Removed(false, Tasks.Num());
+    for (int32 TaskIndex : TaskIndices)
+    {
+        if (Tasks.IsValidIndex(TaskIndex))
+        {
+            Removed[TaskIndex] = true;
+        }
+    }
     
-    // Write task references
-    // Note: This only writes GUIDs, not the actual tasks
-    // The tasks will need to be resolved separately
-    int32 TaskCount = Tasks.Num();
-    MemWriter << TaskCount;
+    // Number of kept tasks before each index, which is also the new index of every kept task
+    TArray<int32> NumKeptBefore;
+    NumKeptBefore.SetNumUninitialized(Tasks.Num() + 1);
+    NumKeptBefore[0] = 0;
+    for (int32 TaskIndex = 0; TaskIndex < Tasks.Num(); ++TaskIndex)
+    {
+        NumKeptBefore[TaskIndex + 1] = NumKeptBefore[TaskIndex] + (Removed[TaskIndex] ? 0 : 1);
+    }
+    if (NumKeptBefore.Last() == Tasks.Num())
+    {
+        return;
+    }
     
-    for (int32 i = 0; i < Tasks.Num(); ++i)
+    TArray<UHTNPrimitiveTask*> KeptTasks;
+    KeptTasks.Reserve(NumKeptBefore.Last());
+    for (int32 TaskIndex = 0; TaskIndex < Tasks.Num(); ++TaskIndex)
     {
-        const UHTNPrimitiveTask* Task = Tasks[i];
-        if (Task)
+        if (!Removed[TaskIndex])
         {
-            bool bValidTask = true;
-            MemWriter << bValidTask;
-            
-            // Write the task GUID and class name for later reconstruction
-            FGuid TaskID = Task->GetTaskID();
-            FString ClassName = Task->GetClass()->GetPathName();
-            FName TaskName = Task->TaskName;
-            float Cost = Task->GetCost();
-            
-            MemWriter << TaskID;
-            MemWriter << ClassName;
-            MemWriter << TaskName;
-            MemWriter << Cost;
+            KeptTasks.Add(Tasks[TaskIndex]);
         }
-        else
+        else if (Tasks[TaskIndex])
         {
-            bool bValidTask = false;
-            MemWriter << bValidTask;
+            TotalCost -= Tasks[TaskIndex]->GetCost();
         }
     }
     
-    // Write task parameters
-    int32 ParamCount = TaskParameters.Num();
-    MemWriter << ParamCount;
-    
-    for (auto& Pair : TaskParameters)
+    // Parameters and results are keyed by task index, see SetTaskParameter
+    auto RemapTaskValues = [&Removed, &NumKeptBefore](TMap<FName, FHTNProperty>& Values)
     {
-        MemWriter << Pair.Key;
-        
-        // Serialize the property type
-        int32 PropType = static_cast<int32>(Pair.Value.GetType());
-        MemWriter << PropType;
-        
-        // Serialize the property value based on its type
-        switch (Pair.Value.GetType())
+        TMap<FName, FHTNProperty> KeptValues;
+        for (const auto& Pair : Values)
         {
-        case EHTNPropertyType::Boolean:
+            const FString KeyStr = Pair.Key.ToString();
+            const int32 UnderscorePos = KeyStr.StartsWith(TEXT("Task_")) ? KeyStr.Find(TEXT("_"), ESearchCase::CaseSensitive, ESearchDir::FromStart, 5) : INDEX_NONE;
+            if (UnderscorePos == INDEX_NONE)
             {
-                bool BoolValue = Pair.Value.GetBoolValue();
-                MemWriter << BoolValue;
-                break;
-            }
-        case EHTNPropertyType::Integer:
-            {
-                int32 IntValue = Pair.Value.GetIntValue();
-                MemWriter << IntValue;
-                break;
-            }
-        case EHTNPropertyType::Float:
-            {
-                float FloatValue = Pair.Value.GetFloatValue();
-                MemWriter << FloatValue;
-                break;
-            }
-        case EHTNPropertyType::String:
-            {
-                FString StringValue = Pair.Value.GetStringValue();
-                MemWriter << StringValue;
-                break;
-            }
-        case EHTNPropertyType::Name:
-            {
-                FName NameValue = Pair.Value.GetNameValue();
-                MemWriter << NameValue;
-                break;
-            }
-        case EHTNPropertyType::Vector:
-            {
-                FVector VectorValue = Pair.Value.GetVectorValue();
-                MemWriter << VectorValue;
-                break;
+                KeptValues.Add(Pair.Key, Pair.Value);
+                continue;
             }
-        case EHTNPropertyType::Object:
+            
+            const int32 TaskIndex = FCString::Atoi(*KeyStr.Mid(5, UnderscorePos - 5));
+            if (Removed.IsValidIndex(TaskIndex) && !Removed[TaskIndex])
             {
-                // For objects, just write a null reference as they can't be reliably serialized
-                bool bHasObject = false;
-                MemWriter << bHasObject;
-                break;
+                KeptValues.Add(FName(*FString::Printf(TEXT("Task_%d_%s"), NumKeptBefore[TaskIndex], *KeyStr.RightChop(UnderscorePos + 1))), Pair.Value);
             }
-            default:
+        }
+        Values = MoveTemp(KeptValues);
+    };
+    RemapTaskValues(TaskParameters);
+    RemapTaskValues(TaskResults);
+    
+    TMap<int32, TArray<int32>> KeptDependencies;
+    for (const auto& Pair : TaskDependencies)
+    {
+        if (!Removed.IsValidIndex(Pair.Key) || Removed[Pair.Key])
+        {
+            continue;
+        }
+        
+        TArray<int32> AdjustedDependencies;
+        for (int32 DepIndex : Pair.Value)
+        {
+            if (Removed.IsValidIndex(DepIndex) && !Removed[DepIndex])
             {
-                // Invalid type, just write a marker
-                bool bInvalidType = true;
-                MemWriter << bInvalidType;
-                break;
+                AdjustedDependencies.Add(NumKeptBefore[DepIndex]);
             }
         }
+        
+        if (AdjustedDependencies.Num() > 0)
+        {
+            KeptDependencies.Add(NumKeptBefore[Pair.Key], MoveTemp(AdjustedDependencies));
+        }
     }
+    TaskDependencies = MoveTemp(KeptDependencies);
     
-    // Write task results (same pattern as parameters)
-    int32 ResultCount = TaskResults.Num();
-    MemWriter << ResultCount;
-    
-    for (auto& Pair : TaskResults)
+    // The nodes of removed tasks are dropped; they are leaves, so only the parent indices after them shift
+    TArray<int32> NodeRemap;
+    NodeRemap.Init(INDEX_NONE, Decomposition.Num());
+    TArray<FHTNDecompositionNode> KeptNodes;
+    KeptNodes.Reserve(Decomposition.Num());
+    for (int32 NodeIndex = 0; NodeIndex < Decomposition.Num(); ++NodeIndex)
     {
-        MemWriter << Pair.Key;
-        
-        // Serialize the property type
-        int32 PropType = static_cast<int32>(Pair.Value.GetType());
-        MemWriter << PropType;
+        const FHTNDecompositionNode& Node = Decomposition[NodeIndex];
+        if (!Node.Method && Removed.IsValidIndex(Node.FirstTaskIndex) && Removed[Node.FirstTaskIndex])
+        {
+            continue;
+        }
         
-        // Serialize the property value based on its type
-        switch (Pair.Value.GetType())
+        const int32 FirstTaskIndex = FMath::Clamp(Node.FirstTaskIndex, 0, Tasks.Num());
+        const int32 EndTaskIndex = FMath::Clamp(Node.FirstTaskIndex + Node.NumTasks, FirstTaskIndex, Tasks.Num());
+        NodeRemap[NodeIndex] = KeptNodes.Num();
+        FHTNDecompositionNode& KeptNode = KeptNodes.Add_GetRef(Node);
+        KeptNode.ParentIndex = Decomposition.IsValidIndex(Node.ParentIndex) ? NodeRemap[Node.ParentIndex] : INDEX_NONE;
+        KeptNode.FirstTaskIndex = NumKeptBefore[FirstTaskIndex];
+        KeptNode.NumTasks = NumKeptBefore[EndTaskIndex] - KeptNode.FirstTaskIndex;
+    }
+    Decomposition = MoveTemp(KeptNodes);
+    
+    CurrentTaskIndex = NumKeptBefore[FMath::Clamp(CurrentTaskIndex, 0, Tasks.Num())];
+    Tasks = MoveTemp(KeptTasks);
+}
+
+bool FHTNPlan::ToBinary(TArray<uint8>& OutData)
+{
+    using namespace HTNPlanBinary;
+    
+    // Strings are collected while the body is written, and written once ahead of it
+    FStringTableBuilder GetStringIndex;
+    
+    // Task strings first, so the index width of the task records is known before they are written
+    for (const UHTNPrimitiveTask* Task : Tasks)
+    {
+        if (Task)
         {
-        case EHTNPropertyType::Boolean:
-            {
-                bool BoolValue = Pair.Value.GetBoolValue();
-                MemWriter << BoolValue;
-                break;
-            }
-        case EHTNPropertyType::Integer:
-            {
-                int32 IntValue = Pair.Value.GetIntValue();
-                MemWriter << IntValue;
-                break;
-            }
-        case EHTNPropertyType::Float:
-            {
-                float FloatValue = Pair.Value.GetFloatValue();
-                MemWriter << FloatValue;
-                break;
-            }
-        case EHTNPropertyType::String:
-            {
-                FString StringValue = Pair.Value.GetStringValue();
-                MemWriter << StringValue;
-                break;
-            }
-        case EHTNPropertyType::Name:
-            {
-                FName NameValue = Pair.Value.GetNameValue();
-                MemWriter << NameValue;
-                break;
-            }
-        case EHTNPropertyType::Vector:
-            {
-                FVector VectorValue = Pair.Value.GetVectorValue();
-                MemWriter << VectorValue;
-                break;
-            }
-        case EHTNPropertyType::Object:
-            {
-                // For objects, just write a null reference as they can't be reliably serialized
-                bool bHasObject = false;
-                MemWriter << bHasObject;
-                break;
-            }
-        default:
-            {
-                // Invalid type, just write a marker
-                bool bInvalidType = true;
-                MemWriter << bInvalidType;
-                break;
-            }
+            GetStringIndex(Task->GetClass()->GetPathName());
+            GetStringIndex(Task->TaskName.ToString());
+        }
+    }
+    const int32 NumStrings = GetStringIndex.Strings.Num();
+    const int32 IndexWidth = GetFixedWidth(NumStrings + 1);
+    
+    TArray<uint8> Body;
+    FWriter BodyWriter(Body);
+    BodyWriter.WriteFloat(TotalCost);
+    BodyWriter.WriteVarInt(ZigZagEncode(CurrentTaskIndex));
+    BodyWriter.WriteByte((bIsExecuting ? Flag_IsExecuting : 0) | (bIsComplete ? Flag_IsComplete : 0) |
+        (bFailed ? Flag_Failed : 0) | (bIsPaused ? Flag_IsPaused : 0));
+    BodyWriter.WriteFloat(StartTime);
+    BodyWriter.WriteFloat(EndTime);
+    BodyWriter.WriteByte(static_cast<uint8>(Status));
+    
+    BodyWriter.WriteVarInt(Tasks.Num());
+    BodyWriter.WriteByte(static_cast<uint8>(IndexWidth));
+    for (const UHTNPrimitiveTask* Task : Tasks)
+    {
+        BodyWriter.WriteFixed(Task ? GetStringIndex(Task->GetClass()->GetPathName()) + 1 : 0, IndexWidth);
+        BodyWriter.WriteFixed(Task ? GetStringIndex(Task->TaskName.ToString()) : 0, IndexWidth);
+        BodyWriter.WriteGuid(Task ? Task->GetTaskID() : FGuid());
+        BodyWriter.WriteFloat(Task ? Task->GetCost() : 0.0f);
+    }
+    
+    // Sections are prefixed with their size, so readers can skip them
+    TArray<uint8> Section;
+    FWriter SectionWriter(Section);
+    for (const TMap<FName, FHTNProperty>* Properties : { &TaskParameters, &TaskResults })
+    {
+        Section.Reset();
+        SectionWriter.WriteVarInt(Properties->Num());
+        for (const TPair<FName, FHTNProperty>& Pair : *Properties)
+        {
+            SectionWriter.WriteVarInt(GetStringIndex(Pair.Key.ToString()));
+            WriteValue(SectionWriter, Pair.Value, GetStringIndex);
         }
+        BodyWriter.WriteVarInt(Section.Num());
+        BodyWriter.WriteBytes(Section);
     }
     
-    // Write task dependencies
-    int32 DependencyMapSize = TaskDependencies.Num();
-    MemWriter << DependencyMapSize;
+    Section.Reset();
+    WriteDependencies(SectionWriter, TaskDependencies);
+    BodyWriter.WriteVarInt(Section.Num());
+    BodyWriter.WriteBytes(Section);
+    
+    // Assemble: header, string table, body
+    OutData.Reset();
+    FWriter Writer(OutData);
+    Writer.WriteFixed(static_cast<uint32>(Version), 4);
+    Writer.WriteFixed(0, 4);
+    WriteStringTable(Writer, GetStringIndex.Strings);
+    Writer.WriteBytes(Body);
     
-    for (auto& Pair : TaskDependencies)
+    const uint32 Checksum = FCrc::MemCrc32(OutData.GetData() + HeaderSize, OutData.Num() - HeaderSize);
+    for (int32 ByteIndex = 0; ByteIndex < 4; ++ByteIndex)
     {
-        MemWriter << Pair.Key;
-        
-        int32 DependencyCount = Pair.Value.Num();
-        MemWriter << DependencyCount;
-        
-        for (int32 DepIndex : Pair.Value)
+        OutData[4 + ByteIndex] = static_cast<uint8>(Checksum >> (8 * ByteIndex));
+    }
+    
+    return true;
+}
+
+bool FHTNPlan::FromBinaryV2(TConstArrayView<uint8> InData)
+{
+    using namespace HTNPlanBinary;
+    
+    FReader Reader(InData);
+    Reader.ReadFixed(4);
+    const uint32 Checksum = Reader.ReadFixed(4);
+    if (Reader.HasError() || Checksum != FCrc::MemCrc32(InData.GetData() + HeaderSize, InData.Num() - HeaderSize))
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Cannot deserialize plan: checksum mismatch"));
+        return false;
+    }
+    
+    TArray<FString> Strings;
+    if (!ReadStringTable(Reader, Strings))
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Cannot deserialize plan: truncated string table"));
+        return false;
+    }
+    auto GetString = [&Strings](uint32 StringIndex)
+    {
+        return Strings.IsValidIndex(StringIndex) ? Strings[StringIndex] : FString();
+    };
+    
+    Clear();
+    
+    TotalCost = Reader.ReadFloat();
+    CurrentTaskIndex = ZigZagDecode(Reader.ReadVarInt());
+    const uint8 Flags = Reader.ReadByte();
+    bIsExecuting = (Flags & Flag_IsExecuting) != 0;
+    bIsComplete = (Flags & Flag_IsComplete) != 0;
+    bFailed = (Flags & Flag_Failed) != 0;
+    bIsPaused = (Flags & Flag_IsPaused) != 0;
+    StartTime = Reader.ReadFloat();
+    EndTime = Reader.ReadFloat();
+    Status = static_cast<EHTNPlanStatus>(Reader.ReadByte());
+    
+    // Tasks can't be recreated from their records alone; keep the plan's shape with null placeholders, like version 1
+    const int32 TaskCount = static_cast<int32>(Reader.ReadVarInt());
+    const int32 IndexWidth = Reader.ReadByte();
+    const int32 RecordSize = 2 * IndexWidth + TaskRecordFixedSize;
+    if (!IsValidFixedWidth(IndexWidth) || !Reader.CanReadArray(TaskCount, RecordSize))
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Cannot deserialize plan: truncated task table"));
+        return false;
+    }
+    Reader.ReadBytes(TaskCount * RecordSize);
+    Tasks.SetNumZeroed(TaskCount);
+    
+    for (TMap<FName, FHTNProperty>* Properties : { &TaskParameters, &TaskResults })
+    {
+        Reader.ReadVarInt();
+        const int32 EntryCount = static_cast<int32>(Reader.ReadVarInt());
+        for (int32 EntryIndex = 0; EntryIndex < EntryCount && !Reader.HasError(); ++EntryIndex)
         {
-            MemWriter << DepIndex;
+            const FName Key(*GetString(Reader.ReadVarInt()));
+            Properties->Add(Key, ReadValue(Reader, GetString));
         }
     }
     
+    Reader.ReadVarInt();
+    ReadDependencies(Reader, TaskDependencies);
+    
+    if (Reader.HasError())
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Cannot deserialize plan: truncated data"));
+        Clear();
+        return false;
+    }
+    
+    if (TaskCount > 0)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Loaded %d task references, but actual task objects cannot be reconstructed without a task registry"), TaskCount);
+    }
     return true;
 }
 
@@ -1231,6 +1460,11 @@ bool FHTNPlan::FromBinary(const TArray<uint8>& InData)
     int32 SerializationVersion;
     MemReader << SerializationVersion;
     
+    if (SerializationVersion == HTNPlanBinary::Version)
+    {
+        return FromBinaryV2(InData);
+    }
+    
     if (SerializationVersion != 1)
     {
         UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Unsupported serialization version: %d"), SerializationVersion);
@@ -1510,6 +1744,233 @@ bool FHTNPlan::FromBinary(const TArray<uint8>& InData)
     return true;
 }
 
+namespace HTNPlanBinary
+{
+    /** Identify the plan a delta applies to by its tasks */
+    uint32 GetDeltaBaseFingerprint(const FHTNPlan& Plan)
+    {
+        uint32 Fingerprint = GetTypeHash(Plan.Tasks.Num());
+        for (const UHTNPrimitiveTask* Task : Plan.Tasks)
+        {
+            Fingerprint = HashCombine(Fingerprint, GetTypeHash(Task ? Task->GetTaskID() : FGuid()));
+        }
+        return Fingerprint;
+    }
+}
+
+void FHTNPlan::ComputeDelta(const FHTNPlan& OldPlan, const FHTNPlan& NewPlan, TArray<uint8>& OutDelta)
+{
+    using namespace HTNPlanBinary;
+    
+    FStringTableBuilder GetStringIndex;
+    TArray<uint8> Body;
+    FWriter BodyWriter(Body);
+    
+    // Replans usually keep the tasks up to the one that failed, so only the rest is sent
+    const int32 MaxPrefixLength = FMath::Min(OldPlan.Tasks.Num(), NewPlan.Tasks.Num());
+    int32 PrefixLength = 0;
+    while (PrefixLength < MaxPrefixLength && OldPlan.Tasks[PrefixLength] == NewPlan.Tasks[PrefixLength])
+    {
+        PrefixLength++;
+    }
+    BodyWriter.WriteVarInt(PrefixLength);
+    
+    // Tasks the receiver already has are sent as an index, which is a byte or two instead of a GUID
+    TMap<const UHTNPrimitiveTask*, int32> OldTaskIndices;
+    for (int32 TaskIndex = OldPlan.Tasks.Num() - 1; TaskIndex >= 0; --TaskIndex)
+    {
+        OldTaskIndices.Add(OldPlan.Tasks[TaskIndex], TaskIndex);
+    }
+    BodyWriter.WriteVarInt(NewPlan.Tasks.Num() - PrefixLength);
+    for (int32 TaskIndex = PrefixLength; TaskIndex < NewPlan.Tasks.Num(); ++TaskIndex)
+    {
+        const UHTNPrimitiveTask* Task = NewPlan.Tasks[TaskIndex];
+        if (const int32* OldTaskIndex = OldTaskIndices.Find(Task))
+        {
+            BodyWriter.WriteVarInt(*OldTaskIndex + 1);
+        }
+        else
+        {
+            BodyWriter.WriteVarInt(0);
+            BodyWriter.WriteGuid(Task ? Task->GetTaskID() : FGuid());
+        }
+    }
+    
+    BodyWriter.WriteFloat(NewPlan.TotalCost);
+    BodyWriter.WriteVarInt(ZigZagEncode(NewPlan.CurrentTaskIndex));
+    BodyWriter.WriteByte((NewPlan.bIsExecuting ? Flag_IsExecuting : 0) | (NewPlan.bIsComplete ? Flag_IsComplete : 0) |
+        (NewPlan.bFailed ? Flag_Failed : 0) | (NewPlan.bIsPaused ? Flag_IsPaused : 0));
+    BodyWriter.WriteFloat(NewPlan.StartTime);
+    BodyWriter.WriteFloat(NewPlan.EndTime);
+    BodyWriter.WriteByte(static_cast<uint8>(NewPlan.Status));
+    
+    const TPair<const TMap<FName, FHTNProperty>*, const TMap<FName, FHTNProperty>*> PropertyMaps[] = {
+        { &OldPlan.TaskParameters, &NewPlan.TaskParameters },
+        { &OldPlan.TaskResults, &NewPlan.TaskResults } };
+    TArray<const TPair<FName, FHTNProperty>*> SetEntries;
+    TArray<FName> RemovedKeys;
+    for (const TPair<const TMap<FName, FHTNProperty>*, const TMap<FName, FHTNProperty>*>& PropertyMap : PropertyMaps)
+    {
+        const TMap<FName, FHTNProperty>* OldProperties = PropertyMap.Key;
+        const TMap<FName, FHTNProperty>* NewProperties = PropertyMap.Value;
+        SetEntries.Reset();
+        for (const TPair<FName, FHTNProperty>& Pair : *NewProperties)
+        {
+            const FHTNProperty* OldValue = OldProperties->Find(Pair.Key);
+            if (!OldValue || !(*OldValue == Pair.Value))
+            {
+                SetEntries.Add(&Pair);
+            }
+        }
+        BodyWriter.WriteVarInt(SetEntries.Num());
+        for (const TPair<FName, FHTNProperty>* Pair : SetEntries)
+        {
+            BodyWriter.WriteVarInt(GetStringIndex(Pair->Key.ToString()));
+            WriteValue(BodyWriter, Pair->Value, GetStringIndex);
+        }
+        
+        RemovedKeys.Reset();
+        for (const TPair<FName, FHTNProperty>& Pair : *OldProperties)
+        {
+            if (!NewProperties->Contains(Pair.Key))
+            {
+                RemovedKeys.Add(Pair.Key);
+            }
+        }
+        BodyWriter.WriteVarInt(RemovedKeys.Num());
+        for (const FName& Key : RemovedKeys)
+        {
+            BodyWriter.WriteVarInt(GetStringIndex(Key.ToString()));
+        }
+    }
+    
+    const bool bDependenciesChanged = !OldPlan.TaskDependencies.OrderIndependentCompareEqual(NewPlan.TaskDependencies);
+    BodyWriter.WriteByte(bDependenciesChanged ? 1 : 0);
+    if (bDependenciesChanged)
+    {
+        WriteDependencies(BodyWriter, NewPlan.TaskDependencies);
+    }
+    
+    // Assemble: header, string table, body
+    OutDelta.Reset();
+    FWriter Writer(OutDelta);
+    Writer.WriteByte(DeltaVersion);
+    Writer.WriteFixed(GetDeltaBaseFingerprint(OldPlan), 4);
+    WriteStringTable(Writer, GetStringIndex.Strings);
+    Writer.WriteBytes(Body);
+}
+
+bool FHTNPlan::ApplyDelta(TConstArrayView<uint8> Delta, const FHTNTaskIndex* TaskIndex)
+{
+    using namespace HTNPlanBinary;
+    
+    FReader Reader(Delta);
+    const uint8 SerializationVersion = Reader.ReadByte();
+    if (Reader.HasError() || SerializationVersion != DeltaVersion)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Cannot apply plan delta: unsupported version %d"), SerializationVersion);
+        return false;
+    }
+    
+    if (Reader.ReadFixed(4) != GetDeltaBaseFingerprint(*this))
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Cannot apply plan delta: it was computed from a different plan"));
+        return false;
+    }
+    
+    TArray<FString> Strings;
+    if (!ReadStringTable(Reader, Strings))
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Cannot apply plan delta: truncated string table"));
+        return false;
+    }
+    auto GetString = [&Strings](uint32 StringIndex)
+    {
+        return Strings.IsValidIndex(StringIndex) ? Strings[StringIndex] : FString();
+    };
+    
+    // Patch a copy, so a bad delta leaves this plan as it was
+    FHTNPlan Patched(*this);
+    
+    // Deltas don't carry decompositions, and the old one no longer describes the patched tasks
+    Patched.Decomposition.Reset();
+    
+    const int32 PrefixLength = static_cast<int32>(Reader.ReadVarInt());
+    const int32 SuffixLength = static_cast<int32>(Reader.ReadVarInt());
+    if (PrefixLength < 0 || PrefixLength > Tasks.Num() || !Reader.CanRead(SuffixLength))
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Cannot apply plan delta: invalid task list"));
+        return false;
+    }
+    Patched.Tasks.SetNum(PrefixLength);
+    Patched.Tasks.Reserve(PrefixLength + SuffixLength);
+    int32 UnresolvedTaskCount = 0;
+    for (int32 SuffixIndex = 0; SuffixIndex < SuffixLength && !Reader.HasError(); ++SuffixIndex)
+    {
+        const uint32 OldTaskReference = Reader.ReadVarInt();
+        if (OldTaskReference > 0)
+        {
+            if (!Tasks.IsValidIndex(OldTaskReference - 1))
+            {
+                UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Cannot apply plan delta: invalid task index %u"), OldTaskReference - 1);
+                return false;
+            }
+            Patched.Tasks.Add(Tasks[OldTaskReference - 1]);
+            continue;
+        }
+        
+        const FGuid TaskID = Reader.ReadGuid();
+        UHTNPrimitiveTask* Task = TaskIndex && TaskID.IsValid() ? TaskIndex->FindTask(TaskID) : nullptr;
+        UnresolvedTaskCount += Task || !TaskID.IsValid() ? 0 : 1;
+        Patched.Tasks.Add(Task);
+    }
+    
+    Patched.TotalCost = Reader.ReadFloat();
+    Patched.CurrentTaskIndex = ZigZagDecode(Reader.ReadVarInt());
+    const uint8 Flags = Reader.ReadByte();
+    Patched.bIsExecuting = (Flags & Flag_IsExecuting) != 0;
+    Patched.bIsComplete = (Flags & Flag_IsComplete) != 0;
+    Patched.bFailed = (Flags & Flag_Failed) != 0;
+    Patched.bIsPaused = (Flags & Flag_IsPaused) != 0;
+    Patched.StartTime = Reader.ReadFloat();
+    Patched.EndTime = Reader.ReadFloat();
+    Patched.Status = static_cast<EHTNPlanStatus>(Reader.ReadByte());
+    
+    for (TMap<FName, FHTNProperty>* Properties : { &Patched.TaskParameters, &Patched.TaskResults })
+    {
+        const int32 SetCount = static_cast<int32>(Reader.ReadVarInt());
+        for (int32 EntryIndex = 0; EntryIndex < SetCount && !Reader.HasError(); ++EntryIndex)
+        {
+            const FName Key(*GetString(Reader.ReadVarInt()));
+            Properties->Add(Key, ReadValue(Reader, GetString));
+        }
+        
+        const int32 RemovedCount = static_cast<int32>(Reader.ReadVarInt());
+        for (int32 EntryIndex = 0; EntryIndex < RemovedCount && !Reader.HasError(); ++EntryIndex)
+        {
+            Properties->Remove(FName(*GetString(Reader.ReadVarInt())));
+        }
+    }
+    
+    if (Reader.ReadByte() != 0)
+    {
+        ReadDependencies(Reader, Patched.TaskDependencies);
+    }
+    
+    if (Reader.HasError())
+    {
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Cannot apply plan delta: truncated data"));
+        return false;
+    }
+    
+    if (UnresolvedTaskCount > 0)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Plan delta has %d tasks that could not be resolved by ID and were loaded as null"), UnresolvedTaskCount);
+    }
+    *this = MoveTemp(Patched);
+    return true;
+}
+
 FString FHTNPlan::ToGraphViz() const
 {
     FString Result = TEXT("digraph HTNPlan {\n");
@@ -1858,36 +2319,127 @@ FString FHTNPlan::ToJson() const
     return OutputString;
 }
 
-bool FHTNPlan::FromJson(const FString& JsonString)
+bool FHTNPlan::FromJson(const FString& JsonString, const FHTNTaskIndex* TaskIndex)
 {
-    TSharedPtr<FJsonObject> JsonObject;
     TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
-    if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid())
+    EJsonNotation Notation;
+    if (!Reader->ReadNext(Notation) || Notation != EJsonNotation::ObjectStart)
     {
-        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Failed to parse plan JSON: %s"), *JsonString);
+        UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Failed to parse plan JSON: expected an object"));
         return false;
     }
     
+    return ReadJson(*Reader, TaskIndex);
+}
+
+bool FHTNPlan::ReadJson(TJsonReader<TCHAR>& Reader, const FHTNTaskIndex* TaskIndex)
+{
     // Clear existing data
     Clear();
     
-    // Read plan metadata
-    TotalCost = JsonObject->GetNumberField(TEXT("TotalCost"));
-    CurrentTaskIndex = JsonObject->GetIntegerField(TEXT("CurrentTaskIndex"));
-    bIsExecuting = JsonObject->GetBoolField(TEXT("IsExecuting"));
-    bIsComplete = JsonObject->GetBoolField(TEXT("IsComplete"));
-    bFailed = JsonObject->GetBoolField(TEXT("Failed"));
-    StartTime = JsonObject->GetNumberField(TEXT("StartTime"));
-    EndTime = JsonObject->GetNumberField(TEXT("EndTime"));
-    
-    // Note: Deserializing actual task objects would require more context
-    // such as a task registry to look up classes by name. This implementation
-    // just sets up the metadata but leaves the Tasks array empty.
-    // A more complete implementation would recreate the task objects.
-    
-    UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Plan deserialized from JSON, but task objects were not recreated."));
+    int32 NumUnresolvedTasks = 0;
+    EJsonNotation Notation;
+    while (Reader.ReadNext(Notation))
+    {
+        const FString& Identifier = Reader.GetIdentifier();
+        switch (Notation)
+        {
+        case EJsonNotation::ObjectEnd:
+            if (NumUnresolvedTasks > 0)
+            {
+                UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Plan deserialized from JSON, but %d of %d tasks could not be resolved%s"),
+                    NumUnresolvedTasks, Tasks.Num(), TaskIndex ? TEXT("") : TEXT(" without a task index"));
+            }
+            return true;
+            
+        case EJsonNotation::Number:
+            if (Identifier == TEXT("TotalCost"))
+            {
+                TotalCost = Reader.GetValueAsNumber();
+            }
+            else if (Identifier == TEXT("CurrentTaskIndex"))
+            {
+                CurrentTaskIndex = static_cast<int32>(Reader.GetValueAsNumber());
+            }
+            else if (Identifier == TEXT("StartTime"))
+            {
+                StartTime = Reader.GetValueAsNumber();
+            }
+            else if (Identifier == TEXT("EndTime"))
+            {
+                EndTime = Reader.GetValueAsNumber();
+            }
+            break;
+            
+        case EJsonNotation::Boolean:
+            if (Identifier == TEXT("IsExecuting"))
+            {
+                bIsExecuting = Reader.GetValueAsBoolean();
+            }
+            else if (Identifier == TEXT("IsComplete"))
+            {
+                bIsComplete = Reader.GetValueAsBoolean();
+            }
+            else if (Identifier == TEXT("Failed"))
+            {
+                bFailed = Reader.GetValueAsBoolean();
+            }
+            break;
+            
+        case EJsonNotation::ArrayStart:
+            if (Identifier != TEXT("Tasks"))
+            {
+                Reader.SkipArray();
+                break;
+            }
+            
+            // Each task is an object of Class, Name, ID and Cost; only the ID is needed to resolve it
+            while (Reader.ReadNext(Notation) && Notation != EJsonNotation::ArrayEnd)
+            {
+                if (Notation != EJsonNotation::ObjectStart)
+                {
+                    continue;
+                }
+                
+                bool bIsNullTask = true;
+                FGuid TaskID;
+                while (Reader.ReadNext(Notation) && Notation != EJsonNotation::ObjectEnd)
+                {
+                    if (Notation == EJsonNotation::String && Reader.GetIdentifier() == TEXT("Class"))
+                    {
+                        bIsNullTask = Reader.GetValueAsString() == TEXT("NULL");
+                    }
+                    else if (Notation == EJsonNotation::String && Reader.GetIdentifier() == TEXT("ID"))
+                    {
+                        FGuid::Parse(Reader.GetValueAsString(), TaskID);
+                    }
+                    else if (Notation == EJsonNotation::ObjectStart)
+                    {
+                        Reader.SkipObject();
+                    }
+                    else if (Notation == EJsonNotation::ArrayStart)
+                    {
+                        Reader.SkipArray();
+                    }
+                }
+                
+                UHTNPrimitiveTask* Task = !bIsNullTask && TaskIndex ? TaskIndex->FindTask(TaskID) : nullptr;
+                NumUnresolvedTasks += !bIsNullTask && !Task ? 1 : 0;
+                Tasks.Add(Task);
+            }
+            break;
+            
+        case EJsonNotation::ObjectStart:
+            Reader.SkipObject();
+            break;
+            
+        default:
+            break;
+        }
+    }
     
-    return true;
+    UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Failed to parse plan JSON: %s"), *Reader.GetErrorMessage());
+    return false;
 }
 
 void UHTNPlanLibrary::ClearPlan(FHTNPlan& Plan)
@@ -6,6 +6,7 @@
 #include "Serialization/JsonReader.h"
 #include "Misc/FileHelper.h"
 #include "HTNLogging.h"
+#include "HTNTaskIndex.h"
 
 UHTNPlanAsset::UHTNPlanAsset()
 {
@@ -38,15 +39,21 @@ UHTNPlanAsset* UHTNPlanAsset::CreateFromPlan(
 }
 
 UHTNPlanAsset* UHTNPlanAsset::LoadFromJson(const FString& JsonString, UObject* OuterObject)
+{
+    return LoadFromJsonWithTaskIndex(JsonString, nullptr, OuterObject);
+}
+
+UHTNPlanAsset* UHTNPlanAsset::LoadFromJsonWithTaskIndex(const FString& JsonString, const FHTNTaskIndex* TaskIndex, UObject* OuterObject)
 {
     if (!OuterObject)
     {
         OuterObject = GetTransientPackage();
     }
     
-    TSharedPtr<FJsonObject> JsonObject;
+    // Read tokens as they come rather than building an object tree, so large files load quickly
     TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
-    if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid())
+    EJsonNotation Notation;
+    if (!Reader->ReadNext(Notation) || Notation != EJsonNotation::ObjectStart)
     {
         UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Failed to parse plan asset JSON"));
         return nullptr;
@@ -59,65 +66,69 @@ UHTNPlanAsset* UHTNPlanAsset::LoadFromJson(const FString& JsonString, UObject* O
         return nullptr;
     }
     
-    // Read description
-    if (JsonObject->HasField(TEXT("Description")))
-    {
-        PlanAsset->Description = JsonObject->GetStringField(TEXT("Description"));
-    }
-    
-    // Read tags
-    if (JsonObject->HasField(TEXT("Tags")))
+    bool bHasCreationTime = false;
+    bool bHasLastModifiedTime = false;
+    while (Reader->ReadNext(Notation) && Notation != EJsonNotation::ObjectEnd)
     {
-        const TArray<TSharedPtr<FJsonValue>>* TagsArray;
-        if (JsonObject->TryGetArrayField(TEXT("Tags"), TagsArray))
+        const FString& Identifier = Reader->GetIdentifier();
+        if (Notation == EJsonNotation::String)
+        {
+            if (Identifier == TEXT("Description"))
+            {
+                PlanAsset->Description = Reader->GetValueAsString();
+            }
+            else if (Identifier == TEXT("CreationTime"))
+            {
+                bHasCreationTime = FDateTime::Parse(Reader->GetValueAsString(), PlanAsset->CreationTime);
+            }
+            else if (Identifier == TEXT("LastModifiedTime"))
+            {
+                bHasLastModifiedTime = FDateTime::Parse(Reader->GetValueAsString(), PlanAsset->LastModifiedTime);
+            }
+            else if (Identifier == TEXT("PlanRaw") && !PlanAsset->Plan.FromJson(Reader->GetValueAsString(), TaskIndex))
+            {
+                UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Failed to parse plan data from JSON"));
+            }
+        }
+        else if (Notation == EJsonNotation::ArrayStart)
         {
-            for (const TSharedPtr<FJsonValue>& Value : *TagsArray)
+            if (Identifier != TEXT("Tags"))
             {
-                PlanAsset->Tags.Add(FName(*Value->AsString()));
+                Reader->SkipArray();
+                continue;
+            }
+            
+            while (Reader->ReadNext(Notation) && Notation != EJsonNotation::ArrayEnd)
+            {
+                if (Notation == EJsonNotation::String)
+                {
+                    PlanAsset->Tags.Add(FName(*Reader->GetValueAsString()));
+                }
+            }
+        }
+        else if (Notation == EJsonNotation::ObjectStart)
+        {
+            if (Identifier != TEXT("Plan"))
+            {
+                Reader->SkipObject();
+            }
+            else if (!PlanAsset->Plan.ReadJson(*Reader, TaskIndex))
+            {
+                UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Failed to parse plan data from JSON"));
+                return PlanAsset;
             }
         }
     }
     
-    // Read creation time
-    if (JsonObject->HasField(TEXT("CreationTime")))
-    {
-        FString CreationTimeStr = JsonObject->GetStringField(TEXT("CreationTime"));
-        FDateTime::Parse(CreationTimeStr, PlanAsset->CreationTime);
-    }
-    else
+    if (!bHasCreationTime)
     {
         PlanAsset->CreationTime = FDateTime::Now();
     }
-    
-    // Read last modified time
-    if (JsonObject->HasField(TEXT("LastModifiedTime")))
-    {
-        FString LastModifiedTimeStr = JsonObject->GetStringField(TEXT("LastModifiedTime"));
-        FDateTime::Parse(LastModifiedTimeStr, PlanAsset->LastModifiedTime);
-    }
-    else
+    if (!bHasLastModifiedTime)
     {
         PlanAsset->LastModifiedTime = PlanAsset->CreationTime;
     }
     
-    // Read plan data
-    if (JsonObject->HasField(TEXT("Plan")))
-    {
-        const TSharedPtr<FJsonObject>* PlanObject;
-        if (JsonObject->TryGetObjectField(TEXT("Plan"), PlanObject))
-        {
-            // Create a new string to hold the serialized JSON
-            FString PlanJsonString;
-            TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&PlanJsonString);
-            FJsonSerializer::Serialize(PlanObject->ToSharedRef(), Writer);
-            
-            if (!PlanAsset->Plan.FromJson(PlanJsonString))
-            {
-                UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Failed to parse plan data from JSON"));
-            }
-        }
-    }
-    
     return PlanAsset;
 }
 
@@ -0,0 +1,480 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HTNProperty.h"
+
+/**
+ * Version 2 of the binary plan format written by FHTNPlan::ToBinary.
+ *
+ * Layout, all multi-byte values little-endian:
+ *   int32   Version (2; version 1 files start with 1 at the same place)
+ *   uint32  CRC32 of everything after this field
+ *   String table:
+ *           varint String count
+ *           uint8  Byte width S of the string offsets (1, 2 or 4)
+ *           String offsets of S bytes each, from the start of the first string, so strings can be addressed directly
+ *           Each string as varint UTF-8 byte count and bytes
+ *   float   TotalCost
+ *   varint  CurrentTaskIndex (zigzag)
+ *   uint8   Flags (see EFlags)
+ *   float   StartTime, EndTime
+ *   uint8   Status
+ *   varint  Task count
+ *   uint8   Byte width W of the string indices in task records (1, 2 or 4)
+ *   Task records of fixed size 2 * W + 20, so tasks can be addressed directly:
+ *           W bytes class path string index + 1 (0 for a null task), W bytes task name string index,
+ *           16 bytes task GUID, float cost
+ *   varint  Parameter section byte count, then varint entry count and entries:
+ *           varint key string index, uint8 property type, value (see WriteValue)
+ *   varint  Result section byte count, then entries as for parameters
+ *   varint  Dependency section byte count, then varint entry count and entries sorted by task index:
+ *           varint task index delta from the previous entry (zigzag), varint dependency count,
+ *           sorted dependency indices as zigzag deltas from the previous one (starting at the task index)
+ *
+ * Plan deltas written by FHTNPlan::ComputeDelta reuse the same encodings:
+ *   uint8   Delta version (1)
+ *   uint32  Base fingerprint: hash of the task count and task IDs of the plan the delta applies to
+ *           String table as above
+ *   varint  Prefix length: number of leading tasks kept
+ *   varint  Suffix task count, then for each task: varint old plan task index + 1, or 0 followed by the task GUID
+ *   float   TotalCost, varint CurrentTaskIndex (zigzag), uint8 Flags, float StartTime, EndTime, uint8 Status
+ *   For parameters, then results: varint set entry count and entries as above, varint removed key count and
+ *           varint key string indices
+ *   uint8   1 if the dependencies changed, followed by the whole dependency section without its byte count
+ */
+namespace HTNPlanBinary
+{
+    constexpr int32 Version = 2;
+
+    /** Version of the plan delta format */
+    constexpr uint8 DeltaVersion = 1;
+
+    /** Byte count of the version and checksum fields */
+    constexpr int32 HeaderSize = 8;
+
+    /** Byte count of the fixed part of a task record */
+    constexpr int32 TaskRecordFixedSize = 20;
+
+    /** Plan flag bits */
+    enum EFlags : uint8
+    {
+        Flag_IsExecuting = 1 << 0,
+        Flag_IsComplete = 1 << 1,
+        Flag_Failed = 1 << 2,
+        Flag_IsPaused = 1 << 3,
+    };
+
+    /**
+     * Get the byte width of fixed-size fields that hold values up to a maximum.
+     * @param MaxValue - The largest value written
+     * @return 1, 2 or 4
+     */
+    inline int32 GetFixedWidth(uint32 MaxValue) { return MaxValue <= MAX_uint8 ? 1 : (MaxValue <= MAX_uint16 ? 2 : 4); }
+
+    /**
+     * Check a byte width read from the data.
+     * @param Width - The width
+     * @return True if it is one GetFixedWidth returns
+     */
+    inline bool IsValidFixedWidth(int32 Width) { return Width == 1 || Width == 2 || Width == 4; }
+
+    inline uint32 ZigZagEncode(int32 Value) { return (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31); }
+    inline int32 ZigZagDecode(uint32 Value) { return static_cast<int32>(Value >> 1) ^ -static_cast<int32>(Value & 1); }
+
+    /** Appends encoded values to a byte array */
+    struct FWriter
+    {
+        explicit FWriter(TArray<uint8>& InData) : Data(InData) {}
+
+        void WriteByte(uint8 Value) { Data.Add(Value); }
+
+        void WriteVarInt(uint32 Value)
+        {
+            while (Value >= 0x80)
+            {
+                Data.Add(static_cast<uint8>(Value | 0x80));
+                Value >>= 7;
+            }
+            Data.Add(static_cast<uint8>(Value));
+        }
+
+        void WriteFixed(uint32 Value, int32 NumBytes)
+        {
+            for (int32 ByteIndex = 0; ByteIndex < NumBytes; ++ByteIndex)
+            {
+                Data.Add(static_cast<uint8>(Value >> (8 * ByteIndex)));
+            }
+        }
+
+        void WriteFloat(float Value) { WriteFixed(*reinterpret_cast<const uint32*>(&Value), 4); }
+
+        void WriteDouble(double Value)
+        {
+            const uint64 Bits = *reinterpret_cast<const uint64*>(&Value);
+            WriteFixed(static_cast<uint32>(Bits), 4);
+            WriteFixed(static_cast<uint32>(Bits >> 32), 4);
+        }
+
+        void WriteGuid(const FGuid& Guid)
+        {
+            WriteFixed(Guid.A, 4);
+            WriteFixed(Guid.B, 4);
+            WriteFixed(Guid.C, 4);
+            WriteFixed(Guid.D, 4);
+        }
+
+        void WriteBytes(TConstArrayView<uint8> Bytes) { Data.Append(Bytes.GetData(), Bytes.Num()); }
+
+        TArray<uint8>& Data;
+    };
+
+    /** Reads encoded values from a byte range; every read fails once the range is exhausted */
+    struct FReader
+    {
+        explicit FReader(TConstArrayView<uint8> InData) : Data(InData) {}
+
+        bool HasError() const { return bError; }
+        bool IsAtEnd() const { return Offset >= Data.Num(); }
+        int32 GetOffset() const { return Offset; }
+
+        bool CanRead(int32 NumBytes)
+        {
+            // Compared against the bytes left, so sizes read from the data can't overflow the sum
+            bError |= NumBytes < 0 || Offset < 0 || NumBytes > Data.Num() - Offset;
+            return !bError;
+        }
+
+        /** Check for Count elements of ElementSize bytes, without overflowing the product */
+        bool CanReadArray(int32 Count, int32 ElementSize)
+        {
+            bError |= Count < 0 || ElementSize < 0 || (ElementSize > 0 && Count > (Data.Num() - Offset) / ElementSize);
+            return CanRead(0);
+        }
+
+        uint8 ReadByte() { return CanRead(1) ? Data[Offset++] : 0; }
+
+        uint32 ReadVarInt()
+        {
+            uint32 Value = 0;
+            for (int32 Shift = 0; Shift < 35 && CanRead(1); Shift += 7)
+            {
+                const uint8 Byte = Data[Offset++];
+                Value |= static_cast<uint32>(Byte & 0x7F) << Shift;
+                if (!(Byte & 0x80))
+                {
+                    return Value;
+                }
+            }
+            bError = true;
+            return 0;
+        }
+
+        uint32 ReadFixed(int32 NumBytes)
+        {
+            uint32 Value = 0;
+            if (CanRead(NumBytes))
+            {
+                for (int32 ByteIndex = 0; ByteIndex < NumBytes; ++ByteIndex)
+                {
+                    Value |= static_cast<uint32>(Data[Offset++]) << (8 * ByteIndex);
+                }
+            }
+            return Value;
+        }
+
+        float ReadFloat()
+        {
+            const uint32 Bits = ReadFixed(4);
+            return *reinterpret_cast<const float*>(&Bits);
+        }
+
+        double ReadDouble()
+        {
+            const uint64 Low = ReadFixed(4);
+            const uint64 Bits = Low | (static_cast<uint64>(ReadFixed(4)) << 32);
+            return *reinterpret_cast<const double*>(&Bits);
+        }
+
+        FGuid ReadGuid()
+        {
+            const uint32 A = ReadFixed(4);
+            const uint32 B = ReadFixed(4);
+            const uint32 C = ReadFixed(4);
+            const uint32 D = ReadFixed(4);
+            return FGuid(A, B, C, D);
+        }
+
+        /** Get the next bytes without copying them, and move past them */
+        TConstArrayView<uint8> ReadBytes(int32 NumBytes)
+        {
+            if (!CanRead(NumBytes))
+            {
+                return TConstArrayView<uint8>();
+            }
+            const TConstArrayView<uint8> Bytes = Data.Slice(Offset, NumBytes);
+            Offset += NumBytes;
+            return Bytes;
+        }
+
+        TConstArrayView<uint8> Data;
+        int32 Offset = 0;
+        bool bError = false;
+    };
+
+    /**
+     * Read a UTF-8 string without copying it.
+     * @param Reader - Reader positioned at the string
+     * @return The string bytes
+     */
+    inline TConstArrayView<uint8> ReadStringBytes(FReader& Reader)
+    {
+        const int32 NumBytes = static_cast<int32>(Reader.ReadVarInt());
+        return Reader.ReadBytes(NumBytes);
+    }
+
+    /**
+     * Convert UTF-8 string bytes.
+     * @param Bytes - The bytes
+     * @return The string
+     */
+    inline FString BytesToString(TConstArrayView<uint8> Bytes)
+    {
+        const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Bytes.GetData()), Bytes.Num());
+        return FString(Converted.Length(), Converted.Get());
+    }
+
+    /** Collects the strings written to a string table, each once */
+    struct FStringTableBuilder
+    {
+        uint32 operator()(const FString& String)
+        {
+            if (const int32* ExistingIndex = Indices.Find(String))
+            {
+                return *ExistingIndex;
+            }
+            const int32 NewIndex = Strings.Add(String);
+            Indices.Add(String, NewIndex);
+            return NewIndex;
+        }
+
+        TArray<FString> Strings;
+        TMap<FString, int32> Indices;
+    };
+
+    /**
+     * Write a string table.
+     * @param Writer - The writer
+     * @param Strings - The strings
+     */
+    inline void WriteStringTable(FWriter& Writer, TConstArrayView<FString> Strings)
+    {
+        TArray<uint8> StringData;
+        FWriter StringWriter(StringData);
+        TArray<uint32> Offsets;
+        Offsets.Reserve(Strings.Num());
+        for (const FString& String : Strings)
+        {
+            Offsets.Add(StringData.Num());
+            const FTCHARToUTF8 Utf8(*String);
+            StringWriter.WriteVarInt(Utf8.Length());
+            StringWriter.WriteBytes(TConstArrayView<uint8>(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length()));
+        }
+
+        const int32 OffsetWidth = GetFixedWidth(Offsets.Num() > 0 ? Offsets.Last() : 0);
+        Writer.WriteVarInt(Strings.Num());
+        Writer.WriteByte(static_cast<uint8>(OffsetWidth));
+        for (const uint32 Offset : Offsets)
+        {
+            Writer.WriteFixed(Offset, OffsetWidth);
+        }
+        Writer.WriteBytes(StringData);
+    }
+
+    /**
+     * Read a string table written by WriteStringTable.
+     * @param Reader - Reader positioned at the table
+     * @param OutStrings - Overwritten with the strings
+     * @return False if the table is truncated
+     */
+    inline bool ReadStringTable(FReader& Reader, TArray<FString>& OutStrings)
+    {
+        OutStrings.Reset();
+        const int32 StringCount = static_cast<int32>(Reader.ReadVarInt());
+        const int32 OffsetWidth = Reader.ReadByte();
+        if (!IsValidFixedWidth(OffsetWidth) || !Reader.CanReadArray(StringCount, OffsetWidth))
+        {
+            return false;
+        }
+
+        // Strings are read in order, so the offsets aren't needed
+        Reader.ReadBytes(StringCount * OffsetWidth);
+        if (!Reader.CanRead(StringCount))
+        {
+            return false;
+        }
+        OutStrings.Reserve(StringCount);
+        for (int32 StringIndex = 0; StringIndex < StringCount && !Reader.HasError(); ++StringIndex)
+        {
+            OutStrings.Add(BytesToString(ReadStringBytes(Reader)));
+        }
+        return !Reader.HasError();
+    }
+
+    /**
+     * Write task dependencies, sorted so the indices delta-encode to small values.
+     * @param Writer - The writer
+     * @param Dependencies - Dependency indices by task index
+     */
+    inline void WriteDependencies(FWriter& Writer, const TMap<int32, TArray<int32>>& Dependencies)
+    {
+        TArray<int32> DependentTasks;
+        Dependencies.GetKeys(DependentTasks);
+        DependentTasks.Sort();
+        Writer.WriteVarInt(DependentTasks.Num());
+        int32 PreviousTaskIndex = 0;
+        for (const int32 TaskIndex : DependentTasks)
+        {
+            TArray<int32> TaskDependencies = Dependencies[TaskIndex];
+            TaskDependencies.Sort();
+            Writer.WriteVarInt(ZigZagEncode(TaskIndex - PreviousTaskIndex));
+            Writer.WriteVarInt(TaskDependencies.Num());
+            int32 PreviousDependency = TaskIndex;
+            for (const int32 Dependency : TaskDependencies)
+            {
+                Writer.WriteVarInt(ZigZagEncode(Dependency - PreviousDependency));
+                PreviousDependency = Dependency;
+            }
+            PreviousTaskIndex = TaskIndex;
+        }
+    }
+
+    /**
+     * Read task dependencies written by WriteDependencies.
+     * @param Reader - Reader positioned at the dependencies
+     * @param OutDependencies - Overwritten with the dependency indices by task index
+     */
+    inline void ReadDependencies(FReader& Reader, TMap<int32, TArray<int32>>& OutDependencies)
+    {
+        OutDependencies.Reset();
+        const int32 DependentTaskCount = static_cast<int32>(Reader.ReadVarInt());
+        int32 TaskIndex = 0;
+        for (int32 EntryIndex = 0; EntryIndex < DependentTaskCount && !Reader.HasError(); ++EntryIndex)
+        {
+            TaskIndex += ZigZagDecode(Reader.ReadVarInt());
+            const int32 DependencyCount = static_cast<int32>(Reader.ReadVarInt());
+            TArray<int32>& Dependencies = OutDependencies.Add(TaskIndex);
+            int32 Dependency = TaskIndex;
+            for (int32 DependencyIndex = 0; DependencyIndex < DependencyCount && !Reader.HasError(); ++DependencyIndex)
+            {
+                Dependency += ZigZagDecode(Reader.ReadVarInt());
+                Dependencies.Add(Dependency);
+            }
+        }
+    }
+
+    /**
+     * Write a property value; strings and names go to the string table.
+     * @param Writer - The writer
+     * @param Value - The value
+     * @param GetStringIndex - Returns the string table index of a string
+     */
+    template<typename TGetStringIndex>
+    void WriteValue(FWriter& Writer, const FHTNProperty& Value, TGetStringIndex&& GetStringIndex)
+    {
+        Writer.WriteByte(static_cast<uint8>(Value.GetType()));
+        switch (Value.GetType())
+        {
+        case EHTNPropertyType::Boolean:
+            Writer.WriteByte(Value.GetBoolValue() ? 1 : 0);
+            break;
+        case EHTNPropertyType::Integer:
+            Writer.WriteVarInt(ZigZagEncode(Value.GetIntValue()));
+            break;
+        case EHTNPropertyType::Float:
+            Writer.WriteFloat(Value.GetFloatValue());
+            break;
+        case EHTNPropertyType::String:
+            Writer.WriteVarInt(GetStringIndex(Value.GetStringValue()));
+            break;
+        case EHTNPropertyType::Name:
+            Writer.WriteVarInt(GetStringIndex(Value.GetNameValue().ToString()));
+            break;
+        case EHTNPropertyType::Vector:
+            {
+                const FVector Vector = Value.GetVectorValue();
+                Writer.WriteDouble(Vector.X);
+                Writer.WriteDouble(Vector.Y);
+                Writer.WriteDouble(Vector.Z);
+                break;
+            }
+        default:
+            // Object references can't be serialized reliably and are loaded as null, like in version 1
+            break;
+        }
+    }
+
+    /**
+     * Read a property value written by WriteValue.
+     * @param Reader - Reader positioned at the value
+     * @param GetString - Returns the string table entry at an index
+     * @return The value
+     */
+    template<typename TGetString>
+    FHTNProperty ReadValue(FReader& Reader, TGetString&& GetString)
+    {
+        const EHTNPropertyType Type = static_cast<EHTNPropertyType>(Reader.ReadByte());
+        switch (Type)
+        {
+        case EHTNPropertyType::Boolean:
+            return FHTNProperty(Reader.ReadByte() != 0);
+        case EHTNPropertyType::Integer:
+            return FHTNProperty(ZigZagDecode(Reader.ReadVarInt()));
+        case EHTNPropertyType::Float:
+            return FHTNProperty(Reader.ReadFloat());
+        case EHTNPropertyType::String:
+            return FHTNProperty(GetString(Reader.ReadVarInt()));
+        case EHTNPropertyType::Name:
+            return FHTNProperty(FName(*GetString(Reader.ReadVarInt())));
+        case EHTNPropertyType::Vector:
+            {
+                const double X = Reader.ReadDouble();
+                const double Y = Reader.ReadDouble();
+                const double Z = Reader.ReadDouble();
+                return FHTNProperty(FVector(X, Y, Z));
+            }
+        case EHTNPropertyType::Object:
+            return FHTNProperty(static_cast<UObject*>(nullptr));
+        default:
+            return FHTNProperty::Invalid();
+        }
+    }
+
+    /**
+     * Skip a property value written by WriteValue.
+     * @param Reader - Reader positioned at the value
+     */
+    inline void SkipValue(FReader& Reader)
+    {
+        switch (static_cast<EHTNPropertyType>(Reader.ReadByte()))
+        {
+        case EHTNPropertyType::Boolean:
+            Reader.ReadByte();
+            break;
+        case EHTNPropertyType::Integer:
+        case EHTNPropertyType::String:
+        case EHTNPropertyType::Name:
+            Reader.ReadVarInt();
+            break;
+        case EHTNPropertyType::Float:
+            Reader.ReadBytes(4);
+            break;
+        case EHTNPropertyType::Vector:
+            Reader.ReadBytes(24);
+            break;
+        default:
+            break;
+        }
+    }
+}
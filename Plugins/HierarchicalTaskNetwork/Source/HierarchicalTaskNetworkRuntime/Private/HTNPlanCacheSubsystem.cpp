@@ -0,0 +1,164 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNPlanCacheSubsystem.h"
+
+#include "Engine/Engine.h"
+#include "HTNDomainAsset.h"
+#include "HTNLogging.h"
+#include "HTNWorldStateStruct.h"
+#include "Tasks/HTNPrimitiveTask.h"
+#include "UObject/UObjectIterator.h"
+
+UHTNPlanCacheSubsystem::UHTNPlanCacheSubsystem()
+    : MaxRuntimePlans(1024)
+{
+}
+
+UHTNPlanCacheSubsystem* UHTNPlanCacheSubsystem::Get()
+{
+    return GEngine ? GEngine->GetEngineSubsystem<UHTNPlanCacheSubsystem>() : nullptr;
+}
+
+namespace HTNPlanCacheSubsystem
+{
+    /** Combine a start state fingerprint with the goals; goals are identified by task ID, which is saved with the task */
+    uint32 CombineGoalTaskIDs(uint32 Fingerprint, TConstArrayView<UHTNTask*> GoalTasks)
+    {
+        for (const UHTNTask* GoalTask : GoalTasks)
+        {
+            Fingerprint = HashCombine(Fingerprint, GoalTask ? GetTypeHash(GoalTask->GetTaskID()) : 0);
+        }
+        return Fingerprint;
+    }
+}
+
+uint32 UHTNPlanCacheSubsystem::GetRequestFingerprint(const FHTNWorldStateStruct& WorldState, TConstArrayView<UHTNTask*> GoalTasks)
+{
+    return HTNPlanCacheSubsystem::CombineGoalTaskIDs(WorldState.GetStableFingerprint(), GoalTasks);
+}
+
+uint32 UHTNPlanCacheSubsystem::GetRequestFingerprint(const UHTNWorldState* WorldState, TConstArrayView<UHTNTask*> GoalTasks)
+{
+    return HTNPlanCacheSubsystem::CombineGoalTaskIDs(WorldState ? WorldState->GetStableFingerprint() : 0, GoalTasks);
+}
+
+bool UHTNPlanCacheSubsystem::FindPlan(uint32 Fingerprint, FHTNPlan& OutPlan) const
+{
+    // Only the tasks and cost are cached, so nothing of the plan the output held before may carry over
+    OutPlan.Clear();
+
+    const FHTNCachedPlan* CachedPlan = Plans.Find(Fingerprint);
+    if (!CachedPlan)
+    {
+        return false;
+    }
+
+    OutPlan.Tasks.Reserve(CachedPlan->Tasks.Num());
+    for (const TWeakObjectPtr<UHTNPrimitiveTask>& Task : CachedPlan->Tasks)
+    {
+        UHTNPrimitiveTask* LoadedTask = Task.Get();
+        if (!LoadedTask)
+        {
+            OutPlan.Tasks.Reset();
+            return false;
+        }
+        OutPlan.Tasks.Add(LoadedTask);
+    }
+    OutPlan.TotalCost = CachedPlan->Cost;
+    return true;
+}
+
+void UHTNPlanCacheSubsystem::AddPlan(uint32 Fingerprint, const FHTNPlan& Plan)
+{
+    if (MaxRuntimePlans <= 0 || Plans.Contains(Fingerprint))
+    {
+        return;
+    }
+
+    // Precomputed plans stay; only plans found at runtime are evicted, oldest first
+    if (RuntimePlanOrder.Num() >= MaxRuntimePlans)
+    {
+        const int32 NumToEvict = RuntimePlanOrder.Num() - MaxRuntimePlans + 1;
+        for (int32 Index = 0; Index < NumToEvict; ++Index)
+        {
+            Plans.Remove(RuntimePlanOrder[Index]);
+        }
+        RuntimePlanOrder.RemoveAt(0, NumToEvict);
+    }
+
+    FHTNCachedPlan& CachedPlan = Plans.Add(Fingerprint);
+    CachedPlan.Tasks.Append(Plan.Tasks);
+    CachedPlan.Cost = Plan.TotalCost;
+    RuntimePlanOrder.Add(Fingerprint);
+}
+
+int32 UHTNPlanCacheSubsystem::SeedFromDomain(const UHTNDomainAsset* Domain)
+{
+    if (!Domain)
+    {
+        return 0;
+    }
+
+    const FHTNTaskIndex& TaskIndex = Domain->GetTaskIndex();
+    int32 NumAdded = 0;
+    for (const FHTNWarmPlan& WarmPlan : Domain->WarmPlans)
+    {
+        FHTNCachedPlan CachedPlan;
+        CachedPlan.Cost = WarmPlan.Cost;
+        CachedPlan.bWarm = true;
+        CachedPlan.Tasks.Reserve(WarmPlan.TaskIDs.Num());
+        for (const FGuid& TaskID : WarmPlan.TaskIDs)
+        {
+            UHTNPrimitiveTask* Task = TaskIndex.FindTask(TaskID);
+            if (!Task)
+            {
+                break;
+            }
+            CachedPlan.Tasks.Add(Task);
+        }
+
+        if (CachedPlan.Tasks.Num() != WarmPlan.TaskIDs.Num())
+        {
+            UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNPlanCacheSubsystem: Skipping a precomputed plan of %s with a task the domain no longer has"),
+                *Domain->GetPathName());
+            continue;
+        }
+
+        // A precomputed plan replaces a runtime one for the same request, and is then no longer evicted
+        if (const FHTNCachedPlan* ExistingPlan = Plans.Find(WarmPlan.Fingerprint); ExistingPlan && !ExistingPlan->bWarm)
+        {
+            RuntimePlanOrder.Remove(WarmPlan.Fingerprint);
+        }
+        Plans.Add(WarmPlan.Fingerprint, MoveTemp(CachedPlan));
+        NumAdded++;
+    }
+
+    return NumAdded;
+}
+
+void UHTNPlanCacheSubsystem::Reset()
+{
+    Plans.Reset();
+    RuntimePlanOrder.Reset();
+}
+
+void UHTNPlanCacheSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    Super::Initialize(Collection);
+
+    // Domains loaded before the engine came up couldn't seed the cache themselves
+    for (TObjectIterator<UHTNDomainAsset> It; It; ++It)
+    {
+        if (!It->HasAnyFlags(RF_ClassDefaultObject | RF_NeedPostLoad))
+        {
+            SeedFromDomain(*It);
+        }
+    }
+}
+
+void UHTNPlanCacheSubsystem::Deinitialize()
+{
+    Reset();
+
+    Super::Deinitialize();
+}
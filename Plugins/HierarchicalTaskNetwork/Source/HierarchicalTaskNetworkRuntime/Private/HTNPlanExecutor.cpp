@@ -2,8 +2,12 @@
 
 #include "HTNPlanExecutor.h"
 
+#include "Algo/BinarySearch.h"
 #include "HTNExecutionContext.h"
 #include "HTNLogging.h"
+#include "HTNPlanExecutorManager.h"
+#include "Effects/HTNEffect.h"
+#include "Misc/ScopeExit.h"
 
 UHTNPlanExecutor::UHTNPlanExecutor()
     : ExecutionMode(EHTNPlanExecutorMode::Sequential)
@@ -14,6 +18,12 @@ UHTNPlanExecutor::UHTNPlanExecutor()
     , bIsExecuting(false)
     , bIsPaused(false)
     , PlanStartTime(0.0f)
+    , ValidationWorldState(nullptr)
+    , PlanExecutionId(0)
+    , FailedTaskIndex(INDEX_NONE)
+    , bRemainingPlanValid(false)
+    , bHasQueuedPlan(false)
+    , bPendingHandOff(false)
 {
 }
 
@@ -27,11 +37,53 @@ UHTNPlanExecutor::~UHTNPlanExecutor()
 }
 
 void UHTNPlanExecutor::Tick(float DeltaTime)
+{
+    // Without a manager (e.g. no world), run the thread-safe ticks inline
+    TArray<FHTNThreadSafeTaskTick> ThreadSafeTicks;
+    GatherThreadSafeTicks(ThreadSafeTicks);
+    for (FHTNThreadSafeTaskTick& TaskTick : ThreadSafeTicks)
+    {
+        TaskTick.Run(DeltaTime);
+    }
+    
+    TickExecution(DeltaTime, ThreadSafeTicks);
+}
+
+void UHTNPlanExecutor::GatherThreadSafeTicks(TArray<FHTNThreadSafeTaskTick>& OutTicks)
+{
+    if (!bIsExecuting || bIsPaused || !CurrentWorldState || ExecutionMode == EHTNPlanExecutorMode::Sequential)
+    {
+        return;
+    }
+    
+    for (int32 TaskIndex : ExecutingTaskIndices)
+    {
+        const UHTNPrimitiveTask* Task = CurrentPlan.Tasks.IsValidIndex(TaskIndex) ? CurrentPlan.Tasks[TaskIndex] : nullptr;
+        uint8* TaskMemory = GetTaskMemory(TaskIndex);
+        if (Task && Task->HasThreadSafeTick() && Task->GetStatus(TaskMemory) == EHTNTaskStatus::InProgress)
+        {
+            FHTNThreadSafeTaskTick& TaskTick = OutTicks.AddDefaulted_GetRef();
+            TaskTick.Task = Task;
+            TaskTick.WorldState = CurrentWorldState;
+            TaskTick.NodeMemory = TaskMemory;
+            TaskTick.TaskIndex = TaskIndex;
+            TaskTick.PlanExecutionId = PlanExecutionId;
+        }
+    }
+}
+
+void UHTNPlanExecutor::TickExecution(float DeltaTime, TConstArrayView<FHTNThreadSafeTaskTick> ThreadSafeTicks)
 {
     if (!bIsExecuting || bIsPaused || !CurrentWorldState)
     {
         return;
     }
+    
+    // If the plan completes during this tick, continue with the queued plan once the tick has unwound
+    ON_SCOPE_EXIT
+    {
+        HandOffToQueuedPlan();
+    };
 
     // Get current time for timeout checking
     float CurrentTime = FPlatformTime::Seconds();
@@ -43,6 +95,7 @@ void UHTNPlanExecutor::Tick(float DeltaTime)
     if (ExecutionMode == EHTNPlanExecutorMode::Sequential)
     {
         // Get the current task
+        const int32 TaskIndex = CurrentPlan.CurrentTaskIndex;
         UHTNPrimitiveTask* CurrentTask = GetCurrentTask();
         if (!CurrentTask)
         {
@@ -52,14 +105,15 @@ void UHTNPlanExecutor::Tick(float DeltaTime)
         }
 
         // Tick the current task
-        if (CurrentTask && CurrentTask->GetStatus() == EHTNTaskStatus::InProgress)
+        uint8* TaskMemory = GetTaskMemory(TaskIndex);
+        if (CurrentTask->GetStatus(TaskMemory) == EHTNTaskStatus::InProgress)
         {
-            EHTNTaskStatus NewStatus = CurrentTask->TickTask(ExecutionContext, DeltaTime);
+            EHTNTaskStatus NewStatus = CurrentTask->Tick(ExecutionContext, TaskMemory, DeltaTime);
             
             // If the task status changed during the tick, handle it
             if (NewStatus != EHTNTaskStatus::InProgress)
             {
-                OnTaskCompleted(CurrentTask, NewStatus);
+                OnTaskCompleted(TaskIndex, NewStatus);
                 
                 // Try to execute the next task if the plan hasn't ended
                 if (bIsExecuting && !bIsPaused)
@@ -72,115 +126,87 @@ void UHTNPlanExecutor::Tick(float DeltaTime)
     // For parallel or dependency-based execution, tick all executing tasks
     else
     {
-        TArray<UHTNPrimitiveTask*> TasksToRemove;
+        // Apply the thread-safe ticks first, in the order they were gathered
+        for (const FHTNThreadSafeTaskTick& TaskTick : ThreadSafeTicks)
+        {
+            if (!bIsExecuting)
+            {
+                return;
+            }
+            
+            // Skip ticks whose task was completed or aborted since they were gathered
+            if (TaskTick.PlanExecutionId != PlanExecutionId ||
+                GetTaskStatusAtIndex(TaskTick.TaskIndex) != EHTNTaskStatus::InProgress)
+            {
+                continue;
+            }
+            
+            if (TaskTick.Status != EHTNTaskStatus::InProgress)
+            {
+                OnTaskCompleted(TaskTick.TaskIndex, TaskTick.Status);
+            }
+        }
         
-        // Tick all executing tasks
-        for (UHTNPrimitiveTask* Task : ExecutingTasks)
+        if (!bIsExecuting)
         {
-            if (Task && Task->GetStatus() == EHTNTaskStatus::InProgress)
+            return;
+        }
+        
+        TArray<int32> TasksToRemove;
+        
+        // Tick all executing tasks. Iterate a copy, completing a task may abort the plan.
+        const TArray<int32> TasksToTick = ExecutingTaskIndices;
+        for (int32 TaskIndex : TasksToTick)
+        {
+            if (!bIsExecuting)
+            {
+                return;
+            }
+            
+            UHTNPrimitiveTask* Task = CurrentPlan.Tasks.IsValidIndex(TaskIndex) ? CurrentPlan.Tasks[TaskIndex] : nullptr;
+            uint8* TaskMemory = GetTaskMemory(TaskIndex);
+            if (Task && Task->HasThreadSafeTick() && Task->GetStatus(TaskMemory) == EHTNTaskStatus::InProgress)
             {
-                EHTNTaskStatus NewStatus = Task->TickTask(ExecutionContext, DeltaTime);
+                // Already ticked with the thread-safe ticks
+                continue;
+            }
+            
+            if (Task && Task->GetStatus(TaskMemory) == EHTNTaskStatus::InProgress)
+            {
+                EHTNTaskStatus NewStatus = Task->Tick(ExecutionContext, TaskMemory, DeltaTime);
                 
                 // If the task status changed during the tick, handle it
                 if (NewStatus != EHTNTaskStatus::InProgress)
                 {
-                    OnTaskCompleted(Task, NewStatus);
-                    TasksToRemove.Add(Task);
+                    OnTaskCompleted(TaskIndex, NewStatus);
+                    TasksToRemove.Add(TaskIndex);
                 }
             }
             else
             {
                 // Task is not in progress anymore, remove it
-                TasksToRemove.Add(Task);
+                TasksToRemove.Add(TaskIndex);
             }
         }
         
+        if (!bIsExecuting)
+        {
+            return;
+        }
+        
         // Remove completed tasks
-        for (UHTNPrimitiveTask* Task : TasksToRemove)
+        for (int32 TaskIndex : TasksToRemove)
         {
-            ExecutingTasks.Remove(Task);
+            ExecutingTaskIndices.Remove(TaskIndex);
         }
         
-        // If we have no executing tasks, try to start new ones
-        if (ExecutingTasks.Num() == 0)
+        // Start new tasks once no tasks are executing, or in dependency-based mode as soon as their dependencies succeed
+        if (ExecutingTaskIndices.Num() == 0 || ExecutionMode == EHTNPlanExecutorMode::DependencyBased)
         {
-            // For parallel mode, start all available tasks
-            if (ExecutionMode == EHTNPlanExecutorMode::Parallel)
-            {
-                bool bTasksStarted = false;
-                
-                // Try to start all remaining tasks that are ready
-                TArray<UHTNPrimitiveTask*> RemainingTasks = CurrentPlan.GetRemainingTasks();
-                for (UHTNPrimitiveTask* Task : RemainingTasks)
-                {
-                    if (Task && Task->IsApplicable(CurrentWorldState))
-                    {
-                        // Start this task
-                        if (Task->Execute(ExecutionContext))
-                        {
-                            ExecutingTasks.Add(Task);
-                            TaskStartTimes.Add(Task, CurrentTime);
-                            OnTaskStarted.Broadcast(CurrentPlan, Task);
-                            bTasksStarted = true;
-                            
-                            // If the task completed immediately, handle it
-                            if (Task->IsComplete())
-                            {
-                                OnTaskCompleted(Task, Task->GetStatus());
-                                ExecutingTasks.Remove(Task);
-                            }
-                        }
-                    }
-                }
-                
-                // If no tasks could be started, check if the plan is complete
-                if (!bTasksStarted)
-                {
-                    CheckPlanCompletion();
-                }
-            }
-            // For dependency-based mode, start tasks whose dependencies are satisfied
-            else if (ExecutionMode == EHTNPlanExecutorMode::DependencyBased)
+            // If no tasks could be started, check if the plan is complete
+            if (!StartReadyTasks(CurrentTime) && ExecutingTaskIndices.Num() == 0)
             {
-                bool bTasksStarted = false;
-                
-                // Get all remaining tasks
-                TArray<UHTNPrimitiveTask*> RemainingTasks = CurrentPlan.GetRemainingTasks();
-                
-                // Try to start tasks whose dependencies are satisfied
-                for (int32 i = 0; i < RemainingTasks.Num(); ++i)
-                {
-                    UHTNPrimitiveTask* Task = RemainingTasks[i];
-                    int32 TaskIndex = CurrentPlan.Tasks.Find(Task);
-                    
-                    if (Task && 
-                        TaskIndex != INDEX_NONE && 
-                        CurrentPlan.AreTaskDependenciesSatisfied(TaskIndex) &&
-                        Task->IsApplicable(CurrentWorldState))
-                    {
-                        // Start this task
-                        if (Task->Execute(ExecutionContext))
-                        {
-                            ExecutingTasks.Add(Task);
-                            TaskStartTimes.Add(Task, CurrentTime);
-                            OnTaskStarted.Broadcast(CurrentPlan, Task);
-                            bTasksStarted = true;
-                            
-                            // If the task completed immediately, handle it
-                            if (Task->IsComplete())
-                            {
-                                OnTaskCompleted(Task, Task->GetStatus());
-                                ExecutingTasks.Remove(Task);
-                            }
-                        }
-                    }
-                }
-                
-                // If no tasks could be started, check if the plan is complete
-                if (!bTasksStarted)
-                {
-                    CheckPlanCompletion();
-                }
+                CheckPlanCompletion();
             }
         }
     }
@@ -188,7 +214,8 @@ void UHTNPlanExecutor::Tick(float DeltaTime)
 
 bool UHTNPlanExecutor::IsTickable() const
 {
-    return bIsExecuting && !bIsPaused;
+    // Executors registered with a manager are ticked in a batch by it
+    return bIsExecuting && !bIsPaused && !TickManager.IsValid();
 }
 
 TStatId UHTNPlanExecutor::GetStatId() const
@@ -220,8 +247,13 @@ bool UHTNPlanExecutor::StartPlan(const FHTNPlan& InPlan, UHTNExecutionContext* i
         return false;
     }
     
+    // A plan started from outside replaces anything queued for the previous one
+    ClearQueuedPlan();
+    bPendingHandOff = false;
+    
     // Set up the execution
     CurrentPlan = InPlan;
+    ExecutionContext->SetExecutor(this);
     ExecutionContext = ExecutionContext;
     CurrentWorldState = ExecutionContext->GetWorldState();
     OwnerActor = InOwner;
@@ -237,6 +269,22 @@ bool UHTNPlanExecutor::StartPlan(const FHTNPlan& InPlan, UHTNExecutionContext* i
     CurrentPlan.bFailed = false;
     CurrentPlan.bIsPaused = false;
     CurrentPlan.CurrentTaskIndex = 0;
+    ++PlanExecutionId;
+    FailedTaskIndex = INDEX_NONE;
+    SucceededTaskIndices.Reset();
+    
+    // Allocate the per-agent runtime state for every task in the plan
+    InitializeInstanceMemory();
+    
+    // Record what the plan expects the world to look like at each step
+    BuildPlanPredictions();
+    
+    // Let the world's manager batch this executor's ticks with all other agents
+    TickManager = UHTNPlanExecutorManager::Get(OwnerActor ? static_cast<UObject*>(OwnerActor) : this);
+    if (UHTNPlanExecutorManager* Manager = TickManager.Get())
+    {
+        Manager->RegisterExecutor(this);
+    }
     
     LogExecution(FString::Printf(TEXT("Starting plan execution with %d tasks"), CurrentPlan.Tasks.Num()));
     
@@ -249,75 +297,11 @@ bool UHTNPlanExecutor::StartPlan(const FHTNPlan& InPlan, UHTNExecutionContext* i
         // Start with the first task
         return ExecuteNextTask();
     }
-    else if (ExecutionMode == EHTNPlanExecutorMode::Parallel)
-    {
-        // Start all applicable tasks
-        bool bTasksStarted = false;
-        float CurrentTime = FPlatformTime::Seconds();
-        
-        for (UHTNPrimitiveTask* Task : CurrentPlan.Tasks)
-        {
-            if (Task && Task->IsApplicable(CurrentWorldState))
-            {
-                // Start this task
-                if (Task->Execute(ExecutionContext))
-                {
-                    ExecutingTasks.Add(Task);
-                    TaskStartTimes.Add(Task, CurrentTime);
-                    OnTaskStarted.Broadcast(CurrentPlan, Task);
-                    bTasksStarted = true;
-                    
-                    // If the task completed immediately, handle it
-                    if (Task->IsComplete())
-                    {
-                        OnTaskCompleted(Task, Task->GetStatus());
-                        ExecutingTasks.Remove(Task);
-                    }
-                }
-            }
-        }
-        
-        // If no tasks could be started, the plan fails
-        if (!bTasksStarted)
-        {
-            LogExecution(TEXT("Failed to start any tasks in the plan"), ELogVerbosity::Warning);
-            AbortPlan(true);
-            return false;
-        }
-        
-        return true;
-    }
-    else if (ExecutionMode == EHTNPlanExecutorMode::DependencyBased)
+    else if (ExecutionMode == EHTNPlanExecutorMode::Parallel ||
+             ExecutionMode == EHTNPlanExecutorMode::DependencyBased)
     {
-        // Start tasks with no dependencies
-        bool bTasksStarted = false;
-        float CurrentTime = FPlatformTime::Seconds();
-        
-        for (int32 i = 0; i < CurrentPlan.Tasks.Num(); ++i)
-        {
-            UHTNPrimitiveTask* Task = CurrentPlan.Tasks[i];
-            
-            if (Task && 
-                CurrentPlan.AreTaskDependenciesSatisfied(i) &&
-                Task->IsApplicable(CurrentWorldState))
-            {
-                // Start this task
-                if (Task->Execute(ExecutionContext))
-                {
-                    ExecutingTasks.Add(Task);
-                    TaskStartTimes.Add(Task, CurrentTime);
-                    OnTaskStarted.Broadcast(CurrentPlan, Task);
-                    bTasksStarted = true;
-                    
-                    // If the task completed immediately, handle it
-                    if (Task->IsComplete())
-                    {
-                        OnTaskCompleted(Task, Task->GetStatus());
-                        ExecutingTasks.Remove(Task);
-                    }
-                }
-            }
-        }
+        // Start all applicable tasks (with no unsatisfied dependencies in dependency-based mode)
+        const bool bTasksStarted = StartReadyTasks(FPlatformTime::Seconds());
         
         // If no tasks could be started, the plan fails
         if (!bTasksStarted)
@@ -379,16 +363,24 @@ bool UHTNPlanExecutor::AbortPlan(bool bFailTasks)
     
     LogExecution(TEXT("Aborting plan execution"));
     
+    // The queued plan was made to follow this one
+    ClearQueuedPlan();
+    bPendingHandOff = false;
+    
     // Abort all executing tasks
-    for (UHTNPrimitiveTask* Task : ExecutingTasks)
+    for (int32 TaskIndex : ExecutingTaskIndices)
     {
-        if (Task && Task->GetStatus() == EHTNTaskStatus::InProgress)
+        UHTNPrimitiveTask* Task = CurrentPlan.Tasks.IsValidIndex(TaskIndex) ? CurrentPlan.Tasks[TaskIndex] : nullptr;
+        uint8* TaskMemory = GetTaskMemory(TaskIndex);
+        if (Task && Task->GetStatus(TaskMemory) == EHTNTaskStatus::InProgress)
         {
-            Task->AbortTask(ExecutionContext);
+            Task->AbortTask(ExecutionContext, TaskMemory);
+            Task->OnTaskAborted.Broadcast(Task, ExecutionContext);
             
             if (bFailTasks)
             {
                 OnTaskFailed.Broadcast(CurrentPlan, Task);
+                Task->OnTaskFailed.Broadcast(Task, ExecutionContext);
             }
         }
     }
@@ -435,6 +427,11 @@ void UHTNPlanExecutor::SetExecutionMode(EHTNPlanExecutorMode InExecutionMode)
     ExecutionMode = InExecutionMode;
 }
 
+EHTNPlanExecutorMode UHTNPlanExecutor::GetExecutionMode() const
+{
+    return ExecutionMode;
+}
+
 void UHTNPlanExecutor::SetMaxTaskExecutionTime(float InMaxTaskExecutionTime)
 {
     MaxTaskExecutionTime = InMaxTaskExecutionTime;
@@ -465,12 +462,19 @@ bool UHTNPlanExecutor::IsTaskExecuting(UHTNPrimitiveTask* Task) const
     
     if (ExecutionMode == EHTNPlanExecutorMode::Sequential)
     {
-        UHTNPrimitiveTask* CurrentTask = GetCurrentTask();
-        return CurrentTask == Task && CurrentTask->GetStatus() == EHTNTaskStatus::InProgress;
+        return GetCurrentTask() == Task && 
+            GetTaskStatusAtIndex(CurrentPlan.CurrentTaskIndex) == EHTNTaskStatus::InProgress;
     }
     else
     {
-        return ExecutingTasks.Contains(Task) && Task->GetStatus() == EHTNTaskStatus::InProgress;
+        for (int32 TaskIndex : ExecutingTaskIndices)
+        {
+            if (CurrentPlan.Tasks[TaskIndex] == Task && GetTaskStatusAtIndex(TaskIndex) == EHTNTaskStatus::InProgress)
+            {
+                return true;
+            }
+        }
+        return false;
     }
 }
 
@@ -481,7 +485,25 @@ EHTNTaskStatus UHTNPlanExecutor::GetTaskStatus(UHTNPrimitiveTask* Task) const
         return EHTNTaskStatus::Invalid;
     }
     
-    return Task->GetStatus();
+    // Prefer the task that is currently running if the task appears more than once in the plan
+    if (GetCurrentTask() == Task)
+    {
+        return GetTaskStatusAtIndex(CurrentPlan.CurrentTaskIndex);
+    }
+    
+    return GetTaskStatusAtIndex(CurrentPlan.Tasks.Find(Task));
+}
+
+EHTNTaskStatus UHTNPlanExecutor::GetTaskStatusAtIndex(int32 TaskIndex) const
+{
+    const UHTNPrimitiveTask* Task = CurrentPlan.Tasks.IsValidIndex(TaskIndex) ? CurrentPlan.Tasks[TaskIndex] : nullptr;
+    const uint8* TaskMemory = GetTaskMemory(TaskIndex);
+    if (!Task || !TaskMemory)
+    {
+        return EHTNTaskStatus::Invalid;
+    }
+    
+    return Task->GetStatus(TaskMemory);
 }
 
 bool UHTNPlanExecutor::ExecuteNextTask()
@@ -506,6 +528,7 @@ bool UHTNPlanExecutor::ExecuteNextTask()
             CurrentPlan.bFailed = false;
             CurrentPlan.Status = EHTNPlanStatus::Completed;
             CurrentPlan.EndTime = FPlatformTime::Seconds();
+            bPendingHandOff = bHasQueuedPlan;
             
             // Broadcast plan completed event
             OnPlanCompleted.Broadcast(CurrentPlan);
@@ -517,7 +540,9 @@ bool UHTNPlanExecutor::ExecuteNextTask()
         }
         
         // Get the next task to execute
-        UHTNPrimitiveTask* NextTask = CurrentPlan.Tasks[CurrentPlan.CurrentTaskIndex];
+        const int32 TaskIndex = CurrentPlan.CurrentTaskIndex;
+        UHTNPrimitiveTask* NextTask = CurrentPlan.Tasks[TaskIndex];
+        uint8* TaskMemory = GetTaskMemory(TaskIndex);
         if (!NextTask)
         {
             // Invalid task, skip it
@@ -533,7 +558,7 @@ bool UHTNPlanExecutor::ExecuteNextTask()
             LogExecution(FString::Printf(TEXT("Task %s is not applicable, failing it"), *NextTask->ToString()), ELogVerbosity::Warning);
             
             // Mark the task as failed
-            OnTaskCompleted(NextTask, EHTNTaskStatus::Failed);
+            OnTaskCompleted(TaskIndex, EHTNTaskStatus::Failed);
             
             // Move to the next task if we're still executing
             if (bIsExecuting && !bIsPaused)
@@ -548,17 +573,19 @@ bool UHTNPlanExecutor::ExecuteNextTask()
         LogExecution(FString::Printf(TEXT("Executing task %s"), *NextTask->ToString()));
         
         float CurrentTime = FPlatformTime::Seconds();
-        TaskStartTimes.Add(NextTask, CurrentTime);
+        TaskStartTimes.Add(TaskIndex, CurrentTime);
         
-        if (NextTask->Execute(ExecutionContext))
+        if (NextTask->Execute(ExecutionContext, TaskMemory))
         {
             // Task execution started successfully
+            ExecutingTaskIndices.Add(TaskIndex);
             OnTaskStarted.Broadcast(CurrentPlan, NextTask);
+            NextTask->OnTaskStarted.Broadcast(NextTask, ExecutionContext);
             
             // If the task completed immediately, handle it
-            if (NextTask->IsComplete())
+            if (NextTask->IsComplete(TaskMemory))
             {
-                OnTaskCompleted(NextTask, NextTask->GetStatus());
+                OnTaskCompleted(TaskIndex, NextTask->GetStatus(TaskMemory));
                 
                 // Move to the next task if we're still executing
                 if (bIsExecuting && !bIsPaused)
@@ -575,7 +602,7 @@ bool UHTNPlanExecutor::ExecuteNextTask()
             LogExecution(FString::Printf(TEXT("Failed to start execution of task %s"), *NextTask->ToString()), ELogVerbosity::Warning);
             
             // Mark the task as failed
-            OnTaskCompleted(NextTask, EHTNTaskStatus::Failed);
+            OnTaskCompleted(TaskIndex, EHTNTaskStatus::Failed);
             
             // Move to the next task if we're still executing
             if (bIsExecuting && !bIsPaused)
@@ -591,6 +618,224 @@ bool UHTNPlanExecutor::ExecuteNextTask()
     return false;
 }
 
+bool UHTNPlanExecutor::ValidateRemainingPlan()
+{
+    if (!bIsExecuting || !CurrentWorldState)
+    {
+        return false;
+    }
+    
+    // Nothing changed since the last check, so the result can't have changed either
+    if (!bRemainingPlanValid || CurrentWorldState->IsUnchangedSince(ValidatedLayers, ValidatedLayerVersions))
+    {
+        return bRemainingPlanValid;
+    }
+    
+    // Changes to shared layers count as well, read through the live state's layers
+    TArray<FName> ChangedKeys;
+    if (CurrentWorldState->HasLayers(ValidatedLayers))
+    {
+        CurrentWorldState->GetChangedKeysSince(ValidatedLayerVersions, ChangedKeys);
+    }
+    else
+    {
+        // Layers were attached, detached or replaced, so any key may differ from the predictions
+        ChangedKeys = CurrentWorldState->GetSnapshot().GetPropertyNames();
+        if (PredictedWorldStates.IsValidIndex(GetFirstRemainingTaskIndex()))
+        {
+            ChangedKeys.Append(PredictedWorldStates[GetFirstRemainingTaskIndex()].GetPropertyNames());
+        }
+    }
+    CurrentWorldState->GetLayers(ValidatedLayers);
+    CurrentWorldState->GetLayerVersions(ValidatedLayerVersions);
+    
+    // Values that may differ from the predictions, carried forward step by step. Unset means removed.
+    TMap<FName, TOptional<FHTNProperty>> ChangedValues;
+    for (const FName& Key : ChangedKeys)
+    {
+        FHTNProperty Value;
+        ChangedValues.Add(Key, CurrentWorldState->GetProperty(Key, Value) ? TOptional<FHTNProperty>(Value) : TOptional<FHTNProperty>());
+    }
+    
+    for (int32 StepIndex = GetFirstRemainingTaskIndex(); StepIndex < PredictedWorldStates.Num(); ++StepIndex)
+    {
+        FHTNWorldStateSnapshot& PredictedState = PredictedWorldStates[StepIndex];
+        const FHTNPlanStepKeys& StepKeys = PlanStepKeys[StepIndex];
+        
+        // Drop values the prediction already has, and patch the prediction with the rest
+        bool bReadsChangedKey = false;
+        for (auto It = ChangedValues.CreateIterator(); It; ++It)
+        {
+            FHTNProperty PredictedValue;
+            const bool bPredicted = PredictedState.GetProperty(It.Key(), PredictedValue);
+            if (bPredicted == It.Value().IsSet() && (!bPredicted || PredictedValue == It.Value().GetValue()))
+            {
+                It.RemoveCurrent();
+                continue;
+            }
+            
+            if (It.Value().IsSet())
+            {
+                PredictedState.SetProperty(It.Key(), It.Value().GetValue());
+            }
+            else
+            {
+                PredictedState.RemoveProperty(It.Key());
+            }
+            bReadsChangedKey |= StepKeys.bReadsAnyKey || StepKeys.ReadKeys.Contains(It.Key());
+        }
+        
+        // The rest of the plan sees exactly what was predicted
+        if (ChangedValues.Num() == 0)
+        {
+            break;
+        }
+        
+        // The last prediction is the state after the final step
+        if (!CurrentPlan.Tasks.IsValidIndex(StepIndex))
+        {
+            break;
+        }
+        
+        const UHTNPrimitiveTask* Task = CurrentPlan.Tasks[StepIndex];
+        if (!Task)
+        {
+            continue;
+        }
+        
+        FHTNWorldStateStruct StepState;
+        PredictedState.ToWorldState(StepState);
+        ValidationWorldState->SetWorldState(StepState);
+        if (bReadsChangedKey && !Task->IsApplicable(ValidationWorldState))
+        {
+            LogExecution(FString::Printf(TEXT("Plan step %d (%s) is no longer applicable"), StepIndex, *Task->ToString()));
+            bRemainingPlanValid = false;
+            return false;
+        }
+        
+        // Carry the changes through the step's effects; keys the effects write take their new values
+        for (const UHTNEffect* Effect : Task->Effects)
+        {
+            if (Effect)
+            {
+                Effect->ApplyEffect(ValidationWorldState);
+            }
+        }
+        
+        const FHTNWorldStateStruct& ResultState = ValidationWorldState->GetWorldState();
+        TArray<FName> KeysToCarry;
+        ChangedValues.GetKeys(KeysToCarry);
+        if (StepKeys.bWritesAnyKey)
+        {
+            KeysToCarry.Append(ResultState.GetPropertyNames());
+            KeysToCarry.Append(PredictedWorldStates[StepIndex + 1].GetPropertyNames());
+        }
+        else
+        {
+            KeysToCarry.Append(StepKeys.WriteKeys);
+        }
+        
+        ChangedValues.Reset();
+        for (const FName& Key : KeysToCarry)
+        {
+            FHTNProperty Value;
+            ChangedValues.Add(Key, ResultState.GetProperty(Key, Value) ? TOptional<FHTNProperty>(Value) : TOptional<FHTNProperty>());
+        }
+    }
+    
+    return true;
+}
+
+bool UHTNPlanExecutor::CompleteTask(int32 TaskIndex, EHTNTaskStatus Status)
+{
+    if (!bIsExecuting || (Status != EHTNTaskStatus::Succeeded && Status != EHTNTaskStatus::Failed) ||
+        GetTaskStatusAtIndex(TaskIndex) != EHTNTaskStatus::InProgress)
+    {
+        return false;
+    }
+    
+    OnTaskCompleted(TaskIndex, Status);
+    
+    // The sequential tick only advances after completions it observed itself
+    if (ExecutionMode == EHTNPlanExecutorMode::Sequential && bIsExecuting && !bIsPaused)
+    {
+        ExecuteNextTask();
+    }
+    
+    HandOffToQueuedPlan();
+    return true;
+}
+
+bool UHTNPlanExecutor::SetTaskResult(int32 TaskIndex, FName ResultName, const FHTNProperty& ResultValue)
+{
+    return bIsExecuting && CurrentPlan.SetTaskResult(TaskIndex, ResultName, ResultValue);
+}
+
+FHTNTaskCompletionHandle UHTNPlanExecutor::MakeCompletionHandle(const uint8* NodeMemory) const
+{
+    FHTNTaskCompletionHandle Handle;
+    
+    const UHTNPlanExecutorManager* Manager = TickManager.Get();
+    const int32 TaskIndex = GetTaskIndexFromMemory(NodeMemory);
+    if (!bIsExecuting || !Manager || TaskIndex == INDEX_NONE)
+    {
+        return Handle;
+    }
+    
+    Handle.Queue = Manager->GetCompletionQueue();
+    Handle.Executor = const_cast<UHTNPlanExecutor*>(this);
+    Handle.PlanExecutionId = PlanExecutionId;
+    Handle.TaskIndex = TaskIndex;
+    return Handle;
+}
+
+int32 UHTNPlanExecutor::GetTaskIndexFromMemory(const uint8* NodeMemory) const
+{
+    if (!NodeMemory || InstanceMemory.Num() == 0)
+    {
+        return INDEX_NONE;
+    }
+    
+    const int64 Offset = NodeMemory - InstanceMemory.GetData();
+    if (Offset < 0 || Offset >= InstanceMemory.Num())
+    {
+        return INDEX_NONE;
+    }
+    
+    // Offsets ascend with the task index, the owner is the last task starting at or before the offset
+    return Algo::UpperBound(InstanceMemoryOffsets, static_cast<int32>(Offset)) - 1;
+}
+
+int32 UHTNPlanExecutor::GetNumRemainingTasks() const
+{
+    return bIsExecuting ? CurrentPlan.Tasks.Num() - GetFirstRemainingTaskIndex() : 0;
+}
+
+const FHTNWorldStateSnapshot* UHTNPlanExecutor::GetPredictedFinalWorldState() const
+{
+    return bIsExecuting && PredictedWorldStates.Num() > 0 ? &PredictedWorldStates.Last() : nullptr;
+}
+
+bool UHTNPlanExecutor::QueueNextPlan(const FHTNPlan& NextPlan)
+{
+    if (!bIsExecuting || !NextPlan.IsValid())
+    {
+        return false;
+    }
+    
+    QueuedPlan = NextPlan;
+    bHasQueuedPlan = true;
+    
+    LogExecution(FString::Printf(TEXT("Queued next plan with %d tasks"), QueuedPlan.Tasks.Num()));
+    return true;
+}
+
+void UHTNPlanExecutor::ClearQueuedPlan()
+{
+    QueuedPlan = FHTNPlan();
+    bHasQueuedPlan = false;
+}
+
 FString UHTNPlanExecutor::ToString() const
 {
     FString Result = FString::Printf(TEXT("HTN Plan Executor - %s\n"), 
@@ -610,8 +855,9 @@ FString UHTNPlanExecutor::ToString() const
     return Result;
 }
 
-void UHTNPlanExecutor::OnTaskCompleted(UHTNPrimitiveTask* Task, EHTNTaskStatus Status)
+void UHTNPlanExecutor::OnTaskCompleted(int32 TaskIndex, EHTNTaskStatus Status)
 {
+    UHTNPrimitiveTask* Task = CurrentPlan.Tasks.IsValidIndex(TaskIndex) ? CurrentPlan.Tasks[TaskIndex] : nullptr;
     if (!bIsExecuting || !Task)
     {
         return;
@@ -622,14 +868,21 @@ void UHTNPlanExecutor::OnTaskCompleted(UHTNPrimitiveTask* Task, EHTNTaskStatus S
         *StaticEnum<EHTNTaskStatus>()->GetNameStringByValue(static_cast<int64>(Status))));
     
     // Remove task from execution tracking
-    TaskStartTimes.Remove(Task);
+    TaskStartTimes.Remove(TaskIndex);
+    ExecutingTaskIndices.Remove(TaskIndex);
 
-    Task->EndTask(ExecutionContext, Status);
+    uint8* TaskMemory = GetTaskMemory(TaskIndex);
+    Task->Finish(ExecutionContext, TaskMemory, Status);
+    Task->SetStatus(TaskMemory, Status);
     
     if (Status == EHTNTaskStatus::Succeeded)
     {
+        // A repair must not run these again, even when they come after the failed task
+        SucceededTaskIndices.Add(TaskIndex);
+        
         // Broadcast task succeeded event
         OnTaskSucceeded.Broadcast(CurrentPlan, Task);
+        Task->OnTaskSucceeded.Broadcast(Task, ExecutionContext);
         
         // If in sequential mode, move to the next task
         if (ExecutionMode == EHTNPlanExecutorMode::Sequential)
@@ -639,8 +892,15 @@ void UHTNPlanExecutor::OnTaskCompleted(UHTNPrimitiveTask* Task, EHTNTaskStatus S
     }
     else if (Status == EHTNTaskStatus::Failed)
     {
+        // Remember the task that failed first, which is what a repair starts from
+        if (FailedTaskIndex == INDEX_NONE)
+        {
+            FailedTaskIndex = TaskIndex;
+        }
+        
         // Broadcast task failed event
         OnTaskFailed.Broadcast(CurrentPlan, Task);
+        Task->OnTaskFailed.Broadcast(Task, ExecutionContext);
         
         // Check if we should abort the plan on task failure
         if (bAbortOnTaskFailure)
@@ -666,38 +926,46 @@ void UHTNPlanExecutor::CheckTaskTimeouts(float CurrentTime)
         return; // No timeout
     }
     
-    TArray<UHTNPrimitiveTask*> TasksToTimeout;
+    TArray<int32> TasksToTimeout;
     
     // Check each executing task for timeout
     for (const auto& Pair : TaskStartTimes)
     {
-        UHTNPrimitiveTask* Task = Pair.Key;
+        int32 TaskIndex = Pair.Key;
         float StartTime = Pair.Value;
         
-        if (Task && CurrentTime - StartTime > MaxTaskExecutionTime)
+        if (CurrentPlan.Tasks.IsValidIndex(TaskIndex) && CurrentTime - StartTime > MaxTaskExecutionTime)
         {
-            TasksToTimeout.Add(Task);
+            TasksToTimeout.Add(TaskIndex);
         }
     }
     
     // Handle timed out tasks
-    for (UHTNPrimitiveTask* Task : TasksToTimeout)
+    for (int32 TaskIndex : TasksToTimeout)
     {
+        if (!bIsExecuting)
+        {
+            break;
+        }
+        
+        UHTNPrimitiveTask* Task = CurrentPlan.Tasks[TaskIndex];
+        if (!Task)
+        {
+            TaskStartTimes.Remove(TaskIndex);
+            continue;
+        }
+        
         LogExecution(FString::Printf(TEXT("Task %s timed out after %.2f seconds"), 
             *Task->ToString(), MaxTaskExecutionTime), ELogVerbosity::Warning);
         
         // Abort the task
-        Task->AbortTask(ExecutionContext);
+        Task->AbortTask(ExecutionContext, GetTaskMemory(TaskIndex));
         
         // Broadcast task timeout event
         OnTaskTimeout.Broadcast(CurrentPlan, Task);
         
-        // Remove from executing tasks
-        ExecutingTasks.Remove(Task);
-        TaskStartTimes.Remove(Task);
-        
         // Mark as failed and handle completion
-        OnTaskCompleted(Task, EHTNTaskStatus::Failed);
+        OnTaskCompleted(TaskIndex, EHTNTaskStatus::Failed);
     }
 }
 
@@ -720,25 +988,31 @@ bool UHTNPlanExecutor::CheckPlanCompletion()
         // Parallel or dependency-based mode - check if all tasks are completed
         bool bHasRemainingTasks = false;
         
-        for (UHTNPrimitiveTask* Task : CurrentPlan.Tasks)
+        for (int32 TaskIndex = 0; TaskIndex < CurrentPlan.Tasks.Num(); ++TaskIndex)
         {
-            if (Task && !Task->IsComplete())
+            if (GetTaskStatusAtIndex(TaskIndex) == EHTNTaskStatus::InProgress)
             {
                 bHasRemainingTasks = true;
                 break;
             }
         }
         
-        bAllTasksCompleted = !bHasRemainingTasks && ExecutingTasks.Num() == 0;
+        // In dependency-based mode, tasks that were waiting on the ones that just completed start now
+        if (!bHasRemainingTasks && ExecutionMode == EHTNPlanExecutorMode::DependencyBased && StartReadyTasks(FPlatformTime::Seconds()))
+        {
+            bHasRemainingTasks = true;
+        }
+        
+        bAllTasksCompleted = !bHasRemainingTasks && ExecutingTaskIndices.Num() == 0;
     }
     
     if (bAllTasksCompleted)
     {
         // Check if any tasks failed
         bool bAnyTaskFailed = false;
-        for (UHTNPrimitiveTask* Task : CurrentPlan.Tasks)
+        for (int32 TaskIndex = 0; TaskIndex < CurrentPlan.Tasks.Num(); ++TaskIndex)
         {
-            if (Task && Task->GetStatus() == EHTNTaskStatus::Failed)
+            if (GetTaskStatusAtIndex(TaskIndex) == EHTNTaskStatus::Failed)
             {
                 bAnyTaskFailed = true;
                 break;
@@ -752,6 +1026,13 @@ bool UHTNPlanExecutor::CheckPlanCompletion()
         CurrentPlan.Status = bAnyTaskFailed ? EHTNPlanStatus::Failed : EHTNPlanStatus::Completed;
         CurrentPlan.EndTime = FPlatformTime::Seconds();
         
+        // Only a successful plan hands off to the plan queued after it
+        if (bAnyTaskFailed)
+        {
+            ClearQueuedPlan();
+        }
+        bPendingHandOff = bHasQueuedPlan;
+        
         if (bAnyTaskFailed)
         {
             LogExecution(TEXT("Plan execution failed - some tasks failed"));
@@ -774,10 +1055,303 @@ bool UHTNPlanExecutor::CheckPlanCompletion()
 
 void UHTNPlanExecutor::CleanupPlan()
 {
+    if (UHTNPlanExecutorManager* Manager = TickManager.Get())
+    {
+        Manager->UnregisterExecutor(this);
+    }
+    TickManager.Reset();
+    
     bIsExecuting = false;
     bIsPaused = false;
-    ExecutingTasks.Empty();
+    ExecutingTaskIndices.Empty();
     TaskStartTimes.Empty();
+    CleanupInstanceMemory();
+    PredictedWorldStates.Reset();
+    PlanStepKeys.Reset();
+}
+
+bool UHTNPlanExecutor::StartReadyTasks(float CurrentTime)
+{
+    bool bTasksStarted = false;
+    for (int32 TaskIndex = CurrentPlan.CurrentTaskIndex; TaskIndex < CurrentPlan.Tasks.Num() && bIsExecuting; ++TaskIndex)
+    {
+        // Skip started tasks before their preconditions are checked again
+        if (GetTaskStatusAtIndex(TaskIndex) != EHTNTaskStatus::Invalid)
+        {
+            continue;
+        }
+        
+        if (ExecutionMode != EHTNPlanExecutorMode::DependencyBased)
+        {
+            bTasksStarted |= StartTaskAtIndex(TaskIndex, CurrentTime);
+            continue;
+        }
+        
+        if (!AreTaskDependenciesCompleted(TaskIndex))
+        {
+            continue;
+        }
+        
+        // Every task writing what this one reads is done, so a task that can't start now never will
+        if (StartTaskAtIndex(TaskIndex, CurrentTime))
+        {
+            bTasksStarted = true;
+        }
+        else if (GetTaskStatusAtIndex(TaskIndex) == EHTNTaskStatus::Invalid && CurrentPlan.Tasks[TaskIndex])
+        {
+            LogExecution(FString::Printf(TEXT("Task %s cannot start once its dependencies are done, failing it"), *CurrentPlan.Tasks[TaskIndex]->ToString()), ELogVerbosity::Warning);
+            OnTaskCompleted(TaskIndex, EHTNTaskStatus::Failed);
+        }
+    }
+    return bTasksStarted;
+}
+
+bool UHTNPlanExecutor::AreTaskDependenciesCompleted(int32 TaskIndex) const
+{
+    const TArray<int32>* Dependencies = CurrentPlan.TaskDependencies.Find(TaskIndex);
+    if (!Dependencies)
+    {
+        return true;
+    }
+    
+    // Tasks before the current one are done; the others have to have succeeded in this execution
+    for (int32 DependencyIndex : *Dependencies)
+    {
+        if (DependencyIndex >= CurrentPlan.CurrentTaskIndex && GetTaskStatusAtIndex(DependencyIndex) != EHTNTaskStatus::Succeeded)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool UHTNPlanExecutor::StartTaskAtIndex(int32 TaskIndex, float CurrentTime)
+{
+    UHTNPrimitiveTask* Task = CurrentPlan.Tasks.IsValidIndex(TaskIndex) ? CurrentPlan.Tasks[TaskIndex] : nullptr;
+    uint8* TaskMemory = GetTaskMemory(TaskIndex);
+    if (!Task || !Task->IsApplicable(CurrentWorldState))
+    {
+        return false;
+    }
+    
+    // Each plan step runs once; a status other than Invalid means it has already been started
+    if (Task->GetStatus(TaskMemory) != EHTNTaskStatus::Invalid)
+    {
+        return false;
+    }
+    
+    // Start this task
+    if (!Task->Execute(ExecutionContext, TaskMemory))
+    {
+        return false;
+    }
+    
+    ExecutingTaskIndices.Add(TaskIndex);
+    TaskStartTimes.Add(TaskIndex, CurrentTime);
+    OnTaskStarted.Broadcast(CurrentPlan, Task);
+    Task->OnTaskStarted.Broadcast(Task, ExecutionContext);
+    
+    // If the task completed immediately, handle it
+    if (Task->IsComplete(TaskMemory))
+    {
+        OnTaskCompleted(TaskIndex, Task->GetStatus(TaskMemory));
+    }
+    
+    return true;
+}
+
+void UHTNPlanExecutor::HandOffToQueuedPlan()
+{
+    if (!bPendingHandOff)
+    {
+        return;
+    }
+    bPendingHandOff = false;
+    
+    // Something else may have started a plan from a completion delegate
+    if (bIsExecuting || !bHasQueuedPlan || !ExecutionContext || !ExecutionContext->GetWorldState())
+    {
+        ClearQueuedPlan();
+        return;
+    }
+    
+    const FHTNPlan NextPlan = MoveTemp(QueuedPlan);
+    ClearQueuedPlan();
+    
+    // The queued plan was made for the predicted end state, check it against the state the plan actually ended in
+    if (!ValidationWorldState)
+    {
+        ValidationWorldState = NewObject<UHTNWorldState>(this);
+    }
+    FHTNWorldStateStruct ActualState;
+    ExecutionContext->GetWorldState()->GetResolvedWorldState(ActualState);
+    ValidationWorldState->SetParentLayer(nullptr);
+    ValidationWorldState->SetWorldState(ActualState);
+    
+    for (const UHTNPrimitiveTask* Task : NextPlan.Tasks)
+    {
+        if (!Task || !Task->IsApplicable(ValidationWorldState))
+        {
+            LogExecution(TEXT("Queued plan is not applicable to the actual world state, discarding it"), ELogVerbosity::Log);
+            return;
+        }
+        
+        for (const UHTNEffect* Effect : Task->Effects)
+        {
+            if (Effect)
+            {
+                Effect->ApplyEffect(ValidationWorldState);
+            }
+        }
+    }
+    
+    LogExecution(TEXT("Handing off to queued plan"));
+    StartPlan(NextPlan, ExecutionContext, OwnerActor);
+}
+
+void UHTNPlanExecutor::BuildPlanPredictions()
+{
+    PredictedWorldStates.Reset();
+    PlanStepKeys.Reset();
+    bRemainingPlanValid = true;
+    
+    if (!CurrentWorldState)
+    {
+        return;
+    }
+    
+    if (!ValidationWorldState)
+    {
+        ValidationWorldState = NewObject<UHTNWorldState>(this);
+    }
+    
+    // Predictions are flattened snapshots, so they stay valid whatever shared layers they were made from
+    CurrentWorldState->GetLayers(ValidatedLayers);
+    CurrentWorldState->GetLayerVersions(ValidatedLayerVersions);
+    PredictedWorldStates.Reserve(CurrentPlan.Tasks.Num() + 1);
+    PredictedWorldStates.Add(CurrentWorldState->GetSnapshot());
+    
+    FHTNWorldStateStruct InitialState;
+    PredictedWorldStates[0].ToWorldState(InitialState);
+    ValidationWorldState->SetParentLayer(nullptr);
+    ValidationWorldState->SetWorldState(InitialState);
+    
+    PlanStepKeys.SetNum(CurrentPlan.Tasks.Num());
+    for (int32 StepIndex = 0; StepIndex < CurrentPlan.Tasks.Num(); ++StepIndex)
+    {
+        // Each prediction shares the chunks its step's effects don't touch with the one before
+        FHTNWorldStateSnapshot NextState = PredictedWorldStates[StepIndex];
+        
+        const UHTNPrimitiveTask* Task = CurrentPlan.Tasks[StepIndex];
+        if (!Task)
+        {
+            PredictedWorldStates.Add(MoveTemp(NextState));
+            continue;
+        }
+        
+        FHTNPlanStepKeys& StepKeys = PlanStepKeys[StepIndex];
+        StepKeys.bReadsAnyKey = !Task->GetPreconditionReadKeys(StepKeys.ReadKeys);
+        StepKeys.bWritesAnyKey = !Task->GetEffectWriteKeys(StepKeys.WriteKeys);
+        
+        const uint32 PreviousVersion = ValidationWorldState->GetWorldState().GetVersion();
+        for (const UHTNEffect* Effect : Task->Effects)
+        {
+            if (Effect)
+            {
+                Effect->ApplyEffect(ValidationWorldState);
+            }
+        }
+        
+        TArray<FName> WrittenKeys;
+        ValidationWorldState->GetWorldState().GetChangedKeysSince(PreviousVersion, WrittenKeys);
+        FHTNProperty Value;
+        for (const FName& Key : WrittenKeys)
+        {
+            if (ValidationWorldState->GetProperty(Key, Value))
+            {
+                NextState.SetProperty(Key, Value);
+            }
+            else
+            {
+                NextState.RemoveProperty(Key);
+            }
+        }
+        PredictedWorldStates.Add(MoveTemp(NextState));
+    }
+}
+
+int32 UHTNPlanExecutor::GetFirstRemainingTaskIndex() const
+{
+    if (ExecutionMode == EHTNPlanExecutorMode::Sequential)
+    {
+        return CurrentPlan.CurrentTaskIndex;
+    }
+    
+    for (int32 TaskIndex = 0; TaskIndex < CurrentPlan.Tasks.Num(); ++TaskIndex)
+    {
+        const EHTNTaskStatus Status = GetTaskStatusAtIndex(TaskIndex);
+        if (Status == EHTNTaskStatus::Invalid || Status == EHTNTaskStatus::InProgress)
+        {
+            return TaskIndex;
+        }
+    }
+    
+    return CurrentPlan.Tasks.Num();
+}
+
+void UHTNPlanExecutor::InitializeInstanceMemory()
+{
+    CleanupInstanceMemory();
+    
+    // Lay out every task's memory back to back, so one agent's runtime state is a single allocation
+    constexpr int32 MemoryAlignment = 16;
+    int32 TotalSize = 0;
+    InstanceMemoryOffsets.SetNumUninitialized(CurrentPlan.Tasks.Num());
+    for (int32 TaskIndex = 0; TaskIndex < CurrentPlan.Tasks.Num(); ++TaskIndex)
+    {
+        const UHTNPrimitiveTask* Task = CurrentPlan.Tasks[TaskIndex];
+        InstanceMemoryOffsets[TaskIndex] = TotalSize;
+        if (Task)
+        {
+            TotalSize += Align(static_cast<int32>(Task->GetInstanceMemorySize()), MemoryAlignment);
+        }
+    }
+    
+    InstanceMemory.SetNumUninitialized(TotalSize);
+    
+    for (int32 TaskIndex = 0; TaskIndex < CurrentPlan.Tasks.Num(); ++TaskIndex)
+    {
+        if (const UHTNPrimitiveTask* Task = CurrentPlan.Tasks[TaskIndex])
+        {
+            Task->InitializeMemory(InstanceMemory.GetData() + InstanceMemoryOffsets[TaskIndex]);
+        }
+    }
+}
+
+void UHTNPlanExecutor::CleanupInstanceMemory()
+{
+    for (int32 TaskIndex = 0; TaskIndex < InstanceMemoryOffsets.Num(); ++TaskIndex)
+    {
+        const UHTNPrimitiveTask* Task = CurrentPlan.Tasks.IsValidIndex(TaskIndex) ? CurrentPlan.Tasks[TaskIndex] : nullptr;
+        if (Task)
+        {
+            Task->CleanupMemory(InstanceMemory.GetData() + InstanceMemoryOffsets[TaskIndex]);
+        }
+    }
+    
+    // Keep the allocation around for the next plan
+    InstanceMemory.Reset();
+    InstanceMemoryOffsets.Reset();
+}
+
+uint8* UHTNPlanExecutor::GetTaskMemory(int32 TaskIndex)
+{
+    return InstanceMemoryOffsets.IsValidIndex(TaskIndex) ? InstanceMemory.GetData() + InstanceMemoryOffsets[TaskIndex] : nullptr;
+}
+
+const uint8* UHTNPlanExecutor::GetTaskMemory(int32 TaskIndex) const
+{
+    return InstanceMemoryOffsets.IsValidIndex(TaskIndex) ? InstanceMemory.GetData() + InstanceMemoryOffsets[TaskIndex] : nullptr;
 }
 
 void UHTNPlanExecutor::ApplyTaskEffects(UHTNPrimitiveTask* Task)
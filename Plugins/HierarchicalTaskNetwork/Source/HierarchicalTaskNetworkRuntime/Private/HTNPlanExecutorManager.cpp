@@ -0,0 +1,109 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNPlanExecutorManager.h"
+
+#include "Async/ParallelFor.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+namespace HTNPlanExecutorManager
+{
+    /** Below this many thread-safe ticks, dispatching to worker threads costs more than it saves */
+    constexpr int32 MinTicksForParallel = 32;
+}
+
+void UHTNPlanExecutorManager::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    // Apply what async task work reported since the last tick before anything else runs
+    DrainCompletionQueue();
+
+    // Executors can start and end plans from delegates while being ticked, so work on a snapshot
+    struct FExecutorTicks
+    {
+        UHTNPlanExecutor* Executor;
+        int32 FirstTick;
+        int32 NumTicks;
+    };
+    
+    TArray<FExecutorTicks, TInlineAllocator<64>> ExecutorTicks;
+    ThreadSafeTicks.Reset();
+    
+    for (const TWeakObjectPtr<UHTNPlanExecutor>& ExecutorPtr : Executors)
+    {
+        if (UHTNPlanExecutor* Executor = ExecutorPtr.Get())
+        {
+            const int32 FirstTick = ThreadSafeTicks.Num();
+            Executor->GatherThreadSafeTicks(ThreadSafeTicks);
+            ExecutorTicks.Add({ Executor, FirstTick, ThreadSafeTicks.Num() - FirstTick });
+        }
+    }
+    
+    // Every tick only touches its own task memory, so they can run in any order
+    ParallelFor(ThreadSafeTicks.Num(), [this, DeltaTime](int32 TickIndex)
+    {
+        ThreadSafeTicks[TickIndex].Run(DeltaTime);
+    }, ThreadSafeTicks.Num() < HTNPlanExecutorManager::MinTicksForParallel ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+    
+    // Apply the results and tick everything else on the game thread, in a fixed order
+    const TConstArrayView<FHTNThreadSafeTaskTick> AllTicks(ThreadSafeTicks);
+    for (const FExecutorTicks& Entry : ExecutorTicks)
+    {
+        if (IsValid(Entry.Executor))
+        {
+            Entry.Executor->TickExecution(DeltaTime, AllTicks.Slice(Entry.FirstTick, Entry.NumTicks));
+        }
+    }
+    
+    Executors.RemoveAll([](const TWeakObjectPtr<UHTNPlanExecutor>& ExecutorPtr) { return !ExecutorPtr.IsValid(); });
+}
+
+void UHTNPlanExecutorManager::DrainCompletionQueue()
+{
+    FHTNTaskCompletionRecord Record;
+    while (CompletionQueue->Dequeue(Record))
+    {
+        // Drop reports for executors that are gone or have moved on to another plan
+        UHTNPlanExecutor* Executor = Record.Executor.Get();
+        if (!Executor || !Executor->IsExecutingPlan() || Executor->GetPlanExecutionId() != Record.PlanExecutionId)
+        {
+            continue;
+        }
+        
+        switch (Record.Type)
+        {
+        case EHTNTaskCompletionRecordType::Completion:
+            Executor->CompleteTask(Record.TaskIndex, Record.Status);
+            break;
+        case EHTNTaskCompletionRecordType::Result:
+            Executor->SetTaskResult(Record.TaskIndex, Record.ResultName, Record.ResultValue);
+            break;
+        }
+    }
+}
+
+TStatId UHTNPlanExecutorManager::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UHTNPlanExecutorManager, STATGROUP_Tickables);
+}
+
+UHTNPlanExecutorManager* UHTNPlanExecutorManager::Get(const UObject* WorldContextObject)
+{
+    UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+    return World ? World->GetSubsystem<UHTNPlanExecutorManager>() : nullptr;
+}
+
+void UHTNPlanExecutorManager::RegisterExecutor(UHTNPlanExecutor* Executor)
+{
+    if (Executor)
+    {
+        Executors.AddUnique(Executor);
+    }
+}
+
+void UHTNPlanExecutorManager::UnregisterExecutor(UHTNPlanExecutor* Executor)
+{
+    // Keep the order of the remaining executors, it defines the order results are applied in
+    Executors.Remove(Executor);
+}
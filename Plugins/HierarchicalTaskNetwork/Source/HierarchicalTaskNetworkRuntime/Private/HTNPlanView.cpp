@@ -0,0 +1,289 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNPlanView.h"
+
+#include "HTNLogging.h"
+#include "HTNPlanBinaryFormat.h"
+#include "Misc/StringBuilder.h"
+
+FHTNPlanView::FHTNPlanView(TConstArrayView<uint8> InData, bool bVerifyChecksum)
+    : Data(InData)
+{
+    using namespace HTNPlanBinary;
+    
+    FReader Reader(Data);
+    const int32 SerializationVersion = static_cast<int32>(Reader.ReadFixed(4));
+    const uint32 Checksum = Reader.ReadFixed(4);
+    if (Reader.HasError() || SerializationVersion != Version)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNPlanView: Unsupported plan data (version %d)"), Reader.HasError() ? 0 : SerializationVersion);
+        return;
+    }
+    
+    if (bVerifyChecksum && Checksum != FCrc::MemCrc32(Data.GetData() + HeaderSize, Data.Num() - HeaderSize))
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNPlanView: Checksum mismatch"));
+        return;
+    }
+    
+    // Walk past the variable-size parts once, remembering where everything starts
+    NumStrings = static_cast<int32>(Reader.ReadVarInt());
+    StringOffsetWidth = Reader.ReadByte();
+    StringOffsetsOffset = Reader.GetOffset();
+    if (IsValidFixedWidth(StringOffsetWidth) && Reader.CanReadArray(NumStrings, StringOffsetWidth))
+    {
+        Reader.ReadBytes(NumStrings * StringOffsetWidth);
+    }
+    StringDataOffset = Reader.GetOffset();
+    
+    // The last string ends the table
+    if (NumStrings > 0 && !Reader.HasError())
+    {
+        FReader OffsetReader(Data);
+        OffsetReader.Offset = StringOffsetsOffset + (NumStrings - 1) * StringOffsetWidth;
+        Reader.ReadBytes(static_cast<int32>(OffsetReader.ReadFixed(StringOffsetWidth)));
+        ReadStringBytes(Reader);
+    }
+    
+    TotalCost = Reader.ReadFloat();
+    CurrentTaskIndex = ZigZagDecode(Reader.ReadVarInt());
+    Flags = Reader.ReadByte();
+    Reader.ReadBytes(8);
+    Status = static_cast<EHTNPlanStatus>(Reader.ReadByte());
+    
+    NumTasks = static_cast<int32>(Reader.ReadVarInt());
+    TaskIndexWidth = Reader.ReadByte();
+    TaskTableOffset = Reader.GetOffset();
+    const int32 RecordSize = 2 * TaskIndexWidth + TaskRecordFixedSize;
+    if (Reader.CanReadArray(NumTasks, RecordSize))
+    {
+        Reader.ReadBytes(NumTasks * RecordSize);
+    }
+    
+    int32* SectionOffsets[] = { &ParametersOffset, &ResultsOffset, &DependenciesOffset };
+    for (int32* SectionOffset : SectionOffsets)
+    {
+        const int32 SectionSize = static_cast<int32>(Reader.ReadVarInt());
+        *SectionOffset = Reader.GetOffset();
+        Reader.ReadBytes(SectionSize);
+    }
+    
+    bValid = !Reader.HasError() && IsValidFixedWidth(StringOffsetWidth) && IsValidFixedWidth(TaskIndexWidth);
+    if (!bValid)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNPlanView: Truncated plan data"));
+    }
+}
+
+bool FHTNPlanView::IsExecuting() const
+{
+    return (Flags & HTNPlanBinary::Flag_IsExecuting) != 0;
+}
+
+bool FHTNPlanView::IsComplete() const
+{
+    return (Flags & HTNPlanBinary::Flag_IsComplete) != 0;
+}
+
+bool FHTNPlanView::HasFailed() const
+{
+    return (Flags & HTNPlanBinary::Flag_Failed) != 0;
+}
+
+bool FHTNPlanView::IsPaused() const
+{
+    return (Flags & HTNPlanBinary::Flag_IsPaused) != 0;
+}
+
+bool FHTNPlanView::IsTaskNull(int32 TaskIndex) const
+{
+    const int32 RecordOffset = GetTaskRecordOffset(TaskIndex);
+    if (RecordOffset == INDEX_NONE)
+    {
+        return true;
+    }
+    
+    HTNPlanBinary::FReader Reader(Data);
+    Reader.Offset = RecordOffset;
+    return Reader.ReadFixed(TaskIndexWidth) == 0;
+}
+
+FGuid FHTNPlanView::GetTaskID(int32 TaskIndex) const
+{
+    const int32 RecordOffset = GetTaskRecordOffset(TaskIndex);
+    if (RecordOffset == INDEX_NONE)
+    {
+        return FGuid();
+    }
+    
+    HTNPlanBinary::FReader Reader(Data);
+    Reader.Offset = RecordOffset + 2 * TaskIndexWidth;
+    return Reader.ReadGuid();
+}
+
+float FHTNPlanView::GetTaskCost(int32 TaskIndex) const
+{
+    const int32 RecordOffset = GetTaskRecordOffset(TaskIndex);
+    if (RecordOffset == INDEX_NONE)
+    {
+        return 0.0f;
+    }
+    
+    HTNPlanBinary::FReader Reader(Data);
+    Reader.Offset = RecordOffset + 2 * TaskIndexWidth + 16;
+    return Reader.ReadFloat();
+}
+
+FUtf8StringView FHTNPlanView::GetTaskClassPath(int32 TaskIndex) const
+{
+    const int32 RecordOffset = GetTaskRecordOffset(TaskIndex);
+    if (RecordOffset == INDEX_NONE)
+    {
+        return FUtf8StringView();
+    }
+    
+    HTNPlanBinary::FReader Reader(Data);
+    Reader.Offset = RecordOffset;
+    const uint32 ClassIndex = Reader.ReadFixed(TaskIndexWidth);
+    return ClassIndex > 0 ? GetString(ClassIndex - 1) : FUtf8StringView();
+}
+
+FUtf8StringView FHTNPlanView::GetTaskName(int32 TaskIndex) const
+{
+    const int32 RecordOffset = GetTaskRecordOffset(TaskIndex);
+    if (RecordOffset == INDEX_NONE || IsTaskNull(TaskIndex))
+    {
+        return FUtf8StringView();
+    }
+    
+    HTNPlanBinary::FReader Reader(Data);
+    Reader.Offset = RecordOffset + TaskIndexWidth;
+    return GetString(Reader.ReadFixed(TaskIndexWidth));
+}
+
+bool FHTNPlanView::FindParameter(FName Key, FHTNProperty& OutValue) const
+{
+    return FindProperty(ParametersOffset, Key, OutValue);
+}
+
+bool FHTNPlanView::FindResult(FName Key, FHTNProperty& OutValue) const
+{
+    return FindProperty(ResultsOffset, Key, OutValue);
+}
+
+bool FHTNPlanView::GetTaskDependencies(int32 TaskIndex, TArray<int32>& OutDependencies) const
+{
+    using namespace HTNPlanBinary;
+    
+    if (!bValid)
+    {
+        return false;
+    }
+    
+    // Entries are sorted by task index, so the scan can stop early
+    FReader Reader(Data);
+    Reader.Offset = DependenciesOffset;
+    const int32 EntryCount = static_cast<int32>(Reader.ReadVarInt());
+    int32 EntryTaskIndex = 0;
+    for (int32 EntryIndex = 0; EntryIndex < EntryCount && !Reader.HasError(); ++EntryIndex)
+    {
+        EntryTaskIndex += ZigZagDecode(Reader.ReadVarInt());
+        const int32 DependencyCount = static_cast<int32>(Reader.ReadVarInt());
+        if (EntryTaskIndex > TaskIndex)
+        {
+            return false;
+        }
+        
+        int32 Dependency = EntryTaskIndex;
+        for (int32 DependencyIndex = 0; DependencyIndex < DependencyCount && !Reader.HasError(); ++DependencyIndex)
+        {
+            Dependency += ZigZagDecode(Reader.ReadVarInt());
+            if (EntryTaskIndex == TaskIndex)
+            {
+                OutDependencies.Add(Dependency);
+            }
+        }
+        
+        if (EntryTaskIndex == TaskIndex)
+        {
+            return DependencyCount > 0;
+        }
+    }
+    return false;
+}
+
+bool FHTNPlanView::ToPlan(FHTNPlan& OutPlan) const
+{
+    return bValid && OutPlan.FromBinaryV2(Data);
+}
+
+FUtf8StringView FHTNPlanView::GetString(uint32 StringIndex) const
+{
+    if (!bValid || StringIndex >= static_cast<uint32>(NumStrings))
+    {
+        return FUtf8StringView();
+    }
+    
+    HTNPlanBinary::FReader Reader(Data);
+    Reader.Offset = StringOffsetsOffset + static_cast<int32>(StringIndex) * StringOffsetWidth;
+    Reader.Offset = StringDataOffset + static_cast<int32>(Reader.ReadFixed(StringOffsetWidth));
+    
+    const TConstArrayView<uint8> Bytes = HTNPlanBinary::ReadStringBytes(Reader);
+    return FUtf8StringView(reinterpret_cast<const UTF8CHAR*>(Bytes.GetData()), Bytes.Num());
+}
+
+bool FHTNPlanView::FindProperty(int32 SectionOffset, FName Key, FHTNProperty& OutValue) const
+{
+    using namespace HTNPlanBinary;
+    
+    if (!bValid)
+    {
+        return false;
+    }
+    
+    // Find the key in the string table once, then compare entries by string index. Names compare
+    // case-insensitively, like FName, so string values differing from the key only in case match as well.
+    TUtf8StringBuilder<128> KeyString;
+    KeyString << Key;
+    TArray<uint32, TInlineAllocator<4>> KeyStringIndices;
+    for (int32 StringIndex = 0; StringIndex < NumStrings; ++StringIndex)
+    {
+        if (GetString(StringIndex).Equals(KeyString.ToView(), ESearchCase::IgnoreCase))
+        {
+            KeyStringIndices.Add(StringIndex);
+        }
+    }
+    if (KeyStringIndices.Num() == 0)
+    {
+        return false;
+    }
+    
+    FReader Reader(Data);
+    Reader.Offset = SectionOffset;
+    const int32 EntryCount = static_cast<int32>(Reader.ReadVarInt());
+    for (int32 EntryIndex = 0; EntryIndex < EntryCount && !Reader.HasError(); ++EntryIndex)
+    {
+        if (!KeyStringIndices.Contains(Reader.ReadVarInt()))
+        {
+            SkipValue(Reader);
+            continue;
+        }
+        
+        OutValue = ReadValue(Reader, [this](uint32 StringIndex)
+        {
+            const FUtf8StringView String = GetString(StringIndex);
+            return BytesToString(TConstArrayView<uint8>(reinterpret_cast<const uint8*>(String.GetData()), String.Len()));
+        });
+        return !Reader.HasError();
+    }
+    return false;
+}
+
+int32 FHTNPlanView::GetTaskRecordOffset(int32 TaskIndex) const
+{
+    if (!bValid || TaskIndex < 0 || TaskIndex >= NumTasks)
+    {
+        return INDEX_NONE;
+    }
+    return TaskTableOffset + TaskIndex * (2 * TaskIndexWidth + HTNPlanBinary::TaskRecordFixedSize);
+}
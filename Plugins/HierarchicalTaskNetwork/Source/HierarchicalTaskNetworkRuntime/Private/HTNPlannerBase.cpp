@@ -61,6 +61,9 @@ FHTNPlanningConfig::FHTNPlanningConfig()
     , bUseHeuristics(true)
     , HeuristicWeight(0.5f)
     , bCacheDecompositions(true)
+    , bRecordDecomposition(false)
+    , bInferTaskDependencies(false)
+    , bRecordTrace(!UE_BUILD_SHIPPING)
     , bDetailedDebugging(false)
 {
 }
@@ -91,6 +94,16 @@ FHTNPlannerResult UHTNPlannerBase::GeneratePlan(
     return Result;
 }
 
+bool UHTNPlannerBase::GeneratePlanInto(
+    const UHTNWorldState* WorldState,
+    const TArray<UHTNTask*>& GoalTasks,
+    const FHTNPlanningConfig& Config,
+    FHTNPlannerResult& OutResult)
+{
+    OutResult = GeneratePlan(WorldState, GoalTasks, Config);
+    return OutResult.bSuccess;
+}
+
 bool UHTNPlannerBase::ValidatePlan(
     const FHTNPlan& Plan,
     const UHTNWorldState* WorldState)
@@ -0,0 +1,127 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNPlannerTrace.h"
+
+#include "Conditions/HTNCondition.h"
+#include "HTNMethod.h"
+#include "Tasks/HTNCompoundTask.h"
+#include "Tasks/HTNPrimitiveTask.h"
+
+FHTNPlannerTrace::FHTNPlannerTrace()
+    : NumRecorded(0)
+    , StartCycles(0)
+{
+    SetCapacity(4096);
+}
+
+void FHTNPlannerTrace::SetCapacity(int32 NumEvents)
+{
+    Events.SetNum(FMath::RoundUpToPowerOfTwo(FMath::Max(NumEvents, 1)));
+    Reset();
+}
+
+void FHTNPlannerTrace::Reset()
+{
+    NumRecorded = 0;
+    StartCycles = FPlatformTime::Cycles();
+}
+
+int32 FHTNPlannerTrace::InternTask(const UHTNTask* Task)
+{
+    if (!Task)
+    {
+        return INDEX_NONE;
+    }
+
+    int32& TaskId = TaskIds.FindOrAdd(Task, INDEX_NONE);
+    if (TaskId == INDEX_NONE)
+    {
+        TaskId = Tasks.Add(Task);
+    }
+    else if (Tasks[TaskId].Get() != Task)
+    {
+        // A new task at the address of a destroyed one
+        Tasks[TaskId] = Task;
+    }
+    return TaskId;
+}
+
+const UHTNTask* FHTNPlannerTrace::GetTask(int32 TaskId) const
+{
+    return Tasks.IsValidIndex(TaskId) ? Tasks[TaskId].Get() : nullptr;
+}
+
+FString FHTNPlannerTrace::DescribeEvent(const FHTNPlannerTraceEvent& Event) const
+{
+    const UHTNTask* Task = GetTask(Event.TaskId);
+    const FString TaskName = Task ? Task->ToString() : FString(TEXT("<no task>"));
+
+    FString Description;
+    switch (Event.Type)
+    {
+    case EHTNPlannerTraceEventType::NodeEnter:
+        Description = FString::Printf(TEXT("Processing task %s"), *TaskName);
+        break;
+
+    case EHTNPlannerTraceEventType::ConditionFail:
+        {
+            // The index counts authored conditions, several of which can share a condition object
+            const UHTNPrimitiveTask* PrimitiveTask = Cast<UHTNPrimitiveTask>(Task);
+            const UHTNCondition* Condition = nullptr;
+            int32 ConditionIndex = Event.Value;
+            for (int32 Index = 0; PrimitiveTask && ConditionIndex >= 0 && Index < PrimitiveTask->Preconditions.Num(); ++Index)
+            {
+                const UHTNCondition* Candidate = PrimitiveTask->Preconditions[Index];
+                const int32 NumConditions = Candidate ? Candidate->GetNumConditions() : 1;
+                if (ConditionIndex < NumConditions)
+                {
+                    Condition = Candidate;
+                    break;
+                }
+                ConditionIndex -= NumConditions;
+            }
+            Description = Condition
+                ? FString::Printf(TEXT("Task %s is not applicable: precondition %d (%s) failed"), *TaskName, Event.Value, *Condition->DescribeCondition(ConditionIndex))
+                : FString::Printf(TEXT("Task %s is not applicable"), *TaskName);
+            break;
+        }
+
+    case EHTNPlannerTraceEventType::MethodTry:
+        {
+            const UHTNCompoundTask* CompoundTask = Cast<UHTNCompoundTask>(Task);
+            const UHTNMethod* Method = CompoundTask && CompoundTask->GetMethods().IsValidIndex(Event.Value) ? CompoundTask->GetMethods()[Event.Value] : nullptr;
+            Description = FString::Printf(TEXT("Trying method %d (%s) for task %s"), Event.Value, Method ? *Method->GetDescription() : TEXT("unknown"), *TaskName);
+            break;
+        }
+
+    case EHTNPlannerTraceEventType::Backtrack:
+        Description = FString::Printf(TEXT("Backtracking from task %s"), *TaskName);
+        break;
+
+    case EHTNPlannerTraceEventType::PlanFound:
+        Description = FString::Printf(TEXT("Found valid plan with %d tasks"), Event.Value);
+        break;
+
+    case EHTNPlannerTraceEventType::Abort:
+        Description = TEXT("Planning aborted by the time or depth limit");
+        break;
+    }
+
+    return FString::Printf(TEXT("%9.3fms %s%s"), FPlatformTime::ToMilliseconds(Event.Cycles), FCString::Spc(FMath::Min(Event.Depth * 2, 255)), *Description);
+}
+
+FString FHTNPlannerTrace::ToString() const
+{
+    FString Result;
+    if (GetNumDropped() > 0)
+    {
+        Result = FString::Printf(TEXT("(%llu earlier events dropped)\n"), GetNumDropped());
+    }
+
+    for (int32 Index = 0; Index < Num(); ++Index)
+    {
+        Result += DescribeEvent(GetEvent(Index));
+        Result += TEXT("\n");
+    }
+    return Result;
+}
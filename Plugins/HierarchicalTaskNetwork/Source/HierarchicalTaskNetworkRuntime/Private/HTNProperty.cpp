@@ -187,6 +187,45 @@ bool FHTNProperty::operator!=(const FHTNProperty& Other) const
 	return !(*this == Other);
 }
 
+uint32 FHTNProperty::GetValueHash() const
+{
+	const uint32 TypeHash = GetTypeHash(static_cast<uint8>(Type));
+
+	switch (Type)
+	{
+	case EHTNPropertyType::Boolean:
+		return HashCombine(TypeHash, GetTypeHash(BoolValue));
+	case EHTNPropertyType::Integer:
+		return HashCombine(TypeHash, GetTypeHash(IntValue));
+	case EHTNPropertyType::Float:
+		return HashCombine(TypeHash, GetTypeHash(FloatValue));
+	case EHTNPropertyType::String:
+		return HashCombine(TypeHash, GetTypeHash(StringValue));
+	case EHTNPropertyType::Name:
+		return HashCombine(TypeHash, GetTypeHash(NameValue));
+	case EHTNPropertyType::Object:
+		return HashCombine(TypeHash, GetTypeHash(ObjectValue));
+	case EHTNPropertyType::Vector:
+		return HashCombine(TypeHash, GetTypeHash(VectorValue));
+	default:
+		return TypeHash;
+	}
+}
+
+uint32 FHTNProperty::GetStableValueHash() const
+{
+	switch (Type)
+	{
+	case EHTNPropertyType::Name:
+		return HashCombine(GetTypeHash(static_cast<uint8>(Type)), GetTypeHash(NameValue.ToString()));
+	case EHTNPropertyType::Object:
+		return HashCombine(GetTypeHash(static_cast<uint8>(Type)), ObjectValue ? GetTypeHash(ObjectValue->GetPathName()) : 0);
+	default:
+		// The remaining types hash by value already
+		return GetValueHash();
+	}
+}
+
 FString FHTNProperty::ToString() const
 {
 	switch (Type)
@@ -0,0 +1,154 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNSensorScheduler.h"
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HTNLogging.h"
+
+namespace HTNSensorScheduler
+{
+    /** Fractional part of the golden ratio; consecutive multiples of it spread evenly over [0, 1) */
+    constexpr double PhaseStep = 0.6180339887498949;
+}
+
+void UHTNSensorScheduler::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    const UWorld* World = GetWorld();
+    if (!World || Entries.Num() == 0)
+    {
+        return;
+    }
+
+    const double CurrentTime = World->GetTimeSeconds();
+    Entries.RemoveAll([](const FSensorEntry& Entry) { return !Entry.Sensor.IsValid() || !Entry.WorldState.IsValid(); });
+
+    // Collect due entries
+    TArray<int32, TInlineAllocator<256>> DueEntries;
+    for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); ++EntryIndex)
+    {
+        if (Entries[EntryIndex].NextUpdateTime <= CurrentTime)
+        {
+            DueEntries.Add(EntryIndex);
+        }
+    }
+
+    if (DueEntries.Num() == 0)
+    {
+        return;
+    }
+
+    // Over budget, the most overdue sensors go first and the rest stay due for the next tick
+    if (MaxUpdatesPerTick > 0 && DueEntries.Num() > MaxUpdatesPerTick)
+    {
+        DueEntries.StableSort([this](int32 A, int32 B) { return Entries[A].NextUpdateTime < Entries[B].NextUpdateTime; });
+        DueEntries.SetNum(MaxUpdatesPerTick);
+    }
+
+    // Group by sensor class so each class senses all its agents in one batch, keeping registration order within a class
+    DueEntries.StableSort([this](int32 A, int32 B)
+    {
+        const UClass* ClassA = Entries[A].Sensor->GetClass();
+        const UClass* ClassB = Entries[B].Sensor->GetClass();
+        return ClassA != ClassB ? ClassA->GetUniqueID() < ClassB->GetUniqueID() : A < B;
+    });
+
+    Updates.Reset();
+    for (const int32 EntryIndex : DueEntries)
+    {
+        FSensorEntry& Entry = Entries[EntryIndex];
+        const UHTNSensor* Sensor = Entry.Sensor.Get();
+
+        FHTNSensorUpdate& Update = Updates.AddDefaulted_GetRef();
+        Update.Sensor = Sensor;
+        Update.Owner = Entry.Owner.Get();
+        Update.WorldState = Entry.WorldState.Get();
+
+        // Schedule from the previous due time to keep the phase, unless the sensor fell a whole interval behind
+        Entry.NextUpdateTime = FMath::Max(Entry.NextUpdateTime + Sensor->UpdateInterval, CurrentTime);
+    }
+
+    // Run each batch on its first sensor
+    for (int32 BatchStart = 0; BatchStart < Updates.Num();)
+    {
+        const UClass* BatchClass = Updates[BatchStart].Sensor->GetClass();
+        int32 BatchEnd = BatchStart + 1;
+        while (BatchEnd < Updates.Num() && Updates[BatchEnd].Sensor->GetClass() == BatchClass)
+        {
+            ++BatchEnd;
+        }
+
+        Updates[BatchStart].Sensor->SenseBatch(TArrayView<FHTNSensorUpdate>(Updates).Slice(BatchStart, BatchEnd - BatchStart));
+        BatchStart = BatchEnd;
+    }
+
+    CommitUpdates(Updates);
+}
+
+void UHTNSensorScheduler::CommitUpdates(TConstArrayView<FHTNSensorUpdate> InUpdates) const
+{
+    for (const FHTNSensorUpdate& Update : InUpdates)
+    {
+        // Sensing may have destroyed the world state's outer; skip rather than write into a dying object
+        UHTNWorldState* WorldState = const_cast<UHTNWorldState*>(Update.WorldState);
+        if (!IsValid(WorldState))
+        {
+            continue;
+        }
+
+        for (const TPair<FName, FHTNProperty>& Value : Update.Values)
+        {
+            if (!Update.Sensor->OutputKeys.Contains(Value.Key))
+            {
+                UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Sensor %s sensed undeclared key %s, ignoring it"), *Update.Sensor->GetDescription(), *Value.Key.ToString());
+                continue;
+            }
+
+            // Setting an unchanged value keeps the key's version, so plans reading it are not revalidated
+            WorldState->SetProperty(Value.Key, Value.Value);
+        }
+    }
+}
+
+TStatId UHTNSensorScheduler::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UHTNSensorScheduler, STATGROUP_Tickables);
+}
+
+UHTNSensorScheduler* UHTNSensorScheduler::Get(const UObject* WorldContextObject)
+{
+    const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+    return World ? World->GetSubsystem<UHTNSensorScheduler>() : nullptr;
+}
+
+bool UHTNSensorScheduler::RegisterSensor(UHTNSensor* Sensor, UHTNWorldState* WorldState, AActor* Owner)
+{
+    if (!Sensor || !WorldState)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Cannot register sensor: %s"), !Sensor ? TEXT("no sensor") : TEXT("no world state"));
+        return false;
+    }
+
+    if (!Sensor->ValidateSensor())
+    {
+        return false;
+    }
+
+    // Spread first updates over one interval so agents spawned on the same frame do not sense in lockstep
+    const double Phase = FMath::Frac(NumRegistrations++ * HTNSensorScheduler::PhaseStep);
+    const UWorld* World = GetWorld();
+
+    FSensorEntry& Entry = Entries.AddDefaulted_GetRef();
+    Entry.Sensor = Sensor;
+    Entry.WorldState = WorldState;
+    Entry.Owner = Owner;
+    Entry.NextUpdateTime = (World ? World->GetTimeSeconds() : 0.0) + Phase * Sensor->UpdateInterval;
+    return true;
+}
+
+void UHTNSensorScheduler::UnregisterSensors(const UHTNWorldState* WorldState)
+{
+    Entries.RemoveAll([WorldState](const FSensorEntry& Entry) { return Entry.WorldState.Get() == WorldState || !Entry.WorldState.IsValid(); });
+}
@@ -0,0 +1,36 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNTaskCompletionQueue.h"
+
+void FHTNTaskCompletionHandle::Complete(EHTNTaskStatus Status) const
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+    FHTNTaskCompletionRecord Record;
+    Record.Type = EHTNTaskCompletionRecordType::Completion;
+    Record.Executor = Executor;
+    Record.PlanExecutionId = PlanExecutionId;
+    Record.TaskIndex = TaskIndex;
+    Record.Status = Status;
+    Queue->Enqueue(MoveTemp(Record));
+}
+
+void FHTNTaskCompletionHandle::SetResult(FName ResultName, const FHTNProperty& ResultValue) const
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+    FHTNTaskCompletionRecord Record;
+    Record.Type = EHTNTaskCompletionRecordType::Result;
+    Record.Executor = Executor;
+    Record.PlanExecutionId = PlanExecutionId;
+    Record.TaskIndex = TaskIndex;
+    Record.ResultName = ResultName;
+    Record.ResultValue = ResultValue;
+    Queue->Enqueue(MoveTemp(Record));
+}
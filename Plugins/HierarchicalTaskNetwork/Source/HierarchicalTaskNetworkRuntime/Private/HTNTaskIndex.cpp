@@ -0,0 +1,68 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNTaskIndex.h"
+
+#include "HTNLogging.h"
+#include "HTNMethod.h"
+#include "Tasks/HTNCompoundTask.h"
+#include "Tasks/HTNPrimitiveTask.h"
+
+void FHTNTaskIndex::AddDomain(TConstArrayView<UHTNTask*> RootTasks)
+{
+    for (const UHTNTask* RootTask : RootTasks)
+    {
+        AddTask(RootTask);
+    }
+}
+
+void FHTNTaskIndex::AddTask(const UHTNTask* Task)
+{
+    if (!Task)
+    {
+        return;
+    }
+    
+    if (const UHTNPrimitiveTask* PrimitiveTask = Cast<UHTNPrimitiveTask>(Task))
+    {
+        TWeakObjectPtr<UHTNPrimitiveTask>& Entry = Tasks.FindOrAdd(PrimitiveTask->GetTaskID());
+        if (Entry.IsValid() && Entry.Get() != PrimitiveTask)
+        {
+            UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("HTNTaskIndex: Tasks %s and %s share ID %s; keeping the first"),
+                *Entry->GetName(), *PrimitiveTask->GetName(), *PrimitiveTask->GetTaskID().ToString());
+            return;
+        }
+        Entry = const_cast<UHTNPrimitiveTask*>(PrimitiveTask);
+        return;
+    }
+    
+    const UHTNCompoundTask* CompoundTask = Cast<UHTNCompoundTask>(Task);
+    bool bAlreadyVisited = false;
+    VisitedCompoundTasks.Add(Task, &bAlreadyVisited);
+    if (!CompoundTask || bAlreadyVisited)
+    {
+        return;
+    }
+    
+    for (const UHTNMethod* Method : CompoundTask->GetMethods())
+    {
+        if (Method)
+        {
+            for (const UHTNTask* Subtask : Method->GetSubtasks())
+            {
+                AddTask(Subtask);
+            }
+        }
+    }
+}
+
+UHTNPrimitiveTask* FHTNTaskIndex::FindTask(const FGuid& TaskID) const
+{
+    const TWeakObjectPtr<UHTNPrimitiveTask>* Entry = Tasks.Find(TaskID);
+    return Entry ? Entry->Get() : nullptr;
+}
+
+void FHTNTaskIndex::Reset()
+{
+    Tasks.Reset();
+    VisitedCompoundTasks.Reset();
+}
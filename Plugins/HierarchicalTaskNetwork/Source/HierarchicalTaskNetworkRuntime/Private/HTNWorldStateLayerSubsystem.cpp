@@ -0,0 +1,37 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNWorldStateLayerSubsystem.h"
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+UHTNWorldStateLayerSubsystem* UHTNWorldStateLayerSubsystem::Get(const UObject* WorldContextObject)
+{
+    const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+    return World ? World->GetSubsystem<UHTNWorldStateLayerSubsystem>() : nullptr;
+}
+
+UHTNWorldState* UHTNWorldStateLayerSubsystem::GetGlobalLayer()
+{
+    if (!GlobalLayer)
+    {
+        GlobalLayer = NewObject<UHTNWorldState>(this, TEXT("GlobalLayer"));
+    }
+    return GlobalLayer;
+}
+
+UHTNWorldState* UHTNWorldStateLayerSubsystem::GetSquadLayer(FName SquadName)
+{
+    if (SquadName.IsNone())
+    {
+        return GetGlobalLayer();
+    }
+    
+    UHTNWorldState*& SquadLayer = SquadLayers.FindOrAdd(SquadName);
+    if (!SquadLayer)
+    {
+        SquadLayer = NewObject<UHTNWorldState>(this);
+        SquadLayer->SetParentLayer(GetGlobalLayer());
+    }
+    return SquadLayer;
+}
@@ -0,0 +1,252 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNWorldStatePopulation.h"
+
+#include "Conditions/HTNBoolConditionMask.h"
+#include "HTNWorldStateStruct.h"
+#include "Math/VectorRegister.h"
+
+void FHTNWorldStatePopulation::SetNumAgents(int32 InNumAgents)
+{
+	const int32 PreviousNumAgents = NumAgents;
+	NumAgents = FMath::Max(InNumAgents, 0);
+	const int32 NumWords = GetNumAgentWords();
+
+	for (FColumn& Column : Columns)
+	{
+		Column.PresentBits.SetNumZeroed(NumWords);
+		Column.BoolBits.SetNumZeroed(NumWords);
+		Column.TrueBits.SetNumZeroed(NumWords);
+		if (Column.Values.Num() > 0)
+		{
+			Column.Values.SetNum(NumAgents);
+		}
+
+		// Agents dropped from the middle of the last word must not come back holding their old bits
+		for (int32 AgentIndex = NumAgents; AgentIndex < PreviousNumAgents && AgentIndex < NumWords * 64; ++AgentIndex)
+		{
+			const uint64 ClearMask = ~(uint64(1) << (AgentIndex % 64));
+			Column.PresentBits[AgentIndex / 64] &= ClearMask;
+			Column.BoolBits[AgentIndex / 64] &= ClearMask;
+			Column.TrueBits[AgentIndex / 64] &= ClearMask;
+		}
+	}
+}
+
+bool FHTNWorldStatePopulation::GetProperty(int32 AgentIndex, FName Key, FHTNProperty& OutValue) const
+{
+	const int32 Slot = FHTNKeySlots::Find(Key);
+	if (!Columns.IsValidIndex(Slot) || AgentIndex < 0 || AgentIndex >= NumAgents)
+	{
+		return false;
+	}
+
+	const FColumn& Column = Columns[Slot];
+	const int32 WordIndex = AgentIndex / 64;
+	const uint64 Bit = uint64(1) << (AgentIndex % 64);
+	if (!(Column.PresentBits[WordIndex] & Bit))
+	{
+		return false;
+	}
+
+	OutValue = (Column.BoolBits[WordIndex] & Bit) ? FHTNProperty((Column.TrueBits[WordIndex] & Bit) != 0) : Column.Values[AgentIndex];
+	return true;
+}
+
+void FHTNWorldStatePopulation::SetProperty(int32 AgentIndex, FName Key, const FHTNProperty& Value)
+{
+	if (AgentIndex < 0 || AgentIndex >= NumAgents)
+	{
+		return;
+	}
+
+	const int32 Slot = FHTNKeySlots::FindOrAdd(Key);
+	FColumn& Column = GetOrAddColumn(Slot);
+	ColumnKeys[Slot] = Key;
+	const int32 WordIndex = AgentIndex / 64;
+	const uint64 Bit = uint64(1) << (AgentIndex % 64);
+	const bool bIsBool = Value.GetType() == EHTNPropertyType::Boolean;
+
+	Column.PresentBits[WordIndex] |= Bit;
+	Column.BoolBits[WordIndex] = bIsBool ? Column.BoolBits[WordIndex] | Bit : Column.BoolBits[WordIndex] & ~Bit;
+	Column.TrueBits[WordIndex] = bIsBool && Value.GetBoolValue() ? Column.TrueBits[WordIndex] | Bit : Column.TrueBits[WordIndex] & ~Bit;
+
+	if (!bIsBool)
+	{
+		if (Column.Values.Num() == 0)
+		{
+			Column.Values.SetNum(NumAgents);
+		}
+		Column.Values[AgentIndex] = Value;
+	}
+	else if (Column.Values.Num() > 0)
+	{
+		Column.Values[AgentIndex] = FHTNProperty();
+	}
+}
+
+void FHTNWorldStatePopulation::RemoveProperty(int32 AgentIndex, FName Key)
+{
+	const int32 Slot = FHTNKeySlots::Find(Key);
+	if (!Columns.IsValidIndex(Slot) || AgentIndex < 0 || AgentIndex >= NumAgents)
+	{
+		return;
+	}
+
+	FColumn& Column = Columns[Slot];
+	const int32 WordIndex = AgentIndex / 64;
+	const uint64 ClearMask = ~(uint64(1) << (AgentIndex % 64));
+	Column.PresentBits[WordIndex] &= ClearMask;
+	Column.BoolBits[WordIndex] &= ClearMask;
+	Column.TrueBits[WordIndex] &= ClearMask;
+	if (Column.Values.Num() > 0)
+	{
+		Column.Values[AgentIndex] = FHTNProperty();
+	}
+}
+
+void FHTNWorldStatePopulation::CopyFromWorldState(int32 AgentIndex, const UHTNWorldState* WorldState)
+{
+	for (int32 Slot = 0; Slot < ColumnKeys.Num(); ++Slot)
+	{
+		RemoveProperty(AgentIndex, ColumnKeys[Slot]);
+	}
+
+	if (!WorldState)
+	{
+		return;
+	}
+
+	FHTNWorldStateStruct Resolved;
+	WorldState->GetResolvedWorldState(Resolved);
+	FHTNProperty Value;
+	for (const FName& Key : Resolved.GetPropertyNames())
+	{
+		if (Resolved.GetProperty(Key, Value))
+		{
+			SetProperty(AgentIndex, Key, Value);
+		}
+	}
+}
+
+void FHTNWorldStatePopulation::CopyToWorldState(int32 AgentIndex, UHTNWorldState* WorldState) const
+{
+	if (!WorldState)
+	{
+		return;
+	}
+
+	TMap<FName, FHTNProperty> Properties;
+	FHTNProperty Value;
+	for (const FName& Key : ColumnKeys)
+	{
+		if (!Key.IsNone() && GetProperty(AgentIndex, Key, Value))
+		{
+			Properties.Add(Key, Value);
+		}
+	}
+	WorldState->SetWorldState(FHTNWorldStateStruct(WorldState->GetOwner(), Properties));
+}
+
+uint32 FHTNWorldStatePopulation::GetFingerprint(int32 AgentIndex, TConstArrayView<FName> Keys) const
+{
+	uint32 Fingerprint = 0;
+	FHTNProperty Value;
+	for (const FName& Key : Keys)
+	{
+		// Collisions are possible, callers that group by fingerprint confirm with HasEqualProperties
+		const uint32 ValueHash = GetProperty(AgentIndex, Key, Value) ? Value.GetValueHash() : 0;
+		Fingerprint = HashCombine(Fingerprint, HashCombine(GetTypeHash(Key), ValueHash));
+	}
+	return Fingerprint;
+}
+
+bool FHTNWorldStatePopulation::HasEqualProperties(int32 AgentIndex, int32 OtherAgentIndex, TConstArrayView<FName> Keys) const
+{
+	FHTNProperty Value;
+	FHTNProperty OtherValue;
+	for (const FName& Key : Keys)
+	{
+		const bool bHasValue = GetProperty(AgentIndex, Key, Value);
+		const bool bOtherHasValue = GetProperty(OtherAgentIndex, Key, OtherValue);
+		if (bHasValue != bOtherHasValue || (bHasValue && Value != OtherValue))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FHTNWorldStatePopulation::EvaluateBoolMask(const FHTNBoolConditionMask& Mask, TArray<uint64>& OutAgentBits) const
+{
+	const int32 NumWords = GetNumAgentWords();
+	OutAgentBits.Reset();
+	OutAgentBits.SetNumUninitialized(NumWords);
+	for (int32 WordIndex = 0; WordIndex < NumWords; ++WordIndex)
+	{
+		OutAgentBits[WordIndex] = ~uint64(0);
+	}
+	if (NumAgents % 64 != 0)
+	{
+		OutAgentBits.Last() = (uint64(1) << (NumAgents % 64)) - 1;
+	}
+
+	const TConstArrayView<uint64> RequiredBits = Mask.GetRequiredBits();
+	const TConstArrayView<uint64> ExpectedTrueBits = Mask.GetExpectedTrueBits();
+	for (int32 SlotWord = 0; SlotWord < RequiredBits.Num(); ++SlotWord)
+	{
+		uint64 SlotBits = RequiredBits[SlotWord];
+		while (SlotBits)
+		{
+			const int32 BitIndex = FMath::CountTrailingZeros64(SlotBits);
+			SlotBits &= SlotBits - 1;
+			const int32 Slot = SlotWord * 64 + BitIndex;
+			const bool bExpectTrue = (ExpectedTrueBits[SlotWord] & (uint64(1) << BitIndex)) != 0;
+
+			// No agent ever held the key
+			if (!Columns.IsValidIndex(Slot))
+			{
+				FMemory::Memzero(OutAgentBits.GetData(), NumWords * sizeof(uint64));
+				return Mask.GetRemainingConditions().Num() == 0;
+			}
+
+			// Agents pass where the key holds a boolean with the expected value: Bool & True, or Bool & ~True
+			const FColumn& Column = Columns[Slot];
+			uint64* Result = OutAgentBits.GetData();
+			const uint64* Bools = Column.BoolBits.GetData();
+			const uint64* Trues = Column.TrueBits.GetData();
+			int32 WordIndex = 0;
+			for (; WordIndex + 2 <= NumWords; WordIndex += 2)
+			{
+				const VectorRegister4Int BoolWords = VectorIntLoad(Bools + WordIndex);
+				const VectorRegister4Int TrueWords = VectorIntLoad(Trues + WordIndex);
+				const VectorRegister4Int Passing = bExpectTrue ? VectorIntAnd(BoolWords, TrueWords) : VectorIntAndNot(TrueWords, BoolWords);
+				VectorIntStore(VectorIntAnd(VectorIntLoad(Result + WordIndex), Passing), Result + WordIndex);
+			}
+			for (; WordIndex < NumWords; ++WordIndex)
+			{
+				Result[WordIndex] &= bExpectTrue ? Bools[WordIndex] & Trues[WordIndex] : Bools[WordIndex] & ~Trues[WordIndex];
+			}
+		}
+	}
+
+	return Mask.GetRemainingConditions().Num() == 0;
+}
+
+FHTNWorldStatePopulation::FColumn& FHTNWorldStatePopulation::GetOrAddColumn(int32 Slot)
+{
+	if (!Columns.IsValidIndex(Slot))
+	{
+		const int32 NumWords = GetNumAgentWords();
+		const int32 FirstNewSlot = Columns.Num();
+		Columns.SetNum(Slot + 1);
+		ColumnKeys.SetNum(Slot + 1);
+		for (int32 NewSlot = FirstNewSlot; NewSlot <= Slot; ++NewSlot)
+		{
+			Columns[NewSlot].PresentBits.SetNumZeroed(NumWords);
+			Columns[NewSlot].BoolBits.SetNumZeroed(NumWords);
+			Columns[NewSlot].TrueBits.SetNumZeroed(NumWords);
+		}
+	}
+	return Columns[Slot];
+}
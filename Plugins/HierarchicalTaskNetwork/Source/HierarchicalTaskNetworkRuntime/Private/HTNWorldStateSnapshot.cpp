@@ -0,0 +1,126 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HTNWorldStateSnapshot.h"
+
+#include "HTNWorldStateStruct.h"
+
+FHTNWorldStateSnapshot::FHTNWorldStateSnapshot(const FHTNWorldStateStruct& WorldState)
+{
+	FHTNProperty Value;
+	for (const FName& Key : WorldState.GetPropertyNames())
+	{
+		if (WorldState.GetProperty(Key, Value))
+		{
+			GetMutableChunk(GetChunkIndex(Key)).Add(Key, Value);
+		}
+	}
+}
+
+const FHTNProperty* FHTNWorldStateSnapshot::FindProperty(FName Key) const
+{
+	const TSharedPtr<FChunk, ESPMode::ThreadSafe>& Chunk = Chunks[GetChunkIndex(Key)];
+	return Chunk ? Chunk->Find(Key) : nullptr;
+}
+
+bool FHTNWorldStateSnapshot::GetProperty(FName Key, FHTNProperty& OutValue) const
+{
+	if (const FHTNProperty* Property = FindProperty(Key))
+	{
+		OutValue = *Property;
+		return true;
+	}
+	return false;
+}
+
+void FHTNWorldStateSnapshot::SetProperty(FName Key, const FHTNProperty& Value)
+{
+	// Don't copy a shared chunk just to write the value it already holds
+	const FHTNProperty* Existing = FindProperty(Key);
+	if (Existing && *Existing == Value)
+	{
+		return;
+	}
+
+	GetMutableChunk(GetChunkIndex(Key)).Add(Key, Value);
+}
+
+bool FHTNWorldStateSnapshot::RemoveProperty(FName Key)
+{
+	if (!HasProperty(Key))
+	{
+		return false;
+	}
+
+	GetMutableChunk(GetChunkIndex(Key)).Remove(Key);
+	return true;
+}
+
+int32 FHTNWorldStateSnapshot::Num() const
+{
+	int32 Count = 0;
+	for (const TSharedPtr<FChunk, ESPMode::ThreadSafe>& Chunk : Chunks)
+	{
+		Count += Chunk ? Chunk->Num() : 0;
+	}
+	return Count;
+}
+
+TArray<FName> FHTNWorldStateSnapshot::GetPropertyNames() const
+{
+	TArray<FName> Names;
+	Names.Reserve(Num());
+	for (const TSharedPtr<FChunk, ESPMode::ThreadSafe>& Chunk : Chunks)
+	{
+		if (Chunk)
+		{
+			for (const TPair<FName, FHTNProperty>& Pair : *Chunk)
+			{
+				Names.Add(Pair.Key);
+			}
+		}
+	}
+	return Names;
+}
+
+void FHTNWorldStateSnapshot::ToWorldState(FHTNWorldStateStruct& OutWorldState) const
+{
+	TMap<FName, FHTNProperty> Properties;
+	Properties.Reserve(Num());
+	for (const TSharedPtr<FChunk, ESPMode::ThreadSafe>& Chunk : Chunks)
+	{
+		if (Chunk)
+		{
+			Properties.Append(*Chunk);
+		}
+	}
+
+	// Keep the owner, only the properties come from the snapshot
+	OutWorldState = FHTNWorldStateStruct(OutWorldState.GetOwner(), Properties);
+}
+
+bool FHTNWorldStateSnapshot::SharesAllChunks(const FHTNWorldStateSnapshot& Other) const
+{
+	for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ++ChunkIndex)
+	{
+		if (Chunks[ChunkIndex] != Other.Chunks[ChunkIndex])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+FHTNWorldStateSnapshot::FChunk& FHTNWorldStateSnapshot::GetMutableChunk(int32 ChunkIndex)
+{
+	TSharedPtr<FChunk, ESPMode::ThreadSafe>& Chunk = Chunks[ChunkIndex];
+	if (!Chunk)
+	{
+		Chunk = MakeShared<FChunk, ESPMode::ThreadSafe>();
+	}
+	else if (!Chunk.IsUnique())
+	{
+		// Copy on write: the other holders keep the old chunk
+		Chunk = MakeShared<FChunk, ESPMode::ThreadSafe>(*Chunk);
+	}
+	return *Chunk;
+}
@@ -1,11 +1,50 @@
 #include "HTNWorldStateStruct.h"
 
+#include "HTNLogging.h"
+#include "Misc/ScopeRWLock.h"
+
+namespace HTNKeySlots
+{
+	FRWLock Lock;
+	TMap<FName, int32> Slots;
+}
+
+int32 FHTNKeySlots::Find(FName Key)
+{
+	FReadScopeLock ReadLock(HTNKeySlots::Lock);
+	const int32* Slot = HTNKeySlots::Slots.Find(Key);
+	return Slot ? *Slot : INDEX_NONE;
+}
+
+int32 FHTNKeySlots::FindOrAdd(FName Key)
+{
+	const int32 ExistingSlot = Find(Key);
+	if (ExistingSlot != INDEX_NONE)
+	{
+		return ExistingSlot;
+	}
+
+	FWriteScopeLock WriteLock(HTNKeySlots::Lock);
+	if (const int32* Slot = HTNKeySlots::Slots.Find(Key))
+	{
+		return *Slot;
+	}
+	return HTNKeySlots::Slots.Add(Key, HTNKeySlots::Slots.Num());
+}
+
 // FHTNWorldState Implementation
 
+namespace HTNWorldState
+{
+	/** Stands in for the value hash of keys marked removed in fingerprints */
+	constexpr uint32 RemovedKeyHash = 0x9E3779B9;
+}
+
 FHTNWorldStateStruct::FHTNWorldStateStruct(const TMap<FName, FHTNProperty>& InProperties)
 	: Properties(InProperties)
 	, OwnerActor(nullptr)
 {
+	RebuildKeyBits();
 }
 
 FHTNWorldStateStruct::FHTNWorldStateStruct(AActor* InOwnerActor)
@@ -17,17 +56,32 @@ FHTNWorldStateStruct::FHTNWorldStateStruct(AActor* InOwnerActor, const TMap<FNam
 	: Properties(InProperties)
 	, OwnerActor(InOwnerActor)
 {
+	RebuildKeyBits();
 }
 
 FHTNWorldStateStruct::FHTNWorldStateStruct(const FHTNWorldStateStruct& Other)
 	: Properties(Other.Properties)
 	, OwnerActor(Other.OwnerActor)
+	, RemovedKeys(Other.RemovedKeys)
+	, Version(Other.Version)
+	, KeyVersions(Other.KeyVersions)
+	, PresentBits(Other.PresentBits)
+	, BoolBits(Other.BoolBits)
+	, TrueBits(Other.TrueBits)
+	, RemovedBits(Other.RemovedBits)
 {
 }
 
 FHTNWorldStateStruct::FHTNWorldStateStruct(FHTNWorldStateStruct&& Other) noexcept
 	: Properties(MoveTemp(Other.Properties))
 	, OwnerActor(Other.OwnerActor)
+	, RemovedKeys(MoveTemp(Other.RemovedKeys))
+	, Version(Other.Version)
+	, KeyVersions(MoveTemp(Other.KeyVersions))
+	, PresentBits(MoveTemp(Other.PresentBits))
+	, BoolBits(MoveTemp(Other.BoolBits))
+	, TrueBits(MoveTemp(Other.TrueBits))
+	, RemovedBits(MoveTemp(Other.RemovedBits))
 {
 	// Clear the moved-from object's owner to avoid double deletion issues
 	Other.OwnerActor = nullptr;
@@ -37,8 +91,16 @@ FHTNWorldStateStruct& FHTNWorldStateStruct::operator=(const FHTNWorldStateStruct
 {
 	if (this != &Other)
 	{
+		const TMap<FName, FHTNProperty> PreviousProperties = MoveTemp(Properties);
+		const TSet<FName> PreviousRemovedKeys = MoveTemp(RemovedKeys);
 		Properties = Other.Properties;
 		OwnerActor = Other.OwnerActor;
+		RemovedKeys = Other.RemovedKeys;
+		PresentBits = Other.PresentBits;
+		BoolBits = Other.BoolBits;
+		TrueBits = Other.TrueBits;
+		RemovedBits = Other.RemovedBits;
+		MarkReplacedKeysChanged(PreviousProperties, PreviousRemovedKeys, Other.Version);
 	}
 	return *this;
 }
@@ -47,8 +109,16 @@ FHTNWorldStateStruct& FHTNWorldStateStruct::operator=(FHTNWorldStateStruct&& Oth
 {
 	if (this != &Other)
 	{
+		const TMap<FName, FHTNProperty> PreviousProperties = MoveTemp(Properties);
+		const TSet<FName> PreviousRemovedKeys = MoveTemp(RemovedKeys);
 		Properties = MoveTemp(Other.Properties);
 		OwnerActor = Other.OwnerActor;
+		RemovedKeys = MoveTemp(Other.RemovedKeys);
+		PresentBits = MoveTemp(Other.PresentBits);
+		BoolBits = MoveTemp(Other.BoolBits);
+		TrueBits = MoveTemp(Other.TrueBits);
+		RemovedBits = MoveTemp(Other.RemovedBits);
+		MarkReplacedKeysChanged(PreviousProperties, PreviousRemovedKeys, Other.Version);
 		
 		// Clear the moved-from object's owner to avoid double deletion issues
 		Other.OwnerActor = nullptr;
@@ -78,7 +148,20 @@ bool FHTNWorldStateStruct::GetProperty(FName Key, FHTNProperty& OutValue) const
 
 void FHTNWorldStateStruct::SetProperty(FName Key, const FHTNProperty& Value)
 {
+	// Setting a property to its current value is not a change
+	const FHTNProperty* Existing = Properties.Find(Key);
+	if (Existing && *Existing == Value)
+	{
+		return;
+	}
+
 	Properties.Add(Key, Value);
+	UpdateKeyBits(Key, &Value);
+	if (RemovedKeys.Remove(Key) > 0)
+	{
+		UpdateRemovedBit(Key, false);
+	}
+	MarkKeyChanged(Key);
 }
 
 bool FHTNWorldStateStruct::HasProperty(FName Key) const
@@ -88,19 +171,219 @@ bool FHTNWorldStateStruct::HasProperty(FName Key) const
 
 bool FHTNWorldStateStruct::RemoveProperty(FName Key)
 {
-	return Properties.Remove(Key) > 0;
+	if (Properties.Remove(Key) > 0)
+	{
+		UpdateKeyBits(Key, nullptr);
+		MarkKeyChanged(Key);
+		return true;
+	}
+	return false;
+}
+
+bool FHTNWorldStateStruct::MarkPropertyRemoved(FName Key)
+{
+	bool bAlreadyRemoved = false;
+	RemovedKeys.Add(Key, &bAlreadyRemoved);
+	if (bAlreadyRemoved)
+	{
+		return false;
+	}
+
+	Properties.Remove(Key);
+	UpdateKeyBits(Key, nullptr);
+	UpdateRemovedBit(Key, true);
+	MarkKeyChanged(Key);
+	return true;
+}
+
+void FHTNWorldStateStruct::ClearRemovedMarks()
+{
+	RemovedKeys.Reset();
+	RemovedBits.Reset();
+}
+
+void FHTNWorldStateStruct::GetChangedKeysSince(uint32 SinceVersion, TArray<FName>& OutKeys) const
+{
+	if (SinceVersion == Version)
+	{
+		return;
+	}
+
+	for (const auto& Pair : KeyVersions)
+	{
+		if (Pair.Value > SinceVersion)
+		{
+			OutKeys.Add(Pair.Key);
+		}
+	}
+}
+
+uint32 FHTNWorldStateStruct::GetFingerprint() const
+{
+	// Summing per-property hashes keeps the fingerprint independent of map order
+	uint32 Fingerprint = Properties.Num();
+	for (const auto& Pair : Properties)
+	{
+		Fingerprint += HashCombine(GetTypeHash(Pair.Key), Pair.Value.GetValueHash());
+	}
+
+	// Removal marks hide parent values, so they tell layered states apart like values do
+	for (const FName& Key : RemovedKeys)
+	{
+		Fingerprint += HashCombine(GetTypeHash(Key), HTNWorldState::RemovedKeyHash);
+	}
+	return Fingerprint;
+}
+
+uint32 FHTNWorldStateStruct::GetStableFingerprint() const
+{
+	uint32 Fingerprint = Properties.Num();
+	for (const auto& Pair : Properties)
+	{
+		Fingerprint += HashCombine(GetTypeHash(Pair.Key.ToString()), Pair.Value.GetStableValueHash());
+	}
+	for (const FName& Key : RemovedKeys)
+	{
+		Fingerprint += HashCombine(GetTypeHash(Key.ToString()), HTNWorldState::RemovedKeyHash);
+	}
+	return Fingerprint;
+}
+
+void FHTNWorldStateStruct::PostSerialize(const FArchive& Ar)
+{
+	if (Ar.IsLoading())
+	{
+		RebuildKeyBits();
+	}
+}
+
+void FHTNWorldStateStruct::UpdateKeyBits(FName Key, const FHTNProperty* Value)
+{
+	// Removed keys that never got a slot have no bits to clear
+	const int32 Slot = Value ? FHTNKeySlots::FindOrAdd(Key) : FHTNKeySlots::Find(Key);
+	const int32 WordIndex = Slot / 64;
+	if (Slot == INDEX_NONE || (!Value && !PresentBits.IsValidIndex(WordIndex)))
+	{
+		return;
+	}
+
+	if (!PresentBits.IsValidIndex(WordIndex))
+	{
+		PresentBits.SetNumZeroed(WordIndex + 1);
+		BoolBits.SetNumZeroed(WordIndex + 1);
+		TrueBits.SetNumZeroed(WordIndex + 1);
+	}
+
+	const uint64 Bit = uint64(1) << (Slot % 64);
+	const bool bIsBool = Value && Value->GetType() == EHTNPropertyType::Boolean;
+	PresentBits[WordIndex] = Value ? PresentBits[WordIndex] | Bit : PresentBits[WordIndex] & ~Bit;
+	BoolBits[WordIndex] = bIsBool ? BoolBits[WordIndex] | Bit : BoolBits[WordIndex] & ~Bit;
+	TrueBits[WordIndex] = bIsBool && Value->GetBoolValue() ? TrueBits[WordIndex] | Bit : TrueBits[WordIndex] & ~Bit;
+}
+
+void FHTNWorldStateStruct::UpdateRemovedBit(FName Key, bool bRemoved)
+{
+	const int32 Slot = bRemoved ? FHTNKeySlots::FindOrAdd(Key) : FHTNKeySlots::Find(Key);
+	const int32 WordIndex = Slot / 64;
+	if (Slot == INDEX_NONE || (!bRemoved && !RemovedBits.IsValidIndex(WordIndex)))
+	{
+		return;
+	}
+
+	if (!RemovedBits.IsValidIndex(WordIndex))
+	{
+		RemovedBits.SetNumZeroed(WordIndex + 1);
+	}
+
+	const uint64 Bit = uint64(1) << (Slot % 64);
+	RemovedBits[WordIndex] = bRemoved ? RemovedBits[WordIndex] | Bit : RemovedBits[WordIndex] & ~Bit;
+}
+
+void FHTNWorldStateStruct::RebuildKeyBits()
+{
+	PresentBits.Reset();
+	BoolBits.Reset();
+	TrueBits.Reset();
+	RemovedBits.Reset();
+	for (const auto& Pair : Properties)
+	{
+		UpdateKeyBits(Pair.Key, &Pair.Value);
+	}
+	for (const FName& Key : RemovedKeys)
+	{
+		UpdateRemovedBit(Key, true);
+	}
+}
+
+void FHTNWorldStateStruct::MarkKeyChanged(FName Key)
+{
+	KeyVersions.Add(Key, ++Version);
+}
+
+void FHTNWorldStateStruct::MarkReplacedKeysChanged(const TMap<FName, FHTNProperty>& PreviousProperties, const TSet<FName>& PreviousRemovedKeys, uint32 MinVersion)
+{
+	TArray<FName, TInlineAllocator<16>> ChangedKeys;
+	for (const auto& Pair : Properties)
+	{
+		const FHTNProperty* PreviousValue = PreviousProperties.Find(Pair.Key);
+		if (!PreviousValue || !(*PreviousValue == Pair.Value))
+		{
+			ChangedKeys.Add(Pair.Key);
+		}
+	}
+	for (const auto& Pair : PreviousProperties)
+	{
+		if (!Properties.Contains(Pair.Key))
+		{
+			ChangedKeys.Add(Pair.Key);
+		}
+	}
+
+	// Marking a key removed, or no longer, changes what it resolves to
+	for (const FName& Key : RemovedKeys)
+	{
+		if (!PreviousRemovedKeys.Contains(Key))
+		{
+			ChangedKeys.Add(Key);
+		}
+	}
+	for (const FName& Key : PreviousRemovedKeys)
+	{
+		if (!RemovedKeys.Contains(Key))
+		{
+			ChangedKeys.Add(Key);
+		}
+	}
+
+	// Replacing the properties with the same values is not a change
+	if (ChangedKeys.Num() == 0)
+	{
+		return;
+	}
+
+	// Keep versions increasing so anyone holding an older version sees the replacement
+	Version = FMath::Max(Version, MinVersion) + 1;
+	for (const FName& Key : ChangedKeys)
+	{
+		KeyVersions.Add(Key, Version);
+	}
 }
 
 FHTNWorldStateStruct FHTNWorldStateStruct::Clone() const
 {
-	// Create a new world state with the same properties and owner
-	return FHTNWorldStateStruct(OwnerActor, Properties);
+	// Create a new world state with the same properties, removal marks and owner
+	FHTNWorldStateStruct Result(OwnerActor, Properties);
+	for (const FName& Key : RemovedKeys)
+	{
+		Result.MarkPropertyRemoved(Key);
+	}
+	return Result;
 }
 
 bool FHTNWorldStateStruct::Equals(const FHTNWorldStateStruct& Other) const
 {
 	// Note: We don't compare owners because we're focusing on property equality
-	if (Properties.Num() != Other.Properties.Num())
+	if (Properties.Num() != Other.Properties.Num() || RemovedKeys.Num() != Other.RemovedKeys.Num() || !RemovedKeys.Includes(Other.RemovedKeys))
 	{
 		return false;
 	}
@@ -181,27 +464,81 @@ UHTNWorldState::UHTNWorldState()
 
 bool UHTNWorldState::GetProperty(FName Key, FHTNProperty& OutValue) const
 {
-	return WorldState.GetProperty(Key, OutValue);
+	for (const UHTNWorldState* Layer = this; Layer; Layer = Layer->ParentLayer)
+	{
+		if (Layer->WorldState.GetProperty(Key, OutValue))
+		{
+			return true;
+		}
+		if (Layer->WorldState.IsPropertyMarkedRemoved(Key))
+		{
+			return false;
+		}
+	}
+	return false;
 }
 
 void UHTNWorldState::SetProperty(FName Key, const FHTNProperty& Value)
 {
-	WorldState.SetProperty(Key, Value);
+	UHTNWorldState* Layer = GetWriteLayer(Key);
+	const uint32 PreviousVersion = Layer->WorldState.GetVersion();
+	Layer->WorldState.SetProperty(Key, Value);
+	Layer->BroadcastKeyChanged(Key, PreviousVersion);
 }
 
 bool UHTNWorldState::HasProperty(FName Key) const
 {
-	return WorldState.HasProperty(Key);
+	return FindLayerWithKey(Key) != nullptr;
 }
 
 bool UHTNWorldState::RemoveProperty(FName Key)
 {
-	return WorldState.RemoveProperty(Key);
+	// Shared layers are left alone; a key one of them holds is marked removed in the write layer instead
+	UHTNWorldState* Layer = GetWriteLayer(Key);
+	const uint32 PreviousVersion = Layer->WorldState.GetVersion();
+	const bool bHeldByParent = Layer->ParentLayer && Layer->ParentLayer->FindLayerWithKey(Key);
+	const bool bRemoved = bHeldByParent ? Layer->WorldState.MarkPropertyRemoved(Key) : Layer->WorldState.RemoveProperty(Key);
+	Layer->BroadcastKeyChanged(Key, PreviousVersion);
+	return bRemoved;
+}
+
+void UHTNWorldState::SetWorldState(const FHTNWorldStateStruct& InWorldState)
+{
+	const uint32 PreviousVersion = WorldState.GetVersion();
+	WorldState = InWorldState;
+
+	if (KeyChangedDelegates.Num() == 0 && !AnyKeyChangedDelegate.IsBound())
+	{
+		return;
+	}
+
+	TArray<FName> ChangedKeys;
+	WorldState.GetChangedKeysSince(PreviousVersion, ChangedKeys);
+	for (const FName& Key : ChangedKeys)
+	{
+		BroadcastKeyChanged(Key, PreviousVersion);
+	}
+}
+
+void UHTNWorldState::BroadcastKeyChanged(FName Key, uint32 PreviousVersion)
+{
+	// Unchanged values leave the version alone
+	if (WorldState.GetVersion() == PreviousVersion)
+	{
+		return;
+	}
+
+	if (const FHTNWorldStateKeyChangedDelegate* KeyDelegate = KeyChangedDelegates.Find(Key))
+	{
+		KeyDelegate->Broadcast(Key);
+	}
+	AnyKeyChangedDelegate.Broadcast(Key);
 }
 
 UHTNWorldState* UHTNWorldState::Clone() const
 {
 	UHTNWorldState* Clone = CreateFromStruct(WorldState.Clone());
+	Clone->ParentLayer = ParentLayer;
 	return Clone;
 }
 
@@ -212,7 +549,16 @@ bool UHTNWorldState::Equals(const UHTNWorldState* Other) const
 		return false;
 	}
 
-	return WorldState.Equals(Other->WorldState);
+	if (ParentLayer == Other->ParentLayer)
+	{
+		return WorldState.Equals(Other->WorldState);
+	}
+
+	FHTNWorldStateStruct Resolved;
+	FHTNWorldStateStruct OtherResolved;
+	GetResolvedWorldState(Resolved);
+	Other->GetResolvedWorldState(OtherResolved);
+	return Resolved.Equals(OtherResolved);
 }
 
 UHTNWorldState* UHTNWorldState::CreateDifference(const UHTNWorldState* Other) const
@@ -227,12 +573,26 @@ UHTNWorldState* UHTNWorldState::CreateDifference(const UHTNWorldState* Other) co
 
 TArray<FName> UHTNWorldState::GetPropertyNames() const
 {
-	return WorldState.GetPropertyNames();
+	if (!ParentLayer)
+	{
+		return WorldState.GetPropertyNames();
+	}
+
+	FHTNWorldStateStruct Resolved;
+	GetResolvedWorldState(Resolved);
+	return Resolved.GetPropertyNames();
 }
 
 FString UHTNWorldState::ToString() const
 {
-	return WorldState.ToString();
+	if (!ParentLayer)
+	{
+		return WorldState.ToString();
+	}
+
+	FHTNWorldStateStruct Resolved;
+	GetResolvedWorldState(Resolved);
+	return Resolved.ToString();
 }
 
 UHTNWorldState* UHTNWorldState::CreateFromStruct(const FHTNWorldStateStruct& InWorldState)
@@ -240,4 +600,241 @@ UHTNWorldState* UHTNWorldState::CreateFromStruct(const FHTNWorldStateStruct& InW
 	UHTNWorldState* Result = NewObject<UHTNWorldState>();
 	Result->SetWorldState(InWorldState);
 	return Result;
-}
\ No newline at end of file
+}
+
+void UHTNWorldState::SetParentLayer(UHTNWorldState* InParentLayer, bool bInWriteToOwningLayer)
+{
+	// A layer can't resolve through itself
+	for (const UHTNWorldState* Layer = InParentLayer; Layer; Layer = Layer->ParentLayer)
+	{
+		if (Layer == this)
+		{
+			UE_LOG(LogHTNPlannerPlugin, Error, TEXT("Cannot set world state parent layer: it would create a cycle"));
+			return;
+		}
+	}
+
+	ParentLayer = InParentLayer;
+	bWriteToOwningLayer = bInWriteToOwningLayer;
+}
+
+void UHTNWorldState::CopyFrom(const UHTNWorldState* Source)
+{
+	SetWorldState(Source->WorldState);
+	ParentLayer = Source->ParentLayer;
+	bWriteToOwningLayer = false;
+}
+
+void UHTNWorldState::GetResolvedWorldState(FHTNWorldStateStruct& OutWorldState) const
+{
+	// The resolved state has no parent layers, so it needs no removal marks; they hide the key in every farther layer
+	OutWorldState = WorldState;
+	OutWorldState.ClearRemovedMarks();
+	TSet<FName> RemovedKeys = WorldState.GetRemovedKeys();
+
+	FHTNProperty Value;
+	for (const UHTNWorldState* Layer = ParentLayer; Layer; Layer = Layer->ParentLayer)
+	{
+		for (const FName& Key : Layer->WorldState.GetPropertyNames())
+		{
+			// Nearer layers shadow farther ones
+			if (!OutWorldState.HasProperty(Key) && !RemovedKeys.Contains(Key) && Layer->WorldState.GetProperty(Key, Value))
+			{
+				OutWorldState.SetProperty(Key, Value);
+			}
+		}
+		RemovedKeys.Append(Layer->WorldState.GetRemovedKeys());
+	}
+}
+
+uint32 UHTNWorldState::GetVersion() const
+{
+	uint32 Version = 0;
+	for (const UHTNWorldState* Layer = this; Layer; Layer = Layer->ParentLayer)
+	{
+		Version += Layer->WorldState.GetVersion();
+	}
+	return Version;
+}
+
+void UHTNWorldState::GetLayerVersions(TArray<uint32>& OutLayerVersions) const
+{
+	OutLayerVersions.Reset();
+	for (const UHTNWorldState* Layer = this; Layer; Layer = Layer->ParentLayer)
+	{
+		OutLayerVersions.Add(Layer->WorldState.GetVersion());
+	}
+}
+
+void UHTNWorldState::GetLayers(TArray<TWeakObjectPtr<const UHTNWorldState>>& OutLayers) const
+{
+	OutLayers.Reset();
+	for (const UHTNWorldState* Layer = this; Layer; Layer = Layer->ParentLayer)
+	{
+		OutLayers.Add(Layer);
+	}
+}
+
+bool UHTNWorldState::HasLayers(TConstArrayView<TWeakObjectPtr<const UHTNWorldState>> Layers) const
+{
+	int32 LayerIndex = 0;
+	for (const UHTNWorldState* Layer = this; Layer; Layer = Layer->ParentLayer, ++LayerIndex)
+	{
+		if (!Layers.IsValidIndex(LayerIndex) || Layers[LayerIndex].Get() != Layer)
+		{
+			return false;
+		}
+	}
+	return LayerIndex == Layers.Num();
+}
+
+bool UHTNWorldState::IsUnchangedSince(TConstArrayView<TWeakObjectPtr<const UHTNWorldState>> Layers, TConstArrayView<uint32> LayerVersions) const
+{
+	int32 LayerIndex = 0;
+	for (const UHTNWorldState* Layer = this; Layer; Layer = Layer->ParentLayer, ++LayerIndex)
+	{
+		if (!Layers.IsValidIndex(LayerIndex) || !LayerVersions.IsValidIndex(LayerIndex) ||
+			Layers[LayerIndex].Get() != Layer || LayerVersions[LayerIndex] != Layer->WorldState.GetVersion())
+		{
+			return false;
+		}
+	}
+	return LayerIndex == Layers.Num() && LayerIndex == LayerVersions.Num();
+}
+
+void UHTNWorldState::GetChangedKeysSince(TConstArrayView<uint32> LayerVersions, TArray<FName>& OutKeys) const
+{
+	int32 LayerIndex = 0;
+	for (const UHTNWorldState* Layer = this; Layer; Layer = Layer->ParentLayer, ++LayerIndex)
+	{
+		// Layers attached since then count as entirely changed
+		Layer->WorldState.GetChangedKeysSince(LayerVersions.IsValidIndex(LayerIndex) ? LayerVersions[LayerIndex] : 0, OutKeys);
+	}
+}
+
+uint32 UHTNWorldState::GetFingerprint() const
+{
+	// Shared layers are identified by object and version rather than rehashed for every agent
+	uint32 Fingerprint = WorldState.GetFingerprint();
+	for (const UHTNWorldState* Layer = ParentLayer; Layer; Layer = Layer->ParentLayer)
+	{
+		Fingerprint = HashCombine(Fingerprint, HashCombine(GetTypeHash(Layer), GetTypeHash(Layer->WorldState.GetVersion())));
+	}
+	return Fingerprint;
+}
+
+uint32 UHTNWorldState::GetStableFingerprint() const
+{
+	// Layers are told apart by address in GetFingerprint, which differs between processes
+	if (!ParentLayer)
+	{
+		return WorldState.GetStableFingerprint();
+	}
+
+	FHTNWorldStateStruct ResolvedWorldState;
+	GetResolvedWorldState(ResolvedWorldState);
+	return ResolvedWorldState.GetStableFingerprint();
+}
+
+bool UHTNWorldState::MatchesBoolBits(TConstArrayView<uint64> RequiredBits, TConstArrayView<uint64> ExpectedTrueBits) const
+{
+	if (ExpectedTrueBits.Num() < RequiredBits.Num())
+	{
+		UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Cannot match boolean bits: expected values cover %d words of %d required"), ExpectedTrueBits.Num(), RequiredBits.Num());
+		return false;
+	}
+
+	for (int32 WordIndex = 0; WordIndex < RequiredBits.Num(); ++WordIndex)
+	{
+		const uint64 Required = RequiredBits[WordIndex];
+		if (!Required)
+		{
+			continue;
+		}
+
+		// Resolve the word through the layers; a key held by a nearer layer shadows farther ones whatever its type
+		uint64 Covered = 0;
+		uint64 Bools = 0;
+		uint64 Trues = 0;
+		for (const UHTNWorldState* Layer = this; Layer && (Covered & Required) != Required; Layer = Layer->ParentLayer)
+		{
+			// Keys marked removed are covered without a value, so farther layers can't supply one
+			uint64 LayerPresent, LayerBools, LayerTrues, LayerRemoved;
+			Layer->WorldState.GetKeyBits(WordIndex, LayerPresent, LayerBools, LayerTrues, LayerRemoved);
+			const uint64 Uncovered = LayerPresent & ~Covered;
+			Bools |= LayerBools & Uncovered;
+			Trues |= LayerTrues & Uncovered;
+			Covered |= LayerPresent | LayerRemoved;
+		}
+
+		if ((Bools & Required) != Required || (Trues & Required) != ExpectedTrueBits[WordIndex])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+FHTNWorldStateSnapshot UHTNWorldState::GetSnapshot() const
+{
+	TArray<uint32> LayerVersions;
+	GetLayerVersions(LayerVersions);
+
+	if (!HasLayers(CachedSnapshotLayers))
+	{
+		// Keys of detached layers can't be told apart from the rest, so start over
+		FHTNWorldStateStruct Resolved;
+		GetResolvedWorldState(Resolved);
+		CachedSnapshot = FHTNWorldStateSnapshot(Resolved);
+		GetLayers(CachedSnapshotLayers);
+	}
+	else if (LayerVersions != CachedSnapshotLayerVersions)
+	{
+		TArray<FName> ChangedKeys;
+		GetChangedKeysSince(CachedSnapshotLayerVersions, ChangedKeys);
+
+		FHTNProperty Value;
+		for (const FName& Key : ChangedKeys)
+		{
+			if (GetProperty(Key, Value))
+			{
+				CachedSnapshot.SetProperty(Key, Value);
+			}
+			else
+			{
+				CachedSnapshot.RemoveProperty(Key);
+			}
+		}
+	}
+
+	CachedSnapshotLayerVersions = MoveTemp(LayerVersions);
+	return CachedSnapshot;
+}
+
+const UHTNWorldState* UHTNWorldState::FindLayerWithKey(FName Key) const
+{
+	for (const UHTNWorldState* Layer = this; Layer; Layer = Layer->ParentLayer)
+	{
+		if (Layer->WorldState.HasProperty(Key))
+		{
+			return Layer;
+		}
+		if (Layer->WorldState.IsPropertyMarkedRemoved(Key))
+		{
+			return nullptr;
+		}
+	}
+	return nullptr;
+}
+
+UHTNWorldState* UHTNWorldState::GetWriteLayer(FName Key)
+{
+	if (bWriteToOwningLayer && ParentLayer)
+	{
+		if (const UHTNWorldState* OwningLayer = FindLayerWithKey(Key))
+		{
+			return const_cast<UHTNWorldState*>(OwningLayer);
+		}
+	}
+	return this;
+}
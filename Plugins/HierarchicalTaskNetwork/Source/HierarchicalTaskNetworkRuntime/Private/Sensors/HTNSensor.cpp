@@ -0,0 +1,44 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Sensors/HTNSensor.h"
+
+#include "HTNLogging.h"
+
+UHTNSensor::UHTNSensor()
+	: UpdateInterval(0.5f)
+{
+}
+
+void UHTNSensor::SenseBatch(TArrayView<FHTNSensorUpdate> Updates) const
+{
+	// Base implementation senses agent by agent
+	for (FHTNSensorUpdate& Update : Updates)
+	{
+		if (Update.Sensor)
+		{
+			Update.Sensor->Sense(Update.Owner, Update.WorldState, Update.Values);
+		}
+	}
+}
+
+void UHTNSensor::Sense_Implementation(AActor* Owner, const UHTNWorldState* WorldState, TMap<FName, FHTNProperty>& OutValues) const
+{
+	// Base implementation senses nothing
+}
+
+FString UHTNSensor::GetDescription_Implementation() const
+{
+	// Default description uses the class name
+	return FString::Printf(TEXT("Sensor: %s"), *GetClass()->GetName());
+}
+
+bool UHTNSensor::ValidateSensor_Implementation() const
+{
+	if (OutputKeys.Num() == 0)
+	{
+		UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("Sensor writes no keys: %s"), *GetDescription());
+		return false;
+	}
+
+	return true;
+}
@@ -18,15 +18,21 @@ UHTNMoveToTask::UHTNMoveToTask()
     , bAllowPartialPath(true)
     , bUsePathfinding(true)
     , MovementSpeed(0.0f)
-    , MoveRequestID(FAIRequestID::InvalidRequest)
-    , PathComputationWaitTime(0.0f)
 {
     TaskName = FName("MoveTo");
     DebugColor = FLinearColor(0.0f, 0.7f, 1.0f); // Cyan blue for movement
 }
 
-EHTNTaskStatus UHTNMoveToTask::ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext)
+EHTNTaskStatus UHTNMoveToTask::ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) const
 {
+    FHTNMoveToTaskMemory* Memory = ExecutionContext->GetTaskMemory<FHTNMoveToTaskMemory>();
+    if (!Memory)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("MoveTo task failed: No instance memory"));
+        return EHTNTaskStatus::Failed;
+    }
+
+
     // Try to get the AI controller from the world state's owner actor
     AAIController* Controller = GetController(ExecutionContext->GetWorldState());
     if (!Controller)
@@ -83,9 +89,25 @@ EHTNTaskStatus UHTNMoveToTask::ExecuteTask_Implementation(UHTNExecutionContext*
     }
 
 
-    //Listen for move finished
-    Controller->ReceiveMoveCompleted.AddDynamic(this, &UHTNMoveToTask::OnMoveFinished);
-    DidFinish = false;
+    // Listen for move finished. The binding targets this agent's instance memory; the component
+    // it is added to is remembered, so EndTask or CleanupMemory can remove it even if the
+    // controller or pawn changes in the meantime.
+    UnbindMoveFinished(*Memory);
+    Memory->bDidFinish = false;
+    Memory->MoveRequestID = FAIRequestID::InvalidRequest;
+    if (UPathFollowingComponent* PathFollowingComp = Controller->GetPathFollowingComponent())
+    {
+        Memory->PathFollowingComponent = PathFollowingComp;
+        Memory->MoveFinishedHandle = PathFollowingComp->OnRequestFinished.AddLambda(
+            [Memory](FAIRequestID RequestID, const FPathFollowingResult& Result)
+            {
+                if (Memory->MoveRequestID.IsValid() && RequestID == Memory->MoveRequestID)
+                {
+                    Memory->bDidFinish = true;
+                    Memory->ResultOfPathing = Result.Code;
+                }
+            });
+    }
     
     // Start the movement
     FPathFollowingRequestResult RequestResult = Controller->MoveTo(MoveRequest);
@@ -102,30 +124,37 @@ EHTNTaskStatus UHTNMoveToTask::ExecuteTask_Implementation(UHTNExecutionContext*
     }
 
     // Store the move request ID for later checking
-    MoveRequestID = RequestResult.MoveId;
-    PathComputationWaitTime = 0.0f;
+    Memory->MoveRequestID = RequestResult.MoveId;
+    Memory->PathComputationWaitTime = 0.0f;
 
     UE_LOG(LogHTNPlannerPlugin, Verbose, TEXT("MoveTo task started: Moving to %s"), *Destination.ToString());
     return EHTNTaskStatus::InProgress;
 }
 
-EHTNTaskStatus UHTNMoveToTask::TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime)
+EHTNTaskStatus UHTNMoveToTask::TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime) const
 {
-    if(DidFinish)
+    FHTNMoveToTaskMemory* Memory = ExecutionContext->GetTaskMemory<FHTNMoveToTaskMemory>();
+    if (!Memory)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("MoveTo task failed during tick: No instance memory"));
+        return EHTNTaskStatus::Failed;
+    }
+
+    if(Memory->bDidFinish)
     {
-        if(ResultOfPathing == EPathFollowingResult::Type::Success)
+        if(Memory->ResultOfPathing == EPathFollowingResult::Type::Success)
         {
             return EHTNTaskStatus::Succeeded;
         }
         else
         {
-            if(ResultOfPathing == EPathFollowingResult::Type::Blocked)
+            if(Memory->ResultOfPathing == EPathFollowingResult::Type::Blocked)
                 UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("MoveTo task failed during tick: Blocked"));
-            if(ResultOfPathing == EPathFollowingResult::Type::OffPath)
+            if(Memory->ResultOfPathing == EPathFollowingResult::Type::OffPath)
                 UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("MoveTo task failed during tick: OffPath"));
-            if(ResultOfPathing == EPathFollowingResult::Type::Aborted)
+            if(Memory->ResultOfPathing == EPathFollowingResult::Type::Aborted)
                 UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("MoveTo task failed during tick: Aborted"));
-            if(ResultOfPathing == EPathFollowingResult::Type::Invalid)
+            if(Memory->ResultOfPathing == EPathFollowingResult::Type::Invalid)
                 UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("MoveTo task failed during tick: Invalid"));
             return EHTNTaskStatus::Failed;
         }
@@ -147,7 +176,7 @@ EHTNTaskStatus UHTNMoveToTask::TickTask_Implementation(UHTNExecutionContext* Exe
     }
 
     // Check if the movement is still valid
-    if (MoveRequestID == FAIRequestID::InvalidRequest)
+    if (Memory->MoveRequestID == FAIRequestID::InvalidRequest)
     {
         UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("MoveTo task failed during tick: Invalid move request ID"));
         return EHTNTaskStatus::Failed;
@@ -156,10 +185,10 @@ EHTNTaskStatus UHTNMoveToTask::TickTask_Implementation(UHTNExecutionContext* Exe
     // If the move is still being processed (path is being created), wait for a reasonable time
     if (PathFollowingComp->GetStatus() == EPathFollowingStatus::Waiting)
     {
-        PathComputationWaitTime += DeltaTime;
+        Memory->PathComputationWaitTime += DeltaTime;
         
         // If we've waited too long for path computation, fail the task
-        if (PathComputationWaitTime > 3.0f)  // 3 seconds is a reasonable timeout
+        if (Memory->PathComputationWaitTime > 3.0f)  // 3 seconds is a reasonable timeout
         {
             UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("MoveTo task failed: Path computation timed out"));
             return EHTNTaskStatus::Failed;
@@ -228,25 +257,32 @@ EHTNTaskStatus UHTNMoveToTask::TickTask_Implementation(UHTNExecutionContext* Exe
     return EHTNTaskStatus::InProgress;
 }
 
-void UHTNMoveToTask::EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus)
+void UHTNMoveToTask::EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus) const
 {
     Super::EndTask_Implementation(ExecutionContext, FinalStatus);
     
+    FHTNMoveToTaskMemory* Memory = ExecutionContext ? ExecutionContext->GetTaskMemory<FHTNMoveToTaskMemory>() : nullptr;
+    if (!Memory)
+    {
+        return;
+    }
+    
+    // Stop listening through the component the binding was added to, whatever the controller is now
+    UnbindMoveFinished(*Memory);
+
     // Clean up the move request if needed
     AAIController* Controller = GetController(ExecutionContext->GetWorldState());
-    if (Controller && MoveRequestID != FAIRequestID::InvalidRequest)
+    if (Controller)
     {
-        Controller->ReceiveMoveCompleted.RemoveDynamic(this, &UHTNMoveToTask::OnMoveFinished);
-        
         // Only abort if we failed or the request is still active
-        if (FinalStatus != EHTNTaskStatus::Succeeded)
+        if (Memory->MoveRequestID != FAIRequestID::InvalidRequest && FinalStatus != EHTNTaskStatus::Succeeded)
         {
             Controller->StopMovement();
         }
-        
-        // Reset the request ID
-        MoveRequestID = FAIRequestID::InvalidRequest;
     }
+    
+    // Reset the request
+    Memory->MoveRequestID = FAIRequestID::InvalidRequest;
 }
 
 bool UHTNMoveToTask::IsApplicable(const UHTNWorldState* WorldState) const
@@ -305,6 +341,35 @@ bool UHTNMoveToTask::IsApplicable(const UHTNWorldState* WorldState) const
     return true;
 }
 
+uint16 UHTNMoveToTask::GetInstanceMemorySize() const
+{
+    return sizeof(FHTNMoveToTaskMemory);
+}
+
+void UHTNMoveToTask::InitializeMemory(uint8* NodeMemory) const
+{
+    new (NodeMemory) FHTNMoveToTaskMemory();
+}
+
+void UHTNMoveToTask::CleanupMemory(uint8* NodeMemory) const
+{
+    FHTNMoveToTaskMemory* Memory = CastInstanceMemory<FHTNMoveToTaskMemory>(NodeMemory);
+
+    // The binding captures this memory, so it must not outlive it
+    UnbindMoveFinished(*Memory);
+    Memory->~FHTNMoveToTaskMemory();
+}
+
+void UHTNMoveToTask::UnbindMoveFinished(FHTNMoveToTaskMemory& Memory)
+{
+    if (UPathFollowingComponent* PathFollowingComp = Memory.PathFollowingComponent.Get())
+    {
+        PathFollowingComp->OnRequestFinished.Remove(Memory.MoveFinishedHandle);
+    }
+    Memory.PathFollowingComponent.Reset();
+    Memory.MoveFinishedHandle.Reset();
+}
+
 bool UHTNMoveToTask::ValidateTask_Implementation() const
 {
     // Check base validation
@@ -422,12 +487,3 @@ bool UHTNMoveToTask::GetDestination(const UHTNWorldState* WorldState, FVector& O
     
     return false;
 }
-
-void UHTNMoveToTask::OnMoveFinished(FAIRequestID RequestID, EPathFollowingResult::Type Result)
-{
-    if(MoveRequestID)
-    {
-        DidFinish = true;
-        ResultOfPathing = Result;
-    }
-}
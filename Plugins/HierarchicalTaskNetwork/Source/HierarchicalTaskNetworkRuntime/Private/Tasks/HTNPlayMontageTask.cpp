@@ -20,15 +20,12 @@ UHTNPlayMontageTask::UHTNPlayMontageTask()
     , bNotifyAnimationComplete(false)
     , bStoreMontageLength(false)
     , MontageLengthKey(NAME_None)
-    , ActiveMontage(nullptr)
-    , bMontageStarted(false)
-    , bMontageCompleted(false)
 {
     TaskName = FName("PlayMontage");
     DebugColor = FLinearColor(0.8f, 0.2f, 0.8f); // Purple for animation tasks
 }
 
-EHTNTaskStatus UHTNPlayMontageTask::ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext)
+EHTNTaskStatus UHTNPlayMontageTask::ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) const
 {
     if (!ExecutionContext || !ExecutionContext->GetWorldState())
     {
@@ -36,6 +33,13 @@ EHTNTaskStatus UHTNPlayMontageTask::ExecuteTask_Implementation(UHTNExecutionCont
         return EHTNTaskStatus::Failed;
     }
 
+    FHTNPlayMontageTaskMemory* Memory = ExecutionContext->GetTaskMemory<FHTNPlayMontageTaskMemory>();
+    if (!Memory)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("PlayMontageTask: No instance memory"));
+        return EHTNTaskStatus::Failed;
+    }
+
     // Get the actor
     AActor* TargetActor = ExecutionContext->GetOwner();
     if (!TargetActor)
@@ -83,9 +87,6 @@ EHTNTaskStatus UHTNPlayMontageTask::ExecuteTask_Implementation(UHTNExecutionCont
         return bFailWhenNotPlayed ? EHTNTaskStatus::Failed : EHTNTaskStatus::Succeeded;
     }
 
-    // Register delegate for montage end
-    RegisterMontageEndDelegate(AnimInstance);
-
     // Play the montage
     float MontageLength = AnimInstance->Montage_Play(MontageToPlay, PlayRate, EMontagePlayReturnType::MontageLength, StartPosition, false);
     
@@ -93,7 +94,6 @@ EHTNTaskStatus UHTNPlayMontageTask::ExecuteTask_Implementation(UHTNExecutionCont
     if (MontageLength <= 0.0f)
     {
         UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("PlayMontageTask: Failed to play montage %s"), *MontageToPlay->GetName());
-        UnregisterMontageEndDelegate(AnimInstance);
         return bFailWhenNotPlayed ? EHTNTaskStatus::Failed : EHTNTaskStatus::Succeeded;
     }
 
@@ -103,9 +103,12 @@ EHTNTaskStatus UHTNPlayMontageTask::ExecuteTask_Implementation(UHTNExecutionCont
         AnimInstance->Montage_JumpToSection(StartSection, MontageToPlay);
     }
 
-    // Keep track of the active montage
-    ActiveMontage = MontageToPlay;
-    bMontageStarted = true;
+    // Keep track of the active montage and listen for the end of this montage instance
+    UnbindMontageEndDelegate(*Memory);
+    Memory->ActiveMontage = MontageToPlay;
+    Memory->ActiveAnimInstance = AnimInstance;
+    Memory->bMontageStarted = true;
+    BindMontageEndDelegate(AnimInstance, MontageToPlay, Memory);
     
     // Store the montage length in the execution context if desired
     if (bStoreMontageLength && MontageLengthKey != NAME_None)
@@ -119,7 +122,7 @@ EHTNTaskStatus UHTNPlayMontageTask::ExecuteTask_Implementation(UHTNExecutionCont
     // If we're not waiting for completion, succeed immediately
     if (!bWaitForCompletion)
     {
-        bMontageCompleted = true;
+        Memory->bMontageCompleted = true;
         return EHTNTaskStatus::Succeeded;
     }
 
@@ -127,16 +130,23 @@ EHTNTaskStatus UHTNPlayMontageTask::ExecuteTask_Implementation(UHTNExecutionCont
     return EHTNTaskStatus::InProgress;
 }
 
-EHTNTaskStatus UHTNPlayMontageTask::TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime)
+EHTNTaskStatus UHTNPlayMontageTask::TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime) const
 {
-    // Check if the montage has completed - this could be set by the OnMontageEnded delegate
-    if (bMontageCompleted)
+    FHTNPlayMontageTaskMemory* Memory = ExecutionContext ? ExecutionContext->GetTaskMemory<FHTNPlayMontageTaskMemory>() : nullptr;
+    if (!Memory)
+    {
+        UE_LOG(LogHTNPlannerPlugin, Warning, TEXT("PlayMontageTask: No instance memory during tick"));
+        return EHTNTaskStatus::Failed;
+    }
+
+    // Check if the montage has completed - this could be set by the montage end delegate
+    if (Memory->bMontageCompleted)
     {
         return EHTNTaskStatus::Succeeded;
     }
 
     // If the montage hasn't started or we're not waiting for completion, nothing to tick
-    if (!bMontageStarted || !bWaitForCompletion)
+    if (!Memory->bMontageStarted || !bWaitForCompletion)
     {
         return EHTNTaskStatus::InProgress;
     }
@@ -158,10 +168,11 @@ EHTNTaskStatus UHTNPlayMontageTask::TickTask_Implementation(UHTNExecutionContext
     }
 
     // Check if the montage is still playing - this is a fallback in case the delegate doesn't fire
-    if (ActiveMontage && !AnimInstance->Montage_IsPlaying(ActiveMontage))
+    UAnimMontage* ActiveMontage = Memory->ActiveMontage.Get();
+    if (!ActiveMontage || !AnimInstance->Montage_IsPlaying(ActiveMontage))
     {
         // Montage is no longer playing
-        bMontageCompleted = true;
+        Memory->bMontageCompleted = true;
         
         // Apply effects if notifying on animation complete
         if (bNotifyAnimationComplete)
@@ -176,37 +187,33 @@ EHTNTaskStatus UHTNPlayMontageTask::TickTask_Implementation(UHTNExecutionContext
     return EHTNTaskStatus::InProgress;
 }
 
-void UHTNPlayMontageTask::EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus)
+void UHTNPlayMontageTask::EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus) const
 {
     Super::EndTask_Implementation(ExecutionContext, FinalStatus);
 
-    // Get the actor
-    AActor* TargetActor = ExecutionContext ? ExecutionContext->GetOwner() : nullptr;
-    if (TargetActor)
+    FHTNPlayMontageTaskMemory* Memory = ExecutionContext ? ExecutionContext->GetTaskMemory<FHTNPlayMontageTaskMemory>() : nullptr;
+    if (!Memory)
     {
-        // Get the anim instance
-        UAnimInstance* AnimInstance = GetAnimInstance(TargetActor);
-        if (AnimInstance)
-        {
-            // Clean up the delegate
-            UnregisterMontageEndDelegate(AnimInstance);
-
-            // If the montage is still playing and the task is ending, stop it
-            if (bMontageStarted && !bMontageCompleted)
-            {
-                // If we know the montage, stop it
-                if (!bUseMontageFromWorldState && Montage)
-                {
-                    AnimInstance->Montage_Stop(BlendOutTime, Montage);
-                }
-            }
-        }
+        return;
+    }
+
+    // Use the anim instance the montage was started on, even if the owner's mesh changed since
+    UAnimInstance* AnimInstance = Memory->ActiveAnimInstance.Get();
+    UAnimMontage* ActiveMontage = Memory->ActiveMontage.Get();
+
+    // Clean up the delegate before stopping, so a delayed blend out can't reach released memory
+    UnbindMontageEndDelegate(*Memory);
+
+    // If the montage is still playing and the task is ending, stop it
+    if (AnimInstance && ActiveMontage && Memory->bMontageStarted && !Memory->bMontageCompleted)
+    {
+        AnimInstance->Montage_Stop(BlendOutTime, ActiveMontage);
     }
 
     // Reset state
-    bMontageStarted = false;
-    bMontageCompleted = false;
-    ActiveMontage = nullptr;
+    Memory->bMontageStarted = false;
+    Memory->bMontageCompleted = false;
+    Memory->ActiveMontage.Reset();
 }
 
 bool UHTNPlayMontageTask::IsApplicable(const UHTNWorldState* WorldState) const
@@ -248,6 +255,25 @@ bool UHTNPlayMontageTask::IsApplicable(const UHTNWorldState* WorldState) const
     return GetAnimInstance(TargetActor) != nullptr;
 }
 
+uint16 UHTNPlayMontageTask::GetInstanceMemorySize() const
+{
+    return sizeof(FHTNPlayMontageTaskMemory);
+}
+
+void UHTNPlayMontageTask::InitializeMemory(uint8* NodeMemory) const
+{
+    new (NodeMemory) FHTNPlayMontageTaskMemory();
+}
+
+void UHTNPlayMontageTask::CleanupMemory(uint8* NodeMemory) const
+{
+    FHTNPlayMontageTaskMemory* Memory = CastInstanceMemory<FHTNPlayMontageTaskMemory>(NodeMemory);
+
+    // The end delegate captures this memory, so it must not outlive it
+    UnbindMontageEndDelegate(*Memory);
+    Memory->~FHTNPlayMontageTaskMemory();
+}
+
 bool UHTNPlayMontageTask::ValidateTask_Implementation() const
 {
     // Check base validation
@@ -317,33 +343,41 @@ UAnimInstance* UHTNPlayMontageTask::GetAnimInstance(const AActor* TargetActor) c
     return nullptr;
 }
 
-void UHTNPlayMontageTask::RegisterMontageEndDelegate(UAnimInstance* AnimInstance)
+void UHTNPlayMontageTask::BindMontageEndDelegate(UAnimInstance* AnimInstance, UAnimMontage* InMontage, FHTNPlayMontageTaskMemory* Memory) const
 {
-    if (AnimInstance)
+    if (!AnimInstance || !InMontage)
     {
-        AnimInstance->OnMontageEnded.AddDynamic(this, &UHTNPlayMontageTask::OnMontageEnded);
+        return;
     }
-}
 
-void UHTNPlayMontageTask::UnregisterMontageEndDelegate(UAnimInstance* AnimInstance)
-{
-    if (AnimInstance)
+    // Bind to this montage instance rather than the anim instance's global event,
+    // so the callback only ever sees the agent that started it
+    FOnMontageEnded EndDelegate;
+    EndDelegate.BindWeakLambda(AnimInstance, [Memory](UAnimMontage* EndedMontage, bool bInterrupted)
     {
-        AnimInstance->OnMontageEnded.RemoveDynamic(this, &UHTNPlayMontageTask::OnMontageEnded);
-    }
+        if (Memory->bMontageStarted && !Memory->bMontageCompleted)
+        {
+            Memory->bMontageCompleted = true;
+
+            UE_LOG(LogHTNPlannerPlugin, Verbose, TEXT("PlayMontageTask: Montage %s completed (interrupted: %s)"), 
+                EndedMontage ? *EndedMontage->GetName() : TEXT("None"), bInterrupted ? TEXT("true") : TEXT("false"));
+
+            // The task will complete on the next tick, which will handle task status transitions
+        }
+    });
+    AnimInstance->Montage_SetEndDelegate(EndDelegate, InMontage);
 }
 
-void UHTNPlayMontageTask::OnMontageEnded(UAnimMontage* InMontage, bool bInterrupted)
+void UHTNPlayMontageTask::UnbindMontageEndDelegate(FHTNPlayMontageTaskMemory& Memory)
 {
-    // Check if this is the montage we care about
-    if ((bUseMontageFromWorldState || InMontage == Montage || InMontage == ActiveMontage) && 
-        bMontageStarted && !bMontageCompleted)
+    UAnimInstance* AnimInstance = Memory.ActiveAnimInstance.Get();
+    UAnimMontage* ActiveMontage = Memory.ActiveMontage.Get();
+    if (AnimInstance && ActiveMontage)
     {
-        bMontageCompleted = true;
-        
-        UE_LOG(LogHTNPlannerPlugin, Verbose, TEXT("PlayMontageTask: Montage %s completed (interrupted: %s)"), 
-            *InMontage->GetName(), bInterrupted ? TEXT("true") : TEXT("false"));
-        
-        // The task will complete on the next tick, which will handle task status transitions
+        if (FOnMontageEnded* EndDelegate = AnimInstance->Montage_GetEndedDelegate(ActiveMontage))
+        {
+            EndDelegate->Unbind();
+        }
     }
-}
\ No newline at end of file
+    Memory.ActiveAnimInstance.Reset();
+}
@@ -7,10 +7,8 @@
 
 UHTNPrimitiveTask::UHTNPrimitiveTask()
     : Super()
-    , Status(EHTNTaskStatus::Invalid)
-    , ExecutionStartTime(0.0f)
     , MaxExecutionTime(0.0f)
-    , bIsExecuting(false)
+    , bThreadSafeTick(false)
 {
 }
 
@@ -21,37 +19,55 @@ void UHTNPrimitiveTask::PostInitProperties()
     // Initialize any properties specific to primitive tasks
 }
 
-bool UHTNPrimitiveTask::IsApplicable(const UHTNWorldState* WorldState) const
+void UHTNPrimitiveTask::PostLoad()
 {
-    // Check all preconditions
-    for (const UHTNCondition* Condition : Preconditions)
+    Super::PostLoad();
+
+    CompilePreconditions();
+}
+
+#if WITH_EDITOR
+void UHTNPrimitiveTask::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+    Super::PostEditChangeProperty(PropertyChangedEvent);
+
+    // Edits to the conditions themselves report the owning array as the member property
+    if (PropertyChangedEvent.GetMemberPropertyName() == GET_MEMBER_NAME_CHECKED(UHTNPrimitiveTask, Preconditions))
     {
-        if (IsValid(Condition) && !Condition->CheckCondition(WorldState))
-        {
-            // If any precondition fails, the task is not applicable
-            return false;
-        }
+        CompilePreconditions();
     }
+}
+#endif
 
-    // If there are no preconditions or all preconditions pass, the task is applicable
-    return true;
+void UHTNPrimitiveTask::CompilePreconditions()
+{
+    PreconditionMask.Compile(Preconditions);
+}
+
+bool UHTNPrimitiveTask::IsApplicable(const UHTNWorldState* WorldState) const
+{
+    // Boolean preconditions are checked together as bit masks, the rest one by one
+    return PreconditionMask.CheckConditions(Preconditions, WorldState);
 }
 
 UHTNWorldState* UHTNPrimitiveTask::GetExpectedEffects(const UHTNWorldState* WorldState) const
 {
     // Create a copy of the world state to represent the expected effects
     UHTNWorldState* OutEffects = WorldState->Clone();
+    ApplyExpectedEffects(OutEffects);
+    return OutEffects;
+}
 
+void UHTNPrimitiveTask::ApplyExpectedEffects(UHTNWorldState* WorldState) const
+{
     // Apply all effects
     for (const UHTNEffect* Effect : Effects)
     {
         if (Effect)
         {
-            Effect->ApplyEffect(OutEffects);
+            Effect->ApplyEffect(WorldState);
         }
     }
-
-    return OutEffects;
 }
 
 bool UHTNPrimitiveTask::Decompose(const UHTNWorldState* WorldState, TArray<UHTNPrimitiveTask*>& OutTasks)
@@ -61,12 +77,17 @@ bool UHTNPrimitiveTask::Decompose(const UHTNWorldState* WorldState, TArray<UHTNP
     return true;
 }
 
-bool UHTNPrimitiveTask::Execute(UHTNExecutionContext* ExecutionContext)
+bool UHTNPrimitiveTask::Execute(UHTNExecutionContext* ExecutionContext, uint8* NodeMemory) const
 {
-    ActiveExecutionContext = ExecutionContext;
+    FHTNPrimitiveTaskMemory* Memory = CastInstanceMemory<FHTNPrimitiveTaskMemory>(NodeMemory);
+    if (!Memory || !ExecutionContext)
+    {
+        UE_LOG(LogHTNTask, Warning, TEXT("Task executed without instance memory or context: %s"), *ToString());
+        return false;
+    }
     
     // Can't execute if already executing
-    if (bIsExecuting)
+    if (Memory->bIsExecuting)
     {
         UE_LOG(LogHTNTask, Warning, TEXT("Task is already executing: %s"), *ToString());
         return false;
@@ -76,76 +97,163 @@ bool UHTNPrimitiveTask::Execute(UHTNExecutionContext* ExecutionContext)
     if (!IsApplicable(ExecutionContext->GetWorldState()))
     {
         UE_LOG(LogHTNTask, Warning, TEXT("Task is not applicable in the current world state: %s"), *ToString());
-        SetStatus(EHTNTaskStatus::Failed);
+        SetStatus(NodeMemory, EHTNTaskStatus::Failed);
         return false;
     }
 
     // Start execution
-    bIsExecuting = true;
-    ExecutionStartTime = FPlatformTime::Seconds();
-    SetStatus(EHTNTaskStatus::InProgress);
-
-    // Broadcast task started event
-    BroadcastTaskEvent(Status);
+    Memory->bIsExecuting = true;
+    Memory->ExecutionStartTime = FPlatformTime::Seconds();
+    SetStatus(NodeMemory, EHTNTaskStatus::InProgress);
 
     // Execute the task and get its initial status
-    EHTNTaskStatus InitialStatus = ExecuteTask(ExecutionContext);
+    EHTNTaskStatus InitialStatus;
+    {
+        FHTNTaskMemoryScope MemoryScope(ExecutionContext, NodeMemory);
+        InitialStatus = ExecuteTask(ExecutionContext);
+    }
     
     // If the task completed immediately, update the status
     if (InitialStatus != EHTNTaskStatus::InProgress)
     {
-        SetStatus(InitialStatus);
+        SetStatus(NodeMemory, InitialStatus);
         
         // End the task if it completed immediately
-        EndTask(ExecutionContext, InitialStatus);
-        bIsExecuting = false;
+        Finish(ExecutionContext, NodeMemory, InitialStatus);
     }
 
     return true;
 }
 
-bool UHTNPrimitiveTask::IsComplete() const
+EHTNTaskStatus UHTNPrimitiveTask::Tick(UHTNExecutionContext* ExecutionContext, uint8* NodeMemory, float DeltaTime) const
+{
+    FHTNPrimitiveTaskMemory* Memory = CastInstanceMemory<FHTNPrimitiveTaskMemory>(NodeMemory);
+    if (!Memory || !Memory->bIsExecuting)
+    {
+        return Memory ? Memory->Status : EHTNTaskStatus::Invalid;
+    }
+
+    EHTNTaskStatus NewStatus;
+    if (bThreadSafeTick)
+    {
+        NewStatus = TickTaskThreadSafe(ExecutionContext ? ExecutionContext->GetWorldState() : nullptr, NodeMemory, DeltaTime);
+    }
+    else
+    {
+        FHTNTaskMemoryScope MemoryScope(ExecutionContext, NodeMemory);
+        NewStatus = TickTask(ExecutionContext, DeltaTime);
+    }
+
+    SetStatus(NodeMemory, NewStatus);
+    return NewStatus;
+}
+
+void UHTNPrimitiveTask::Finish(UHTNExecutionContext* ExecutionContext, uint8* NodeMemory, EHTNTaskStatus FinalStatus) const
+{
+    FHTNPrimitiveTaskMemory* Memory = CastInstanceMemory<FHTNPrimitiveTaskMemory>(NodeMemory);
+    if (!Memory || !Memory->bIsExecuting)
+    {
+        return;
+    }
+
+    {
+        FHTNTaskMemoryScope MemoryScope(ExecutionContext, NodeMemory);
+        EndTask(ExecutionContext, FinalStatus);
+    }
+
+    // End the execution
+    Memory->bIsExecuting = false;
+    SetStatus(NodeMemory, FinalStatus);
+}
+
+bool UHTNPrimitiveTask::IsComplete(const uint8* NodeMemory) const
 {
     // The task is complete if it's not in progress
-    return Status != EHTNTaskStatus::InProgress;
+    return GetStatus(NodeMemory) != EHTNTaskStatus::InProgress;
+}
+
+EHTNTaskStatus UHTNPrimitiveTask::GetStatus(const uint8* NodeMemory) const
+{
+    const FHTNPrimitiveTaskMemory* Memory = CastInstanceMemory<FHTNPrimitiveTaskMemory>(NodeMemory);
+    return Memory ? Memory->Status : EHTNTaskStatus::Invalid;
+}
+
+uint16 UHTNPrimitiveTask::GetInstanceMemorySize() const
+{
+    return sizeof(FHTNPrimitiveTaskMemory);
 }
 
-EHTNTaskStatus UHTNPrimitiveTask::GetStatus() const
+void UHTNPrimitiveTask::InitializeMemory(uint8* NodeMemory) const
 {
-    return Status;
+    new (NodeMemory) FHTNPrimitiveTaskMemory();
 }
 
-EHTNTaskStatus UHTNPrimitiveTask::ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext)
+void UHTNPrimitiveTask::CleanupMemory(uint8* NodeMemory) const
+{
+    CastInstanceMemory<FHTNPrimitiveTaskMemory>(NodeMemory)->~FHTNPrimitiveTaskMemory();
+}
+
+EHTNTaskStatus UHTNPrimitiveTask::ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) const
 {
     // Base implementation does nothing and succeeds immediately
     UE_LOG(LogHTNTask, Verbose, TEXT("ExecuteTask not implemented for primitive task: %s - using default success behavior"), *ToString());
     return EHTNTaskStatus::Succeeded;
 }
 
-EHTNTaskStatus UHTNPrimitiveTask::TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime)
+EHTNTaskStatus UHTNPrimitiveTask::TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime) const
 {
+    const FHTNPrimitiveTaskMemory* Memory = ExecutionContext ? ExecutionContext->GetTaskMemory<FHTNPrimitiveTaskMemory>() : nullptr;
+    if (!Memory)
+    {
+        return EHTNTaskStatus::Failed;
+    }
+
     // Check for execution timeout if one is set
-    if (MaxExecutionTime > 0.0f)
+    if (HasExecutionTimedOut(*Memory))
     {
-        float CurrentTime = FPlatformTime::Seconds();
-        float ElapsedTime = CurrentTime - ExecutionStartTime;
-        
-        if (ElapsedTime > MaxExecutionTime)
-        {
-            UE_LOG(LogHTNTask, Warning, TEXT("Task execution timed out: %s (%.2fs > %.2fs)"), 
-                *ToString(), ElapsedTime, MaxExecutionTime);
-            return EHTNTaskStatus::Failed;
-        }
+        return EHTNTaskStatus::Failed;
     }
     
-    return Status;
+    return Memory->Status;
 }
 
-void UHTNPrimitiveTask::EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus)
+EHTNTaskStatus UHTNPrimitiveTask::TickTaskThreadSafe(const UHTNWorldState* WorldState, uint8* NodeMemory, float DeltaTime) const
 {
-    //End the execution
-    bIsExecuting = false;
+    const FHTNPrimitiveTaskMemory* Memory = CastInstanceMemory<FHTNPrimitiveTaskMemory>(NodeMemory);
+    if (!Memory)
+    {
+        return EHTNTaskStatus::Failed;
+    }
+
+    // Base implementation only enforces the execution timeout
+    if (HasExecutionTimedOut(*Memory))
+    {
+        return EHTNTaskStatus::Failed;
+    }
     
+    return Memory->Status;
+}
+
+bool UHTNPrimitiveTask::HasExecutionTimedOut(const FHTNPrimitiveTaskMemory& Memory) const
+{
+    if (MaxExecutionTime <= 0.0f)
+    {
+        return false;
+    }
+
+    const float ElapsedTime = static_cast<float>(FPlatformTime::Seconds() - Memory.ExecutionStartTime);
+    if (ElapsedTime > MaxExecutionTime)
+    {
+        UE_LOG(LogHTNTask, Warning, TEXT("Task execution timed out: %s (%.2fs > %.2fs)"), 
+            *ToString(), ElapsedTime, MaxExecutionTime);
+        return true;
+    }
+
+    return false;
+}
+
+void UHTNPrimitiveTask::EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus) const
+{
     // If the task succeeded, apply its effects to the world state
     if (FinalStatus == EHTNTaskStatus::Succeeded)
     {
@@ -153,26 +261,27 @@ void UHTNPrimitiveTask::EndTask_Implementation(UHTNExecutionContext* ExecutionCo
     }
 }
 
-void UHTNPrimitiveTask::AbortTask(UHTNExecutionContext* ExecutionContext)
+void UHTNPrimitiveTask::AbortTask(UHTNExecutionContext* ExecutionContext, uint8* NodeMemory) const
 {
+    const FHTNPrimitiveTaskMemory* Memory = CastInstanceMemory<FHTNPrimitiveTaskMemory>(NodeMemory);
+    
     // Only abort if the task is executing
-    if (bIsExecuting)
+    if (Memory && Memory->bIsExecuting)
     {
         UE_LOG(LogHTNTask, Verbose, TEXT("Aborting task: %s"), *ToString());
         
-        // Set status to failed
-        SetStatus(EHTNTaskStatus::Failed);
-        
-        // End the task
-        EndTask(nullptr, EHTNTaskStatus::Failed);
-        
-        // Update execution state
-        bIsExecuting = false;
+        // End the task as failed
+        Finish(ExecutionContext, NodeMemory, EHTNTaskStatus::Failed);
     }
 }
 
 void UHTNPrimitiveTask::ApplyEffects(UHTNExecutionContext* ExecutionContext) const
 {
+    if (!ExecutionContext)
+    {
+        return;
+    }
+    
     // Apply all effects to the world state
     for (const UHTNEffect* Effect : Effects)
     {
@@ -183,16 +292,54 @@ void UHTNPrimitiveTask::ApplyEffects(UHTNExecutionContext* ExecutionContext) con
     }
 }
 
-void UHTNPrimitiveTask::SetStatus(EHTNTaskStatus NewStatus)
+bool UHTNPrimitiveTask::GetPreconditionReadKeys(TArray<FName>& OutKeys) const
+{
+    bool bAllKeysKnown = true;
+    for (const UHTNCondition* Condition : Preconditions)
+    {
+        if (Condition && !Condition->GetReadKeys(OutKeys))
+        {
+            bAllKeysKnown = false;
+        }
+    }
+    return bAllKeysKnown;
+}
+
+bool UHTNPrimitiveTask::GetEffectWriteKeys(TArray<FName>& OutKeys) const
+{
+    bool bAllKeysKnown = true;
+    for (const UHTNEffect* Effect : Effects)
+    {
+        if (Effect && !Effect->GetWriteKeys(OutKeys))
+        {
+            bAllKeysKnown = false;
+        }
+    }
+    return bAllKeysKnown;
+}
+
+bool UHTNPrimitiveTask::GetEffectReadKeys(TArray<FName>& OutKeys) const
 {
+    bool bAllKeysKnown = true;
+    for (const UHTNEffect* Effect : Effects)
+    {
+        if (Effect && !Effect->GetReadKeys(OutKeys))
+        {
+            bAllKeysKnown = false;
+        }
+    }
+    return bAllKeysKnown;
+}
+
+void UHTNPrimitiveTask::SetStatus(uint8* NodeMemory, EHTNTaskStatus NewStatus) const
+{
+    FHTNPrimitiveTaskMemory* Memory = CastInstanceMemory<FHTNPrimitiveTaskMemory>(NodeMemory);
+    
     // Only update if the status has changed
-    if (Status != NewStatus)
+    if (Memory && Memory->Status != NewStatus)
     {
-        EHTNTaskStatus OldStatus = Status;
-        Status = NewStatus;
-        
-        // Broadcast the appropriate event based on the new status
-        BroadcastTaskEvent(NewStatus);
+        EHTNTaskStatus OldStatus = Memory->Status;
+        Memory->Status = NewStatus;
         
         UE_LOG(LogHTNTask, Verbose, TEXT("Task status changed: %s -> %s for task %s"),
             *StaticEnum<EHTNTaskStatus>()->GetNameStringByValue((int64)OldStatus),
@@ -201,6 +348,50 @@ void UHTNPrimitiveTask::SetStatus(EHTNTaskStatus NewStatus)
     }
 }
 
+namespace HTNPrimitiveTaskDeprecation
+{
+    /** Get the instance memory bound to a context for the deprecated Blueprint functions, warning if there is none */
+    uint8* GetBoundTaskMemory(const UHTNPrimitiveTask* Task, const UHTNExecutionContext* ExecutionContext)
+    {
+        uint8* NodeMemory = ExecutionContext ? ExecutionContext->GetActiveTaskMemory() : nullptr;
+        if (!NodeMemory)
+        {
+            UE_LOG(LogHTNTask, Warning, TEXT("Deprecated task function called outside of a task event, or without its execution context: %s"), *Task->ToString());
+        }
+        return NodeMemory;
+    }
+}
+
+bool UHTNPrimitiveTask::K2_Execute(UHTNExecutionContext* ExecutionContext)
+{
+    uint8* NodeMemory = HTNPrimitiveTaskDeprecation::GetBoundTaskMemory(this, ExecutionContext);
+    return NodeMemory && Execute(ExecutionContext, NodeMemory);
+}
+
+bool UHTNPrimitiveTask::K2_IsComplete(UHTNExecutionContext* ExecutionContext) const
+{
+    const uint8* NodeMemory = HTNPrimitiveTaskDeprecation::GetBoundTaskMemory(this, ExecutionContext);
+    return NodeMemory && IsComplete(NodeMemory);
+}
+
+EHTNTaskStatus UHTNPrimitiveTask::K2_GetStatus(UHTNExecutionContext* ExecutionContext) const
+{
+    return GetStatus(HTNPrimitiveTaskDeprecation::GetBoundTaskMemory(this, ExecutionContext));
+}
+
+void UHTNPrimitiveTask::K2_SetStatus(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus NewStatus)
+{
+    SetStatus(HTNPrimitiveTaskDeprecation::GetBoundTaskMemory(this, ExecutionContext), NewStatus);
+}
+
+void UHTNPrimitiveTask::K2_AbortTask(UHTNExecutionContext* ExecutionContext)
+{
+    if (uint8* NodeMemory = HTNPrimitiveTaskDeprecation::GetBoundTaskMemory(this, ExecutionContext))
+    {
+        AbortTask(ExecutionContext, NodeMemory);
+    }
+}
+
 bool UHTNPrimitiveTask::ValidateTask_Implementation() const
 {
     // First validate the base task
@@ -229,23 +420,4 @@ bool UHTNPrimitiveTask::ValidateTask_Implementation() const
     }
     
     return true;
-}
-
-void UHTNPrimitiveTask::BroadcastTaskEvent(EHTNTaskStatus NewStatus)
-{
-    switch (NewStatus)
-    {
-    case EHTNTaskStatus::InProgress:
-        OnTaskStarted.Broadcast(this);
-        break;
-    case EHTNTaskStatus::Succeeded:
-        OnTaskSucceeded.Broadcast(this);
-        break;
-    case EHTNTaskStatus::Failed:
-        OnTaskFailed.Broadcast(this);
-        break;
-    default:
-        // No broadcast for other statuses
-        break;
-    }
 }
\ No newline at end of file
@@ -15,7 +15,7 @@ UHTNPrintLogTask::UHTNPrintLogTask()
     DebugColor = FLinearColor(0.5f, 0.5f, 0.5f); // Gray for debug tasks
 }
 
-EHTNTaskStatus UHTNPrintLogTask::ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext)
+EHTNTaskStatus UHTNPrintLogTask::ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) const
 {
     if (!ExecutionContext || !ExecutionContext->GetWorldState())
     {
@@ -0,0 +1,111 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HTNComponent.h"
+#include "HTNWorldStateStruct.h"
+#include "Tests/HTNTestConditions.h"
+#include "Tests/HTNTestTasks.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHTNComponentTest, "HTNPlanner.Component", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHTNComponentTest::RunTest(const FString& Parameters)
+{
+	AddExpectedError(TEXT("Plan generation failed"), EAutomationExpectedErrorFlags::Contains, 0);
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	AActor* Actor = World->SpawnActor<AActor>();
+	UHTNComponent* Component = Actor ? NewObject<UHTNComponent>(Actor) : nullptr;
+	if (!TestNotNull("The component is created", Component))
+	{
+		World->DestroyWorld(false);
+		return false;
+	}
+	Component->RegisterComponent();
+	Actor->DispatchBeginPlay();
+	UHTNWorldState* WorldState = Component->GetWorldState();
+
+	// Open the door once it is unlocked
+	UHTNTestLatentTask* OpenDoor = NewObject<UHTNTestLatentTask>();
+	OpenDoor->NumTicksToFinish = 100;
+	UHTNTestCountingCondition* DoorUnlocked = NewObject<UHTNTestCountingCondition>(OpenDoor);
+	DoorUnlocked->PropertyKey = FName("DoorUnlocked");
+	DoorUnlocked->CheckType = EHTNPropertyCheckType::IsTrue;
+	OpenDoor->Preconditions = { DoorUnlocked };
+	const TArray<UHTNTask*> GoalTasks = { OpenDoor };
+
+	auto GetBackoffDelay = [World, Component]()
+	{
+		return Component->GetNextReplanTime() - World->GetTimeSeconds();
+	};
+
+	// Test backing off automatic replanning after failed planning attempts
+	{
+		// The defaults start at half a second, double with every failure and stop at eight seconds
+		WorldState->SetPropertyValue(FName("DoorUnlocked"), false);
+		const TArray<float> ExpectedDelays = { 0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 8.0f };
+		for (int32 Attempt = 0; Attempt < ExpectedDelays.Num(); ++Attempt)
+		{
+			WorldState->SetPropertyValue(FName("Attempt"), Attempt);
+			TestFalse("Planning fails while the door is locked", Component->GeneratePlan(GoalTasks));
+			TestEqual(FString::Printf(TEXT("Failure %d backs off by the expected delay"), Attempt + 1), GetBackoffDelay(), ExpectedDelays[Attempt], KINDA_SMALL_NUMBER);
+		}
+
+		WorldState->SetPropertyValue(FName("DoorUnlocked"), true);
+		TestTrue("Planning succeeds once the door is unlocked", Component->GeneratePlan(GoalTasks));
+		TestEqual("Success resets the backoff", Component->GetNextReplanTime(), 0.0f);
+
+		// Ticking subscribes to the keys the goals read
+		Component->TickComponent(0.1f, LEVELTICK_All, nullptr);
+		WorldState->SetPropertyValue(FName("DoorUnlocked"), false);
+		Component->GeneratePlan(GoalTasks);
+		Component->GeneratePlan(GoalTasks);
+		TestEqual("Failures after a success back off from the first delay again", GetBackoffDelay(), 1.0f, KINDA_SMALL_NUMBER);
+
+		WorldState->SetPropertyValue(FName("Attempt"), 100);
+		TestEqual("Keys the goals don't read keep the backoff", GetBackoffDelay(), 1.0f, KINDA_SMALL_NUMBER);
+		WorldState->SetPropertyValue(FName("DoorUnlocked"), true);
+		TestEqual("A change to a key the goals read resets the backoff", Component->GetNextReplanTime(), 0.0f);
+		Component->AbortPlan(false);
+	}
+
+	// Test skipping requests that failed before
+	{
+		WorldState->SetPropertyValue(FName("DoorUnlocked"), false);
+		WorldState->SetPropertyValue(FName("Visit"), 0);
+		const int32 NumChecksBefore = DoorUnlocked->NumChecks;
+		TestFalse("Planning fails while the door is locked", Component->GeneratePlan(GoalTasks));
+		int32 NumChecks = DoorUnlocked->NumChecks;
+		TestTrue("A new request searches", NumChecks > NumChecksBefore);
+		TestFalse("A request that failed before fails again", Component->GeneratePlan(GoalTasks));
+		TestEqual("A request that failed before fails without searching", DoorUnlocked->NumChecks, NumChecks);
+
+		WorldState->SetPropertyValue(FName("Visit"), 1);
+		Component->GeneratePlan(GoalTasks);
+		TestTrue("A changed world state is searched again", DoorUnlocked->NumChecks > NumChecks);
+
+		// The cache remembers the last 16 requests by default, so these push out the first request of this test
+		for (int32 Visit = 2; Visit <= 16; ++Visit)
+		{
+			WorldState->SetPropertyValue(FName("Visit"), Visit);
+			Component->GeneratePlan(GoalTasks);
+		}
+		NumChecks = DoorUnlocked->NumChecks;
+		Component->GeneratePlan(GoalTasks);
+		TestEqual("Recent failures stay cached", DoorUnlocked->NumChecks, NumChecks);
+
+		WorldState->SetPropertyValue(FName("Visit"), 0);
+		Component->GeneratePlan(GoalTasks);
+		TestTrue("The oldest failure is dropped once the cache is full", DoorUnlocked->NumChecks > NumChecks);
+	}
+
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
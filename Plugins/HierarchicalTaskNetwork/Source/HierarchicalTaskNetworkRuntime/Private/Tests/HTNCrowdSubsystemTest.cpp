@@ -0,0 +1,227 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+#include "Conditions/HTNPropertyCondition.h"
+#include "Effects/HTNSetPropertyEffect.h"
+#include "Engine/World.h"
+#include "HTNCrowdSubsystem.h"
+#include "HTNMethod.h"
+#include "HTNWorldStateStruct.h"
+#include "Tasks/HTNCompoundTask.h"
+#include "Tests/HTNTestTasks.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHTNCrowdSubsystemTest, "HTNPlanner.Crowd", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHTNCrowdSubsystemTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	UHTNCrowdSubsystem* Crowd = World->GetSubsystem<UHTNCrowdSubsystem>();
+	if (!TestNotNull("The world has a crowd subsystem", Crowd))
+	{
+		World->DestroyWorld(false);
+		return false;
+	}
+
+	// Root -> [Eat] if Hungry, else [Wander]
+	UHTNCompoundTask* Root = NewObject<UHTNCompoundTask>();
+	UHTNTestLatentTask* Eat = NewObject<UHTNTestLatentTask>();
+	UHTNTestLatentTask* Wander = NewObject<UHTNTestLatentTask>();
+	Eat->NumTicksToFinish = 100;
+	Wander->NumTicksToFinish = 100;
+	UHTNPropertyCondition* IsHungry = NewObject<UHTNPropertyCondition>();
+	IsHungry->PropertyKey = FName("Hungry");
+	IsHungry->CheckType = EHTNPropertyCheckType::IsTrue;
+	UHTNMethod* EatMethod = NewObject<UHTNMethod>(Root);
+	EatMethod->Priority = 2.0f;
+	EatMethod->Conditions.Add(IsHungry);
+	EatMethod->Subtasks = { Eat };
+	UHTNMethod* WanderMethod = NewObject<UHTNMethod>(Root);
+	WanderMethod->Priority = 1.0f;
+	WanderMethod->Subtasks = { Wander };
+	Root->Methods = { EatMethod, WanderMethod };
+	const int32 DomainIndex = Crowd->RegisterDomain({ Root });
+
+	UHTNWorldState* HungryState = NewObject<UHTNWorldState>();
+	HungryState->SetProperty(FName("Hungry"), FHTNProperty(true));
+	UHTNWorldState* FedState = NewObject<UHTNWorldState>();
+	FedState->SetProperty(FName("Hungry"), FHTNProperty(false));
+
+	// Test planning once per group of agents in the same situation
+	{
+		constexpr int32 NumAgentsPerGroup = 10;
+		TArray<FHTNCrowdAgentHandle> HungryAgents;
+		TArray<FHTNCrowdAgentHandle> FedAgents;
+		for (int32 AgentIndex = 0; AgentIndex < NumAgentsPerGroup; ++AgentIndex)
+		{
+			HungryAgents.Add(Crowd->AddAgent(DomainIndex, HungryState));
+			FedAgents.Add(Crowd->AddAgent(DomainIndex, FedState));
+		}
+
+		// Two planner runs are enough for two groups, whatever their size
+		Crowd->bBatchPlanning = true;
+		Crowd->MaxPlansPerTick = 2;
+		Crowd->Tick(0.1f);
+
+		bool bAllPlanned = true;
+		bool bGroupsShareTheirPlan = true;
+		const FHTNCrowdPlanFragment* HungryPlan = Crowd->GetPlan(HungryAgents[0]);
+		const FHTNCrowdPlanFragment* FedPlan = Crowd->GetPlan(FedAgents[0]);
+		for (int32 AgentIndex = 0; AgentIndex < NumAgentsPerGroup; ++AgentIndex)
+		{
+			const FHTNCrowdPlanFragment* Plan = Crowd->GetPlan(HungryAgents[AgentIndex]);
+			const FHTNCrowdPlanFragment* OtherPlan = Crowd->GetPlan(FedAgents[AgentIndex]);
+			bAllPlanned &= Plan && Plan->HasPlan() && OtherPlan && OtherPlan->HasPlan();
+			bGroupsShareTheirPlan &= Plan && OtherPlan && Plan->TaskIndices == HungryPlan->TaskIndices && OtherPlan->TaskIndices == FedPlan->TaskIndices;
+		}
+		TestTrue("Every agent of a group gets a plan from one planner run", bAllPlanned);
+		TestTrue("Agents get the plan of their own group", bGroupsShareTheirPlan && HungryPlan->TaskIndices != FedPlan->TaskIndices);
+		TestEqual("Every hungry agent eats", Eat->NumExecutions.GetValue(), NumAgentsPerGroup);
+		TestEqual("Every fed agent wanders", Wander->NumExecutions.GetValue(), NumAgentsPerGroup);
+
+		// A changed agent leaves its group and plans for its own situation
+		Crowd->GetWorldStates().SetProperty(FedAgents[0].Index, FName("Hungry"), FHTNProperty(true));
+		Crowd->ResetPlan(FedAgents[0]);
+		Crowd->Tick(0.1f);
+		TestTrue("Agents that changed plan for their new situation", Crowd->GetPlan(FedAgents[0])->TaskIndices == HungryPlan->TaskIndices);
+
+		for (const FHTNCrowdAgentHandle& Agent : HungryAgents)
+		{
+			Crowd->RemoveAgent(Agent);
+		}
+		for (const FHTNCrowdAgentHandle& Agent : FedAgents)
+		{
+			Crowd->RemoveAgent(Agent);
+		}
+		TestEqual("Agents are removed", Crowd->GetNumAgents(), 0);
+		TestFalse("Handles of removed agents are invalid", Crowd->IsValidAgent(HungryAgents[0]));
+	}
+
+	// Test that without batching, the budget counts agents
+	{
+		TArray<FHTNCrowdAgentHandle> Agents;
+		for (int32 AgentIndex = 0; AgentIndex < 6; ++AgentIndex)
+		{
+			Agents.Add(Crowd->AddAgent(DomainIndex, HungryState));
+		}
+
+		Crowd->bBatchPlanning = false;
+		Crowd->MaxPlansPerTick = 2;
+		Crowd->Tick(0.1f);
+		int32 NumPlanned = 0;
+		for (const FHTNCrowdAgentHandle& Agent : Agents)
+		{
+			NumPlanned += Crowd->GetPlan(Agent)->HasPlan() ? 1 : 0;
+		}
+		TestEqual("Agents are planned one at a time up to the budget", NumPlanned, 2);
+
+		for (const FHTNCrowdAgentHandle& Agent : Agents)
+		{
+			Crowd->RemoveAgent(Agent);
+		}
+	}
+
+	// Test that a failed step drops the plan and waits before planning again
+	{
+		Eat->FinishStatus = EHTNTaskStatus::Failed;
+		Eat->NumTicksToFinish = 1;
+		Eat->NumExecutions.Reset();
+		Crowd->bBatchPlanning = true;
+		Crowd->MaxPlansPerTick = 0;
+		Crowd->ReplanDelay = 10.0f;
+
+		const FHTNCrowdAgentHandle Agent = Crowd->AddAgent(DomainIndex, HungryState);
+		Crowd->Tick(0.1f);
+		Crowd->Tick(0.1f);
+		TestFalse("The failed step's plan is dropped", Crowd->GetPlan(Agent)->HasPlan());
+
+		Crowd->Tick(0.1f);
+		Crowd->Tick(0.1f);
+		TestEqual("The failed task is not retried before the delay", Eat->NumExecutions.GetValue(), 1);
+
+		Crowd->Tick(10.0f);
+		TestEqual("The agent plans again after the delay", Eat->NumExecutions.GetValue(), 2);
+		Crowd->RemoveAgent(Agent);
+	}
+
+	// Test that a step whose preconditions stopped holding after planning fails instead of starting
+	{
+		// DoorRoot -> [Approach, OpenDoor], where OpenDoor needs DoorUnlocked
+		UHTNCompoundTask* DoorRoot = NewObject<UHTNCompoundTask>();
+		UHTNTestLatentTask* Approach = NewObject<UHTNTestLatentTask>();
+		UHTNTestLatentTask* OpenDoor = NewObject<UHTNTestLatentTask>();
+		Approach->NumTicksToFinish = 1;
+		OpenDoor->NumTicksToFinish = 1;
+		UHTNPropertyCondition* DoorUnlocked = NewObject<UHTNPropertyCondition>(OpenDoor);
+		DoorUnlocked->PropertyKey = FName("DoorUnlocked");
+		DoorUnlocked->CheckType = EHTNPropertyCheckType::IsTrue;
+		OpenDoor->Preconditions.Add(DoorUnlocked);
+		OpenDoor->CompilePreconditions();
+		UHTNMethod* DoorMethod = NewObject<UHTNMethod>(DoorRoot);
+		DoorMethod->Subtasks = { Approach, OpenDoor };
+		DoorRoot->Methods = { DoorMethod };
+		const int32 DoorDomainIndex = Crowd->RegisterDomain({ DoorRoot });
+
+		UHTNWorldState* UnlockedState = NewObject<UHTNWorldState>();
+		UnlockedState->SetProperty(FName("DoorUnlocked"), FHTNProperty(true));
+		Crowd->ReplanDelay = 10.0f;
+		const FHTNCrowdAgentHandle Agent = Crowd->AddAgent(DoorDomainIndex, UnlockedState);
+		Crowd->Tick(0.1f);
+		TestTrue("The agent plans to open the door", Crowd->GetPlan(Agent)->HasPlan() && Crowd->GetPlan(Agent)->TaskIndices.Num() == 2);
+		TestEqual("The first step starts", Approach->NumExecutions.GetValue(), 1);
+
+		// The door is locked while the agent approaches it
+		Crowd->GetWorldStates().SetProperty(Agent.Index, FName("DoorUnlocked"), FHTNProperty(false));
+		Crowd->Tick(0.1f);
+		Crowd->Tick(0.1f);
+		TestEqual("The inapplicable step is not executed", OpenDoor->NumExecutions.GetValue(), 0);
+		TestFalse("The inapplicable step fails the plan", Crowd->GetPlan(Agent)->HasPlan());
+		Crowd->RemoveAgent(Agent);
+	}
+
+	// Test that agents differing only in a key an effect copies from are planned apart
+	{
+		// CopyRoot -> [Grab, Use], where Grab copies ToolCharged into HasTool and Use needs HasTool
+		UHTNCompoundTask* CopyRoot = NewObject<UHTNCompoundTask>();
+		UHTNTestLatentTask* Grab = NewObject<UHTNTestLatentTask>();
+		UHTNTestLatentTask* Use = NewObject<UHTNTestLatentTask>();
+		Grab->NumTicksToFinish = 100;
+		Use->NumTicksToFinish = 100;
+		UHTNSetPropertyEffect* CopyCharge = NewObject<UHTNSetPropertyEffect>(Grab);
+		CopyCharge->PropertyKey = FName("HasTool");
+		CopyCharge->bUseSourceProperty = true;
+		CopyCharge->SourcePropertyKey = FName("ToolCharged");
+		Grab->Effects.Add(CopyCharge);
+		UHTNPropertyCondition* HasTool = NewObject<UHTNPropertyCondition>(Use);
+		HasTool->PropertyKey = FName("HasTool");
+		HasTool->CheckType = EHTNPropertyCheckType::IsTrue;
+		Use->Preconditions.Add(HasTool);
+		UHTNMethod* CopyMethod = NewObject<UHTNMethod>(CopyRoot);
+		CopyMethod->Subtasks = { Grab, Use };
+		CopyRoot->Methods = { CopyMethod };
+		const int32 CopyDomainIndex = Crowd->RegisterDomain({ CopyRoot });
+
+		UHTNWorldState* ChargedState = NewObject<UHTNWorldState>();
+		ChargedState->SetProperty(FName("ToolCharged"), FHTNProperty(true));
+		UHTNWorldState* EmptyState = NewObject<UHTNWorldState>();
+		EmptyState->SetProperty(FName("ToolCharged"), FHTNProperty(false));
+
+		Crowd->bBatchPlanning = true;
+		Crowd->MaxPlansPerTick = 0;
+		const FHTNCrowdAgentHandle ChargedAgent = Crowd->AddAgent(CopyDomainIndex, ChargedState);
+		const FHTNCrowdAgentHandle EmptyAgent = Crowd->AddAgent(CopyDomainIndex, EmptyState);
+		Crowd->Tick(0.1f);
+		TestTrue("The agent whose copied key holds plans to use the tool", Crowd->GetPlan(ChargedAgent)->HasPlan());
+		TestFalse("The other agent doesn't share that plan", Crowd->GetPlan(EmptyAgent)->HasPlan());
+		Crowd->RemoveAgent(ChargedAgent);
+		Crowd->RemoveAgent(EmptyAgent);
+	}
+
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,109 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+#include "Conditions/HTNComparisonCondition.h"
+#include "Conditions/HTNCookedConditions.h"
+#include "Conditions/HTNPropertyCondition.h"
+#include "HTNDFSPlanner.h"
+#include "HTNDomainBlob.h"
+#include "HTNMethod.h"
+#include "HTNPlannerTrace.h"
+#include "HTNWorldStateStruct.h"
+#include "Tasks/HTNCompoundTask.h"
+#include "Tasks/HTNPrimitiveTask.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHTNDomainBlobTest, "HTNPlanner.DomainBlob", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHTNDomainBlobTest::RunTest(const FString& Parameters)
+{
+	// Root -> [Enter] if its preconditions hold, else [Walk]
+	UHTNCompoundTask* Root = NewObject<UHTNCompoundTask>();
+	UHTNPrimitiveTask* Enter = NewObject<UHTNPrimitiveTask>();
+	UHTNPrimitiveTask* Walk = NewObject<UHTNPrimitiveTask>();
+	Enter->TaskName = FName("Enter");
+	Walk->TaskName = FName("Walk");
+
+	// A property check, an object condition, then another property check
+	UHTNPropertyCondition* HasKey = NewObject<UHTNPropertyCondition>(Enter);
+	HasKey->PropertyKey = FName("HasKey");
+	HasKey->CheckType = EHTNPropertyCheckType::IsTrue;
+	UHTNComparisonCondition* IsAlive = NewObject<UHTNComparisonCondition>(Enter);
+	FindFProperty<FNameProperty>(UHTNComparisonCondition::StaticClass(), TEXT("LeftPropertyKey"))->SetPropertyValue_InContainer(IsAlive, FName("Health"));
+	UHTNPropertyCondition* DoorUnlocked = NewObject<UHTNPropertyCondition>(Enter);
+	DoorUnlocked->PropertyKey = FName("DoorUnlocked");
+	DoorUnlocked->CheckType = EHTNPropertyCheckType::IsTrue;
+	Enter->Preconditions = { HasKey, IsAlive, DoorUnlocked };
+
+	UHTNMethod* EnterMethod = NewObject<UHTNMethod>(Root);
+	EnterMethod->Priority = 2.0f;
+	EnterMethod->Subtasks = { Enter };
+	UHTNMethod* WalkMethod = NewObject<UHTNMethod>(Root);
+	WalkMethod->Priority = 1.0f;
+	WalkMethod->Subtasks = { Walk };
+	Root->Methods = { EnterMethod, WalkMethod };
+
+	// Test recreating a domain from its compiled blob
+	TArray<uint8> Data;
+	TestTrue("The domain compiles", FHTNDomainBlob::Compile({ Root }, Data));
+	const TSharedRef<FHTNDomainBlob, ESPMode::ThreadSafe> Blob = MakeShared<FHTNDomainBlob, ESPMode::ThreadSafe>();
+	TestTrue("The blob initializes", Blob->Initialize(MoveTemp(Data)));
+	TArray<UHTNTask*> CookedGoalTasks;
+	TestTrue("Every node is recreated", Blob->CreateTasks(GetTransientPackage(), CookedGoalTasks));
+
+	const UHTNCompoundTask* CookedRoot = CookedGoalTasks.Num() == 1 ? Cast<UHTNCompoundTask>(CookedGoalTasks[0]) : nullptr;
+	const bool bHasMethods = CookedRoot && CookedRoot->GetMethods().Num() == 2 && CookedRoot->GetMethods()[0]->GetSubtasks().Num() == 1;
+	if (!TestTrue("The hierarchy is recreated", bHasMethods))
+	{
+		return false;
+	}
+
+	const UHTNPrimitiveTask* CookedEnter = Cast<UHTNPrimitiveTask>(CookedRoot->GetMethods()[0]->GetSubtasks()[0]);
+	TestTrue("Tasks keep their properties", CookedEnter && CookedEnter->TaskName == FName("Enter"));
+	TestTrue("Conditions keep their authored order", CookedEnter && CookedEnter->Preconditions.Num() == 3
+		&& CookedEnter->Preconditions[0]->IsA<UHTNCookedConditions>()
+		&& CookedEnter->Preconditions[1]->IsA<UHTNComparisonCondition>()
+		&& CookedEnter->Preconditions[2]->IsA<UHTNCookedConditions>());
+
+	// Test that traces of a cooked domain number preconditions as authored
+	{
+		UHTNWorldState* WorldState = NewObject<UHTNWorldState>();
+		WorldState->SetPropertyValue(FName("HasKey"), true);
+		WorldState->SetPropertyValue(FName("Health"), 10);
+		WorldState->SetPropertyValue(FName("DoorUnlocked"), false);
+
+		FHTNPlanningConfig Config;
+		Config.bRecordTrace = true;
+		auto FindFailedCondition = [&Config, WorldState](UHTNTask* GoalTask, FString& OutDescription)
+		{
+			UHTNDFSPlanner* Planner = NewObject<UHTNDFSPlanner>();
+			Planner->GeneratePlan(WorldState, { GoalTask }, Config);
+			const FHTNPlannerTrace& Trace = Planner->GetTrace();
+			for (int32 EventIndex = 0; EventIndex < Trace.Num(); ++EventIndex)
+			{
+				if (Trace.GetEvent(EventIndex).Type == EHTNPlannerTraceEventType::ConditionFail)
+				{
+					OutDescription = Trace.DescribeEvent(Trace.GetEvent(EventIndex));
+					return Trace.GetEvent(EventIndex).Value;
+				}
+			}
+			return INDEX_NONE;
+		};
+
+		FString Description;
+		TestEqual("The authored domain traces the failed precondition", FindFailedCondition(Root, Description), 2);
+		FString CookedDescription;
+		TestEqual("The cooked domain traces the same precondition", FindFailedCondition(CookedGoalTasks[0], CookedDescription), 2);
+		TestTrue("The traced precondition is described on its own", CookedDescription.Contains(TEXT("precondition 2")) && CookedDescription.Contains(TEXT("DoorUnlocked")) && !CookedDescription.Contains(TEXT("HasKey")));
+
+		WorldState->SetPropertyValue(FName("Health"), 0);
+		TestEqual("Object conditions between property checks keep their index", FindFailedCondition(CookedGoalTasks[0], CookedDescription), 1);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
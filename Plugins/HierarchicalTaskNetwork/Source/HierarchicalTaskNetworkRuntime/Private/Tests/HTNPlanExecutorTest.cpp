@@ -0,0 +1,299 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+#include "Async/ParallelFor.h"
+#include "Conditions/HTNPropertyCondition.h"
+#include "Effects/HTNSetPropertyEffect.h"
+#include "Engine/World.h"
+#include "HTNExecutionContext.h"
+#include "HTNPlan.h"
+#include "HTNPlanExecutor.h"
+#include "HTNPlanExecutorManager.h"
+#include "HTNWorldStateStruct.h"
+#include "Tests/HTNTestTasks.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace HTNPlanExecutorTest
+{
+	/** Create an executor in a world, with its own world state and execution context */
+	UHTNPlanExecutor* MakeExecutor(UWorld* World, EHTNPlanExecutorMode ExecutionMode, UHTNExecutionContext*& OutExecutionContext)
+	{
+		UHTNPlanExecutor* Executor = NewObject<UHTNPlanExecutor>(World);
+		Executor->SetExecutionMode(ExecutionMode);
+		OutExecutionContext = NewObject<UHTNExecutionContext>(Executor);
+		OutExecutionContext->SetWorldState(NewObject<UHTNWorldState>(Executor));
+		return Executor;
+	}
+
+	/** Create a task that finishes after a number of ticks, requires the read keys to be true and sets the write keys to true */
+	UHTNTestLatentTask* MakeTask(int32 NumTicksToFinish, const TArray<FName>& ReadKeys, const TArray<FName>& WriteKeys)
+	{
+		UHTNTestLatentTask* Task = NewObject<UHTNTestLatentTask>();
+		Task->NumTicksToFinish = NumTicksToFinish;
+		for (const FName& Key : ReadKeys)
+		{
+			UHTNPropertyCondition* Condition = NewObject<UHTNPropertyCondition>(Task);
+			Condition->PropertyKey = Key;
+			Condition->CheckType = EHTNPropertyCheckType::IsTrue;
+			Task->Preconditions.Add(Condition);
+		}
+		for (const FName& Key : WriteKeys)
+		{
+			UHTNSetPropertyEffect* Effect = NewObject<UHTNSetPropertyEffect>(Task);
+			Effect->PropertyKey = Key;
+			Effect->PropertyValue = FHTNProperty(true);
+			Task->Effects.Add(Effect);
+		}
+		return Task;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHTNPlanExecutorTest, "HTNPlanner.PlanExecutor", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHTNPlanExecutorTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	UHTNPlanExecutorManager* Manager = World->GetSubsystem<UHTNPlanExecutorManager>();
+	if (!TestNotNull("The world has an executor manager", Manager))
+	{
+		World->DestroyWorld(false);
+		return false;
+	}
+
+	// Test batched thread-safe ticks across agents
+	{
+		// Enough agents for the manager to dispatch the ticks to worker threads
+		constexpr int32 NumAgents = 48;
+		UHTNTestLatentTask* Task = NewObject<UHTNTestLatentTask>();
+		Task->SetThreadSafeTick(true);
+		Task->NumTicksToFinish = 3;
+
+		TArray<UHTNPlanExecutor*> Executors;
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			UHTNExecutionContext* ExecutionContext = nullptr;
+			UHTNPlanExecutor* Executor = HTNPlanExecutorTest::MakeExecutor(World, EHTNPlanExecutorMode::Parallel, ExecutionContext);
+			Executor->StartPlan(FHTNPlan({ Task, Task }), ExecutionContext);
+			Executors.Add(Executor);
+		}
+		TestEqual("Executors register with the manager", Manager->GetNumExecutors(), NumAgents);
+
+		Manager->Tick(0.1f);
+		Manager->Tick(0.1f);
+		TestTrue("Tasks run until they finish", Executors[0]->IsExecutingPlan() && Executors[0]->GetTaskStatusAtIndex(1) == EHTNTaskStatus::InProgress);
+
+		Manager->Tick(0.1f);
+		bool bAllCompleted = true;
+		for (const UHTNPlanExecutor* Executor : Executors)
+		{
+			bAllCompleted &= !Executor->IsExecutingPlan() && Executor->GetCurrentPlan().Status == EHTNPlanStatus::Completed;
+		}
+		TestTrue("Every agent's plan completes on the same tick", bAllCompleted);
+		TestEqual("Every task is ticked once per frame", Task->NumThreadSafeTicks.GetValue(), NumAgents * 2 * 3);
+		TestEqual("Thread-safe tasks are not ticked on the game thread", Task->NumGameThreadTicks.GetValue(), 0);
+		TestEqual("Finished executors unregister", Manager->GetNumExecutors(), 0);
+	}
+
+	// Test completing tasks from worker threads through the completion queue
+	{
+		constexpr int32 NumAgents = 16;
+		UHTNTestLatentTask* Task = NewObject<UHTNTestLatentTask>();
+		Task->bCompleteThroughHandle = true;
+
+		TArray<UHTNPlanExecutor*> Executors;
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			UHTNExecutionContext* ExecutionContext = nullptr;
+			UHTNPlanExecutor* Executor = HTNPlanExecutorTest::MakeExecutor(World, EHTNPlanExecutorMode::Sequential, ExecutionContext);
+			Executor->StartPlan(FHTNPlan({ Task, Task }), ExecutionContext);
+			Executors.Add(Executor);
+		}
+
+		TArray<FHTNTaskCompletionHandle> Handles = MoveTemp(Task->CompletionHandles);
+		bool bAllHandlesValid = Handles.Num() == NumAgents;
+		for (const FHTNTaskCompletionHandle& Handle : Handles)
+		{
+			bAllHandlesValid &= Handle.IsValid() && Handle.TaskIndex == 0;
+		}
+		TestTrue("Each agent's first task hands out a handle", bAllHandlesValid);
+
+		// Many producers, reporting each completion twice
+		ParallelFor(Handles.Num(), [&Handles](int32 HandleIndex)
+		{
+			Handles[HandleIndex].SetResult(FName("Worker"), FHTNProperty(HandleIndex));
+			Handles[HandleIndex].Complete(EHTNTaskStatus::Succeeded);
+			Handles[HandleIndex].Complete(EHTNTaskStatus::Failed);
+		});
+		TestEqual("Reports wait for the game thread", Executors[0]->GetTaskStatusAtIndex(0), EHTNTaskStatus::InProgress);
+
+		Manager->Tick(0.1f);
+		bool bAllAdvanced = true;
+		bool bAllResultsStored = true;
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			FHTNProperty Result;
+			bAllAdvanced &= Executors[AgentIndex]->IsExecutingPlan() && Executors[AgentIndex]->GetCurrentPlan().CurrentTaskIndex == 1;
+			bAllResultsStored &= Executors[AgentIndex]->GetCurrentPlan().GetTaskResult(0, FName("Worker"), Result);
+		}
+		TestTrue("Queued completions are applied, and reports for finished tasks are dropped", bAllAdvanced);
+		TestTrue("Queued results are applied", bAllResultsStored);
+
+		// A report from an earlier plan doesn't reach the plan that replaced it
+		Executors[0]->AbortPlan(false);
+		UHTNExecutionContext* ExecutionContext = NewObject<UHTNExecutionContext>(Executors[0]);
+		ExecutionContext->SetWorldState(NewObject<UHTNWorldState>(Executors[0]));
+		Executors[0]->StartPlan(FHTNPlan({ Task }), ExecutionContext);
+		Handles[0].Complete(EHTNTaskStatus::Succeeded);
+		Manager->Tick(0.1f);
+		TestEqual("Reports for replaced plans are dropped", Executors[0]->GetTaskStatusAtIndex(0), EHTNTaskStatus::InProgress);
+
+		for (UHTNPlanExecutor* Executor : Executors)
+		{
+			Executor->AbortPlan(false);
+		}
+		TestEqual("Aborted executors unregister", Manager->GetNumExecutors(), 0);
+	}
+
+	// Test that agents running the same task keep separate instance memory and events
+	{
+		UHTNTestLatentTask* Task = NewObject<UHTNTestLatentTask>();
+		Task->NumTicksToFinish = 2;
+		UHTNTestTaskListener* Listener = NewObject<UHTNTestTaskListener>();
+		Task->OnTaskSucceeded.AddDynamic(Listener, &UHTNTestTaskListener::HandleTaskEvent);
+		Task->OnTaskAborted.AddDynamic(Listener, &UHTNTestTaskListener::HandleTaskEvent);
+
+		UHTNExecutionContext* FirstContext = nullptr;
+		UHTNPlanExecutor* FirstExecutor = HTNPlanExecutorTest::MakeExecutor(World, EHTNPlanExecutorMode::Sequential, FirstContext);
+		UHTNExecutionContext* SecondContext = nullptr;
+		UHTNPlanExecutor* SecondExecutor = HTNPlanExecutorTest::MakeExecutor(World, EHTNPlanExecutorMode::Sequential, SecondContext);
+
+		// The second agent starts a tick later, so it is one tick behind on the same task
+		FirstExecutor->StartPlan(FHTNPlan({ Task }), FirstContext);
+		Manager->Tick(0.1f);
+		SecondExecutor->StartPlan(FHTNPlan({ Task }), SecondContext);
+		Manager->Tick(0.1f);
+		TestTrue("The first agent finishes", !FirstExecutor->IsExecutingPlan() && FirstExecutor->GetCurrentPlan().Status == EHTNPlanStatus::Completed);
+		TestEqual("The second agent keeps its own tick count", SecondExecutor->GetTaskStatusAtIndex(0), EHTNTaskStatus::InProgress);
+		TestTrue("Events fire only for the agent the task finished for", Listener->ExecutionContexts.Num() == 1 && Listener->ExecutionContexts[0] == FirstContext);
+
+		SecondExecutor->AbortPlan(false);
+		TestTrue("Aborting one agent reports that agent", Listener->ExecutionContexts.Num() == 2 && Listener->ExecutionContexts[1] == SecondContext);
+	}
+
+	// Test recording which task failed when tasks run out of order
+	{
+		UHTNTestLatentTask* LongTask = NewObject<UHTNTestLatentTask>();
+		LongTask->NumTicksToFinish = 10;
+		UHTNTestLatentTask* FailingTask = NewObject<UHTNTestLatentTask>();
+		FailingTask->FinishStatus = EHTNTaskStatus::Failed;
+
+		UHTNExecutionContext* ExecutionContext = nullptr;
+		UHTNPlanExecutor* Executor = HTNPlanExecutorTest::MakeExecutor(World, EHTNPlanExecutorMode::Parallel, ExecutionContext);
+		Executor->StartPlan(FHTNPlan({ LongTask, FailingTask }), ExecutionContext);
+		TestEqual("No task has failed yet", Executor->GetFailedTaskIndex(), static_cast<int32>(INDEX_NONE));
+
+		Manager->Tick(0.1f);
+		TestTrue("The failure fails the plan", !Executor->IsExecutingPlan() && Executor->GetCurrentPlan().bFailed);
+		TestEqual("The failed task is recorded, not the current one", Executor->GetFailedTaskIndex(), 1);
+
+		Executor->StartPlan(FHTNPlan({ LongTask }), ExecutionContext);
+		TestEqual("Starting a plan forgets the failed task", Executor->GetFailedTaskIndex(), static_cast<int32>(INDEX_NONE));
+		Executor->AbortPlan(false);
+	}
+
+	// Test running tasks in the order of their inferred dependencies
+	{
+		AddExpectedError(TEXT("cannot start once its dependencies are done"), EAutomationExpectedErrorFlags::Contains, 1);
+
+		// Move and draw the weapon in parallel, and shoot once both are done
+		FHTNPlan Plan({
+			HTNPlanExecutorTest::MakeTask(2, {}, { FName("AtCover") }),
+			HTNPlanExecutorTest::MakeTask(1, {}, { FName("WeaponDrawn") }),
+			HTNPlanExecutorTest::MakeTask(1, { FName("AtCover"), FName("WeaponDrawn") }, { FName("TargetHit") })
+		});
+		Plan.InferTaskDependencies();
+
+		UHTNExecutionContext* ExecutionContext = nullptr;
+		UHTNPlanExecutor* Executor = HTNPlanExecutorTest::MakeExecutor(World, EHTNPlanExecutorMode::DependencyBased, ExecutionContext);
+		Executor->StartPlan(Plan, ExecutionContext);
+		TestTrue("Independent tasks start together", Executor->GetTaskStatusAtIndex(0) == EHTNTaskStatus::InProgress && Executor->GetTaskStatusAtIndex(1) == EHTNTaskStatus::InProgress);
+		TestEqual("Tasks wait for their dependencies", Executor->GetTaskStatusAtIndex(2), EHTNTaskStatus::Invalid);
+
+		Manager->Tick(0.1f);
+		TestTrue("Tasks wait for every dependency", Executor->GetTaskStatusAtIndex(1) == EHTNTaskStatus::Succeeded && Executor->GetTaskStatusAtIndex(2) == EHTNTaskStatus::Invalid);
+		TestTrue("Tasks that succeed out of order are recorded", Executor->GetSucceededTaskIndices() == TArray<int32>({ 1 }));
+
+		Manager->Tick(0.1f);
+		TestTrue("Tasks start once their dependencies succeed", Executor->GetTaskStatusAtIndex(0) == EHTNTaskStatus::Succeeded && Executor->GetTaskStatusAtIndex(2) != EHTNTaskStatus::Invalid);
+
+		Manager->Tick(0.1f);
+		Manager->Tick(0.1f);
+		TestTrue("The plan completes", !Executor->IsExecutingPlan() && Executor->GetCurrentPlan().Status == EHTNPlanStatus::Completed);
+		TestTrue("The last task ran on the effects of the others", ExecutionContext->GetWorldState()->GetPropertyValue<bool>(FName("TargetHit"), false));
+
+		// A task that is ready but not applicable fails the plan, rather than being left out of it
+		FHTNPlan BlockedPlan({
+			HTNPlanExecutorTest::MakeTask(1, {}, { FName("AtDoor") }),
+			HTNPlanExecutorTest::MakeTask(1, { FName("AtDoor"), FName("DoorUnlocked") }, {})
+		});
+		BlockedPlan.InferTaskDependencies();
+		Executor->StartPlan(BlockedPlan, ExecutionContext);
+		Manager->Tick(0.1f);
+		TestTrue("The plan fails", !Executor->IsExecutingPlan() && Executor->GetCurrentPlan().Status == EHTNPlanStatus::Failed);
+		TestEqual("The task that couldn't start is the failed one", Executor->GetFailedTaskIndex(), 1);
+	}
+
+	// Test handing off to a plan queued while the current plan runs
+	{
+		UHTNTestLatentTask* WalkToDoor = HTNPlanExecutorTest::MakeTask(1, {}, { FName("AtDoor") });
+		UHTNTestLatentTask* OpenDoor = HTNPlanExecutorTest::MakeTask(5, { FName("AtDoor"), FName("DoorUnlocked") }, {});
+
+		UHTNExecutionContext* ExecutionContext = nullptr;
+		UHTNPlanExecutor* Executor = HTNPlanExecutorTest::MakeExecutor(World, EHTNPlanExecutorMode::Sequential, ExecutionContext);
+		ExecutionContext->GetWorldState()->SetPropertyValue(FName("DoorUnlocked"), true);
+		TestFalse("Nothing can be queued without a running plan", Executor->QueueNextPlan(FHTNPlan({ OpenDoor })));
+
+		Executor->StartPlan(FHTNPlan({ WalkToDoor }), ExecutionContext);
+		const FHTNWorldStateSnapshot* PredictedState = Executor->GetPredictedFinalWorldState();
+		TestTrue("The plan is planned ahead from its predicted end state", PredictedState && PredictedState->FindProperty(FName("AtDoor")) && PredictedState->FindProperty(FName("AtDoor"))->GetBoolValue());
+
+		const uint32 FirstExecutionId = Executor->GetPlanExecutionId();
+		TestTrue("A plan is queued while the current one runs", Executor->QueueNextPlan(FHTNPlan({ OpenDoor })) && Executor->HasQueuedPlan());
+		Manager->Tick(0.1f);
+		Manager->Tick(0.1f);
+		TestTrue("The queued plan starts once the current plan completes", Executor->IsExecutingPlan() && Executor->GetPlanExecutionId() != FirstExecutionId
+			&& Executor->GetCurrentPlan().Tasks.Num() == 1 && Executor->GetCurrentPlan().Tasks[0] == OpenDoor);
+		TestEqual("The queued plan is started once", OpenDoor->NumExecutions.GetValue(), 1);
+		TestFalse("The queue is emptied by the handoff", Executor->HasQueuedPlan());
+		Executor->AbortPlan(false);
+
+		// The world changes after the plan was queued, so the state it was planned from is stale by the handoff
+		ExecutionContext->GetWorldState()->SetPropertyValue(FName("AtDoor"), false);
+		Executor->StartPlan(FHTNPlan({ WalkToDoor }), ExecutionContext);
+		Executor->QueueNextPlan(FHTNPlan({ OpenDoor }));
+		ExecutionContext->GetWorldState()->SetPropertyValue(FName("DoorUnlocked"), false);
+		Manager->Tick(0.1f);
+		Manager->Tick(0.1f);
+		TestTrue("The current plan still completes", Executor->GetCurrentPlan().Status == EHTNPlanStatus::Completed && Executor->GetCurrentPlan().Tasks[0] == WalkToDoor);
+		TestTrue("A queued plan that no longer applies is discarded", !Executor->IsExecutingPlan() && !Executor->HasQueuedPlan());
+		TestEqual("The discarded plan never starts", OpenDoor->NumExecutions.GetValue(), 1);
+
+		// Only a successful plan hands off
+		UHTNTestLatentTask* FailingTask = HTNPlanExecutorTest::MakeTask(1, {}, {});
+		FailingTask->FinishStatus = EHTNTaskStatus::Failed;
+		ExecutionContext->GetWorldState()->SetPropertyValue(FName("DoorUnlocked"), true);
+		Executor->StartPlan(FHTNPlan({ FailingTask }), ExecutionContext);
+		Executor->QueueNextPlan(FHTNPlan({ WalkToDoor }));
+		Manager->Tick(0.1f);
+		Manager->Tick(0.1f);
+		TestTrue("A failed plan discards the queued plan", !Executor->IsExecutingPlan() && !Executor->HasQueuedPlan() && Executor->GetCurrentPlan().Status == EHTNPlanStatus::Failed);
+	}
+
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
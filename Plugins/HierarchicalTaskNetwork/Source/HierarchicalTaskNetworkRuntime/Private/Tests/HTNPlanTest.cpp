@@ -0,0 +1,577 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+#include "Conditions/HTNPropertyCondition.h"
+#include "Effects/HTNSetPropertyEffect.h"
+#include "HTNDFSPlanner.h"
+#include "HTNExecutionContext.h"
+#include "HTNMethod.h"
+#include "HTNPlan.h"
+#include "HTNPlanAsset.h"
+#include "HTNPlanBinaryFormat.h"
+#include "HTNPlanCacheSubsystem.h"
+#include "HTNPlannerTrace.h"
+#include "HTNPlanView.h"
+#include "HTNTaskIndex.h"
+#include "HTNWorldStateStruct.h"
+#include "Serialization/MemoryWriter.h"
+#include "Tasks/HTNCompoundTask.h"
+#include "Tasks/HTNPrimitiveTask.h"
+#include "UObject/UObjectIterator.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHTNPlanTest, "HTNPlanner.Plan", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHTNPlanTest::RunTest(const FString& Parameters)
+{
+	// Test plan deltas, with the receiving side standing in for a client
+	{
+		TArray<UHTNPrimitiveTask*> DomainTasks;
+		FHTNTaskIndex TaskIndex;
+		for (int32 Index = 0; Index < 5; ++Index)
+		{
+			UHTNPrimitiveTask* Task = NewObject<UHTNPrimitiveTask>();
+			DomainTasks.Add(Task);
+			TaskIndex.AddTask(Task);
+		}
+
+		FHTNPlan ServerPlan({ DomainTasks[0], DomainTasks[1], DomainTasks[2] }, 3.0f);
+		ServerPlan.SetTaskParameter(1, FName("Target"), FHTNProperty(FName("Door")));
+		ServerPlan.SetTaskParameter(2, FName("Speed"), FHTNProperty(2.0f));
+		FHTNPlan ClientPlan = ServerPlan;
+		ClientPlan.Decomposition.Add(FHTNDecompositionNode(nullptr, INDEX_NONE, 0, 3));
+
+		// Replan: keep the first two tasks, reuse the third later and add new ones
+		FHTNPlan ReplannedPlan({ DomainTasks[0], DomainTasks[1], DomainTasks[3], DomainTasks[2], DomainTasks[4] }, 5.0f);
+		ReplannedPlan.CurrentTaskIndex = 2;
+		ReplannedPlan.SetTaskParameter(1, FName("Target"), FHTNProperty(FName("Window")));
+		ReplannedPlan.AddTaskDependency(3, 2);
+
+		TArray<uint8> Delta;
+		FHTNPlan::ComputeDelta(ServerPlan, ReplannedPlan, Delta);
+		TArray<uint8> FullPlan;
+		ReplannedPlan.ToBinary(FullPlan);
+		TestTrue("The delta is smaller than the whole plan", Delta.Num() < FullPlan.Num());
+
+		TestTrue("The delta applies to the plan it was computed from", ClientPlan.ApplyDelta(Delta, &TaskIndex));
+		TestTrue("Tasks match", ClientPlan.Tasks == ReplannedPlan.Tasks);
+		TestEqual("Cost matches", ClientPlan.TotalCost, 5.0f);
+		TestEqual("Current task matches", ClientPlan.CurrentTaskIndex, 2);
+
+		FHTNProperty Value;
+		TestTrue("Changed parameters are applied", ClientPlan.GetTaskParameter(1, FName("Target"), Value) && Value.GetNameValue() == FName("Window"));
+		TestFalse("Removed parameters are removed", ClientPlan.GetTaskParameter(2, FName("Speed"), Value));
+		TestTrue("Dependencies are applied", ClientPlan.TaskDependencies.Contains(3));
+		TestEqual("The old decomposition is dropped", ClientPlan.Decomposition.Num(), 0);
+
+		TestFalse("The delta doesn't apply twice", ClientPlan.ApplyDelta(Delta, &TaskIndex));
+		TestTrue("A rejected delta leaves the plan unchanged", ClientPlan.Tasks == ReplannedPlan.Tasks);
+	}
+
+	// Test binary serialization
+	{
+		AddExpectedError(TEXT("Cannot deserialize plan"), EAutomationExpectedErrorFlags::Contains, 0);
+		AddExpectedError(TEXT("task references"), EAutomationExpectedErrorFlags::Contains, 0);
+		AddExpectedError(TEXT("Loaded task reference"), EAutomationExpectedErrorFlags::Contains, 0);
+		AddExpectedError(TEXT("HTNPlanView"), EAutomationExpectedErrorFlags::Contains, 0);
+
+		FHTNPlan Plan({ NewObject<UHTNPrimitiveTask>(), nullptr, NewObject<UHTNPrimitiveTask>() }, 4.5f);
+		Plan.CurrentTaskIndex = 1;
+		Plan.Status = EHTNPlanStatus::Executing;
+		Plan.SetTaskParameter(0, FName("Target"), FHTNProperty(FName("Door")));
+		Plan.SetTaskParameter(2, FName("Location"), FHTNProperty(FVector(1.0, 2.0, 3.0)));
+		Plan.SetTaskResult(0, FName("Opened"), FHTNProperty(true));
+		Plan.SetTaskResult(2, FName("Message"), FHTNProperty(FString(TEXT("Done"))));
+		Plan.AddTaskDependency(2, 0);
+
+		TArray<uint8> Data;
+		Plan.ToBinary(Data);
+		FHTNPlan Loaded;
+		TestTrue("Version 2 data loads", Loaded.FromBinary(Data));
+		TestEqual("Tasks keep their slots", Loaded.Tasks.Num(), 3);
+		TestEqual("Cost is kept", Loaded.TotalCost, 4.5f);
+		TestEqual("Current task is kept", Loaded.CurrentTaskIndex, 1);
+		TestTrue("Status is kept", Loaded.Status == EHTNPlanStatus::Executing);
+		FHTNProperty Value;
+		TestTrue("Name parameters are kept", Loaded.GetTaskParameter(0, FName("Target"), Value) && Value.GetNameValue() == FName("Door"));
+		TestTrue("Vector parameters are kept", Loaded.GetTaskParameter(2, FName("Location"), Value) && Value.GetVectorValue() == FVector(1.0, 2.0, 3.0));
+		TestTrue("Boolean results are kept", Loaded.GetTaskResult(0, FName("Opened"), Value) && Value.GetBoolValue());
+		TestTrue("String results are kept", Loaded.GetTaskResult(2, FName("Message"), Value) && Value.GetStringValue() == TEXT("Done"));
+		const TArray<int32>* Dependencies = Loaded.TaskDependencies.Find(2);
+		TestTrue("Dependencies are kept", Dependencies && *Dependencies == TArray<int32>({ 0 }));
+
+		TArray<uint8> Corrupted = Data;
+		Corrupted.Last() ^= 0xFF;
+		TestFalse("Corrupted data is rejected", FHTNPlan().FromBinary(Corrupted));
+
+		for (int32 NumBytes : { 0, 4, 9, Data.Num() / 2, Data.Num() - 1 })
+		{
+			const TArray<uint8> Truncated(Data.GetData(), NumBytes);
+			TestFalse(FString::Printf(TEXT("Data truncated to %d bytes is rejected"), NumBytes), FHTNPlan().FromBinary(Truncated));
+			TestFalse(FString::Printf(TEXT("Views of data truncated to %d bytes are invalid"), NumBytes), FHTNPlanView(Truncated, false).IsValid());
+		}
+
+		// A task table whose size overflows, behind a valid checksum
+		TArray<uint8> Oversized;
+		HTNPlanBinary::FWriter Writer(Oversized);
+		Writer.WriteFixed(HTNPlanBinary::Version, 4);
+		Writer.WriteFixed(0, 4);
+		HTNPlanBinary::WriteStringTable(Writer, TArray<FString>());
+		Writer.WriteFloat(0.0f);
+		Writer.WriteVarInt(0);
+		Writer.WriteByte(0);
+		Writer.WriteFloat(0.0f);
+		Writer.WriteFloat(0.0f);
+		Writer.WriteByte(0);
+		Writer.WriteVarInt(0x0FFFFFFF);
+		Writer.WriteByte(4);
+		const uint32 Checksum = FCrc::MemCrc32(Oversized.GetData() + HTNPlanBinary::HeaderSize, Oversized.Num() - HTNPlanBinary::HeaderSize);
+		for (int32 ByteIndex = 0; ByteIndex < 4; ++ByteIndex)
+		{
+			Oversized[4 + ByteIndex] = static_cast<uint8>(Checksum >> (8 * ByteIndex));
+		}
+		TestFalse("Oversized task tables are rejected", FHTNPlan().FromBinary(Oversized));
+		TestFalse("Views of oversized task tables are invalid", FHTNPlanView(Oversized).IsValid());
+
+		// Version 1 data, as written before the compact format
+		TArray<uint8> VersionOneData;
+		FMemoryWriter VersionOneWriter(VersionOneData);
+		int32 SerializationVersion = 1;
+		float TotalCost = 2.5f;
+		int32 CurrentTaskIndex = 1;
+		bool bFalse = false;
+		float Time = 0.0f;
+		int32 StatusInt = static_cast<int32>(EHTNPlanStatus::Executing);
+		int32 TaskCount = 2;
+		bool bTrue = true;
+		FGuid TaskID = FGuid::NewGuid();
+		FString ClassName = UHTNPrimitiveTask::StaticClass()->GetPathName();
+		FName TaskName("Walk");
+		float TaskCost = 1.0f;
+		int32 ParamCount = 1;
+		FName ParamKey("Task_0_Speed");
+		int32 ParamType = static_cast<int32>(EHTNPropertyType::Float);
+		float Speed = 3.0f;
+		int32 ResultCount = 0;
+		int32 DependencyMapSize = 1;
+		int32 DependentTask = 1;
+		int32 DependencyCount = 1;
+		int32 Dependency = 0;
+		VersionOneWriter << SerializationVersion << TotalCost << CurrentTaskIndex << bFalse << bFalse << bFalse << bFalse << Time << Time << StatusInt;
+		VersionOneWriter << TaskCount << bTrue << TaskID << ClassName << TaskName << TaskCost << bFalse;
+		VersionOneWriter << ParamCount << ParamKey << ParamType << Speed << ResultCount;
+		VersionOneWriter << DependencyMapSize << DependentTask << DependencyCount << Dependency;
+
+		FHTNPlan VersionOnePlan;
+		TestTrue("Version 1 data still loads", VersionOnePlan.FromBinary(VersionOneData));
+		TestTrue("Version 1 plans keep their fields", VersionOnePlan.Tasks.Num() == 2 && VersionOnePlan.TotalCost == 2.5f && VersionOnePlan.CurrentTaskIndex == 1);
+		TestTrue("Version 1 parameters are kept", VersionOnePlan.GetTaskParameter(0, FName("Speed"), Value) && Value.GetFloatValue() == 3.0f);
+		TestTrue("Version 1 dependencies are kept", VersionOnePlan.TaskDependencies.Contains(1));
+		TestFalse("Views don't read version 1 data", FHTNPlanView(VersionOneData).IsValid());
+	}
+
+	// Test plan views
+	{
+		UHTNPrimitiveTask* Walk = NewObject<UHTNPrimitiveTask>();
+		Walk->TaskName = FName("Walk");
+		UHTNPrimitiveTask* Open = NewObject<UHTNPrimitiveTask>();
+		Open->TaskName = FName("Open");
+		FHTNPlan Plan({ Walk, nullptr, Open }, 2.0f);
+		Plan.SetTaskParameter(0, FName("Target"), FHTNProperty(FName("Door")));
+		Plan.SetTaskResult(2, FName("Opened"), FHTNProperty(true));
+		Plan.AddTaskDependency(2, 0);
+
+		// Enough strings for wide string offsets, one of them differing from a key only in case
+		Plan.SetTaskParameter(0, FName("Label"), FHTNProperty(FString(TEXT("TASK_0_TARGET"))));
+		for (int32 Index = 0; Index < 300; ++Index)
+		{
+			Plan.SetTaskParameter(2, FName(*FString::Printf(TEXT("Waypoint%d"), Index)), FHTNProperty(FString::Printf(TEXT("Marker %d"), Index)));
+		}
+
+		TArray<uint8> Data;
+		Plan.ToBinary(Data);
+		const FHTNPlanView View(Data);
+		TestTrue("The view reads version 2 data", View.IsValid());
+		TestEqual("The view has every task", View.GetNumTasks(), 3);
+		TestTrue("Null tasks are kept", View.IsTaskNull(1) && !View.IsTaskNull(0));
+		TestTrue("Task IDs are read in place", View.GetTaskID(2) == Open->GetTaskID());
+		TestTrue("Task names are read in place", View.GetTaskName(0).Equals(UTF8TEXTVIEW("Walk")) && View.GetTaskName(2).Equals(UTF8TEXTVIEW("Open")));
+		const FTCHARToUTF8 ClassPath(*UHTNPrimitiveTask::StaticClass()->GetPathName());
+		TestTrue("Task class paths are read in place", View.GetTaskClassPath(0).Equals(FUtf8StringView(reinterpret_cast<const UTF8CHAR*>(ClassPath.Get()), ClassPath.Length())));
+		TestTrue("Null tasks have no name", View.GetTaskName(1).IsEmpty());
+		TestEqual("Task costs are read in place", View.GetTaskCost(0), Walk->GetCost());
+
+		FHTNProperty Value;
+		TestTrue("Parameters are found by key", View.FindParameter(FName("Task_0_Target"), Value) && Value.GetNameValue() == FName("Door"));
+		TestTrue("Keys compare like names", View.FindParameter(FName("TASK_0_TARGET"), Value) && Value.GetNameValue() == FName("Door"));
+		TestTrue("Strings past the first offsets are found", View.FindParameter(FName("Task_2_Waypoint299"), Value) && Value.GetStringValue() == TEXT("Marker 299"));
+		TestTrue("Results are found by key", View.FindResult(FName("Task_2_Opened"), Value) && Value.GetBoolValue());
+		TestFalse("Missing keys are not found", View.FindParameter(FName("Task_1_Target"), Value));
+
+		TArray<int32> Dependencies;
+		TestTrue("Dependencies are read in place", View.GetTaskDependencies(2, Dependencies) && Dependencies == TArray<int32>({ 0 }));
+		TestFalse("Tasks without dependencies have none", View.GetTaskDependencies(0, Dependencies));
+
+		FHTNPlan Loaded;
+		TestTrue("Views convert to plans", View.ToPlan(Loaded) && Loaded.Tasks.Num() == 3 && Loaded.TaskParameters.Num() == Plan.TaskParameters.Num());
+	}
+
+	// Test resolving tasks by ID when loading plans from JSON
+	{
+		AddExpectedError(TEXT("could not be resolved"), EAutomationExpectedErrorFlags::Contains, 0);
+
+		// Root -> [Walk, Open], indexed the way a domain is when it loads
+		UHTNCompoundTask* Root = NewObject<UHTNCompoundTask>();
+		UHTNPrimitiveTask* Walk = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Open = NewObject<UHTNPrimitiveTask>();
+		UHTNMethod* RootMethod = NewObject<UHTNMethod>(Root);
+		RootMethod->Subtasks = { Walk, Open };
+		Root->Methods = { RootMethod };
+		FHTNTaskIndex TaskIndex;
+		TaskIndex.AddDomain({ Root });
+		TestEqual("Only primitive tasks are indexed", TaskIndex.Num(), 2);
+		TestTrue("Tasks are found by ID", TaskIndex.FindTask(Open->GetTaskID()) == Open && !TaskIndex.FindTask(FGuid::NewGuid()));
+
+		FHTNPlan Plan({ Walk, nullptr, Open });
+		Plan.CurrentTaskIndex = 1;
+		const FString Json = Plan.ToJson();
+
+		FHTNPlan LoadedPlan;
+		TestTrue("The plan loads", LoadedPlan.FromJson(Json, &TaskIndex));
+		TestTrue("Tasks are resolved through the index, and null tasks stay null", LoadedPlan.Tasks == Plan.Tasks);
+		TestTrue("The plan's state is loaded", LoadedPlan.CurrentTaskIndex == 1 && FMath::IsNearlyEqual(LoadedPlan.TotalCost, Plan.TotalCost));
+
+		TestTrue("The plan loads without an index", LoadedPlan.FromJson(Json));
+		TestTrue("Without an index, every task is null", LoadedPlan.Tasks.Num() == 3 && !LoadedPlan.Tasks[0] && !LoadedPlan.Tasks[2]);
+
+		// A task the domain doesn't have is left null rather than failing the load
+		FHTNTaskIndex PartialIndex;
+		PartialIndex.AddTask(Walk);
+		TestTrue("The plan loads with unknown tasks", LoadedPlan.FromJson(Json, &PartialIndex));
+		TestTrue("Unknown tasks are null", LoadedPlan.Tasks == TArray<UHTNPrimitiveTask*>({ Walk, nullptr, nullptr }));
+
+		const UHTNPlanAsset* Asset = UHTNPlanAsset::CreateFromPlan(Plan, TEXT("Door"), {});
+		const UHTNPlanAsset* LoadedAsset = UHTNPlanAsset::LoadFromJsonWithTaskIndex(Asset->SaveToJson(), &TaskIndex);
+		TestTrue("Plan assets resolve their tasks through the index", LoadedAsset && LoadedAsset->Plan.Tasks == Plan.Tasks && LoadedAsset->Description == TEXT("Door"));
+	}
+
+	// Test decomposition trees
+	{
+		// Root -> [Move -> [Walk, Open], Enter]
+		UHTNCompoundTask* Root = NewObject<UHTNCompoundTask>();
+		UHTNCompoundTask* Move = NewObject<UHTNCompoundTask>();
+		UHTNPrimitiveTask* Walk = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Open = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Enter = NewObject<UHTNPrimitiveTask>();
+		UHTNMethod* MoveMethod = NewObject<UHTNMethod>(Move);
+		MoveMethod->Subtasks = { Walk, Open };
+		Move->Methods.Add(MoveMethod);
+		UHTNMethod* RootMethod = NewObject<UHTNMethod>(Root);
+		RootMethod->Subtasks = { Move, Enter };
+		Root->Methods.Add(RootMethod);
+
+		FHTNPlanningConfig Config;
+		Config.bRecordDecomposition = true;
+		UHTNDFSPlanner* Planner = NewObject<UHTNDFSPlanner>();
+		const FHTNPlannerResult Result = Planner->GeneratePlan(NewObject<UHTNWorldState>(), { Root }, Config);
+		TestTrue("Plan found", Result.bSuccess);
+
+		const TArray<FHTNDecompositionNode>& Nodes = Result.Plan.Decomposition;
+		TestEqual("Every processed task has a node", Nodes.Num(), 5);
+		if (Nodes.Num() == 5)
+		{
+			TestTrue("The root spans the plan", Nodes[0].Task == Root && Nodes[0].Method == RootMethod && Nodes[0].NumTasks == 3);
+			TestTrue("Subtrees span their tasks", Nodes[1].Task == Move && Nodes[1].ParentIndex == 0 && Nodes[1].FirstTaskIndex == 0 && Nodes[1].NumTasks == 2);
+			TestEqual("Plan tasks map to their nodes", Result.Plan.FindDecompositionNode(2), 4);
+			TestEqual("Primitive nodes have their compound parent", Nodes[Result.Plan.FindDecompositionNode(1)].ParentIndex, 1);
+		}
+	}
+
+	// Test plan repair around a failed task
+	{
+		// Root -> [Move -> [Walk, Open] if HasKey, else [Walk, Break], Enter]
+		UHTNCompoundTask* Root = NewObject<UHTNCompoundTask>();
+		UHTNCompoundTask* Move = NewObject<UHTNCompoundTask>();
+		UHTNPrimitiveTask* Walk = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Open = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Break = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Enter = NewObject<UHTNPrimitiveTask>();
+		UHTNPropertyCondition* HasKey = NewObject<UHTNPropertyCondition>();
+		HasKey->PropertyKey = FName("HasKey");
+		HasKey->CheckType = EHTNPropertyCheckType::IsTrue;
+		UHTNMethod* OpenMethod = NewObject<UHTNMethod>(Move);
+		OpenMethod->Priority = 2.0f;
+		OpenMethod->Conditions.Add(HasKey);
+		OpenMethod->Subtasks = { Walk, Open };
+		UHTNMethod* BreakMethod = NewObject<UHTNMethod>(Move);
+		BreakMethod->Priority = 1.0f;
+		BreakMethod->Subtasks = { Walk, Break };
+		Move->Methods = { OpenMethod, BreakMethod };
+		UHTNMethod* RootMethod = NewObject<UHTNMethod>(Root);
+		RootMethod->Subtasks = { Move, Enter };
+		Root->Methods.Add(RootMethod);
+
+		FHTNPlanningConfig Config;
+		Config.bRecordDecomposition = true;
+		UHTNDFSPlanner* Planner = NewObject<UHTNDFSPlanner>();
+		UHTNWorldState* WorldState = NewObject<UHTNWorldState>();
+		WorldState->SetProperty(FName("HasKey"), FHTNProperty(true));
+		const FHTNPlannerResult Result = Planner->GeneratePlan(WorldState, { Root }, Config);
+		TestTrue("Plan found", Result.bSuccess && Result.Plan.Tasks.Num() == 3 && Result.Plan.Tasks[1] == Open);
+
+		// Opening failed because the key is gone
+		WorldState->SetProperty(FName("HasKey"), FHTNProperty(false));
+		FHTNPlannerResult Repaired;
+		TestTrue("Plan repaired", Planner->RepairPlan(Result.Plan, 1, WorldState, Config, Repaired));
+		TestTrue("Only the enclosing compound task is decomposed again", Repaired.Plan.Tasks == TArray<UHTNPrimitiveTask*>({ Walk, Walk, Break, Enter }));
+		TestEqual("The repaired plan resumes at the failed task", Repaired.Plan.CurrentTaskIndex, 1);
+
+		const TArray<FHTNDecompositionNode>& Nodes = Repaired.Plan.Decomposition;
+		TestEqual("The new subtree replaces the old one", Nodes.Num(), 5);
+		if (Nodes.Num() == 5)
+		{
+			TestTrue("Ancestors span the new tasks", Nodes[0].Task == Root && Nodes[0].NumTasks == 4);
+			TestTrue("The repaired task uses the other method", Nodes[1].Task == Move && Nodes[1].Method == BreakMethod && Nodes[1].FirstTaskIndex == 1 && Nodes[1].NumTasks == 2);
+			TestEqual("Kept tasks keep their nodes", Repaired.Plan.FindDecompositionNode(3), 4);
+			TestEqual("Kept nodes keep their parents", Nodes[4].ParentIndex, 0);
+		}
+
+		const FHTNPlan Remaining = Repaired.Plan.ExtractSubplan(1, 3);
+		TestTrue("Subplans keep their decomposition", Remaining.Decomposition.Num() == 5 && Remaining.Decomposition[0].NumTasks == 3 && Remaining.FindDecompositionNode(1) == 3);
+	}
+
+	// Test plan repair after tasks following the failed one already ran, as in dependency-based execution
+	{
+		// Root -> [Move -> [Walk, Open] if HasKey, else [Walk, Break], Wave if SeesFriend, Enter after Open and Wave]
+		UHTNCompoundTask* Root = NewObject<UHTNCompoundTask>();
+		UHTNCompoundTask* Move = NewObject<UHTNCompoundTask>();
+		UHTNPrimitiveTask* Walk = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Open = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Break = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Wave = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Enter = NewObject<UHTNPrimitiveTask>();
+		UHTNPropertyCondition* HasKey = NewObject<UHTNPropertyCondition>();
+		HasKey->PropertyKey = FName("HasKey");
+		HasKey->CheckType = EHTNPropertyCheckType::IsTrue;
+		UHTNPropertyCondition* SeesFriend = NewObject<UHTNPropertyCondition>(Wave);
+		SeesFriend->PropertyKey = FName("SeesFriend");
+		SeesFriend->CheckType = EHTNPropertyCheckType::IsTrue;
+		Wave->Preconditions.Add(SeesFriend);
+		UHTNMethod* OpenMethod = NewObject<UHTNMethod>(Move);
+		OpenMethod->Priority = 2.0f;
+		OpenMethod->Conditions.Add(HasKey);
+		OpenMethod->Subtasks = { Walk, Open };
+		UHTNMethod* BreakMethod = NewObject<UHTNMethod>(Move);
+		BreakMethod->Priority = 1.0f;
+		BreakMethod->Subtasks = { Walk, Break };
+		Move->Methods = { OpenMethod, BreakMethod };
+		UHTNMethod* RootMethod = NewObject<UHTNMethod>(Root);
+		RootMethod->Subtasks = { Move, Wave, Enter };
+		Root->Methods.Add(RootMethod);
+
+		FHTNPlanningConfig Config;
+		Config.bRecordDecomposition = true;
+		UHTNDFSPlanner* Planner = NewObject<UHTNDFSPlanner>();
+		UHTNWorldState* WorldState = NewObject<UHTNWorldState>();
+		WorldState->SetProperty(FName("HasKey"), FHTNProperty(true));
+		WorldState->SetProperty(FName("SeesFriend"), FHTNProperty(true));
+		const FHTNPlannerResult Result = Planner->GeneratePlan(WorldState, { Root }, Config);
+		FHTNPlan Plan = Result.Plan;
+		Plan.AddTaskDependency(3, 1);
+		Plan.AddTaskDependency(3, 2);
+		TestTrue("Plan found", Result.bSuccess && Plan.Tasks == TArray<UHTNPrimitiveTask*>({ Walk, Open, Wave, Enter }));
+
+		// Walk and Wave ran, and the friend walked off, before opening failed because the key is gone
+		WorldState->SetProperty(FName("HasKey"), FHTNProperty(false));
+		WorldState->SetProperty(FName("SeesFriend"), FHTNProperty(false));
+		FHTNPlannerResult Repaired;
+		TestFalse("Tasks that ran are checked again without their completions", Planner->RepairPlan(Plan, 1, WorldState, Config, Repaired));
+		TestTrue("Plan repaired", Planner->RepairPlan(Plan, 1, WorldState, Config, Repaired, { 0, 2 }));
+		TestTrue("Tasks that ran after the failed one are left out", Repaired.Plan.Tasks == TArray<UHTNPrimitiveTask*>({ Walk, Walk, Break, Enter }));
+		TestEqual("The repaired plan resumes at the failed task", Repaired.Plan.CurrentTaskIndex, 1);
+		TestFalse("Dependencies on tasks that ran are met", Repaired.Plan.TaskDependencies.Contains(3));
+
+		const TArray<FHTNDecompositionNode>& Nodes = Repaired.Plan.Decomposition;
+		TestEqual("The nodes of tasks that ran are dropped", Nodes.Num(), 5);
+		if (Nodes.Num() == 5)
+		{
+			TestTrue("Ancestors span the remaining tasks", Nodes[0].Task == Root && Nodes[0].NumTasks == 4);
+			TestEqual("Kept tasks keep their nodes", Repaired.Plan.FindDecompositionNode(3), 4);
+			TestTrue("Kept nodes keep their parents", Nodes[4].Task == Enter && Nodes[4].ParentIndex == 0);
+		}
+	}
+
+	// Test inferred task dependencies
+	{
+		auto MakeTask = [](TArray<FName> ReadKeys, TArray<FName> WriteKeys)
+		{
+			UHTNPrimitiveTask* Task = NewObject<UHTNPrimitiveTask>();
+			for (const FName& Key : ReadKeys)
+			{
+				UHTNPropertyCondition* Condition = NewObject<UHTNPropertyCondition>(Task);
+				Condition->PropertyKey = Key;
+				Condition->CheckType = EHTNPropertyCheckType::IsTrue;
+				Task->Preconditions.Add(Condition);
+			}
+			for (const FName& Key : WriteKeys)
+			{
+				UHTNSetPropertyEffect* Effect = NewObject<UHTNSetPropertyEffect>(Task);
+				Effect->PropertyKey = Key;
+				Effect->PropertyValue = FHTNProperty(true);
+				Task->Effects.Add(Effect);
+			}
+			return Task;
+		};
+
+		// Move and draw the weapon in parallel, shoot once both are done, then holster
+		FHTNPlan Plan({
+			MakeTask({}, { FName("AtCover") }),
+			MakeTask({}, { FName("WeaponDrawn") }),
+			MakeTask({ FName("AtCover"), FName("WeaponDrawn") }, { FName("TargetHit") }),
+			MakeTask({}, { FName("WeaponDrawn") })
+		});
+		Plan.InferTaskDependencies();
+		TestFalse("Independent tasks don't depend on each other", Plan.TaskDependencies.Contains(1));
+		const TArray<int32>* ShootDependencies = Plan.TaskDependencies.Find(2);
+		TestTrue("Reads depend on the writers", ShootDependencies && ShootDependencies->Num() == 2 && ShootDependencies->Contains(0) && ShootDependencies->Contains(1));
+		const TArray<int32>* HolsterDependencies = Plan.TaskDependencies.Find(3);
+		TestTrue("Writes wait for earlier readers, and implied dependencies are left out", HolsterDependencies && *HolsterDependencies == TArray<int32>({ 2 }));
+
+		// The same task reached along two paths is not a cycle
+		Plan.AddTask(MakeTask({}, {}));
+		Plan.AddTaskDependency(1, 0);
+		TestTrue("Dependencies can be added across diamonds", Plan.AddTaskDependency(4, 3));
+		TestFalse("Circular dependencies are rejected", Plan.AddTaskDependency(0, 4));
+	}
+
+	// Test planner traces
+	{
+		// Root -> [Locked] if the precondition holds, else [Walk]
+		UHTNCompoundTask* Root = NewObject<UHTNCompoundTask>();
+		UHTNPrimitiveTask* Locked = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Walk = NewObject<UHTNPrimitiveTask>();
+		UHTNPropertyCondition* HasKey = NewObject<UHTNPropertyCondition>(Locked);
+		HasKey->PropertyKey = FName("HasKey");
+		HasKey->CheckType = EHTNPropertyCheckType::IsTrue;
+		Locked->Preconditions.Add(HasKey);
+		UHTNMethod* LockedMethod = NewObject<UHTNMethod>(Root);
+		LockedMethod->Priority = 2.0f;
+		LockedMethod->Subtasks = { Locked };
+		UHTNMethod* WalkMethod = NewObject<UHTNMethod>(Root);
+		WalkMethod->Priority = 1.0f;
+		WalkMethod->Subtasks = { Walk };
+		Root->Methods = { LockedMethod, WalkMethod };
+
+		FHTNPlanningConfig Config;
+		Config.bRecordTrace = true;
+		UHTNDFSPlanner* Planner = NewObject<UHTNDFSPlanner>();
+		TestTrue("Plan found", Planner->GeneratePlan(NewObject<UHTNWorldState>(), { Root }, Config).bSuccess);
+
+		const FHTNPlannerTrace& Trace = Planner->GetTrace();
+		TestEqual("Every step of the search is traced", Trace.Num(), 7);
+		if (Trace.Num() == 7)
+		{
+			TestTrue("Methods are traced by index", Trace.GetEvent(1).Type == EHTNPlannerTraceEventType::MethodTry && Trace.GetEvent(1).Value == 0);
+			const FHTNPlannerTraceEvent& FailEvent = Trace.GetEvent(3);
+			TestTrue("Failed preconditions are traced by index", FailEvent.Type == EHTNPlannerTraceEventType::ConditionFail && FailEvent.Value == 0 && Trace.GetTask(FailEvent.TaskId) == Locked);
+			TestTrue("Events keep their depth", Trace.GetEvent(3).Depth == 1 && Trace.GetEvent(6).Depth == 2);
+			TestTrue("The trace ends with the plan", Trace.GetEvent(6).Type == EHTNPlannerTraceEventType::PlanFound && Trace.GetEvent(6).Value == 1);
+			TestTrue("Events are formatted when viewed", Trace.DescribeEvent(FailEvent).Contains(TEXT("precondition 0")));
+		}
+
+		FHTNPlannerTrace Ring;
+		Ring.SetCapacity(3);
+		for (int32 Index = 0; Index < 6; ++Index)
+		{
+			Ring.Add(EHTNPlannerTraceEventType::NodeEnter, Walk, 0, Index);
+		}
+		TestEqual("The capacity is rounded up to a power of two", Ring.Num(), 4);
+		TestEqual("The oldest events are overwritten", Ring.GetEvent(0).Value, 2);
+		TestTrue("Overwritten events are counted", Ring.GetNumDropped() == 2);
+		TestEqual("Tasks are interned once", Ring.GetEvent(0).TaskId, Ring.GetEvent(3).TaskId);
+	}
+
+	// Test reusing the planner's working states and the result across plans
+	{
+		// Root -> [Open, Enter], where Enter needs the door Open leaves open
+		UHTNCompoundTask* Root = NewObject<UHTNCompoundTask>();
+		UHTNPrimitiveTask* Open = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Enter = NewObject<UHTNPrimitiveTask>();
+		UHTNPropertyCondition* HasKey = NewObject<UHTNPropertyCondition>(Open);
+		HasKey->PropertyKey = FName("HasKey");
+		HasKey->CheckType = EHTNPropertyCheckType::IsTrue;
+		Open->Preconditions.Add(HasKey);
+		UHTNSetPropertyEffect* OpensDoor = NewObject<UHTNSetPropertyEffect>(Open);
+		OpensDoor->PropertyKey = FName("DoorOpen");
+		OpensDoor->PropertyValue = FHTNProperty(true);
+		Open->Effects.Add(OpensDoor);
+		UHTNPropertyCondition* DoorOpen = NewObject<UHTNPropertyCondition>(Enter);
+		DoorOpen->PropertyKey = FName("DoorOpen");
+		DoorOpen->CheckType = EHTNPropertyCheckType::IsTrue;
+		Enter->Preconditions.Add(DoorOpen);
+		UHTNMethod* RootMethod = NewObject<UHTNMethod>(Root);
+		RootMethod->Subtasks = { Open, Enter };
+		Root->Methods = { RootMethod };
+
+		auto CountWorldStates = []()
+		{
+			int32 NumWorldStates = 0;
+			for (TObjectIterator<UHTNWorldState> It; It; ++It)
+			{
+				++NumWorldStates;
+			}
+			return NumWorldStates;
+		};
+
+		UHTNDFSPlanner* Planner = NewObject<UHTNDFSPlanner>();
+		UHTNWorldState* WorldState = NewObject<UHTNWorldState>();
+		WorldState->SetPropertyValue(FName("HasKey"), true);
+		FHTNPlanningConfig Config;
+		FHTNPlannerResult Result;
+		TestTrue("Plan found", Planner->GeneratePlanInto(WorldState, { Root }, Config, Result));
+
+		const int32 NumWorldStates = CountWorldStates();
+		TestTrue("Replanning into the same result finds the same plan", Planner->GeneratePlanInto(WorldState, { Root }, Config, Result) && Result.Plan.Tasks == TArray<UHTNPrimitiveTask*>({ Open, Enter }));
+		TestEqual("Replanning creates no world states", CountWorldStates(), NumWorldStates);
+		TestFalse("Effects are applied to the working states, not the input", WorldState->HasProperty(FName("DoorOpen")));
+
+		WorldState->SetPropertyValue(FName("HasKey"), false);
+		TestFalse("No plan without the key", Planner->GeneratePlanInto(WorldState, { Root }, Config, Result));
+		TestEqual("A failed search leaves no tasks from the previous plan", Result.Plan.Tasks.Num(), 0);
+
+		UHTNExecutionContext* ExecutionContext = NewObject<UHTNExecutionContext>();
+		ExecutionContext->SetWorldState(WorldState);
+		ExecutionContext->SetParameterValue(FName("Target"), 1);
+		ExecutionContext->Reset();
+		TestFalse("Resetting the execution context clears its parameters", ExecutionContext->HasParameter(FName("Target")));
+		TestTrue("Resetting the execution context keeps its world state", ExecutionContext->GetWorldState() == WorldState);
+	}
+
+	// Test that a plan from the shared plan cache replaces the whole output plan
+	{
+		UHTNPrimitiveTask* Walk = NewObject<UHTNPrimitiveTask>();
+		UHTNPrimitiveTask* Open = NewObject<UHTNPrimitiveTask>();
+		UHTNPlanCacheSubsystem* PlanCache = NewObject<UHTNPlanCacheSubsystem>();
+		PlanCache->AddPlan(1, FHTNPlan({ Walk, Open }));
+
+		// The output still holds an earlier plan, as a reused planner result does
+		FHTNPlan Plan({ Open, Walk, Open });
+		Plan.SetTaskParameter(2, FName("Target"), FHTNProperty(1));
+		Plan.AddTaskDependency(2, 0);
+		Plan.CurrentTaskIndex = 2;
+		TestTrue("Cached plans are found", PlanCache->FindPlan(1, Plan));
+		TestTrue("The cached tasks are used", Plan.Tasks == TArray<UHTNPrimitiveTask*>({ Walk, Open }));
+		TestTrue("Nothing of the previous plan carries over", Plan.TaskParameters.Num() == 0 && Plan.TaskDependencies.Num() == 0 && Plan.CurrentTaskIndex == 0);
+
+		Plan.AddTaskDependency(1, 0);
+		TestFalse("Unknown requests are not found", PlanCache->FindPlan(2, Plan));
+		TestTrue("A miss leaves no plan behind", Plan.Tasks.Num() == 0 && Plan.TaskDependencies.Num() == 0);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
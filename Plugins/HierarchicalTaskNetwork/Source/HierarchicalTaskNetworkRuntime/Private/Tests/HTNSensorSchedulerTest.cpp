@@ -0,0 +1,104 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+#include "Engine/World.h"
+#include "HTNSensorScheduler.h"
+#include "HTNWorldStateStruct.h"
+#include "Tests/HTNTestSensors.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHTNSensorSchedulerTest, "HTNPlanner.SensorScheduler", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHTNSensorSchedulerTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	UHTNSensorScheduler* Scheduler = World->GetSubsystem<UHTNSensorScheduler>();
+	if (!TestNotNull("The world has a sensor scheduler", Scheduler))
+	{
+		World->DestroyWorld(false);
+		return false;
+	}
+
+	AddExpectedError(TEXT("sensed undeclared key"), EAutomationExpectedErrorFlags::Contains, 0);
+
+	// Test staggered, batched sensor updates
+	{
+		constexpr int32 NumAgents = 8;
+		UHTNTestSensor::NumBatches = 0;
+		World->TimeSeconds = 0.0;
+
+		TArray<UHTNTestSensor*> Sensors;
+		TArray<UHTNWorldState*> WorldStates;
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			UHTNTestSensor* Sensor = NewObject<UHTNTestSensor>();
+			Sensor->UpdateInterval = 1.0f;
+			Sensor->OutputKeys.Add(FName("Sensed"));
+			UHTNWorldState* WorldState = NewObject<UHTNWorldState>();
+			TestTrue("Sensors register", Scheduler->RegisterSensor(Sensor, WorldState, nullptr));
+			Sensors.Add(Sensor);
+			WorldStates.Add(WorldState);
+		}
+
+		UHTNTestSensor* KeylessSensor = NewObject<UHTNTestSensor>();
+		AddExpectedError(TEXT("Sensor writes no keys"), EAutomationExpectedErrorFlags::Contains, 1);
+		TestFalse("Sensors without output keys are rejected", Scheduler->RegisterSensor(KeylessSensor, NewObject<UHTNWorldState>(), nullptr));
+
+		Scheduler->Tick(0.0f);
+		int32 NumSensed = 0;
+		for (const UHTNTestSensor* Sensor : Sensors)
+		{
+			NumSensed += Sensor->NumSensed;
+		}
+		TestTrue("Agents registered together don't all sense on the same frame", NumSensed > 0 && NumSensed < NumAgents);
+
+		// One interval later every agent is due, and all of them sense in one batch
+		World->TimeSeconds = 1.0;
+		UHTNTestSensor::NumBatches = 0;
+		Scheduler->Tick(1.0f);
+		bool bAllSensed = true;
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			bAllSensed &= Sensors[AgentIndex]->NumSensed >= 1 && WorldStates[AgentIndex]->GetPropertyValue<bool>(FName("Sensed"), false);
+		}
+		TestTrue("Every agent senses once per interval", bAllSensed);
+		TestEqual("Sensors of one class sense in one batch", UHTNTestSensor::NumBatches, 1);
+		TestFalse("Undeclared keys are not written", WorldStates[0]->HasProperty(FName("Undeclared")));
+
+		// Unchanged values leave the versions alone
+		const uint32 Version = WorldStates[0]->GetVersion();
+		World->TimeSeconds = 2.0;
+		Scheduler->Tick(1.0f);
+		TestEqual("Sensing an unchanged value keeps the version", WorldStates[0]->GetVersion(), Version);
+
+		// Over budget, the rest wait for the next tick
+		Scheduler->MaxUpdatesPerTick = 3;
+		World->TimeSeconds = 10.0;
+		for (UHTNTestSensor* Sensor : Sensors)
+		{
+			Sensor->NumSensed = 0;
+		}
+		Scheduler->Tick(8.0f);
+		NumSensed = 0;
+		for (const UHTNTestSensor* Sensor : Sensors)
+		{
+			NumSensed += Sensor->NumSensed;
+		}
+		TestEqual("Updates are limited per tick", NumSensed, 3);
+		Scheduler->MaxUpdatesPerTick = 0;
+
+		for (UHTNWorldState* WorldState : WorldStates)
+		{
+			Scheduler->UnregisterSensors(WorldState);
+		}
+		TestEqual("Sensors unregister with their world state", Scheduler->GetNumSensors(), 0);
+	}
+
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,14 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Tests/HTNTestConditions.h"
+
+bool UHTNTestCountingCondition::CheckCondition_Implementation(const UHTNWorldState* WorldState) const
+{
+	++NumChecks;
+	return Super::CheckCondition_Implementation(WorldState);
+}
+
+bool UHTNTestCountingCondition::GetRequiredBoolValue(FName& OutKey, bool& bOutExpectedValue) const
+{
+	return false;
+}
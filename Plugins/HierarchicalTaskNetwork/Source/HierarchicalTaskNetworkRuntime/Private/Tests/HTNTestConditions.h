@@ -0,0 +1,26 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Conditions/HTNPropertyCondition.h"
+#include "HTNTestConditions.generated.h"
+
+/**
+ * Property condition used by the automation tests that counts how often it is checked.
+ * It is never folded into a bool mask, so every check goes through CheckCondition.
+ */
+UCLASS(HideDropdown, NotBlueprintable)
+class UHTNTestCountingCondition : public UHTNPropertyCondition
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin UHTNCondition Interface
+	virtual bool CheckCondition_Implementation(const UHTNWorldState* WorldState) const override;
+	virtual bool GetRequiredBoolValue(FName& OutKey, bool& bOutExpectedValue) const override;
+	//~ End UHTNCondition Interface
+
+	/** Number of times the condition was checked */
+	mutable int32 NumChecks = 0;
+};
@@ -0,0 +1,21 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Tests/HTNTestSensors.h"
+
+int32 UHTNTestSensor::NumBatches = 0;
+
+void UHTNTestSensor::SenseBatch(TArrayView<FHTNSensorUpdate> Updates) const
+{
+	++NumBatches;
+	Super::SenseBatch(Updates);
+}
+
+void UHTNTestSensor::Sense_Implementation(AActor* Owner, const UHTNWorldState* WorldState, TMap<FName, FHTNProperty>& OutValues) const
+{
+	++NumSensed;
+	if (OutputKeys.Num() > 0)
+	{
+		OutValues.Add(OutputKeys[0], FHTNProperty(true));
+	}
+	OutValues.Add(FName("Undeclared"), FHTNProperty(1));
+}
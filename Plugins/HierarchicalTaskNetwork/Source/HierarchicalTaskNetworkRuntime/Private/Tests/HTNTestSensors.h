@@ -0,0 +1,29 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Sensors/HTNSensor.h"
+#include "HTNTestSensors.generated.h"
+
+/**
+ * Sensor used by the automation tests that sets its first output key to true, counting its updates and batches.
+ * It also senses one undeclared key, which the scheduler must ignore.
+ */
+UCLASS(HideDropdown, NotBlueprintable)
+class UHTNTestSensor : public UHTNSensor
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin UHTNSensor Interface
+	virtual void SenseBatch(TArrayView<FHTNSensorUpdate> Updates) const override;
+	virtual void Sense_Implementation(AActor* Owner, const UHTNWorldState* WorldState, TMap<FName, FHTNProperty>& OutValues) const override;
+	//~ End UHTNSensor Interface
+
+	/** Number of times this agent's sensor sensed */
+	mutable int32 NumSensed = 0;
+
+	/** Number of SenseBatch calls across all test sensors */
+	static int32 NumBatches;
+};
@@ -0,0 +1,64 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Tests/HTNTestTasks.h"
+
+#include "HTNExecutionContext.h"
+
+EHTNTaskStatus UHTNTestLatentTask::ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) const
+{
+    NumExecutions.Increment();
+
+    if (bCompleteThroughHandle)
+    {
+        CompletionHandles.Add(ExecutionContext->MakeCompletionHandle());
+        return EHTNTaskStatus::InProgress;
+    }
+
+    return NumTicksToFinish > 0 ? EHTNTaskStatus::InProgress : FinishStatus;
+}
+
+EHTNTaskStatus UHTNTestLatentTask::TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime) const
+{
+    NumGameThreadTicks.Increment();
+
+    FHTNTestLatentTaskMemory* Memory = ExecutionContext ? ExecutionContext->GetTaskMemory<FHTNTestLatentTaskMemory>() : nullptr;
+    return Memory ? AdvanceTick(*Memory) : EHTNTaskStatus::Failed;
+}
+
+EHTNTaskStatus UHTNTestLatentTask::TickTaskThreadSafe(const UHTNWorldState* WorldState, uint8* NodeMemory, float DeltaTime) const
+{
+    NumThreadSafeTicks.Increment();
+
+    FHTNTestLatentTaskMemory* Memory = CastInstanceMemory<FHTNTestLatentTaskMemory>(NodeMemory);
+    return Memory ? AdvanceTick(*Memory) : EHTNTaskStatus::Failed;
+}
+
+EHTNTaskStatus UHTNTestLatentTask::AdvanceTick(FHTNTestLatentTaskMemory& Memory) const
+{
+    if (bCompleteThroughHandle)
+    {
+        return EHTNTaskStatus::InProgress;
+    }
+
+    return ++Memory.NumTicks >= NumTicksToFinish ? FinishStatus : EHTNTaskStatus::InProgress;
+}
+
+uint16 UHTNTestLatentTask::GetInstanceMemorySize() const
+{
+    return sizeof(FHTNTestLatentTaskMemory);
+}
+
+void UHTNTestLatentTask::InitializeMemory(uint8* NodeMemory) const
+{
+    new (NodeMemory) FHTNTestLatentTaskMemory();
+}
+
+void UHTNTestLatentTask::CleanupMemory(uint8* NodeMemory) const
+{
+    CastInstanceMemory<FHTNTestLatentTaskMemory>(NodeMemory)->~FHTNTestLatentTaskMemory();
+}
+
+void UHTNTestTaskListener::HandleTaskEvent(UHTNPrimitiveTask* Task, UHTNExecutionContext* ExecutionContext)
+{
+    ExecutionContexts.Add(ExecutionContext);
+}
@@ -0,0 +1,92 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HTNTaskCompletionQueue.h"
+#include "Tasks/HTNPrimitiveTask.h"
+#include "HTNTestTasks.generated.h"
+
+/**
+ * Per-agent instance memory for UHTNTestLatentTask.
+ */
+struct FHTNTestLatentTaskMemory : public FHTNPrimitiveTaskMemory
+{
+    /** Number of ticks so far */
+    int32 NumTicks = 0;
+};
+
+/**
+ * Task used by the automation tests that runs for a number of ticks before finishing,
+ * or until it is completed through a completion handle.
+ */
+UCLASS(HideDropdown, NotBlueprintable)
+class UHTNTestLatentTask : public UHTNPrimitiveTask
+{
+    GENERATED_BODY()
+
+public:
+    //~ Begin UHTNPrimitiveTask Interface
+    virtual EHTNTaskStatus ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) const override;
+    virtual EHTNTaskStatus TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime) const override;
+    virtual EHTNTaskStatus TickTaskThreadSafe(const UHTNWorldState* WorldState, uint8* NodeMemory, float DeltaTime) const override;
+    virtual uint16 GetInstanceMemorySize() const override;
+    virtual void InitializeMemory(uint8* NodeMemory) const override;
+    virtual void CleanupMemory(uint8* NodeMemory) const override;
+    //~ End UHTNPrimitiveTask Interface
+
+    /**
+     * Tick through TickTaskThreadSafe instead of the TickTask event.
+     * 
+     * @param bInThreadSafeTick - Whether the tick is thread-safe
+     */
+    void SetThreadSafeTick(bool bInThreadSafeTick) { bThreadSafeTick = bInThreadSafeTick; }
+
+    /** Ticks until the task finishes; 0 finishes in ExecuteTask */
+    int32 NumTicksToFinish = 1;
+
+    /** Status the task finishes with */
+    EHTNTaskStatus FinishStatus = EHTNTaskStatus::Succeeded;
+
+    /** Whether the task waits for a completion handle instead of finishing from its tick */
+    bool bCompleteThroughHandle = false;
+
+    /** Completion handles created by ExecuteTask when bCompleteThroughHandle is set */
+    mutable TArray<FHTNTaskCompletionHandle> CompletionHandles;
+
+    /** Number of ticks run through TickTaskThreadSafe, across all agents */
+    mutable FThreadSafeCounter NumThreadSafeTicks;
+
+    /** Number of ticks run through the TickTask event, across all agents */
+    mutable FThreadSafeCounter NumGameThreadTicks;
+
+    /** Number of times the task was started, across all agents */
+    mutable FThreadSafeCounter NumExecutions;
+
+private:
+    /** Count a tick and return the resulting status */
+    EHTNTaskStatus AdvanceTick(FHTNTestLatentTaskMemory& Memory) const;
+};
+
+/**
+ * Object used by the automation tests to record which agents a task's events fired for.
+ */
+UCLASS(HideDropdown, NotBlueprintable)
+class UHTNTestTaskListener : public UObject
+{
+    GENERATED_BODY()
+
+public:
+    /**
+     * Record the execution context an event fired for.
+     * 
+     * @param Task - The task the event fired for
+     * @param ExecutionContext - The execution context of the agent running the task
+     */
+    UFUNCTION()
+    void HandleTaskEvent(UHTNPrimitiveTask* Task, UHTNExecutionContext* ExecutionContext);
+
+    /** Execution contexts of the events so far, in order */
+    TArray<UHTNExecutionContext*> ExecutionContexts;
+};
@@ -4,6 +4,9 @@
 #include "Misc/AutomationTest.h"
 #include "Tests/AutomationCommon.h"
 #include "HTNWorldStateStruct.h"
+#include "Conditions/HTNBoolConditionMask.h"
+#include "Conditions/HTNPropertyCondition.h"
+#include "HTNWorldStatePopulation.h"
 
 #if WITH_DEV_AUTOMATION_TESTS
 
@@ -250,6 +253,337 @@ bool FHTNWorldStateTest::RunTest(const FString& Parameters)
 		TestEqual("Created object property value is correct", Value.GetIntValue(), 42);
 	}
 	
+	// Test change versions
+	{
+		FHTNWorldStateStruct WorldState;
+		WorldState.SetProperty(FName("IntProp"), FHTNProperty(1));
+		WorldState.SetProperty(FName("BoolProp"), FHTNProperty(true));
+		const uint32 Version = WorldState.GetVersion();
+		
+		WorldState.SetProperty(FName("IntProp"), FHTNProperty(1));
+		TestEqual("Setting the same value does not change the version", WorldState.GetVersion(), Version);
+		
+		WorldState.SetProperty(FName("IntProp"), FHTNProperty(2));
+		WorldState.RemoveProperty(FName("MissingProp"));
+		TArray<FName> ChangedKeys;
+		WorldState.GetChangedKeysSince(Version, ChangedKeys);
+		TestTrue("Setting a new value changes the version", WorldState.GetVersion() > Version);
+		TestEqual("Only the changed key is reported", ChangedKeys.Num(), 1);
+		TestTrue("Changed key is reported", ChangedKeys.Contains(FName("IntProp")));
+		
+		const uint32 RemoveVersion = WorldState.GetVersion();
+		WorldState.RemoveProperty(FName("BoolProp"));
+		ChangedKeys.Reset();
+		WorldState.GetChangedKeysSince(RemoveVersion, ChangedKeys);
+		TestTrue("Removed key is reported", ChangedKeys.Num() == 1 && ChangedKeys[0] == FName("BoolProp"));
+		
+		FHTNWorldStateStruct Replacement;
+		Replacement.SetProperty(FName("OtherProp"), FHTNProperty(3));
+		const uint32 AssignVersion = WorldState.GetVersion();
+		WorldState = Replacement;
+		ChangedKeys.Reset();
+		WorldState.GetChangedKeysSince(AssignVersion, ChangedKeys);
+		TestTrue("Assignment reports the old keys", ChangedKeys.Contains(FName("IntProp")));
+		TestTrue("Assignment reports the new keys", ChangedKeys.Contains(FName("OtherProp")));
+
+		Replacement.SetProperty(FName("ThirdProp"), FHTNProperty(4));
+		const uint32 ReassignVersion = WorldState.GetVersion();
+		WorldState = Replacement;
+		ChangedKeys.Reset();
+		WorldState.GetChangedKeysSince(ReassignVersion, ChangedKeys);
+		TestTrue("Assignment reports only the keys that differ", ChangedKeys.Num() == 1 && ChangedKeys[0] == FName("ThirdProp"));
+
+		const uint32 SameVersion = WorldState.GetVersion();
+		WorldState = Replacement;
+		TestEqual("Assigning the same values keeps the version", WorldState.GetVersion(), SameVersion);
+	}
+	
+	// Test fingerprints
+	{
+		FHTNWorldStateStruct StateA;
+		StateA.SetProperty(FName("IntProp"), FHTNProperty(1));
+		StateA.SetProperty(FName("NameProp"), FHTNProperty(FName("Value")));
+		
+		FHTNWorldStateStruct StateB;
+		StateB.SetProperty(FName("NameProp"), FHTNProperty(FName("Value")));
+		StateB.SetProperty(FName("IntProp"), FHTNProperty(1));
+		TestEqual("Fingerprint does not depend on insertion order", StateA.GetFingerprint(), StateB.GetFingerprint());
+		
+		StateB.SetProperty(FName("IntProp"), FHTNProperty(2));
+		TestNotEqual("Fingerprint changes with a value", StateA.GetFingerprint(), StateB.GetFingerprint());
+	}
+	
+	// Test key change notifications
+	{
+		UHTNWorldState* WorldState = NewObject<UHTNWorldState>();
+		WorldState->SetProperty(FName("IntProp"), FHTNProperty(1));
+		
+		int32 IntPropChanges = 0;
+		int32 AnyChanges = 0;
+		WorldState->OnKeyChanged(FName("IntProp")).AddLambda([&IntPropChanges](FName) { ++IntPropChanges; });
+		WorldState->OnAnyKeyChanged().AddLambda([&AnyChanges](FName) { ++AnyChanges; });
+		
+		WorldState->SetProperty(FName("IntProp"), FHTNProperty(1));
+		TestEqual("Setting the same value notifies nobody", AnyChanges, 0);
+		
+		WorldState->SetProperty(FName("IntProp"), FHTNProperty(2));
+		WorldState->SetProperty(FName("BoolProp"), FHTNProperty(true));
+		TestEqual("Key subscribers only hear about their key", IntPropChanges, 1);
+		TestEqual("Any-key subscribers hear about every key", AnyChanges, 2);
+		
+		WorldState->RemoveProperty(FName("IntProp"));
+		TestEqual("Removing a key notifies its subscribers", IntPropChanges, 2);
+	}
+	
+	// Test layers
+	{
+		UHTNWorldState* GlobalLayer = NewObject<UHTNWorldState>();
+		UHTNWorldState* AgentState = NewObject<UHTNWorldState>();
+		AgentState->SetParentLayer(GlobalLayer);
+		GlobalLayer->SetProperty(FName("Alarm"), FHTNProperty(false));
+		AgentState->SetProperty(FName("Health"), FHTNProperty(100));
+		
+		TestTrue("Agent reads shared keys through its parent layer", AgentState->HasProperty(FName("Alarm")));
+		TestFalse("Parent layer does not see agent keys", GlobalLayer->HasProperty(FName("Health")));
+		
+		TArray<uint32> LayerVersions;
+		AgentState->GetLayerVersions(LayerVersions);
+		AgentState->SetProperty(FName("Alarm"), FHTNProperty(true));
+		TestTrue("Agent writes shared keys to the owning layer", GlobalLayer->GetPropertyValue<bool>(FName("Alarm"), false));
+		
+		TArray<FName> ChangedKeys;
+		AgentState->GetChangedKeysSince(LayerVersions, ChangedKeys);
+		TestTrue("Changes in parent layers are reported", ChangedKeys.Num() == 1 && ChangedKeys[0] == FName("Alarm"));
+		
+		UHTNWorldState* Overlay = NewObject<UHTNWorldState>();
+		Overlay->CopyFrom(AgentState);
+		Overlay->SetProperty(FName("Alarm"), FHTNProperty(false));
+		TestFalse("Overlay writes stay in the overlay", Overlay->GetPropertyValue<bool>(FName("Alarm"), true));
+		TestTrue("Overlay writes do not reach shared layers", GlobalLayer->GetPropertyValue<bool>(FName("Alarm"), false));
+		
+		FHTNWorldStateStruct Resolved;
+		AgentState->GetResolvedWorldState(Resolved);
+		TestTrue("Resolved state holds the keys of every layer", Resolved.HasProperty(FName("Alarm")) && Resolved.HasProperty(FName("Health")));
+		
+		const uint32 Fingerprint = AgentState->GetFingerprint();
+		GlobalLayer->SetProperty(FName("TimeOfDay"), FHTNProperty(12));
+		TestNotEqual("Shared layer changes change the fingerprint", AgentState->GetFingerprint(), Fingerprint);
+	}
+	
+	// Test removing keys of parent layers through an overlay
+	{
+		UHTNWorldState* BaseLayer = NewObject<UHTNWorldState>();
+		BaseLayer->SetProperty(FName("DoorOpen"), FHTNProperty(true));
+		BaseLayer->SetProperty(FName("Health"), FHTNProperty(100));
+		UHTNWorldState* Overlay = NewObject<UHTNWorldState>();
+		Overlay->SetParentLayer(BaseLayer, false);
+		const FHTNWorldStateSnapshot Snapshot = Overlay->GetSnapshot();
+		
+		const uint32 Fingerprint = Overlay->GetFingerprint();
+		TArray<uint32> LayerVersions;
+		Overlay->GetLayerVersions(LayerVersions);
+		TestTrue("Removing a key of a parent layer succeeds", Overlay->RemoveProperty(FName("DoorOpen")));
+		TestFalse("The overlay no longer has the key", Overlay->HasProperty(FName("DoorOpen")));
+		FHTNProperty Value;
+		TestFalse("The overlay no longer reads the key", Overlay->GetProperty(FName("DoorOpen"), Value));
+		TestTrue("Typed reads fall back to the default", Overlay->GetPropertyValue<bool>(FName("DoorOpen"), true));
+		TestTrue("The parent layer keeps the key", BaseLayer->GetPropertyValue<bool>(FName("DoorOpen"), false));
+		TestFalse("Removing the key again finds nothing to remove", Overlay->RemoveProperty(FName("DoorOpen")));
+		
+		TArray<FName> ChangedKeys;
+		Overlay->GetChangedKeysSince(LayerVersions, ChangedKeys);
+		TestTrue("The removal is reported as a change", ChangedKeys.Contains(FName("DoorOpen")));
+		TestTrue("Earlier snapshots keep the key", Snapshot.HasProperty(FName("DoorOpen")));
+		TestFalse("Snapshots see the removal", Overlay->GetSnapshot().HasProperty(FName("DoorOpen")));
+		
+		FHTNWorldStateStruct Resolved;
+		Overlay->GetResolvedWorldState(Resolved);
+		TestTrue("The resolved state omits the key", !Resolved.HasProperty(FName("DoorOpen")) && Resolved.HasProperty(FName("Health")));
+		
+		const int32 Slot = FHTNKeySlots::Find(FName("DoorOpen"));
+		TArray<uint64> RequiredBits;
+		RequiredBits.SetNumZeroed(Slot / 64 + 1);
+		RequiredBits[Slot / 64] = uint64(1) << (Slot % 64);
+		TestTrue("The parent layer matches the key's bit", BaseLayer->MatchesBoolBits(RequiredBits, RequiredBits));
+		TestFalse("Packed boolean checks don't read through the removal", Overlay->MatchesBoolBits(RequiredBits, RequiredBits));
+		
+		UHTNWorldState* PlanningState = NewObject<UHTNWorldState>();
+		PlanningState->CopyFrom(Overlay);
+		TestFalse("Copies of the overlay keep the removal", PlanningState->HasProperty(FName("DoorOpen")));
+		TestNotEqual("The removal changes the fingerprint", Overlay->GetFingerprint(), Fingerprint);
+		
+		Overlay->SetProperty(FName("DoorOpen"), FHTNProperty(false));
+		TestTrue("Setting the key again makes it visible", Overlay->HasProperty(FName("DoorOpen")) && !Overlay->GetPropertyValue<bool>(FName("DoorOpen"), true));
+		TArray<uint64> ExpectedFalseBits;
+		ExpectedFalseBits.SetNumZeroed(RequiredBits.Num());
+		TestTrue("Packed boolean checks see the new value", Overlay->MatchesBoolBits(RequiredBits, ExpectedFalseBits));
+	}
+	
+	// Test snapshots
+	{
+		UHTNWorldState* LiveState = NewObject<UHTNWorldState>();
+		LiveState->SetProperty(FName("Health"), FHTNProperty(100));
+		LiveState->SetProperty(FName("HasWeapon"), FHTNProperty(true));
+		
+		const FHTNWorldStateSnapshot Snapshot = LiveState->GetSnapshot();
+		TestTrue("Unchanged state snapshots share all chunks", LiveState->GetSnapshot().SharesAllChunks(Snapshot));
+		
+		LiveState->SetProperty(FName("Health"), FHTNProperty(50));
+		LiveState->RemoveProperty(FName("HasWeapon"));
+		TestEqual("Snapshots are not changed by the live state", Snapshot.Num(), 2);
+		
+		FHTNProperty Value;
+		const FHTNWorldStateSnapshot NextSnapshot = LiveState->GetSnapshot();
+		TestTrue("New snapshots see the changes", NextSnapshot.GetProperty(FName("Health"), Value) && Value.GetIntValue() == 50);
+		TestFalse("New snapshots see removals", NextSnapshot.HasProperty(FName("HasWeapon")));
+		
+		FHTNWorldStateSnapshot Copy = Snapshot;
+		Copy.SetProperty(FName("Ammo"), FHTNProperty(10));
+		TestFalse("Writes to a copy don't reach the original", Snapshot.HasProperty(FName("Ammo")));
+		TestTrue("Original keeps its values", Snapshot.GetProperty(FName("Health"), Value) && Value.GetIntValue() == 100);
+	}
+	
+	// Test packed boolean conditions
+	{
+		UHTNPropertyCondition* HasFood = NewObject<UHTNPropertyCondition>();
+		HasFood->PropertyKey = FName("HasFood");
+		HasFood->CheckType = EHTNPropertyCheckType::IsTrue;
+		UHTNPropertyCondition* IsEating = NewObject<UHTNPropertyCondition>();
+		IsEating->PropertyKey = FName("IsEating");
+		IsEating->CheckType = EHTNPropertyCheckType::IsFalse;
+		const TArray<UHTNCondition*> Conditions = { HasFood, IsEating };
+		
+		FHTNBoolConditionMask Mask;
+		UHTNWorldState* SharedLayer = NewObject<UHTNWorldState>();
+		UHTNWorldState* AgentState = NewObject<UHTNWorldState>();
+		AgentState->SetParentLayer(SharedLayer, false);
+		SharedLayer->SetProperty(FName("HasFood"), FHTNProperty(true));
+		TestFalse("Uncompiled masks check conditions one by one", Mask.CheckConditions(Conditions, AgentState));
+		TestFalse("Checking doesn't compile the mask", Mask.IsCompiled());
+		
+		Mask.Compile(Conditions);
+		TestTrue("Mask was compiled", Mask.IsCompiled() && Mask.GetRemainingConditions().Num() == 0);
+		TestFalse("Missing keys fail the mask", Mask.CheckConditions(Conditions, AgentState));
+		
+		AgentState->SetProperty(FName("IsEating"), FHTNProperty(false));
+		TestTrue("Keys resolve through layers", Mask.CheckConditions(Conditions, AgentState));
+		
+		AgentState->SetProperty(FName("HasFood"), FHTNProperty(1));
+		TestFalse("Non-boolean values in nearer layers shadow booleans", Mask.CheckConditions(Conditions, AgentState));
+		
+		AgentState->SetProperty(FName("HasFood"), FHTNProperty(true));
+		AgentState->SetProperty(FName("IsEating"), FHTNProperty(true));
+		TestFalse("Mismatched values fail the mask", Mask.CheckConditions(Conditions, AgentState));
+	}
+	
+	// Test population batch evaluation
+	{
+		UHTNPropertyCondition* HasFood = NewObject<UHTNPropertyCondition>();
+		HasFood->PropertyKey = FName("HasFood");
+		HasFood->CheckType = EHTNPropertyCheckType::IsTrue;
+		FHTNBoolConditionMask Mask;
+		Mask.Compile({ HasFood });
+		
+		FHTNWorldStatePopulation Population;
+		Population.SetNumAgents(130);
+		for (int32 AgentIndex = 0; AgentIndex < 130; AgentIndex += 3)
+		{
+			Population.SetProperty(AgentIndex, FName("HasFood"), FHTNProperty(true));
+		}
+		Population.SetProperty(1, FName("HasFood"), FHTNProperty(false));
+		Population.SetProperty(2, FName("HasFood"), FHTNProperty(5));
+		
+		TArray<uint64> AgentBits;
+		TestTrue("Boolean-only masks are exact", Population.EvaluateBoolMask(Mask, AgentBits));
+		bool bAllMatch = true;
+		for (int32 AgentIndex = 0; AgentIndex < 130; ++AgentIndex)
+		{
+			bAllMatch &= ((AgentBits[AgentIndex / 64] >> (AgentIndex % 64)) & 1) == (AgentIndex % 3 == 0 ? 1 : 0);
+		}
+		TestTrue("Batch result matches every agent", bAllMatch);
+		
+		FHTNProperty Value;
+		TestTrue("Non-boolean values are kept per agent", Population.GetProperty(2, FName("HasFood"), Value) && Value.GetIntValue() == 5);
+	}
+
+	// Test population column storage
+	{
+		UHTNWorldState* SharedLayer = NewObject<UHTNWorldState>();
+		SharedLayer->SetProperty(FName("IsNight"), FHTNProperty(true));
+		UHTNWorldState* AgentState = NewObject<UHTNWorldState>();
+		AgentState->SetParentLayer(SharedLayer, false);
+		AgentState->SetProperty(FName("Health"), FHTNProperty(80));
+		AgentState->SetProperty(FName("IsHungry"), FHTNProperty(false));
+
+		FHTNWorldStatePopulation Population;
+		Population.SetNumAgents(70);
+		Population.SetProperty(3, FName("Stale"), FHTNProperty(true));
+		Population.CopyFromWorldState(3, AgentState);
+		Population.CopyFromWorldState(66, AgentState);
+
+		FHTNProperty Value;
+		TestTrue("Copied states are resolved through their layers", Population.GetProperty(3, FName("IsNight"), Value) && Value.GetBoolValue());
+		TestFalse("Copying replaces the agent's properties", Population.GetProperty(3, FName("Stale"), Value));
+		TestFalse("Other agents are left empty", Population.GetProperty(4, FName("Health"), Value));
+		TestFalse("Agents out of range hold nothing", Population.GetProperty(70, FName("Health"), Value));
+
+		const TArray<FName> Keys = { FName("Health"), FName("IsNight"), FName("IsHungry") };
+		TestTrue("Agents with the same values compare equal across words", Population.HasEqualProperties(3, 66, Keys));
+		TestEqual("Agents with the same values have the same fingerprint", Population.GetFingerprint(3, Keys), Population.GetFingerprint(66, Keys));
+		Population.SetProperty(66, FName("Health"), FHTNProperty(20));
+		TestFalse("Changed values compare unequal", Population.HasEqualProperties(3, 66, Keys));
+		Population.RemoveProperty(66, FName("Health"));
+		TestFalse("Removed values compare unequal", Population.HasEqualProperties(3, 66, Keys));
+
+		UHTNWorldState* CopiedState = NewObject<UHTNWorldState>();
+		CopiedState->SetProperty(FName("Stale"), FHTNProperty(1));
+		Population.CopyToWorldState(3, CopiedState);
+		TestEqual("Agents copy back to flat states", CopiedState->GetStableFingerprint(), AgentState->GetStableFingerprint());
+		TestFalse("Copying back replaces the state's properties", CopiedState->HasProperty(FName("Stale")));
+
+		// Agents dropped and added back start out empty, including in a partly used last word
+		Population.SetNumAgents(66);
+		Population.SetNumAgents(70);
+		TestFalse("Re-added agents hold nothing", Population.GetProperty(66, FName("IsNight"), Value));
+		TestTrue("Kept agents keep their values", Population.GetProperty(3, FName("Health"), Value) && Value.GetIntValue() == 80);
+
+		UHTNPropertyCondition* IsNotHungry = NewObject<UHTNPropertyCondition>();
+		IsNotHungry->PropertyKey = FName("IsHungry");
+		IsNotHungry->CheckType = EHTNPropertyCheckType::IsFalse;
+		UHTNPropertyCondition* HasHealth = NewObject<UHTNPropertyCondition>();
+		HasHealth->PropertyKey = FName("Health");
+		HasHealth->CheckType = EHTNPropertyCheckType::Exists;
+		FHTNBoolConditionMask Mask;
+		Mask.Compile({ IsNotHungry, HasHealth });
+
+		TArray<uint64> AgentBits;
+		TestFalse("Masks with non-boolean conditions are not exact", Population.EvaluateBoolMask(Mask, AgentBits));
+		TestTrue("The boolean part is evaluated per agent", AgentBits.Num() == 2 && AgentBits[0] == (uint64(1) << 3) && AgentBits[1] == 0);
+
+		UHTNPropertyCondition* IsArmed = NewObject<UHTNPropertyCondition>();
+		IsArmed->PropertyKey = FName("IsArmedInPopulationTest");
+		IsArmed->CheckType = EHTNPropertyCheckType::IsTrue;
+		Mask.Compile({ IsArmed });
+		TestTrue("Keys no agent holds fail every agent", Population.EvaluateBoolMask(Mask, AgentBits) && AgentBits[0] == 0 && AgentBits[1] == 0);
+	}
+	
+	// Test stable fingerprints of layered states
+	{
+		UHTNWorldState* GlobalLayer = NewObject<UHTNWorldState>();
+		GlobalLayer->SetProperty(FName("IsNight"), FHTNProperty(true));
+		UHTNWorldState* AgentState = NewObject<UHTNWorldState>();
+		AgentState->SetParentLayer(GlobalLayer);
+		AgentState->SetProperty(FName("Health"), FHTNProperty(100));
+		
+		UHTNWorldState* FlatState = NewObject<UHTNWorldState>();
+		FlatState->SetProperty(FName("Health"), FHTNProperty(100));
+		FlatState->SetProperty(FName("IsNight"), FHTNProperty(true));
+		TestEqual("Layered and flat states with the same facts match", AgentState->GetStableFingerprint(), FlatState->GetStableFingerprint());
+		
+		GlobalLayer->SetProperty(FName("IsNight"), FHTNProperty(false));
+		TestNotEqual("Parent layer changes are seen", AgentState->GetStableFingerprint(), FlatState->GetStableFingerprint());
+	}
+	
 	return true;
 }
 
@@ -0,0 +1,73 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UHTNCondition;
+class UHTNWorldState;
+
+/**
+ * A list of conditions compiled for fast checking.
+ * Conditions that only require a boolean key to hold a value (see UHTNCondition::GetRequiredBoolValue) are packed
+ * into bit masks over the key slots, so all of them are checked with one AND and compare per 64 keys.
+ * The other conditions are checked one by one as before.
+ * Owners compile the mask whenever their condition list is set or changed, on the game thread;
+ * afterwards it is only read, so planners on other threads can check it freely.
+ */
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNBoolConditionMask
+{
+public:
+	/**
+	 * Check a condition list through the mask.
+	 * Uncompiled masks check the list one condition at a time.
+	 * @param Conditions - The condition list this mask was compiled from
+	 * @param WorldState - The world state to check against
+	 * @return True if every condition is satisfied
+	 */
+	bool CheckConditions(const TArray<UHTNCondition*>& Conditions, const UHTNWorldState* WorldState) const;
+
+	/**
+	 * Compile a condition list, replacing what was compiled before.
+	 * Must not be called while the mask is being checked.
+	 * @param Conditions - The conditions to compile
+	 */
+	void Compile(const TArray<UHTNCondition*>& Conditions);
+
+	/**
+	 * Check whether Compile was called.
+	 * @return True if the mask is compiled
+	 */
+	bool IsCompiled() const { return bCompiled; }
+
+	/**
+	 * Get the keys that must hold a boolean, one bit per key slot (see FHTNKeySlots).
+	 * @return The required bits
+	 */
+	TConstArrayView<uint64> GetRequiredBits() const { return RequiredBits; }
+
+	/**
+	 * Get which of the required keys must be true.
+	 * @return The expected bits, the same size as the required bits
+	 */
+	TConstArrayView<uint64> GetExpectedTrueBits() const { return ExpectedTrueBits; }
+
+	/**
+	 * Get the conditions that couldn't be packed into the masks.
+	 * @return The remaining conditions
+	 */
+	const TArray<const UHTNCondition*>& GetRemainingConditions() const { return RemainingConditions; }
+
+private:
+	/** Keys that must hold a boolean, one bit per key slot */
+	TArray<uint64> RequiredBits;
+
+	/** Which of the required keys must be true */
+	TArray<uint64> ExpectedTrueBits;
+
+	/** Conditions that couldn't be packed into the masks */
+	TArray<const UHTNCondition*> RemainingConditions;
+
+	/** Whether Compile was called */
+	bool bCompiled = false;
+};
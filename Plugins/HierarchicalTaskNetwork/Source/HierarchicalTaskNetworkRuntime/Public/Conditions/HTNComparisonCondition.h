@@ -44,6 +44,7 @@ public:
     virtual bool CheckCondition_Implementation(const UHTNWorldState* WorldState) const override;
     virtual FString GetDescription_Implementation() const override;
     virtual bool ValidateCondition_Implementation() const override;
+    virtual bool GetReadKeys(TArray<FName>& OutKeys) const override;
     //~ End UHTNCondition Interface
 
 protected:
@@ -29,6 +29,49 @@ public:
 	bool CheckCondition(const UHTNWorldState* WorldState) const;
 	virtual bool CheckCondition_Implementation(const UHTNWorldState* WorldState) const;
 
+	/**
+	 * Gets the world state keys this condition reads.
+	 * Used to only re-check conditions whose keys changed.
+	 * 
+	 * @param OutKeys - Array the keys are appended to
+	 * @return True if the keys are known, false if the condition may read any key
+	 */
+	virtual bool GetReadKeys(TArray<FName>& OutKeys) const;
+
+	/**
+	 * Gets the boolean key and value this condition requires, if that is all it checks.
+	 * Such conditions are checked together as bit masks (see FHTNBoolConditionMask).
+	 * 
+	 * @param OutKey - The boolean key the condition reads
+	 * @param bOutExpectedValue - The value the key must hold
+	 * @return True if the condition is met exactly when the key holds a boolean equal to the expected value
+	 */
+	virtual bool GetRequiredBoolValue(FName& OutKey, bool& bOutExpectedValue) const;
+
+	/**
+	 * Gets the number of authored conditions this condition checks.
+	 * A condition of a cooked domain can stand for several, and traces number preconditions as they were authored.
+	 * 
+	 * @return The number of authored conditions
+	 */
+	virtual int32 GetNumConditions() const;
+
+	/**
+	 * Finds the first of this condition's authored conditions that isn't satisfied.
+	 * 
+	 * @param WorldState - The world state to check against
+	 * @return The index of the failed condition among GetNumConditions(), or INDEX_NONE if the condition is satisfied
+	 */
+	virtual int32 FindFailedCondition(const UHTNWorldState* WorldState) const;
+
+	/**
+	 * Gets a human-readable description of one of this condition's authored conditions.
+	 * 
+	 * @param ConditionIndex - The index of the authored condition among GetNumConditions()
+	 * @return String description of the authored condition
+	 */
+	virtual FString DescribeCondition(int32 ConditionIndex) const;
+
 	/**
 	 * Gets a human-readable description of this condition.
 	 * 
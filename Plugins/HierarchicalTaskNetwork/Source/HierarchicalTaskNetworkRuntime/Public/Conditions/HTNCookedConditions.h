@@ -0,0 +1,49 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HTNCondition.h"
+#include "HTNCookedConditions.generated.h"
+
+struct FHTNDomainBlob;
+
+/**
+ * Property conditions of a cooked domain, checked straight from its blob's condition table.
+ * Stands in for a run of property conditions, so loading a cooked domain doesn't create an object per condition.
+ */
+UCLASS(NotBlueprintable, NotEditInlineNew, HideDropdown)
+class HIERARCHICALTASKNETWORKRUNTIME_API UHTNCookedConditions : public UHTNCondition
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Point this object at condition records of a blob.
+	 * 
+	 * @param InBlob - The blob, kept alive by this object
+	 * @param InFirstCondition - The first record
+	 * @param InNumConditions - The number of records
+	 */
+	void Initialize(TSharedRef<const FHTNDomainBlob, ESPMode::ThreadSafe> InBlob, int32 InFirstCondition, int32 InNumConditions);
+
+	//~ Begin UHTNCondition Interface
+	virtual bool CheckCondition_Implementation(const UHTNWorldState* WorldState) const override;
+	virtual FString GetDescription_Implementation() const override;
+	virtual bool GetReadKeys(TArray<FName>& OutKeys) const override;
+	virtual bool GetRequiredBoolValue(FName& OutKey, bool& bOutExpectedValue) const override;
+	virtual int32 GetNumConditions() const override { return NumConditions; }
+	virtual int32 FindFailedCondition(const UHTNWorldState* WorldState) const override;
+	virtual FString DescribeCondition(int32 ConditionIndex) const override;
+	//~ End UHTNCondition Interface
+
+private:
+	/** The blob holding the records */
+	TSharedPtr<const FHTNDomainBlob, ESPMode::ThreadSafe> Blob;
+
+	/** The first record */
+	int32 FirstCondition = 0;
+
+	/** The number of records */
+	int32 NumConditions = 0;
+};
@@ -47,8 +47,21 @@ public:
 	virtual bool CheckCondition_Implementation(const UHTNWorldState* WorldState) const override;
 	virtual FString GetDescription_Implementation() const override;
 	virtual bool ValidateCondition_Implementation() const override;
+	virtual bool GetReadKeys(TArray<FName>& OutKeys) const override;
+	virtual bool GetRequiredBoolValue(FName& OutKey, bool& bOutExpectedValue) const override;
 	//~ End UHTNCondition Interface
 
+	/**
+	 * Check a world state property the way this condition does.
+	 * 
+	 * @param WorldState - The world state to check against
+	 * @param Key - The key of the property to check
+	 * @param InCheckType - The type of check to perform
+	 * @param InCompareValue - The value to compare against (for Equals and NotEquals)
+	 * @return True if the check passes
+	 */
+	static bool CheckProperty(const UHTNWorldState* WorldState, FName Key, EHTNPropertyCheckType InCheckType, const FHTNProperty& InCompareValue);
+
 	/** The key of the property to check */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Condition")
 	FName PropertyKey;
@@ -0,0 +1,46 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HTNEffect.h"
+#include "HTNCookedEffects.generated.h"
+
+struct FHTNDomainBlob;
+
+/**
+ * Property effects of a cooked domain, applied straight from its blob's effect table.
+ * Stands in for a run of set and toggle effects, so loading a cooked domain doesn't create an object per effect.
+ */
+UCLASS(NotBlueprintable, NotEditInlineNew, HideDropdown)
+class HIERARCHICALTASKNETWORKRUNTIME_API UHTNCookedEffects : public UHTNEffect
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Point this object at effect records of a blob.
+	 * 
+	 * @param InBlob - The blob, kept alive by this object
+	 * @param InFirstEffect - The first record
+	 * @param InNumEffects - The number of records, applied in order
+	 */
+	void Initialize(TSharedRef<const FHTNDomainBlob, ESPMode::ThreadSafe> InBlob, int32 InFirstEffect, int32 InNumEffects);
+
+	//~ Begin UHTNEffect Interface
+	virtual void ApplyEffect_Implementation(UHTNWorldState* WorldState) const override;
+	virtual FString GetDescription_Implementation() const override;
+	virtual bool GetWriteKeys(TArray<FName>& OutKeys) const override;
+	virtual bool GetReadKeys(TArray<FName>& OutKeys) const override;
+	//~ End UHTNEffect Interface
+
+private:
+	/** The blob holding the records */
+	TSharedPtr<const FHTNDomainBlob, ESPMode::ThreadSafe> Blob;
+
+	/** The first record */
+	int32 FirstEffect = 0;
+
+	/** The number of records */
+	int32 NumEffects = 0;
+};
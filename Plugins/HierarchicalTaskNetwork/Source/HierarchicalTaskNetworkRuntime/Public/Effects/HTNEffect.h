@@ -28,6 +28,24 @@ public:
 	void ApplyEffect(UHTNWorldState* WorldState) const;
 	virtual void ApplyEffect_Implementation(UHTNWorldState* WorldState) const;
 
+	/**
+	 * Gets the world state keys this effect writes.
+	 * Used to only propagate the keys an effect can change.
+	 * 
+	 * @param OutKeys - Array the keys are appended to
+	 * @return True if the keys are known, false if the effect may write any key
+	 */
+	virtual bool GetWriteKeys(TArray<FName>& OutKeys) const;
+
+	/**
+	 * Gets the world state keys this effect reads while it is applied.
+	 * Used to order tasks whose effects depend on values other tasks write.
+	 * 
+	 * @param OutKeys - Array the keys are appended to
+	 * @return True if the keys are known, false if the effect may read any key
+	 */
+	virtual bool GetReadKeys(TArray<FName>& OutKeys) const;
+
 	/**
 	 * Gets a human-readable description of this effect.
 	 * 
@@ -22,6 +22,8 @@ public:
 	virtual void ApplyEffect_Implementation(UHTNWorldState* WorldState) const override;
 	virtual FString GetDescription_Implementation() const override;
 	virtual bool ValidateEffect_Implementation() const override;
+	virtual bool GetWriteKeys(TArray<FName>& OutKeys) const override;
+	virtual bool GetReadKeys(TArray<FName>& OutKeys) const override;
 	//~ End UHTNEffect Interface
 
 	/** The key of the property to set */
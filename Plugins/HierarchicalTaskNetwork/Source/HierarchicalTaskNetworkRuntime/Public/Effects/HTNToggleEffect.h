@@ -21,9 +21,24 @@ public:
 	virtual void ApplyEffect_Implementation(UHTNWorldState* WorldState) const override;
 	virtual FString GetDescription_Implementation() const override;
 	virtual bool ValidateEffect_Implementation() const override;
+	virtual bool GetWriteKeys(TArray<FName>& OutKeys) const override;
+	virtual bool GetReadKeys(TArray<FName>& OutKeys) const override;
 	//~ End UHTNEffect Interface
 
+	/**
+	 * Toggle a world state property the way this effect does.
+	 * 
+	 * @param WorldState - The world state to modify
+	 * @param Key - The key of the boolean property to toggle
+	 * @param bInSetTrueIfMissing - Whether a missing or non-boolean property becomes true rather than false
+	 * @param bInForceValue - Whether to set InForcedValue instead of toggling
+	 * @param InForcedValue - The value to set when forcing
+	 */
+	static void ToggleProperty(UHTNWorldState* WorldState, FName Key, bool bInSetTrueIfMissing, bool bInForceValue, bool InForcedValue);
+
 protected:
+	friend struct FHTNDomainBlob;
+
 	/** The key of the boolean property to toggle */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Effect")
 	FName PropertyKey;
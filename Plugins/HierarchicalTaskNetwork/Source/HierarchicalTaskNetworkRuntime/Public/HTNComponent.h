@@ -11,6 +11,7 @@
 #include "HTNComponent.generated.h"
 
 class UHTNPlanExecutor;
+class UHTNSensor;
 
 /**
  * Component that manages HTN planning and plan execution for an actor.
@@ -77,13 +78,33 @@ public:
 
     /**
      * Configures if automatic replanning should be done during ticking.
+     * Automatic replanning is driven by changes to the world state keys the current plan and goals read.
      * 
      * @param bEnable - Whether to enable automatic replanning
-     * @param CheckInterval - How often to check for replan needs (in seconds)
+     * @param CheckInterval - Minimum time between two replan checks (in seconds)
      */
     UFUNCTION(BlueprintCallable, Category = "AI|HTN")
     void SetAutoReplanEnabled(bool bEnable, float CheckInterval = 0.5f);
 
+    /**
+     * Plans the follow-up plan from the world state the current plan is predicted to end in,
+     * and queues it on the executor so it starts as soon as the current plan completes.
+     * Called automatically once PlanAheadTaskCount or fewer tasks remain and at least one task has finished.
+     * Planning runs synchronously on the calling thread.
+     * 
+     * @return True if a follow-up plan was queued, false otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "AI|HTN")
+    bool PlanAhead();
+
+    /**
+     * Gets the time before which no automatic replan is attempted, pushed back after failed planning attempts.
+     * 
+     * @return World time in seconds, 0 if replanning is not backed off
+     */
+    UFUNCTION(BlueprintPure, Category = "AI|HTN")
+    float GetNextReplanTime() const { return NextReplanTime; }
+
     /**
      * Handles basic error recovery when the plan fails
      */
@@ -163,6 +184,16 @@ public:
     UFUNCTION(BlueprintCallable, Category = "AI|HTN|Debug")
     class UHTNDebugVisualizationComponent* CreateVisualizationComponent();
 
+    /**
+     * Gathers the keys read by the method conditions, preconditions and effects a task may decompose into.
+     * 
+     * @param Task - The task to gather from
+     * @param VisitedTasks - Tasks already gathered, to stop at recursive decompositions
+     * @param OutKeys - Set the keys are added to
+     * @return True if the keys are known, false if some condition or effect may read any key
+     */
+    static bool GatherTaskReadKeys(const UHTNTask* Task, TSet<const UHTNTask*>& VisitedTasks, TSet<FName>& OutKeys);
+
 protected:
     /** World state for planning and execution */
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI|HTN")
@@ -180,13 +211,67 @@ protected:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "AI|HTN|Debug")
     bool bDebugOutput;
 
+    /** Whether the world state resolves shared facts through the squad and global world state layers */
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI|HTN|Layers")
+    bool bUseSharedWorldStateLayers;
+
+    /** Squad whose shared layer sits between this agent's world state and the global layer (None = global layer only) */
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI|HTN|Layers", meta = (EditCondition = "bUseSharedWorldStateLayers"))
+    FName SquadName;
+
     UPROPERTY(BlueprintReadOnly, Category = "AI|HTN")
     UHTNDFSPlanner* Planner;
 
+    /**
+     * Sensors writing to this component's world state.
+     * They are updated by the world's sensor scheduler; changed keys invalidate the plan on the next replan check.
+     */
+    UPROPERTY(EditAnywhere, Instanced, BlueprintReadOnly, Category = "AI|HTN|Sensors")
+    TArray<UHTNSensor*> Sensors;
+
    private:
     /** Initializes the component */
     void Initialize();
 
+    /** Attaches the world state to the shared squad or global layer, unless it already has a parent layer */
+    void AttachSharedWorldStateLayers();
+
+    /** Registers the sensors with the world's sensor scheduler */
+    void RegisterSensors();
+
+    /** Unregisters the sensors from the world's sensor scheduler */
+    void UnregisterSensors();
+
+    /** Gets the planner configuration used for all plans of this component */
+    FHTNPlanningConfig GetPlanningConfig() const;
+
+    /** Repairs the plan around its failed task and resumes it, if the last plan ended with a task failure */
+    bool RepairFailedPlan();
+
+    /** Subscribes to changes of every key read by the remaining plan and the goal tasks, replacing the previous subscriptions */
+    void UpdateKeySubscriptions();
+
+    /** Removes all key change subscriptions */
+    void ClearKeySubscriptions();
+
+    /** Requests a replan check, called when a watched key changes */
+    void OnWatchedKeyChanged(FName Key);
+
+    /**
+     * Computes the fingerprint the negative plan cache is keyed on.
+     * 
+     * @param GoalTasks - The goal tasks being planned for
+     * @return Fingerprint of the world state and goals
+     */
+    uint32 GetPlanRequestFingerprint(const TArray<UHTNTask*>& GoalTasks) const;
+
+    /**
+     * Delays the next automatic replan after a failed planning attempt.
+     * 
+     * @param bHopeless - Whether the failure is cached, so retrying is pointless until the world state changes
+     */
+    void BackOffReplanning(bool bHopeless);
+
     /** Outputs a debug message */
     void DebugMessage(const FString& Message) const;
     
@@ -194,19 +279,114 @@ protected:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "AI|HTN", meta = (AllowPrivateAccess = "true"))
     bool bAutoReplanEnabled;
     
-    /** How often to check for replan needs (in seconds) */
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "AI|HTN", meta = (AllowPrivateAccess = "true", ClampMin = "0.1"))
+    /**
+     * Minimum time between two replan checks (in seconds, 0 = at most once per frame).
+     * Replan checks only run when a watched key changed or the plan ended; changes in between are coalesced.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "AI|HTN", meta = (AllowPrivateAccess = "true", ClampMin = "0.0"))
     float ReplanCheckInterval;
     
+    /**
+     * Number of remaining tasks at which the follow-up plan is computed ahead of time (0 = disabled).
+     * Planning ahead runs synchronously on the game thread, in the tick the threshold is reached, so it
+     * only pays off for plans long enough that the current plan has made progress by then; it never
+     * triggers before the first task of a plan has finished. Only used while automatic replanning is enabled.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "AI|HTN", meta = (AllowPrivateAccess = "true", ClampMin = "0"))
+    int32 PlanAheadTaskCount;
+    
+    /** Delay before the first automatic replan after a failed planning attempt (in seconds, 0 = no backoff) */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "AI|HTN|Backoff", meta = (AllowPrivateAccess = "true", ClampMin = "0.0"))
+    float ReplanBackoffDelay;
+    
+    /** Factor the backoff delay grows by with every further consecutive failure */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "AI|HTN|Backoff", meta = (AllowPrivateAccess = "true", ClampMin = "1.0"))
+    float ReplanBackoffMultiplier;
+    
+    /** Upper limit of the backoff delay (in seconds) */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "AI|HTN|Backoff", meta = (AllowPrivateAccess = "true", ClampMin = "0.0"))
+    float MaxReplanBackoffDelay;
+    
+    /**
+     * Number of hopeless planning requests remembered (0 = disabled).
+     * A request whose world state and goals match a remembered failure fails without searching.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "AI|HTN|Backoff", meta = (AllowPrivateAccess = "true", ClampMin = "0"))
+    int32 NegativePlanCacheSize;
+    
+    /**
+     * Whether to look plans up in the cache shared by all agents before searching, and add the plans found to it.
+     * The cache also holds the plans precomputed for loaded domains (see UHTNPlanCacheSubsystem).
+     * Cached plans don't keep their decomposition, so plans that record it are always searched for.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "AI|HTN|Planning", meta = (AllowPrivateAccess = "true"))
+    bool bUseSharedPlanCache;
+    
+    /**
+     * Number of times in a row a plan whose task failed is repaired before replanning from the goals (0 = always replan).
+     * A repair only decomposes again the nearest compound task above the failed task, and keeps the rest of the plan.
+     * Repairs need every plan to record its decomposition, which costs a node per decomposed task and keeps plans
+     * out of the shared plan cache, so they are off by default.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "AI|HTN|Planning", meta = (AllowPrivateAccess = "true", ClampMin = "0"))
+    int32 MaxConsecutivePlanRepairs;
+    
     /** Time of the last replan check */
     float LastReplanCheckTime;
     
+    /** Time before which no automatic replan is attempted, set after failures */
+    float NextReplanTime;
+    
+    /** Fingerprints of planning requests that found no plan, oldest first */
+    TArray<uint32> NegativePlanCache;
+    
+    /** Whether a watched key changed or the plan ended since the last replan check */
+    bool bReplanRequested;
+    
+    /** World state the key subscriptions are on */
+    TWeakObjectPtr<UHTNWorldState> SubscribedWorldState;
+    
+    /** A change subscription on one layer of the world state */
+    struct FKeySubscription
+    {
+        /** The world state layer subscribed to */
+        TWeakObjectPtr<UHTNWorldState> Layer;
+        
+        /** The key subscribed to, or NAME_None for all keys */
+        FName Key;
+        
+        FDelegateHandle Handle;
+    };
+    
+    /** Subscriptions on the world state and each of its shared layers */
+    TArray<FKeySubscription> KeySubscriptions;
+    
+    /** Whether the subscriptions are to all keys, because some condition does not report its keys */
+    bool bWatchingAllKeys;
+    
+    /** Plan execution the key subscriptions were made for (0 = no plan executing) */
+    uint32 SubscribedExecutionId;
+    
+    /** Plan execution the follow-up plan was last computed for, so it is attempted once per plan */
+    uint32 PlannedAheadExecutionId;
+    
+    /** Result of the last planning operation, reused so planning does not allocate a new one */
+    UPROPERTY(Transient)
+    FHTNPlannerResult PlannerResult;
+    
+    /** World state the follow-up plan is planned from, reused across plans */
+    UPROPERTY(Transient)
+    UHTNWorldState* PlanAheadWorldState;
+    
     /** The goal tasks used for the current plan (saved for replanning) */
     UPROPERTY()
     TArray<UHTNTask*> CurrentGoalTasks;
     
     /** Number of consecutive plan failures */
     int32 ConsecutivePlanFailures;
+    
+    /** Number of plan repairs since a plan was last generated from the goals */
+    int32 ConsecutivePlanRepairs;
 
     FHTNPlan EmptyPlan;
 };
\ No newline at end of file
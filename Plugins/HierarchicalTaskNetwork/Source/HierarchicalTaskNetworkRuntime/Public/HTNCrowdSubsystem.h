@@ -0,0 +1,353 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HTNPlannerBase.h"
+#include "HTNTaskIndex.h"
+#include "HTNWorldStatePopulation.h"
+#include "HTNCrowdSubsystem.generated.h"
+
+class UHTNExecutionContext;
+class UHTNPrimitiveTask;
+class UHTNWorldState;
+
+/**
+ * Handle of a crowd agent. Handles of removed agents stay invalid when their index is reused.
+ */
+USTRUCT(BlueprintType)
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNCrowdAgentHandle
+{
+    GENERATED_BODY()
+
+    /** Index of the agent in the crowd's fragment arrays */
+    UPROPERTY()
+    int32 Index = INDEX_NONE;
+
+    /** Serial number the index had when the agent was added */
+    UPROPERTY()
+    int32 Serial = 0;
+
+    bool IsSet() const { return Index != INDEX_NONE; }
+    bool operator==(const FHTNCrowdAgentHandle& Other) const { return Index == Other.Index && Serial == Other.Serial; }
+};
+
+/**
+ * A domain shared by crowd agents: its goal tasks, and every primitive task its plans use, addressed by index.
+ */
+USTRUCT()
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNCrowdDomain
+{
+    GENERATED_BODY()
+
+    /** Tasks every agent of the domain plans for */
+    UPROPERTY()
+    TArray<UHTNTask*> GoalTasks;
+
+    /** Primitive tasks plans are stored as indices into */
+    UPROPERTY()
+    TArray<UHTNPrimitiveTask*> Tasks;
+
+    /** Index of each task in Tasks */
+    TMap<const UHTNPrimitiveTask*, uint16> TaskIndices;
+
+    /** Keys the goal tasks' decompositions read; agents agreeing on them get the same plan */
+    TArray<FName> ReadKeys;
+
+    /** Whether some condition may read any key, so agents can't be grouped */
+    bool bReadsAnyKey = false;
+
+    /** Every primitive task the goal tasks can decompose into, by ID, for loading serialized plans */
+    FHTNTaskIndex TaskIndex;
+
+    /**
+     * Get the index of a task, adding it to the table if needed.
+     * @param Task - The task
+     * @return The index, or INDEX_NONE if the table is full
+     */
+    int32 FindOrAddTask(UHTNPrimitiveTask* Task);
+};
+
+/**
+ * Plan fragment of a crowd agent: its plan as indices into its domain's task table.
+ */
+struct FHTNCrowdPlanFragment
+{
+    /** Plan steps */
+    TArray<uint16> TaskIndices;
+
+    /** Step being executed, INDEX_NONE without a plan */
+    int32 CurrentStep = INDEX_NONE;
+
+    bool HasPlan() const { return TaskIndices.IsValidIndex(CurrentStep); }
+};
+
+/**
+ * Execution fragment of a crowd agent: the runtime state of its current step.
+ */
+struct FHTNCrowdExecutionFragment
+{
+    /** Instance memory of the current step's task */
+    TArray<uint8, TAlignedHeapAllocator<16>> TaskMemory;
+
+    /** Whether the current step's task was started */
+    bool bTaskStarted = false;
+
+    /** Status reported by the last thread-safe tick, applied on the game thread */
+    EHTNTaskStatus PendingStatus = EHTNTaskStatus::Invalid;
+
+    /** Seconds until the agent may plan again after planning or a plan step failed */
+    float PlanCooldown = 0.0f;
+};
+
+/**
+ * Runs HTN agents that need no actor, component or UObjects of their own, for crowds and ambient life.
+ * Agents are rows in fragment arrays: world states live in a shared column store (see FHTNWorldStatePopulation),
+ * plans are index arrays into a shared domain, and task memory is a plain byte block. Agents are processed in
+ * fixed-size chunks: thread-safe task ticks of all chunks run in parallel, everything else runs on the game thread
+ * through an adapter that loads an agent into a reusable world state and execution context, so the existing task
+ * and planner classes work unchanged.
+ * 
+ * Tasks that complete through completion handles need an executor and are not supported; they must complete from
+ * their tick.
+ */
+UCLASS()
+class HIERARCHICALTASKNETWORKRUNTIME_API UHTNCrowdSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    UHTNCrowdSubsystem();
+
+    //~ Begin USubsystem Interface
+    virtual void Deinitialize() override;
+    //~ End USubsystem Interface
+
+    //~ Begin FTickableGameObject Interface
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+    //~ End FTickableGameObject Interface
+
+    /**
+     * Get the crowd subsystem of the world an object belongs to.
+     * 
+     * @param WorldContextObject - Any object in the world
+     * @return The subsystem, or nullptr if the object has no world
+     */
+    static UHTNCrowdSubsystem* Get(const UObject* WorldContextObject);
+
+    /**
+     * Register a domain crowd agents can be added with.
+     * 
+     * @param GoalTasks - The tasks agents of the domain plan for
+     * @return The domain index
+     */
+    int32 RegisterDomain(const TArray<UHTNTask*>& GoalTasks);
+
+    /**
+     * Get the task index of a domain, for resolving tasks of plans saved with it.
+     * 
+     * @param DomainIndex - The domain returned by RegisterDomain
+     * @return The task index, or nullptr if the domain doesn't exist
+     */
+    const FHTNTaskIndex* GetTaskIndex(int32 DomainIndex) const { return Domains.IsValidIndex(DomainIndex) ? &Domains[DomainIndex].TaskIndex : nullptr; }
+
+    /**
+     * Add an agent.
+     * 
+     * @param DomainIndex - The domain returned by RegisterDomain
+     * @param InitialWorldState - World state to copy, resolved through its layers, or nullptr to start empty
+     * @param Owner - Actor tasks see as the owner, or nullptr
+     * @return The agent's handle, unset if the domain is invalid
+     */
+    FHTNCrowdAgentHandle AddAgent(int32 DomainIndex, const UHTNWorldState* InitialWorldState = nullptr, AActor* Owner = nullptr);
+
+    /**
+     * Remove an agent, aborting its current task.
+     * 
+     * @param Agent - The agent to remove
+     */
+    void RemoveAgent(FHTNCrowdAgentHandle Agent);
+
+    /**
+     * Check whether a handle refers to a live agent.
+     * 
+     * @param Agent - The handle
+     * @return True if the agent exists
+     */
+    bool IsValidAgent(FHTNCrowdAgentHandle Agent) const;
+
+    /**
+     * Get the number of live agents.
+     * 
+     * @return The number of agents
+     */
+    int32 GetNumAgents() const { return NumAgents; }
+
+    /**
+     * Get the world states of all agents, indexed by agent handle index.
+     * 
+     * @return The world state population
+     */
+    FHTNWorldStatePopulation& GetWorldStates() { return WorldStates; }
+    const FHTNWorldStatePopulation& GetWorldStates() const { return WorldStates; }
+
+    /**
+     * Get an agent's plan.
+     * 
+     * @param Agent - The agent
+     * @return The plan fragment, or nullptr if the agent doesn't exist
+     */
+    const FHTNCrowdPlanFragment* GetPlan(FHTNCrowdAgentHandle Agent) const;
+
+    /**
+     * Drop an agent's plan, aborting its current task, so it plans again on the next tick.
+     * 
+     * @param Agent - The agent
+     */
+    void ResetPlan(FHTNCrowdAgentHandle Agent);
+
+    /** Planning configuration used for all agents */
+    UPROPERTY(EditAnywhere, Category = "HTN|Crowd")
+    FHTNPlanningConfig PlanningConfig;
+
+    /** Agents processed together; thread-safe ticks are dispatched one chunk per worker */
+    UPROPERTY(EditAnywhere, Category = "HTN|Crowd", meta = (ClampMin = "1"))
+    int32 ChunkSize;
+
+    /** Maximum number of agents planned per tick (0 = no limit) */
+    UPROPERTY(EditAnywhere, Category = "HTN|Crowd", meta = (ClampMin = "0"))
+    int32 MaxPlansPerTick;
+
+    /** Seconds an agent waits before planning again after planning failed */
+    UPROPERTY(EditAnywhere, Category = "HTN|Crowd", meta = (ClampMin = "0.0"))
+    float ReplanDelay;
+
+    /**
+     * Group agents waiting for a plan by the values of the keys their domain reads, plan once per group and
+     * give every agent of the group the result. MaxPlansPerTick then counts planner runs, not agents.
+     */
+    UPROPERTY(EditAnywhere, Category = "HTN|Crowd")
+    bool bBatchPlanning;
+
+protected:
+    /**
+     * Plan for agents without a plan, round robin up to MaxPlansPerTick.
+     * 
+     * @param DeltaTime - Time in seconds since the last tick
+     */
+    void PlanAgents(float DeltaTime);
+
+    /**
+     * Start, tick and finish the current step of every agent with a plan.
+     * 
+     * @param DeltaTime - Time in seconds since the last tick
+     */
+    void ExecuteAgents(float DeltaTime);
+
+    /**
+     * Plan for one agent through the adapter.
+     * 
+     * @param AgentIndex - The agent
+     */
+    void PlanAgent(int32 AgentIndex);
+
+    /**
+     * Plan once for a group of agents of one domain that agree on the domain's read keys.
+     * 
+     * @param AgentIndices - The agents; the first one is planned for
+     */
+    void PlanAgentGroup(TConstArrayView<int32> AgentIndices);
+
+    /**
+     * Finish the current step of an agent and move to the next one, or drop the plan if the step failed.
+     * 
+     * @param AgentIndex - The agent, loaded into the adapter
+     * @param Status - The final status of the step
+     */
+    void CompleteStep(int32 AgentIndex, EHTNTaskStatus Status);
+
+    /**
+     * Abort the current task of an agent, if started, and release its memory.
+     * 
+     * @param AgentIndex - The agent
+     */
+    void StopCurrentTask(int32 AgentIndex);
+
+    /**
+     * Load an agent into the adapter world state and execution context.
+     * 
+     * @param AgentIndex - The agent
+     */
+    void LoadAdapter(int32 AgentIndex);
+
+    /**
+     * Write the adapter world state back to an agent if a task changed it.
+     * 
+     * @param AgentIndex - The agent loaded into the adapter
+     */
+    void StoreAdapter(int32 AgentIndex);
+
+    /**
+     * Get the task of an agent's current step.
+     * 
+     * @param AgentIndex - The agent
+     * @return The task, or nullptr without a plan
+     */
+    UHTNPrimitiveTask* GetCurrentTask(int32 AgentIndex) const;
+
+    /** Registered domains */
+    UPROPERTY(Transient)
+    TArray<FHTNCrowdDomain> Domains;
+
+    /** World state fragments */
+    FHTNWorldStatePopulation WorldStates;
+
+    /** Domain of each agent, INDEX_NONE for free rows */
+    TArray<int32> AgentDomains;
+
+    /** Serial of each row, incremented when the row is freed */
+    TArray<int32> AgentSerials;
+
+    /** Owner actor of each agent */
+    TArray<TWeakObjectPtr<AActor>> AgentOwners;
+
+    /** Plan fragments */
+    TArray<FHTNCrowdPlanFragment> Plans;
+
+    /** Execution fragments */
+    TArray<FHTNCrowdExecutionFragment> Executions;
+
+    /** Rows free for reuse */
+    TArray<int32> FreeIndices;
+
+    /** Number of live agents */
+    int32 NumAgents = 0;
+
+    /** Row the next planning pass starts at */
+    int32 NextPlanIndex = 0;
+
+    /** Planner shared by all agents */
+    UPROPERTY(Transient)
+    UHTNPlannerBase* Planner;
+
+    /** Result reused by every planning call */
+    UPROPERTY(Transient)
+    FHTNPlannerResult PlannerResult;
+
+    /** World state agents are loaded into on the game thread */
+    UPROPERTY(Transient)
+    UHTNWorldState* AdapterWorldState;
+
+    /** Execution context tasks see on the game thread */
+    UPROPERTY(Transient)
+    UHTNExecutionContext* AdapterContext;
+
+    /** Version of the adapter world state right after loading, to detect task writes */
+    uint32 LoadedAdapterVersion = 0;
+
+    /** World states thread-safe ticks read, one per chunk */
+    UPROPERTY(Transient)
+    TArray<UHTNWorldState*> ChunkWorldStates;
+};
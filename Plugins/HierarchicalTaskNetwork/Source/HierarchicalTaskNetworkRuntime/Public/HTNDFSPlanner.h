@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "HTNPlannerBase.h"
+#include "HTNPlannerTrace.h"
 #include "Tasks/HTNTask.h"
 #include "Tasks/HTNPrimitiveTask.h"
 #include "HTNDFSPlanner.generated.h"
@@ -28,6 +29,12 @@ public:
         const TArray<UHTNTask*>& GoalTasks,
         const FHTNPlanningConfig& Config) override;
 
+    virtual bool GeneratePlanInto(
+        const UHTNWorldState* WorldState,
+        const TArray<UHTNTask*>& GoalTasks,
+        const FHTNPlanningConfig& Config,
+        FHTNPlannerResult& OutResult) override;
+
     virtual bool ValidatePlan(
         const FHTNPlan& Plan,
         const UHTNWorldState* WorldState) override;
@@ -41,6 +48,37 @@ public:
     virtual void ConfigurePlanner(const FHTNPlanningConfig& NewConfig) override;
     //~ End IHTNPlannerInterface
 
+    /**
+     * Get the events of the most recent planning operation.
+     * 
+     * @return The trace, empty if the operation was not traced
+     */
+    const FHTNPlannerTrace& GetTrace() const { return Trace; }
+
+    /**
+     * Repair a plan after one of its tasks failed, re-decomposing only the nearest compound task above it
+     * that can still be decomposed in the current world state, instead of the goals.
+     * The tasks after that compound task are kept, and must remain valid after the new decomposition.
+     * Requires a plan generated with the decomposition recorded (see FHTNPlanningConfig::bRecordDecomposition).
+     * 
+     * @param Plan - The plan with the failed task
+     * @param FailedTaskIndex - Index of the failed task
+     * @param WorldState - The current world state
+     * @param Config - Configuration parameters for the planning process
+     * @param OutResult - Overwritten with the result; the repaired plan keeps the tasks before FailedTaskIndex, and resumes there
+     * @param CompletedTaskIndices - Tasks that already ran, which in parallel or dependency-based execution can come after
+     *                               FailedTaskIndex. Kept tasks among them are left out of the repaired plan; tasks depending on them
+     *                               find their dependencies met. Ones the repaired compound task spans are decomposed again.
+     * @return True if the plan was repaired, false otherwise
+     */
+    bool RepairPlan(
+        const FHTNPlan& Plan,
+        int32 FailedTaskIndex,
+        const UHTNWorldState* WorldState,
+        const FHTNPlanningConfig& Config,
+        FHTNPlannerResult& OutResult,
+        TConstArrayView<int32> CompletedTaskIndices = TConstArrayView<int32>());
+
 protected:
     /** Planning metrics for the most recent planning operation */
     struct FPlanningMetrics
@@ -50,7 +88,6 @@ protected:
         int32 MaxDepthReached;
         float StartTime;
         float EndTime;
-        FString DebugInfo;
 
         FPlanningMetrics()
             : NodesExplored(0)
@@ -68,7 +105,6 @@ protected:
             MaxDepthReached = 0;
             StartTime = FPlatformTime::Seconds();
             EndTime = 0.0f;
-            DebugInfo.Reset();
         }
 
         void Finish()
@@ -80,34 +116,79 @@ protected:
         {
             return EndTime > StartTime ? EndTime - StartTime : 0.0f;
         }
-
-        void AppendDebugInfo(const FString& Info, bool bDetailedDebugging)
-        {
-            if (bDetailedDebugging)
-            {
-                DebugInfo.Append(Info);
-                DebugInfo.Append(TEXT("\n"));
-            }
-        }
     };
 
     /** Current metrics for the ongoing planning operation */
     FPlanningMetrics Metrics;
 
+    /** Events of the most recent planning operation, recorded when the configuration traces (see IsTracing) */
+    FHTNPlannerTrace Trace;
+
+    /** Whether the current planning operation records its events */
+    bool IsTracing() const { return Configuration.bRecordTrace || Configuration.bDetailedDebugging; }
+
+    /**
+     * Working world states, one per search depth, reused across planning operations.
+     * The state at a depth is only written while expanding a primitive task one level up,
+     * so backtracking never needs the overwritten contents again.
+     */
+    UPROPERTY(Transient)
+    TArray<UHTNWorldState*> WorkingStates;
+
+    /**
+     * Get the working world state of a search depth, loaded as an overlay of another state.
+     * Shared layers of the source are read through rather than copied.
+     * 
+     * @param Depth - The search depth
+     * @param Source - The state to copy
+     * @return The working state
+     */
+    UHTNWorldState* GetWorkingState(int32 Depth, const UHTNWorldState* Source);
+
+    /**
+     * Decomposition nodes of the current search path, when the configuration records the decomposition.
+     * Backtracking truncates it to where the abandoned branch began.
+     */
+    TArray<FHTNDecompositionNode> DecompositionTrail;
+
+    /**
+     * Primitive tasks of the current search path, in plan order.
+     * Backtracking truncates it to where the abandoned branch began.
+     */
+    TArray<UHTNPrimitiveTask*> PlanTrail;
+
+    /**
+     * Tasks that still need to be processed on the current search path, as a stack with the next task last.
+     * A decomposition pushes its subtasks, and backtracking truncates the agenda and puts the task back.
+     */
+    TArray<UHTNTask*> TaskAgenda;
+
+    /** Decomposition node each task on the agenda came from (only when recording the decomposition) */
+    TArray<int32> AgendaParents;
+
+    /** Subtasks of the method being applied, moved onto the agenda before the search goes deeper */
+    TArray<UHTNTask*> MethodSubtasks;
+
+    /**
+     * Set up the search trails for a new search.
+     * 
+     * @param Tasks - The tasks to plan, in order
+     * @param ParentNodeIndex - Decomposition node the tasks came from (only when recording the decomposition)
+     * @param InitialPlan - The plan the found tasks are appended to
+     */
+    void BeginSearch(const TArray<UHTNTask*>& Tasks, int32 ParentNodeIndex, const TArray<UHTNPrimitiveTask*>& InitialPlan);
+
     /**
-     * Recursive depth-first search function to find a valid plan.
+     * Recursive depth-first search function to find a valid plan for the tasks on the agenda.
+     * The search trails are left as they were when no plan is found.
      * 
      * @param WorldState - The current world state
-     * @param RemainingTasks - Tasks that still need to be processed
-     * @param CurrentPlan - The plan built so far
      * @param CurrentDepth - Current recursion depth
      * @param OutPlan - The resulting plan if successful
      * @return True if a valid plan was found, false otherwise
      */
     bool FindPlanDFS(
         const UHTNWorldState* WorldState,
-        const TArray<UHTNTask*>& RemainingTasks,
-        const TArray<UHTNPrimitiveTask*>& CurrentPlan,
         int32 CurrentDepth,
         FHTNPlan& OutPlan);
 
@@ -116,8 +197,7 @@ protected:
      * 
      * @param WorldState - The current world state
      * @param Task - The task to process
-     * @param RemainingTasks - Remaining tasks after this one
-     * @param CurrentPlan - The plan built so far
+     * @param ParentNodeIndex - Decomposition node the task came from (only when recording the decomposition)
      * @param CurrentDepth - Current recursion depth
      * @param OutPlan - The resulting plan if successful
      * @return True if processing was successful, false otherwise
@@ -125,8 +205,7 @@ protected:
     bool ProcessTask(
         const UHTNWorldState* WorldState,
         UHTNTask* Task,
-        const TArray<UHTNTask*>& RemainingTasks,
-        const TArray<UHTNPrimitiveTask*>& CurrentPlan,
+        int32 ParentNodeIndex,
         int32 CurrentDepth,
         FHTNPlan& OutPlan);
 
@@ -151,11 +230,12 @@ protected:
 
     /**
      * Populate a planner result structure with the current metrics.
+     * The plan itself is written to the result by the search; its task dependencies are inferred here if configured.
      * 
      * @param Success - Whether planning was successful
-     * @param Plan - The generated plan (only valid if Success is true)
      * @param FailReason - The reason for failure (only valid if Success is false)
-     * @return The populated planner result structure
+     * @param OutResult - The result to populate
+     * @return Success
      */
-    FHTNPlannerResult CreatePlannerResult(bool Success, const FHTNPlan& Plan, EHTNPlannerFailReason FailReason);
+    bool FillPlannerResult(bool Success, EHTNPlannerFailReason FailReason, FHTNPlannerResult& OutResult);
 };
\ No newline at end of file
@@ -0,0 +1,82 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HTNPlanCacheSubsystem.h"
+#include "HTNTaskIndex.h"
+#include "HTNWorldStateStruct.h"
+#include "HTNDomainAsset.generated.h"
+
+class UHTNTask;
+struct FHTNDomainBlob;
+
+/**
+ * Asset holding an HTN domain: the goal tasks agents plan for, with their whole task hierarchy.
+ * When cooked, the hierarchy is saved as a single domain blob (see FHTNDomainBlob) instead of as node objects,
+ * and recreated from the blob on load.
+ * Plans for the domain's common start states can be computed offline and shipped with it (see BuildWarmPlanCache);
+ * they seed the shared plan cache (see UHTNPlanCacheSubsystem) when the domain loads.
+ */
+UCLASS(BlueprintType)
+class HIERARCHICALTASKNETWORKRUNTIME_API UHTNDomainAsset : public UObject
+{
+    GENERATED_BODY()
+
+public:
+    /**
+     * Gets the domain's goal tasks.
+     * 
+     * @return The goal tasks
+     */
+    UFUNCTION(BlueprintCallable, Category = "HTN|Domain")
+    const TArray<UHTNTask*>& GetGoalTasks() const;
+
+    /**
+     * Gets the index of the domain's primitive tasks by ID, for loading plans saved with this domain.
+     * 
+     * @return The task index
+     */
+    const FHTNTaskIndex& GetTaskIndex() const { return TaskIndex; }
+
+#if WITH_EDITOR
+    /**
+     * Plan offline for every archetype start state and store the plans with the domain.
+     * Start states no plan is found for are left out with a warning.
+     * 
+     * @return Number of plans stored
+     */
+    UFUNCTION(CallInEditor, Category = "HTN|Domain")
+    int32 BuildWarmPlanCache();
+#endif
+
+    //~ Begin UObject Interface
+    virtual void Serialize(FArchive& Ar) override;
+    virtual void PostLoad() override;
+    //~ End UObject Interface
+
+#if WITH_EDITORONLY_DATA
+    /** Tasks agents using this domain plan for, as authored */
+    UPROPERTY(EditAnywhere, Instanced, Category = "HTN|Domain")
+    TArray<UHTNTask*> GoalTasks;
+
+    /** Start states many agents plan from, such as spawn states, planned for offline by BuildWarmPlanCache */
+    UPROPERTY(EditAnywhere, Category = "HTN|Domain|Warm Plan Cache")
+    TArray<FHTNWorldStateStruct> ArchetypeStartStates;
+#endif
+
+    /** Plans precomputed for the archetype start states, keyed like the shared plan cache */
+    UPROPERTY(VisibleAnywhere, Category = "HTN|Domain|Warm Plan Cache")
+    TArray<FHTNWarmPlan> WarmPlans;
+
+private:
+    /** Goal tasks recreated from the cooked blob */
+    UPROPERTY(Transient)
+    TArray<UHTNTask*> CookedGoalTasks;
+
+    /** Blob loaded with a cooked asset; its cooked conditions and effects read from it */
+    TSharedPtr<FHTNDomainBlob, ESPMode::ThreadSafe> CookedBlob;
+
+    /** Primitive tasks by ID */
+    FHTNTaskIndex TaskIndex;
+};
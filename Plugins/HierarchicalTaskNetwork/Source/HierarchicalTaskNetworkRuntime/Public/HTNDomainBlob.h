@@ -0,0 +1,242 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HTNProperty.h"
+
+class UHTNTask;
+class UHTNWorldState;
+
+/**
+ * A domain compiled into one flat binary blob: task, method, condition and effect tables, a string table
+ * and the schema of world state keys the domain uses. Tables have fixed-size records and are read in place,
+ * so loading a blob only verifies it and fixes up names, key slots and classes.
+ *
+ * Property conditions and set/toggle effects are stored as table records and evaluated from the blob
+ * (see UHTNCookedConditions and UHTNCookedEffects). Tasks, methods, and any other condition or effect,
+ * including Blueprint ones, are stored as their class and non-default properties and recreated as objects,
+ * since planning and execution run on them.
+ */
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNDomainBlob : public TSharedFromThis<FHTNDomainBlob, ESPMode::ThreadSafe>
+{
+public:
+    /** Current blob version */
+    static constexpr int32 Version = 1;
+
+    /**
+     * Compile a domain into a blob.
+     *
+     * @param GoalTasks - The domain's goal tasks
+     * @param OutData - The blob
+     * @return True if the domain was compiled
+     */
+    static bool Compile(TConstArrayView<UHTNTask*> GoalTasks, TArray<uint8>& OutData);
+
+    /**
+     * Take ownership of blob data and fix it up for use.
+     *
+     * @param InData - The blob
+     * @return True if the blob is valid
+     */
+    bool Initialize(TArray<uint8>&& InData);
+
+    /**
+     * Fix up blob data owned elsewhere, for example a mapped file region, which must outlive this object.
+     *
+     * @param InData - The blob
+     * @return True if the blob is valid
+     */
+    bool InitializeView(TConstArrayView<uint8> InData);
+
+    /**
+     * Check whether the blob was initialized successfully.
+     *
+     * @return True if the blob can be used
+     */
+    bool IsValid() const { return bValid; }
+
+    /**
+     * Recreate the domain's task objects.
+     * Property conditions and set/toggle effects stay records, referenced by cooked condition and effect objects
+     * that keep this blob alive, so the blob must be owned by a shared pointer.
+     *
+     * @param Outer - Outer of the created objects
+     * @param OutGoalTasks - The domain's goal tasks
+     * @return True if every node could be recreated
+     */
+    bool CreateTasks(UObject* Outer, TArray<UHTNTask*>& OutGoalTasks) const;
+
+    /**
+     * Check a condition record.
+     *
+     * @param ConditionIndex - The record
+     * @param WorldState - The world state to check against
+     * @return True if the condition is satisfied
+     */
+    bool CheckCondition(int32 ConditionIndex, const UHTNWorldState* WorldState) const;
+
+    /**
+     * Apply an effect record.
+     *
+     * @param EffectIndex - The record
+     * @param WorldState - The world state to modify
+     */
+    void ApplyEffect(int32 EffectIndex, UHTNWorldState* WorldState) const;
+
+    /**
+     * Get the world state key a condition record reads.
+     *
+     * @param ConditionIndex - The record
+     * @return The key
+     */
+    FName GetConditionKey(int32 ConditionIndex) const;
+
+    /**
+     * Get the boolean value a condition record requires, if that is all it checks.
+     *
+     * @param ConditionIndex - The record
+     * @param bOutExpectedValue - The value the key must hold
+     * @return True if the record is met exactly when its key holds a boolean equal to the expected value
+     */
+    bool GetConditionRequiredBoolValue(int32 ConditionIndex, bool& bOutExpectedValue) const;
+
+    /**
+     * Get the world state key an effect record writes.
+     *
+     * @param EffectIndex - The record
+     * @return The key
+     */
+    FName GetEffectKey(int32 EffectIndex) const;
+
+    /**
+     * Get the world state key an effect record reads: the source of a copy, or the key of a toggle.
+     *
+     * @param EffectIndex - The record
+     * @return The key, or None if the record reads no key
+     */
+    FName GetEffectReadKey(int32 EffectIndex) const;
+
+    /**
+     * Describe a condition record.
+     *
+     * @param ConditionIndex - The record
+     * @return The description
+     */
+    FString DescribeCondition(int32 ConditionIndex) const;
+
+    /**
+     * Describe an effect record.
+     *
+     * @param EffectIndex - The record
+     * @return The description
+     */
+    FString DescribeEffect(int32 EffectIndex) const;
+
+    /**
+     * Get the keys of the domain's schema, in schema order.
+     *
+     * @return The keys
+     */
+    const TArray<FName>& GetSchemaKeys() const { return SchemaKeys; }
+
+    /**
+     * Get the global key slots of the domain's schema (see FHTNKeySlots), in schema order.
+     *
+     * @return The slots
+     */
+    const TArray<int32>& GetSchemaSlots() const { return SchemaSlots; }
+
+private:
+    /** Tables of the blob, in table of contents order */
+    enum ESection : int32
+    {
+        Section_Strings,
+        Section_Schema,
+        Section_Goals,
+        Section_Tasks,
+        Section_Methods,
+        Section_TaskRefs,
+        Section_Conditions,
+        Section_Effects,
+        Section_Objects,
+        Section_ObjectData,
+        Section_Count
+    };
+
+    /** Offset and element count of a table */
+    struct FSection
+    {
+        int32 Offset = 0;
+        int32 Num = 0;
+    };
+
+    friend struct FHTNDomainBlobCompiler;
+
+    /**
+     * Verify the blob and fix up names and key slots.
+     *
+     * @return True if the blob is valid
+     */
+    bool FixUp();
+
+    /**
+     * Read a 32-bit field of a table record.
+     *
+     * @param Section - The table
+     * @param RecordIndex - The record
+     * @param FieldIndex - The field
+     * @return The field value
+     */
+    uint32 ReadField(ESection Section, int32 RecordIndex, int32 FieldIndex) const;
+
+    /**
+     * Read the value stored in a condition or effect record.
+     *
+     * @param Section - The table
+     * @param RecordIndex - The record
+     * @return The value
+     */
+    FHTNProperty ReadValue(ESection Section, int32 RecordIndex) const;
+
+    /**
+     * Read a string table entry with its exact case.
+     *
+     * @param StringIndex - The entry
+     * @return The string
+     */
+    FString ReadString(uint32 StringIndex) const;
+
+    /**
+     * Create the object stored in an object record.
+     *
+     * @param ObjectIndex - The object record
+     * @param Outer - Outer of the object
+     * @return The object, or nullptr if its class is missing
+     */
+    UObject* CreateObject(int32 ObjectIndex, UObject* Outer) const;
+
+    /** Owned blob data, empty for views */
+    TArray<uint8> OwnedData;
+
+    /** The blob */
+    TConstArrayView<uint8> Data;
+
+    /** Tables */
+    FSection Sections[Section_Count];
+
+    /** Offset of each string table entry */
+    TArray<int32> StringOffsets;
+
+    /** String table entries as names */
+    TArray<FName> Names;
+
+    /** Schema keys */
+    TArray<FName> SchemaKeys;
+
+    /** Global slots of the schema keys */
+    TArray<int32> SchemaSlots;
+
+    /** Whether the blob passed its checks */
+    bool bValid = false;
+};
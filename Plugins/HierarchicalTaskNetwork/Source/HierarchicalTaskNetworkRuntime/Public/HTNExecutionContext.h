@@ -3,8 +3,11 @@
 #include "CoreMinimal.h"
 #include "HTNWorldStateStruct.h"
 #include "HTNProperty.h"
+#include "HTNTaskCompletionQueue.h"
 #include "HTNExecutionContext.generated.h"
 
+class UHTNPlanExecutor;
+
 /**
  * Execution context for HTN tasks.
  * This class manages the state and resources during plan execution,
@@ -80,6 +83,11 @@ public:
      */
     void ClearParameters();
 
+    /**
+     * Resets the context for a new plan, keeping the world state and the parameter map's allocation.
+     */
+    void Reset();
+
     /**
      * Creates a string representation of this context for debugging.
      * @return A string representation
@@ -111,6 +119,48 @@ public:
     template<typename T>
     void SetParameterValue(FName Key, const T& Value);
 
+    /**
+     * Gets the instance memory of the task currently being executed with this context.
+     * Only valid while the executor is calling into a task.
+     * @return The raw task memory, or nullptr if no task is active
+     */
+    FORCEINLINE uint8* GetActiveTaskMemory() const { return ActiveTaskMemory; }
+
+    /**
+     * Sets the instance memory of the task currently being executed with this context.
+     * @param InTaskMemory - The task memory, or nullptr to clear it
+     */
+    FORCEINLINE void SetActiveTaskMemory(uint8* InTaskMemory) { ActiveTaskMemory = InTaskMemory; }
+
+    /**
+     * Gets the instance memory of the active task cast to the task's memory struct.
+     * @return The typed task memory, or nullptr if no task is active
+     */
+    template<typename TMemory>
+    TMemory* GetTaskMemory() const
+    {
+        return reinterpret_cast<TMemory*>(ActiveTaskMemory);
+    }
+
+    /**
+     * Gets the plan executor currently running with this context.
+     * @return The executor, or nullptr if no plan is running
+     */
+    FORCEINLINE UHTNPlanExecutor* GetExecutor() const { return Executor.Get(); }
+
+    /**
+     * Sets the plan executor running with this context.
+     * @param InExecutor - The executor
+     */
+    FORCEINLINE void SetExecutor(UHTNPlanExecutor* InExecutor) { Executor = InExecutor; }
+
+    /**
+     * Creates a handle asynchronous work can use to finish the active task, or report results, from any thread.
+     * Only valid while the executor is calling into a task.
+     * @return The handle, invalid if there is no active task or its executor is not ticked by a manager
+     */
+    FHTNTaskCompletionHandle MakeCompletionHandle() const;
+
 private:
     /** The current world state */
     UPROPERTY()
@@ -119,6 +169,41 @@ private:
     /** Parameters shared between tasks */
     UPROPERTY()
     TMap<FName, FHTNProperty> Parameters;
+
+    /** Instance memory of the task currently being executed (owned by the plan executor) */
+    uint8* ActiveTaskMemory;
+
+    /** Executor running the current plan with this context */
+    TWeakObjectPtr<UHTNPlanExecutor> Executor;
+};
+
+/**
+ * Scoped helper that binds a task's instance memory to an execution context
+ * for the duration of a call into the task, restoring the previous binding on exit.
+ */
+struct FHTNTaskMemoryScope
+{
+    FHTNTaskMemoryScope(UHTNExecutionContext* InContext, uint8* InTaskMemory)
+        : Context(InContext)
+        , PreviousMemory(InContext ? InContext->GetActiveTaskMemory() : nullptr)
+    {
+        if (Context)
+        {
+            Context->SetActiveTaskMemory(InTaskMemory);
+        }
+    }
+
+    ~FHTNTaskMemoryScope()
+    {
+        if (Context)
+        {
+            Context->SetActiveTaskMemory(PreviousMemory);
+        }
+    }
+
+private:
+    UHTNExecutionContext* Context;
+    uint8* PreviousMemory;
 };
 
 // Template specializations for type-safe parameter access
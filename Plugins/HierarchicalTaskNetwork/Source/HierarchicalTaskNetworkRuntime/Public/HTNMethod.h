@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
 #include "Conditions/HTNCondition.h"
+#include "Conditions/HTNBoolConditionMask.h"
 #include "HTNMethod.generated.h"
 
 class UHTNTask;
@@ -21,6 +22,13 @@ class HIERARCHICALTASKNETWORKRUNTIME_API UHTNMethod : public UObject
 public:
     UHTNMethod();
 
+    //~ Begin UObject Interface
+    virtual void PostLoad() override;
+#if WITH_EDITOR
+    virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+    //~ End UObject Interface
+
     /**
      * Checks if this method is applicable in the given world state.
      * 
@@ -69,6 +77,13 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Method", meta = (ClampMin = "0.0"))
     float Priority;
  
+    /**
+     * Compile Conditions for checking (see FHTNBoolConditionMask).
+     * Call on the game thread after changing Conditions, before the method is planned with again.
+     * Until then the method checks its conditions one by one.
+     */
+    void CompileConditions();
+
     /** Conditions that must be satisfied for this method to be applicable */
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Instanced, Category = "Method|Conditions")
     TArray<UHTNCondition*> Conditions;
@@ -76,4 +91,8 @@ public:
     /** Subtasks that this method provides for decomposition */
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Instanced, Category = "Method|Subtasks")
     TArray<UHTNTask*> Subtasks;
+
+private:
+    /** Conditions compiled for checking, see CompileConditions */
+    FHTNBoolConditionMask ConditionMask;
 };
\ No newline at end of file
@@ -7,6 +7,11 @@
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "HTNPlan.generated.h"
 
+class UHTNMethod;
+class UHTNTask;
+struct FHTNTaskIndex;
+template <class CharType> class TJsonReader;
+
 /**
  * Enum defining the possible statuses of a plan during execution.
  */
@@ -32,6 +37,45 @@ enum class EHTNPlanStatus : uint8
  Aborted UMETA(DisplayName = "Aborted")
 };
 
+/**
+ * A node of the decomposition tree of a plan: a task the planner processed and the span of plan tasks it produced.
+ */
+USTRUCT(BlueprintType)
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNDecompositionNode
+{
+    GENERATED_BODY()
+
+    FHTNDecompositionNode() = default;
+
+    FHTNDecompositionNode(UHTNTask* InTask, int32 InParentIndex, int32 InFirstTaskIndex, int32 InNumTasks)
+        : Task(InTask)
+        , ParentIndex(InParentIndex)
+        , FirstTaskIndex(InFirstTaskIndex)
+        , NumTasks(InNumTasks)
+    {
+    }
+
+    /** The compound or primitive task */
+    UPROPERTY(BlueprintReadOnly, Category = "HTN|Plan")
+    UHTNTask* Task = nullptr;
+
+    /** The method chosen to decompose a compound task; nullptr for primitive tasks */
+    UPROPERTY(BlueprintReadOnly, Category = "HTN|Plan")
+    UHTNMethod* Method = nullptr;
+
+    /** Index of the node whose method produced this task, or INDEX_NONE for goal tasks */
+    UPROPERTY(BlueprintReadOnly, Category = "HTN|Plan")
+    int32 ParentIndex = INDEX_NONE;
+
+    /** Index of the first plan task this node produced */
+    UPROPERTY(BlueprintReadOnly, Category = "HTN|Plan")
+    int32 FirstTaskIndex = 0;
+
+    /** Number of consecutive plan tasks this node produced */
+    UPROPERTY(BlueprintReadOnly, Category = "HTN|Plan")
+    int32 NumTasks = 0;
+};
+
 /**
  * Structure representing a complete plan generated by the HTN planner.
  * A plan is an ordered sequence of primitive tasks to be executed.
@@ -121,6 +165,14 @@ public:
     
     /** Dependencies between tasks (key: task index, value: dependent task indices) */
     TMap<int32, TArray<int32>> TaskDependencies;
+    
+    /**
+     * The decompositions that produced the tasks, in depth-first order, so every node comes after its parent
+     * and the nodes of a subtree are contiguous. Only recorded when planning with
+     * FHTNPlanningConfig::bRecordDecomposition, and not serialized, since it references method objects.
+     */
+    UPROPERTY(BlueprintReadOnly, Category = "HTN|Plan")
+    TArray<FHTNDecompositionNode> Decomposition;
 
     /**
      * Gets a string representation of this plan for debugging.
@@ -203,6 +255,7 @@ public:
     
     /**
      * Extracts a subplan from this plan.
+     * The decomposition nodes that produced the extracted tasks are kept, with their spans clipped to the subplan.
      * 
      * @param StartIndex - The starting task index
      * @param EndIndex - The ending task index (inclusive)
@@ -220,6 +273,15 @@ public:
      */
     bool ReplaceSection(int32 StartIndex, int32 EndIndex, const FHTNPlan& ReplacementPlan);
     
+    /**
+     * Removes tasks from this plan, such as tasks that already ran.
+     * Dependencies on removed tasks are dropped as met, the nodes of removed tasks are dropped from the decomposition,
+     * and the other nodes' spans shrink to match.
+     * 
+     * @param TaskIndices - Indices of the tasks to remove; invalid indices are ignored
+     */
+    void RemoveTasks(TConstArrayView<int32> TaskIndices);
+    
     /**
      * Finds tasks in the plan by name.
      * 
@@ -293,6 +355,38 @@ public:
      */
     bool AreTaskDependenciesSatisfied(int32 TaskIndex) const;
     
+    /**
+     * Replaces the task dependencies with the fewest that keep the plan correct when independent tasks run in parallel.
+     * A task depends on the last earlier writer of each key its preconditions or effects read or its effects write,
+     * and on the earlier readers of each key it writes since that key was last written.
+     * Tasks whose keys are unknown are ordered after all tasks before them and before all tasks after them.
+     * Dependencies implied through other dependencies are left out.
+     */
+    void InferTaskDependencies();
+    
+    /**
+     * Finds the decomposition node of a plan task.
+     * 
+     * @param TaskIndex - The index of the task
+     * @return The index of the primitive task's node, or INDEX_NONE if no decomposition was recorded
+     */
+    int32 FindDecompositionNode(int32 TaskIndex) const;
+    
+    /**
+     * Gets the cost of the tasks a decomposition node produced.
+     * 
+     * @param NodeIndex - The index of the node
+     * @return The summed cost of the node's span of tasks
+     */
+    float GetDecompositionNodeCost(int32 NodeIndex) const;
+    
+    /**
+     * Gets an indented representation of the decomposition tree for debugging.
+     * 
+     * @return The tree, one node per line, or an empty string if no decomposition was recorded
+     */
+    FString GetDecompositionString() const;
+    
     /**
      * Serializes the plan to JSON format.
      * 
@@ -304,12 +398,22 @@ public:
      * Deserializes a plan from JSON format.
      * 
      * @param JsonString - The JSON string to parse
+     * @param TaskIndex - Index to resolve task IDs against; without one, tasks are loaded as null
      * @return True if deserialization was successful, false otherwise
      */
-    bool FromJson(const FString& JsonString);
+    bool FromJson(const FString& JsonString, const FHTNTaskIndex* TaskIndex = nullptr);
     
     /**
-     * Serializes the plan to binary format.
+     * Deserializes a plan from a JSON token stream, without building an object tree.
+     * 
+     * @param Reader - Reader positioned just after the plan object's start
+     * @param TaskIndex - Index to resolve task IDs against; without one, tasks are loaded as null
+     * @return True if deserialization was successful, false otherwise
+     */
+    bool ReadJson(TJsonReader<TCHAR>& Reader, const FHTNTaskIndex* TaskIndex = nullptr);
+    
+    /**
+     * Serializes the plan to binary format (version 2: string table, varints and a checksum).
      * 
      * @param OutData - The binary data
      * @return True if serialization was successful
@@ -317,13 +421,35 @@ public:
     bool ToBinary(TArray<uint8>& OutData);
     
     /**
-     * Deserializes a plan from binary format.
+     * Deserializes a plan from binary format, version 1 or 2.
      * 
      * @param InData - The binary data
      * @return True if deserialization was successful
      */
     bool FromBinary(const TArray<uint8>& InData);
     
+    /**
+     * Encodes the changes from one plan to another, so a replan can be sent without the whole plan.
+     * The delta keeps the tasks both plans start with and lists the rest of the new plan, each task as the index
+     * of the same task in the old plan or, if the old plan doesn't have it, its task ID. The execution state,
+     * changed parameters and results, and the dependencies if they changed follow.
+     * 
+     * @param OldPlan - The plan the receiver has
+     * @param NewPlan - The plan the receiver should have
+     * @param OutDelta - The encoded delta
+     */
+    static void ComputeDelta(const FHTNPlan& OldPlan, const FHTNPlan& NewPlan, TArray<uint8>& OutDelta);
+    
+    /**
+     * Applies a delta from ComputeDelta to this plan, which must have the old plan's tasks.
+     * The patched plan has no decomposition, since deltas don't carry one.
+     * 
+     * @param Delta - The encoded delta
+     * @param TaskIndex - Index to resolve tasks the old plan doesn't have; without one, they are loaded as null
+     * @return True if the delta was applied; otherwise the plan is left unchanged
+     */
+    bool ApplyDelta(TConstArrayView<uint8> Delta, const FHTNTaskIndex* TaskIndex = nullptr);
+    
     /**
      * Creates a visual representation of the plan as a graph.
      * 
@@ -337,6 +463,17 @@ public:
      * @return A string containing the execution preview
      */
     FString CreateExecutionPreview() const;
+
+private:
+    friend struct FHTNPlanView;
+
+    /**
+     * Deserializes a plan from version 2 binary data.
+     * 
+     * @param InData - The binary data, starting with the version
+     * @return True if deserialization was successful
+     */
+    bool FromBinaryV2(TConstArrayView<uint8> InData);
 };
 
 /**
@@ -4,6 +4,8 @@
 #include "HTNPlannerBase.h"
 #include "HTNPlanAsset.generated.h"
 
+struct FHTNTaskIndex;
+
 /**
  * Asset representing a saved HTN plan template.
  * This allows plans to be saved to disk and reused.
@@ -62,6 +64,16 @@ public:
     UFUNCTION(BlueprintCallable, Category = "HTN|Plan|Asset")
     static UHTNPlanAsset* LoadFromJson(const FString& JsonString, UObject* OuterObject = nullptr);
     
+    /**
+     * Loads a plan asset from a JSON string, resolving the plan's tasks by ID.
+     * 
+     * @param JsonString - The JSON representation of the plan
+     * @param TaskIndex - Index of the domain's tasks; without one, tasks are loaded as null
+     * @param OuterObject - Outer object for the new asset (defaults to transient package)
+     * @return The created plan asset, or nullptr if loading failed
+     */
+    static UHTNPlanAsset* LoadFromJsonWithTaskIndex(const FString& JsonString, const FHTNTaskIndex* TaskIndex, UObject* OuterObject = nullptr);
+    
     /**
      * Saves the plan asset to a JSON string.
      * 
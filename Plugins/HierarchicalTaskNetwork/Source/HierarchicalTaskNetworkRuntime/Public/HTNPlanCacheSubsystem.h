@@ -0,0 +1,151 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "HTNPlan.h"
+#include "HTNPlanCacheSubsystem.generated.h"
+
+class UHTNDomainAsset;
+class UHTNPrimitiveTask;
+class UHTNTask;
+class UHTNWorldState;
+struct FHTNWorldStateStruct;
+
+/**
+ * A plan computed offline for a domain, stored with the domain asset and seeded into the shared plan cache on load.
+ * Tasks are stored by ID, so the plan survives the domain's tasks being recreated.
+ */
+USTRUCT()
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNWarmPlan
+{
+    GENERATED_BODY()
+
+    /** Stable fingerprint of the start state and goals the plan was computed for */
+    UPROPERTY(VisibleAnywhere, Category = "HTN|Plan")
+    uint32 Fingerprint = 0;
+
+    /** IDs of the plan's tasks, in order */
+    UPROPERTY(VisibleAnywhere, Category = "HTN|Plan")
+    TArray<FGuid> TaskIDs;
+
+    /** Total cost of the plan */
+    UPROPERTY(VisibleAnywhere, Category = "HTN|Plan")
+    float Cost = 0.0f;
+};
+
+/**
+ * A plan held by the shared plan cache.
+ */
+USTRUCT()
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNCachedPlan
+{
+    GENERATED_BODY()
+
+    /** The plan's tasks, in order; weak so the cache doesn't keep unloaded domains alive */
+    UPROPERTY()
+    TArray<TWeakObjectPtr<UHTNPrimitiveTask>> Tasks;
+
+    /** Total cost of the plan */
+    UPROPERTY()
+    float Cost = 0.0f;
+
+    /** Whether the plan was precomputed, in which case it is never evicted */
+    UPROPERTY()
+    bool bWarm = false;
+};
+
+/**
+ * Engine subsystem holding plans shared by every agent, keyed by a stable fingerprint of the start state and goals.
+ * It is seeded with the plans precomputed for each loaded domain's archetype start states (see
+ * UHTNDomainAsset::BuildWarmPlanCache), so agents in a common start state skip their first search,
+ * and it remembers the plans found at runtime up to MaxRuntimePlans.
+ */
+UCLASS()
+class HIERARCHICALTASKNETWORKRUNTIME_API UHTNPlanCacheSubsystem : public UEngineSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    UHTNPlanCacheSubsystem();
+
+    /**
+     * Get the shared plan cache.
+     *
+     * @return The cache, or nullptr if the engine isn't running
+     */
+    static UHTNPlanCacheSubsystem* Get();
+
+    /**
+     * Get the key of a planning request, the same in every process.
+     *
+     * @param WorldState - The start state
+     * @param GoalTasks - The goals
+     * @return The fingerprint
+     */
+    static uint32 GetRequestFingerprint(const FHTNWorldStateStruct& WorldState, TConstArrayView<UHTNTask*> GoalTasks);
+
+    /**
+     * Get the key of a planning request from a layered world state, the same in every process.
+     *
+     * @param WorldState - The start state, resolved through its parent layers
+     * @param GoalTasks - The goals
+     * @return The fingerprint
+     */
+    static uint32 GetRequestFingerprint(const UHTNWorldState* WorldState, TConstArrayView<UHTNTask*> GoalTasks);
+
+    /**
+     * Find the plan cached for a request.
+     * Fingerprints can collide, so the plan should be validated against the start state before use.
+     * Only the plan's tasks and cost are cached; task dependencies and the decomposition are not.
+     *
+     * @param Fingerprint - The request
+     * @param OutPlan - Replaced by the plan if found, and cleared otherwise
+     * @return True if a plan was found and all of its tasks are still loaded
+     */
+    bool FindPlan(uint32 Fingerprint, FHTNPlan& OutPlan) const;
+
+    /**
+     * Remember the plan found for a request, evicting the oldest runtime plan if the cache is full.
+     *
+     * @param Fingerprint - The request
+     * @param Plan - The plan
+     */
+    void AddPlan(uint32 Fingerprint, const FHTNPlan& Plan);
+
+    /**
+     * Add the precomputed plans of a domain. Plans whose tasks aren't in the domain are skipped.
+     *
+     * @param Domain - The domain
+     * @return Number of plans added
+     */
+    int32 SeedFromDomain(const UHTNDomainAsset* Domain);
+
+    /**
+     * Get the number of cached plans.
+     *
+     * @return The number of plans
+     */
+    int32 GetNumPlans() const { return Plans.Num(); }
+
+    /** Forget every cached plan, including precomputed ones */
+    void Reset();
+
+    //~ Begin USubsystem Interface
+    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+    virtual void Deinitialize() override;
+    //~ End USubsystem Interface
+
+    /** Maximum number of plans found at runtime that are remembered (0 = only precomputed plans are used) */
+    UPROPERTY(EditAnywhere, Category = "HTN|Plan")
+    int32 MaxRuntimePlans;
+
+private:
+    /** Cached plans by request fingerprint */
+    UPROPERTY(Transient)
+    TMap<uint32, FHTNCachedPlan> Plans;
+
+    /** Fingerprints of the plans found at runtime, oldest first */
+    TArray<uint32> RuntimePlanOrder;
+};
@@ -6,8 +6,11 @@
 #include "HTNPlan.h"
 #include "Tasks/HTNTask.h"
 #include "Tasks/HTNPrimitiveTask.h"
+#include "HTNTaskCompletionQueue.h"
 #include "HTNPlanExecutor.generated.h"
 
+class UHTNPlanExecutorManager;
+
 /**
  * Delegate for plan execution events
  */
@@ -39,6 +42,55 @@ enum class EHTNPlanExecutorMode : uint8
     DependencyBased UMETA(DisplayName = "Dependency Based")
 };
 
+/**
+ * World state keys a plan step reads in its preconditions and writes in its effects.
+ */
+struct FHTNPlanStepKeys
+{
+    /** Keys read by the step's preconditions */
+    TArray<FName> ReadKeys;
+
+    /** Keys written by the step's effects */
+    TArray<FName> WriteKeys;
+
+    /** Whether a precondition may read keys that are not listed */
+    bool bReadsAnyKey = false;
+
+    /** Whether an effect may write keys that are not listed */
+    bool bWritesAnyKey = false;
+};
+
+/**
+ * One thread-safe task tick.
+ * Gathered on the game thread, run on any thread, and applied back to its executor on the game thread.
+ */
+struct FHTNThreadSafeTaskTick
+{
+    /** The task to tick */
+    const UHTNPrimitiveTask* Task = nullptr;
+
+    /** The agent's world state, read-only while the tick runs */
+    const UHTNWorldState* WorldState = nullptr;
+
+    /** The agent's instance memory for the task */
+    uint8* NodeMemory = nullptr;
+
+    /** Index of the task in the executor's plan */
+    int32 TaskIndex = INDEX_NONE;
+
+    /** Execution the tick was gathered for, so results are never applied to a plan started since */
+    uint32 PlanExecutionId = 0;
+
+    /** Status returned by the tick */
+    EHTNTaskStatus Status = EHTNTaskStatus::InProgress;
+
+    /** Run the tick, storing the resulting status */
+    void Run(float DeltaTime)
+    {
+        Status = Task->TickTaskThreadSafe(WorldState, NodeMemory, DeltaTime);
+    }
+};
+
 /**
  * Class responsible for executing HTN plans.
  * Manages the execution of tasks within a plan, handles execution state,
@@ -136,6 +188,14 @@ public:
     UFUNCTION(BlueprintCallable, Category = "HTN|Execution")
     void SetExecutionMode(EHTNPlanExecutorMode InExecutionMode);
 
+    /**
+     * Get the execution mode.
+     * 
+     * @return The execution mode
+     */
+    UFUNCTION(BlueprintPure, Category = "HTN|Execution")
+    EHTNPlanExecutorMode GetExecutionMode() const;
+
     /**
      * Set the maximum time a task can execute before timing out.
      * 
@@ -178,6 +238,16 @@ public:
     UFUNCTION(BlueprintPure, Category = "HTN|Execution")
     EHTNTaskStatus GetTaskStatus(UHTNPrimitiveTask* Task) const;
 
+    /**
+     * Get the status of the task at an index of the current plan.
+     * Prefer this over GetTaskStatus when the same task appears more than once in a plan.
+     * 
+     * @param TaskIndex - Index of the task in the current plan
+     * @return The status of the task, or Invalid if the index is out of range
+     */
+    UFUNCTION(BlueprintPure, Category = "HTN|Execution")
+    EHTNTaskStatus GetTaskStatusAtIndex(int32 TaskIndex) const;
+
     /**
      * Execute the next task in the plan.
      * This is called automatically by the executor, but can be called manually
@@ -188,6 +258,117 @@ public:
     UFUNCTION(BlueprintCallable, Category = "HTN|Execution")
     bool ExecuteNextTask();
 
+    /**
+     * Finish a running task from outside its tick, e.g. when asynchronous work it started is done.
+     * Must be called on the game thread; other threads report through an FHTNTaskCompletionHandle.
+     * 
+     * @param TaskIndex - Index of the task in the current plan
+     * @param Status - The final status (Succeeded or Failed)
+     * @return True if the task was running and has been finished
+     */
+    UFUNCTION(BlueprintCallable, Category = "HTN|Execution")
+    bool CompleteTask(int32 TaskIndex, EHTNTaskStatus Status);
+
+    /**
+     * Store a named result for a task of the current plan.
+     * 
+     * @param TaskIndex - Index of the task in the current plan
+     * @param ResultName - The name of the result
+     * @param ResultValue - The value of the result
+     * @return True if the result was stored
+     */
+    UFUNCTION(BlueprintCallable, Category = "HTN|Execution")
+    bool SetTaskResult(int32 TaskIndex, FName ResultName, const FHTNProperty& ResultValue);
+
+    /**
+     * Create a handle that lets work on any thread finish a task of the current plan or report its results.
+     * 
+     * @param NodeMemory - The task's instance memory, identifying the task
+     * @return The handle, invalid if the memory is not part of the current plan or no manager ticks this executor
+     */
+    FHTNTaskCompletionHandle MakeCompletionHandle(const uint8* NodeMemory) const;
+
+    /**
+     * Get the plan index of the task owning some instance memory.
+     * 
+     * @param NodeMemory - Instance memory handed to a task by this executor
+     * @return The task index, or INDEX_NONE if the memory is not part of the current plan
+     */
+    int32 GetTaskIndexFromMemory(const uint8* NodeMemory) const;
+
+    /**
+     * Check if the remaining steps of the current plan are still valid against the live world state.
+     * Only the steps whose precondition keys changed since the last check are revalidated,
+     * against the world state predicted for that step. Without changes this is a version comparison.
+     * 
+     * @return True if the remaining plan is still valid, false if it is not or no plan is executing
+     */
+    UFUNCTION(BlueprintCallable, Category = "HTN|Execution")
+    bool ValidateRemainingPlan();
+
+    /**
+     * Get the number of steps of the current plan that have not completed yet, including running ones.
+     * 
+     * @return Number of remaining steps, 0 if no plan is executing
+     */
+    UFUNCTION(BlueprintPure, Category = "HTN|Execution")
+    int32 GetNumRemainingTasks() const;
+
+    /**
+     * Get the world state the current plan is predicted to end in.
+     * 
+     * @return The predicted final world state, or nullptr if no plan is executing
+     */
+    const FHTNWorldStateSnapshot* GetPredictedFinalWorldState() const;
+
+    /**
+     * Get the id of the current plan execution, incremented every time a plan starts.
+     * 
+     * @return The execution id
+     */
+    FORCEINLINE uint32 GetPlanExecutionId() const { return PlanExecutionId; }
+
+    /**
+     * Get the index of the first task of the current plan that failed.
+     * Only in sequential mode is it the plan's current task index, since other modes run tasks out of order.
+     * 
+     * @return The task index, or INDEX_NONE if no task of the plan failed
+     */
+    FORCEINLINE int32 GetFailedTaskIndex() const { return FailedTaskIndex; }
+
+    /**
+     * Get the tasks of the current plan that succeeded, in the order they finished.
+     * Outside of sequential mode, these can include tasks after the failed one.
+     * 
+     * @return The task indices
+     */
+    FORCEINLINE const TArray<int32>& GetSucceededTaskIndices() const { return SucceededTaskIndices; }
+
+    /**
+     * Queue the plan to run when the current plan completes successfully.
+     * At handoff, the queued plan is checked against the actual world state and started in the same tick,
+     * or discarded if it is no longer applicable. It is also discarded if the current plan fails or is aborted.
+     * 
+     * @param NextPlan - The plan to run next
+     * @return True if the plan was queued, false if no plan is executing or NextPlan is invalid
+     */
+    UFUNCTION(BlueprintCallable, Category = "HTN|Execution")
+    bool QueueNextPlan(const FHTNPlan& NextPlan);
+
+    /**
+     * Check if a plan is queued to run after the current one.
+     * 
+     * @return True if a plan is queued
+     */
+    UFUNCTION(BlueprintPure, Category = "HTN|Execution")
+    bool HasQueuedPlan() const { return bHasQueuedPlan; }
+
+    /**
+     * Discard the plan queued to run after the current one.
+     */
+    UFUNCTION(BlueprintCallable, Category = "HTN|Execution")
+    void ClearQueuedPlan();
+
     /**
      * Create a string representation of the current execution state for debugging.
      * 
@@ -196,6 +377,24 @@ public:
     UFUNCTION(BlueprintPure, Category = "HTN|Debug")
     FString ToString() const;
 
+    /**
+     * Collect the ticks of executing thread-safe tasks (parallel and dependency-based modes only).
+     * The ticks must be run and passed to TickExecution in the same frame.
+     * 
+     * @param OutTicks - Array the ticks are appended to
+     */
+    void GatherThreadSafeTicks(TArray<FHTNThreadSafeTaskTick>& OutTicks);
+
+    /**
+     * Tick the plan on the game thread.
+     * Applies the results of the thread-safe ticks in the order they were gathered,
+     * then ticks the remaining tasks and starts new ones.
+     * 
+     * @param DeltaTime - Time in seconds since the last tick
+     * @param ThreadSafeTicks - Ticks gathered by GatherThreadSafeTicks that have already been run
+     */
+    void TickExecution(float DeltaTime, TConstArrayView<FHTNThreadSafeTaskTick> ThreadSafeTicks);
+
 public:
     /** Called when plan execution starts */
     UPROPERTY(BlueprintAssignable, Category = "HTN|Execution")
@@ -266,25 +465,117 @@ protected:
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "HTN|Execution")
     bool bAbortOnTaskFailure;
 
-    /** Tasks that are currently executing (for parallel execution) */
+    /** Plan indices of the tasks that are currently executing */
     UPROPERTY(BlueprintReadOnly, Category = "HTN|Execution")
-    TArray<UHTNPrimitiveTask*> ExecutingTasks;
+    TArray<int32> ExecutingTaskIndices;
 
     /** Execution context */
     UPROPERTY(BlueprintReadOnly, Category = "AI|HTN")
     UHTNExecutionContext* ExecutionContext;
 
-    /** Map of task execution start times (for timeout detection) */
-    TMap<UHTNPrimitiveTask*, float> TaskStartTimes;
+    /** Map of plan task index to execution start time (for timeout detection) */
+    TMap<int32, float> TaskStartTimes;
+
+    /**
+     * Contiguous per-agent instance memory for every task in the current plan.
+     * Task objects are shared between agents, so all runtime task state lives here.
+     */
+    TArray<uint8, TAlignedHeapAllocator<16>> InstanceMemory;
+
+    /** Byte offset into InstanceMemory for each task index of the current plan */
+    TArray<int32> InstanceMemoryOffsets;
+
+    /**
+     * World state predicted before each step of the current plan, followed by the state predicted after the last step.
+     * Consecutive predictions share the chunks a step doesn't write. Kept up to date by ValidateRemainingPlan.
+     */
+    TArray<FHTNWorldStateSnapshot> PredictedWorldStates;
+
+    /** Keys read and written by each step of the current plan */
+    TArray<FHTNPlanStepKeys> PlanStepKeys;
+
+    /** Plan to start when the current plan completes successfully */
+    UPROPERTY(BlueprintReadOnly, Category = "HTN|Execution")
+    FHTNPlan QueuedPlan;
+
+    /** Scratch world state the predicted states are evaluated in */
+    UPROPERTY(Transient)
+    UHTNWorldState* ValidationWorldState;
 
 protected:
     /**
      * Called when a task completes execution.
      * 
-     * @param Task - The task that completed
+     * @param TaskIndex - Index of the task in the current plan
      * @param Status - The final status of the task
      */
-    void OnTaskCompleted(UHTNPrimitiveTask* Task, EHTNTaskStatus Status);
+    void OnTaskCompleted(int32 TaskIndex, EHTNTaskStatus Status);
+
+    /**
+     * Start executing the task at an index of the current plan (parallel and dependency-based modes).
+     * 
+     * @param TaskIndex - Index of the task in the current plan
+     * @param CurrentTime - The current time
+     * @return True if the task was started
+     */
+    bool StartTaskAtIndex(int32 TaskIndex, float CurrentTime);
+
+    /**
+     * Start every task of the current plan that isn't started yet and can start (parallel and dependency-based modes).
+     * In dependency-based mode, only tasks whose dependencies have succeeded can start, and a task that can't
+     * start once they have is failed.
+     * 
+     * @param CurrentTime - The current time
+     * @return True if any task was started
+     */
+    bool StartReadyTasks(float CurrentTime);
+
+    /**
+     * Check if the tasks a task of the current plan depends on have all succeeded.
+     * 
+     * @param TaskIndex - Index of the task in the current plan
+     * @return True if the task's dependencies have succeeded
+     */
+    bool AreTaskDependenciesCompleted(int32 TaskIndex) const;
+
+    /**
+     * Allocate and construct instance memory for every task in the current plan.
+     */
+    void InitializeInstanceMemory();
+
+    /**
+     * Destroy the instance memory of the current plan.
+     * The allocation is kept so the next plan can reuse it.
+     */
+    void CleanupInstanceMemory();
+
+    /**
+     * Get the instance memory of the task at an index of the current plan.
+     * 
+     * @param TaskIndex - Index of the task in the current plan
+     * @return The task's instance memory, or nullptr if the index is out of range
+     */
+    uint8* GetTaskMemory(int32 TaskIndex);
+    const uint8* GetTaskMemory(int32 TaskIndex) const;
+
+    /**
+     * Simulate the current plan from the live world state, recording the state predicted
+     * before each step and the keys each step reads and writes.
+     */
+    void BuildPlanPredictions();
+
+    /**
+     * Start the queued plan if the plan that just completed left a handoff pending.
+     * Called once the executor is back at the top of its tick, never from within task callbacks.
+     */
+    void HandOffToQueuedPlan();
+
+    /**
+     * Get the index of the first step of the current plan that has not completed yet.
+     * 
+     * @return The step index, or the number of tasks if all steps completed
+     */
+    int32 GetFirstRemainingTaskIndex() const;
 
     /**
      * Check if any tasks have timed out.
@@ -337,4 +628,31 @@ private:
 
     /** Timestamp when the plan started executing */
     float PlanStartTime;
+
+    /** Incremented every time a plan starts, identifies the execution thread-safe ticks were gathered for */
+    uint32 PlanExecutionId;
+
+    /** Index of the first task of the current plan that failed, or INDEX_NONE */
+    int32 FailedTaskIndex;
+
+    /** Indices of the tasks of the current plan that succeeded */
+    TArray<int32> SucceededTaskIndices;
+
+    /** Layers of the live world state at the last validation, starting with the live state itself */
+    TArray<TWeakObjectPtr<const UHTNWorldState>> ValidatedLayers;
+
+    /** Versions of each layer of the live world state at the last validation */
+    TArray<uint32> ValidatedLayerVersions;
+
+    /** Result of the last validation; once invalid, the plan stays invalid */
+    bool bRemainingPlanValid;
+
+    /** Whether QueuedPlan holds a plan */
+    bool bHasQueuedPlan;
+
+    /** Whether a plan completed successfully and the queued plan should be started */
+    bool bPendingHandOff;
+
+    /** Manager ticking this executor while a plan runs, if it belongs to a world */
+    TWeakObjectPtr<UHTNPlanExecutorManager> TickManager;
 };
\ No newline at end of file
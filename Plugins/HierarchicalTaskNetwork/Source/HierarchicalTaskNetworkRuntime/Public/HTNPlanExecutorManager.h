@@ -0,0 +1,79 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HTNPlanExecutor.h"
+#include "HTNTaskCompletionQueue.h"
+#include "HTNPlanExecutorManager.generated.h"
+
+/**
+ * World subsystem that ticks every executing plan executor of its world in one batch.
+ * Thread-safe task ticks of all agents are run together with ParallelFor, and their
+ * results are applied back on the game thread in executor registration order, then plan order,
+ * so the outcome does not depend on thread scheduling.
+ */
+UCLASS()
+class HIERARCHICALTASKNETWORKRUNTIME_API UHTNPlanExecutorManager : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    //~ Begin FTickableGameObject Interface
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+    //~ End FTickableGameObject Interface
+
+    /**
+     * Get the manager of the world an object belongs to.
+     * 
+     * @param WorldContextObject - Any object in the world
+     * @return The manager, or nullptr if the object has no world
+     */
+    static UHTNPlanExecutorManager* Get(const UObject* WorldContextObject);
+
+    /**
+     * Start ticking an executor. Executors register themselves when they start a plan.
+     * 
+     * @param Executor - The executor to tick
+     */
+    void RegisterExecutor(UHTNPlanExecutor* Executor);
+
+    /**
+     * Stop ticking an executor. Executors unregister themselves when their plan ends.
+     * 
+     * @param Executor - The executor to stop ticking
+     */
+    void UnregisterExecutor(UHTNPlanExecutor* Executor);
+
+    /**
+     * Get the number of executors currently ticked by this manager.
+     * 
+     * @return Number of registered executors
+     */
+    FORCEINLINE int32 GetNumExecutors() const { return Executors.Num(); }
+
+    /**
+     * Get the queue tasks and worker threads push completions and results to.
+     * The queue is drained into the executors on the game thread at the start of every tick.
+     * 
+     * @return The completion queue
+     */
+    FORCEINLINE TSharedPtr<FHTNTaskCompletionQueue, ESPMode::ThreadSafe> GetCompletionQueue() const { return CompletionQueue; }
+
+protected:
+    /**
+     * Apply every queued task completion and result to its executor.
+     */
+    void DrainCompletionQueue();
+
+    /** Task events raised from any thread, waiting to be applied on the game thread */
+    TSharedRef<FHTNTaskCompletionQueue, ESPMode::ThreadSafe> CompletionQueue = MakeShared<FHTNTaskCompletionQueue, ESPMode::ThreadSafe>();
+
+    /** Executors with a running plan, in registration order */
+    TArray<TWeakObjectPtr<UHTNPlanExecutor>> Executors;
+
+    /** Thread-safe ticks gathered this frame, kept to reuse the allocation */
+    TArray<FHTNThreadSafeTaskTick> ThreadSafeTicks;
+};
@@ -0,0 +1,183 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HTNPlan.h"
+
+/**
+ * Read-only view of a plan serialized by FHTNPlan::ToBinary (version 2), reading straight from the buffer.
+ * The buffer can be any memory, for example a loaded file or a mapped file region, and must outlive the view.
+ * Tasks and strings are addressed in constant time; parameters, results and dependencies are looked up when asked for.
+ * Nothing is allocated except for returned property values that hold strings.
+ */
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNPlanView
+{
+public:
+    FHTNPlanView() = default;
+
+    /**
+     * Create a view over serialized plan data.
+     * 
+     * @param InData - The serialized plan
+     * @param bVerifyChecksum - Whether to check the data against its checksum first
+     */
+    explicit FHTNPlanView(TConstArrayView<uint8> InData, bool bVerifyChecksum = true);
+
+    /**
+     * Check whether the data could be read.
+     * 
+     * @return True if the view is usable
+     */
+    bool IsValid() const { return bValid; }
+
+    /** Plan fields */
+    float GetTotalCost() const { return TotalCost; }
+    int32 GetCurrentTaskIndex() const { return CurrentTaskIndex; }
+    EHTNPlanStatus GetStatus() const { return Status; }
+    bool IsExecuting() const;
+    bool IsComplete() const;
+    bool HasFailed() const;
+    bool IsPaused() const;
+
+    /**
+     * Get the number of tasks.
+     * 
+     * @return The number of tasks
+     */
+    int32 GetNumTasks() const { return NumTasks; }
+
+    /**
+     * Check whether a task slot holds no task.
+     * 
+     * @param TaskIndex - The task
+     * @return True if the plan had a null task there
+     */
+    bool IsTaskNull(int32 TaskIndex) const;
+
+    /**
+     * Get the ID of a task.
+     * 
+     * @param TaskIndex - The task
+     * @return The task ID
+     */
+    FGuid GetTaskID(int32 TaskIndex) const;
+
+    /**
+     * Get the cost of a task.
+     * 
+     * @param TaskIndex - The task
+     * @return The task cost
+     */
+    float GetTaskCost(int32 TaskIndex) const;
+
+    /**
+     * Get the class path of a task, pointing into the buffer.
+     * 
+     * @param TaskIndex - The task
+     * @return The class path, empty for null tasks
+     */
+    FUtf8StringView GetTaskClassPath(int32 TaskIndex) const;
+
+    /**
+     * Get the name of a task, pointing into the buffer.
+     * 
+     * @param TaskIndex - The task
+     * @return The task name
+     */
+    FUtf8StringView GetTaskName(int32 TaskIndex) const;
+
+    /**
+     * Look up a task parameter.
+     * 
+     * @param Key - The parameter name
+     * @param OutValue - The value if found
+     * @return True if the plan has the parameter
+     */
+    bool FindParameter(FName Key, FHTNProperty& OutValue) const;
+
+    /**
+     * Look up a task result.
+     * 
+     * @param Key - The result name
+     * @param OutValue - The value if found
+     * @return True if the plan has the result
+     */
+    bool FindResult(FName Key, FHTNProperty& OutValue) const;
+
+    /**
+     * Get the tasks a task depends on.
+     * 
+     * @param TaskIndex - The task
+     * @param OutDependencies - Array the dependency indices are appended to
+     * @return True if the task has dependencies
+     */
+    bool GetTaskDependencies(int32 TaskIndex, TArray<int32>& OutDependencies) const;
+
+    /**
+     * Deserialize the whole plan.
+     * 
+     * @param OutPlan - The plan to fill
+     * @return True if the plan was read
+     */
+    bool ToPlan(FHTNPlan& OutPlan) const;
+
+private:
+    /**
+     * Get a string table entry, pointing into the buffer.
+     * 
+     * @param StringIndex - The entry
+     * @return The string, empty if the index is invalid
+     */
+    FUtf8StringView GetString(uint32 StringIndex) const;
+
+    /**
+     * Look up a key in a parameter or result section.
+     * 
+     * @param SectionOffset - Offset of the section's entry count
+     * @param Key - The key
+     * @param OutValue - The value if found
+     * @return True if the section has the key
+     */
+    bool FindProperty(int32 SectionOffset, FName Key, FHTNProperty& OutValue) const;
+
+    /**
+     * Get the byte offset of a task record.
+     * 
+     * @param TaskIndex - The task
+     * @return The offset, or INDEX_NONE if the index is invalid
+     */
+    int32 GetTaskRecordOffset(int32 TaskIndex) const;
+
+    /** The serialized plan */
+    TConstArrayView<uint8> Data;
+
+    /** Offsets of the parts of the data */
+    int32 StringOffsetsOffset = 0;
+    int32 StringDataOffset = 0;
+    int32 TaskTableOffset = 0;
+    int32 ParametersOffset = 0;
+    int32 ResultsOffset = 0;
+    int32 DependenciesOffset = 0;
+
+    /** Number of string table entries */
+    int32 NumStrings = 0;
+
+    /** Byte width of the string table offsets */
+    int32 StringOffsetWidth = 1;
+
+    /** Number of tasks */
+    int32 NumTasks = 0;
+
+    /** Byte width of string indices in task records */
+    int32 TaskIndexWidth = 1;
+
+    /** Plan fields, decoded up front */
+    float TotalCost = 0.0f;
+    int32 CurrentTaskIndex = 0;
+    uint8 Flags = 0;
+    EHTNPlanStatus Status = EHTNPlanStatus::NotStarted;
+
+    /** Whether the data could be read */
+    bool bValid = false;
+};
@@ -126,7 +126,19 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HTN|Planner|Config")
     uint8 bCacheDecompositions : 1;
     
-    /** Whether to enable detailed debugging output */
+    /** Whether to record the decomposition tree that produced the plan (see FHTNPlan::Decomposition) */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HTN|Planner|Config")
+    uint8 bRecordDecomposition : 1;
+    
+    /** Whether to fill the plan's task dependencies from the keys its tasks read and write (see FHTNPlan::InferTaskDependencies) */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HTN|Planner|Config")
+    uint8 bInferTaskDependencies : 1;
+    
+    /** Whether to record the planner's search in its trace, cheap enough to leave on in development builds */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HTN|Planner|Config")
+    uint8 bRecordTrace : 1;
+    
+    /** Whether to enable detailed debugging output; the search trace is formatted into the result's DebugInfo */
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HTN|Planner|Config")
     uint8 bDetailedDebugging : 1;
 };
@@ -158,6 +170,22 @@ public:
         const TArray<UHTNTask*>& GoalTasks,
         const FHTNPlanningConfig& Config);
     
+    /**
+     * Generate a plan into a caller-owned result, so callers that plan repeatedly can reuse it.
+     * The base implementation forwards to GeneratePlan.
+     * 
+     * @param WorldState - The initial world state
+     * @param GoalTasks - The tasks to achieve (typically compound tasks that will be decomposed)
+     * @param Config - Configuration parameters for the planning process
+     * @param OutResult - Overwritten with the result of the planning operation
+     * @return True if a plan was found, false otherwise
+     */
+    virtual bool GeneratePlanInto(
+        const UHTNWorldState* WorldState,
+        const TArray<UHTNTask*>& GoalTasks,
+        const FHTNPlanningConfig& Config,
+        FHTNPlannerResult& OutResult);
+    
     /**
      * Validate if a plan is still valid given the current world state.
      * 
@@ -0,0 +1,146 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UHTNTask;
+
+/** Kinds of planner trace events */
+enum class EHTNPlannerTraceEventType : uint8
+{
+    /** A task is processed; Value is unused */
+    NodeEnter,
+    /** A task is not applicable; Value is the index of the first failed precondition of a primitive task, or INDEX_NONE */
+    ConditionFail,
+    /** A method of a compound task is tried; Value is the index of the method in the task's methods */
+    MethodTry,
+    /** Every way to plan a task failed and the search backs up; Value is unused */
+    Backtrack,
+    /** A plan is found; Value is the number of tasks */
+    PlanFound,
+    /** The search is aborted by the time or depth limit; Value is unused */
+    Abort,
+};
+
+/** A planner trace event; fixed size, with the task interned and all formatting left to viewing time */
+struct FHTNPlannerTraceEvent
+{
+    /** Cycles since the trace was reset */
+    uint32 Cycles = 0;
+
+    /** Interned task (see FHTNPlannerTrace::GetTask), or INDEX_NONE */
+    int32 TaskId = INDEX_NONE;
+
+    /** Event specific value (see EHTNPlannerTraceEventType) */
+    int32 Value = INDEX_NONE;
+
+    /** Search depth */
+    uint16 Depth = 0;
+
+    /** Kind of event */
+    EHTNPlannerTraceEventType Type = EHTNPlannerTraceEventType::NodeEnter;
+};
+
+/**
+ * Ring buffer of the events of a planning operation.
+ * Recording an event writes a few bytes and interns its task with one hash lookup, so the trace can stay on in
+ * development builds; when the buffer is full, the oldest events are overwritten.
+ */
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNPlannerTrace
+{
+public:
+    FHTNPlannerTrace();
+
+    /**
+     * Set the number of events kept, rounded up to a power of two. Clears the events.
+     *
+     * @param NumEvents - The number of events
+     */
+    void SetCapacity(int32 NumEvents);
+
+    /** Remove the events, and start timing the next ones from now */
+    void Reset();
+
+    /**
+     * Record an event.
+     *
+     * @param Type - The kind of event
+     * @param Task - The task the event is about, if any
+     * @param Depth - The search depth
+     * @param Value - Event specific value (see EHTNPlannerTraceEventType)
+     */
+    void Add(EHTNPlannerTraceEventType Type, const UHTNTask* Task, int32 Depth, int32 Value = INDEX_NONE)
+    {
+        FHTNPlannerTraceEvent& Event = Events[NumRecorded++ & (Events.Num() - 1)];
+        Event.Cycles = FPlatformTime::Cycles() - StartCycles;
+        Event.TaskId = InternTask(Task);
+        Event.Value = Value;
+        Event.Depth = static_cast<uint16>(FMath::Min(Depth, static_cast<int32>(MAX_uint16)));
+        Event.Type = Type;
+    }
+
+    /**
+     * Get the number of events kept.
+     *
+     * @return The number of events
+     */
+    int32 Num() const { return static_cast<int32>(FMath::Min<uint64>(NumRecorded, Events.Num())); }
+
+    /**
+     * Get the number of events recorded since the last reset that were overwritten.
+     *
+     * @return The number of events
+     */
+    uint64 GetNumDropped() const { return NumRecorded - Num(); }
+
+    /**
+     * Get a kept event, oldest first.
+     *
+     * @param Index - Index of the event, less than Num()
+     * @return The event
+     */
+    const FHTNPlannerTraceEvent& GetEvent(int32 Index) const { return Events[(NumRecorded - Num() + Index) & (Events.Num() - 1)]; }
+
+    /**
+     * Get an interned task.
+     *
+     * @param TaskId - The task ID of an event
+     * @return The task, or nullptr if there is none or it was destroyed
+     */
+    const UHTNTask* GetTask(int32 TaskId) const;
+
+    /**
+     * Format an event for display.
+     *
+     * @param Event - The event
+     * @return The description
+     */
+    FString DescribeEvent(const FHTNPlannerTraceEvent& Event) const;
+
+    /**
+     * Format all kept events, one per line.
+     *
+     * @return The description
+     */
+    FString ToString() const;
+
+private:
+    /** Get the ID of a task, interning it on first use */
+    int32 InternTask(const UHTNTask* Task);
+
+    /** The events; the size is a power of two */
+    TArray<FHTNPlannerTraceEvent> Events;
+
+    /** Number of events recorded since the last reset */
+    uint64 NumRecorded;
+
+    /** Cycle count when the trace was reset */
+    uint32 StartCycles;
+
+    /** Interned tasks by ID, kept across resets since planning keeps visiting the same domain */
+    TArray<TWeakObjectPtr<const UHTNTask>> Tasks;
+
+    /** IDs of the interned tasks */
+    TMap<const UHTNTask*, int32> TaskIds;
+};
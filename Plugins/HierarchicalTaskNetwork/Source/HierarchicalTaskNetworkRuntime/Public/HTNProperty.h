@@ -67,6 +67,18 @@ public:
 	/** Returns true if the property is valid (has a non-Invalid type) */
 	bool IsValid() const { return Type != EHTNPropertyType::Invalid; }
 
+	/**
+	 * Hash of the exact stored value, for fingerprinting.
+	 * Unlike operator==, floats and vectors are compared bit for bit, so nearly equal values may hash differently.
+	 */
+	uint32 GetValueHash() const;
+
+	/**
+	 * Hash of the stored value that is the same in every process, for data computed offline.
+	 * Names hash by their text and objects by their path rather than by index or address.
+	 */
+	uint32 GetStableValueHash() const;
+
 	/** Convert the property to a string for debugging */
 	FString ToString() const;
 
@@ -0,0 +1,91 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Sensors/HTNSensor.h"
+#include "HTNSensorScheduler.generated.h"
+
+/**
+ * World subsystem that updates the sensors of every agent in its world.
+ * Sensor updates are staggered across frames so agents registered together do not all sense
+ * on the same frame, and due sensors of the same class are batched into one SenseBatch call.
+ * Sensed values are committed to the world states on the game thread; keys whose value did not
+ * change are left untouched, so change versions only move on real changes.
+ */
+UCLASS()
+class HIERARCHICALTASKNETWORKRUNTIME_API UHTNSensorScheduler : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    //~ Begin FTickableGameObject Interface
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+    //~ End FTickableGameObject Interface
+
+    /**
+     * Get the scheduler of the world an object belongs to.
+     * 
+     * @param WorldContextObject - Any object in the world
+     * @return The scheduler, or nullptr if the object has no world
+     */
+    static UHTNSensorScheduler* Get(const UObject* WorldContextObject);
+
+    /**
+     * Start updating a sensor for an agent.
+     * 
+     * @param Sensor - The agent's sensor instance
+     * @param WorldState - The world state the sensor writes to
+     * @param Owner - The agent the sensor belongs to
+     * @return True if the sensor was registered
+     */
+    bool RegisterSensor(UHTNSensor* Sensor, UHTNWorldState* WorldState, AActor* Owner);
+
+    /**
+     * Stop updating every sensor writing to a world state.
+     * 
+     * @param WorldState - The world state whose sensors to remove
+     */
+    void UnregisterSensors(const UHTNWorldState* WorldState);
+
+    /**
+     * Get the number of sensors currently updated by this scheduler.
+     * 
+     * @return Number of registered sensors
+     */
+    FORCEINLINE int32 GetNumSensors() const { return Entries.Num(); }
+
+    /** Maximum number of sensor updates per tick (0 = no limit). Updates over budget are deferred to the next tick, most overdue first. */
+    UPROPERTY(EditAnywhere, Category = "HTN|Sensors", meta = (ClampMin = "0"))
+    int32 MaxUpdatesPerTick = 0;
+
+protected:
+    /** One sensor of one agent */
+    struct FSensorEntry
+    {
+        TWeakObjectPtr<UHTNSensor> Sensor;
+        TWeakObjectPtr<UHTNWorldState> WorldState;
+        TWeakObjectPtr<AActor> Owner;
+
+        /** World time of the next update */
+        double NextUpdateTime = 0.0;
+    };
+
+    /**
+     * Write the declared output keys of finished updates to their world states.
+     * 
+     * @param Updates - The finished updates
+     */
+    void CommitUpdates(TConstArrayView<FHTNSensorUpdate> Updates) const;
+
+    /** Registered sensors, in registration order */
+    TArray<FSensorEntry> Entries;
+
+    /** Number of sensors ever registered, used to spread update phases */
+    uint32 NumRegistrations = 0;
+
+    /** Sensor updates gathered this frame, kept to reuse the allocation */
+    TArray<FHTNSensorUpdate> Updates;
+};
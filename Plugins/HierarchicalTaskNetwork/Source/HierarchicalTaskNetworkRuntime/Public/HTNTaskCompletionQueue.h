@@ -0,0 +1,94 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HTNProperty.h"
+#include "Tasks/HTNTaskStatus.h"
+
+class UHTNPlanExecutor;
+
+/**
+ * Kind of record pushed to the task completion queue.
+ */
+enum class EHTNTaskCompletionRecordType : uint8
+{
+    /** The task finished with a status */
+    Completion,
+
+    /** The task produced a named result */
+    Result
+};
+
+/**
+ * Task event raised from any thread, applied to its executor on the game thread.
+ */
+struct FHTNTaskCompletionRecord
+{
+    /** What this record reports */
+    EHTNTaskCompletionRecordType Type = EHTNTaskCompletionRecordType::Completion;
+
+    /** Executor running the task; only dereferenced on the game thread */
+    TWeakObjectPtr<UHTNPlanExecutor> Executor;
+
+    /** Plan execution the task belongs to, records for earlier plans are dropped */
+    uint32 PlanExecutionId = 0;
+
+    /** Index of the task in the executor's plan */
+    int32 TaskIndex = INDEX_NONE;
+
+    /** Final status (Completion records) */
+    EHTNTaskStatus Status = EHTNTaskStatus::Invalid;
+
+    /** Name of the result (Result records) */
+    FName ResultName;
+
+    /** Value of the result (Result records) */
+    FHTNProperty ResultValue;
+};
+
+/** Lock-free multiple-producer, single-consumer queue of task events, drained by the plan executor manager */
+typedef TQueue<FHTNTaskCompletionRecord, EQueueMode::Mpsc> FHTNTaskCompletionQueue;
+
+/**
+ * Handle a task hands to asynchronous work so it can report back from any thread.
+ * Created on the game thread while the task runs (see UHTNExecutionContext::MakeCompletionHandle),
+ * then copied freely. Reports are queued and applied on the game thread at the start of the
+ * next manager tick; reports for a task that already finished, or a plan that was replaced, are dropped.
+ * Async work must report through the handle and never touch the task's instance memory.
+ */
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNTaskCompletionHandle
+{
+    /**
+     * Check if the handle can report anything.
+     * Handles of executors outside a world have no manager to drain them and are invalid.
+     * @return True if the handle is bound to a queue and a task
+     */
+    bool IsValid() const { return Queue.IsValid() && TaskIndex != INDEX_NONE; }
+
+    /**
+     * Finish the task. Thread-safe.
+     * @param Status - The final status (Succeeded or Failed)
+     */
+    void Complete(EHTNTaskStatus Status) const;
+
+    /**
+     * Store a named result for the task in the executing plan. Thread-safe.
+     * @param ResultName - The name of the result
+     * @param ResultValue - The value of the result
+     */
+    void SetResult(FName ResultName, const FHTNProperty& ResultValue) const;
+
+    /** Queue of the manager ticking the executor, kept alive by the handle */
+    TSharedPtr<FHTNTaskCompletionQueue, ESPMode::ThreadSafe> Queue;
+
+    /** Executor running the task */
+    TWeakObjectPtr<UHTNPlanExecutor> Executor;
+
+    /** Plan execution the task belongs to */
+    uint32 PlanExecutionId = 0;
+
+    /** Index of the task in the executor's plan */
+    int32 TaskIndex = INDEX_NONE;
+};
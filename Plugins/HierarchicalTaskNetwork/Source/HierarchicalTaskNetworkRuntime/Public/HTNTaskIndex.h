@@ -0,0 +1,55 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UHTNPrimitiveTask;
+class UHTNTask;
+
+/**
+ * Index of the primitive tasks of a domain by task ID, for resolving tasks in serialized plans.
+ * Built once when a domain is loaded by walking its task hierarchy; lookups are a single hash probe.
+ */
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNTaskIndex
+{
+public:
+    /**
+     * Add every primitive task reachable from a domain's root tasks.
+     * 
+     * @param RootTasks - The domain's goal tasks
+     */
+    void AddDomain(TConstArrayView<UHTNTask*> RootTasks);
+
+    /**
+     * Add a task, and the tasks of its methods if it is a compound task.
+     * 
+     * @param Task - The task to add
+     */
+    void AddTask(const UHTNTask* Task);
+
+    /**
+     * Find a primitive task by ID.
+     * 
+     * @param TaskID - The task ID
+     * @return The task, or nullptr if it is unknown or was destroyed
+     */
+    UHTNPrimitiveTask* FindTask(const FGuid& TaskID) const;
+
+    /**
+     * Get the number of indexed tasks.
+     * 
+     * @return The number of tasks
+     */
+    int32 Num() const { return Tasks.Num(); }
+
+    /** Remove all tasks */
+    void Reset();
+
+private:
+    /** Primitive tasks by ID */
+    TMap<FGuid, TWeakObjectPtr<UHTNPrimitiveTask>> Tasks;
+
+    /** Compound tasks already walked, so shared subtrees are visited once */
+    TSet<const UHTNTask*> VisitedCompoundTasks;
+};
@@ -0,0 +1,55 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HTNWorldStateStruct.h"
+#include "HTNWorldStateLayerSubsystem.generated.h"
+
+/**
+ * World subsystem owning the world state layers shared between agents.
+ * Agent world states resolve keys through their squad layer, then the global layer,
+ * so a shared fact is stored once and updated once for every agent reading it.
+ */
+UCLASS()
+class HIERARCHICALTASKNETWORKRUNTIME_API UHTNWorldStateLayerSubsystem : public UWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    /**
+     * Get the layer subsystem of the world an object belongs to.
+     * 
+     * @param WorldContextObject - Any object in the world
+     * @return The subsystem, or nullptr if the object has no world
+     */
+    static UHTNWorldStateLayerSubsystem* Get(const UObject* WorldContextObject);
+
+    /**
+     * Get the layer holding facts shared by every agent of the world (e.g. time of day, alarm state).
+     * 
+     * @return The global layer
+     */
+    UFUNCTION(BlueprintCallable, Category = "HTN|WorldState")
+    UHTNWorldState* GetGlobalLayer();
+
+    /**
+     * Get the layer holding facts shared by the agents of a squad, creating it on first use.
+     * Squad layers resolve keys they don't hold through the global layer.
+     * 
+     * @param SquadName - The squad
+     * @return The squad layer, or the global layer if SquadName is None
+     */
+    UFUNCTION(BlueprintCallable, Category = "HTN|WorldState")
+    UHTNWorldState* GetSquadLayer(FName SquadName);
+
+private:
+    /** Facts shared by every agent */
+    UPROPERTY(Transient)
+    UHTNWorldState* GlobalLayer;
+
+    /** Facts shared by the agents of each squad */
+    UPROPERTY(Transient)
+    TMap<FName, UHTNWorldState*> SquadLayers;
+};
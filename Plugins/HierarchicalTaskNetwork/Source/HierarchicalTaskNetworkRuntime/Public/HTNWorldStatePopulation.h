@@ -0,0 +1,133 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HTNProperty.h"
+
+class UHTNWorldState;
+struct FHTNBoolConditionMask;
+
+/**
+ * World states of many agents stored as columns, one column per key slot (see FHTNKeySlots).
+ * Booleans are packed one bit per agent, so a compiled boolean condition list is evaluated for 64 agents per
+ * word and several words per vector instruction. Other values are kept per agent in their column.
+ * Optional: agents planned one at a time keep using UHTNWorldState. Not thread-safe while being written.
+ */
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNWorldStatePopulation
+{
+public:
+	/**
+	 * Set the number of agents. New agents hold no properties.
+	 * @param InNumAgents - The number of agents
+	 */
+	void SetNumAgents(int32 InNumAgents);
+
+	/**
+	 * Get the number of agents.
+	 * @return The number of agents
+	 */
+	int32 GetNumAgents() const { return NumAgents; }
+
+	/**
+	 * Get the number of 64-bit words an agent bit mask of this population has.
+	 * @return The number of words
+	 */
+	int32 GetNumAgentWords() const { return FMath::DivideAndRoundUp(NumAgents, 64); }
+
+	/**
+	 * Get a property of an agent.
+	 * @param AgentIndex - The agent
+	 * @param Key - The name of the property
+	 * @param OutValue - The value of the property if found
+	 * @return True if the agent holds the property
+	 */
+	bool GetProperty(int32 AgentIndex, FName Key, FHTNProperty& OutValue) const;
+
+	/**
+	 * Set a property of an agent.
+	 * @param AgentIndex - The agent
+	 * @param Key - The name of the property
+	 * @param Value - The value to set
+	 */
+	void SetProperty(int32 AgentIndex, FName Key, const FHTNProperty& Value);
+
+	/**
+	 * Remove a property of an agent.
+	 * @param AgentIndex - The agent
+	 * @param Key - The name of the property
+	 */
+	void RemoveProperty(int32 AgentIndex, FName Key);
+
+	/**
+	 * Replace an agent's properties with a world state resolved through its layers.
+	 * @param AgentIndex - The agent
+	 * @param WorldState - The world state to copy
+	 */
+	void CopyFromWorldState(int32 AgentIndex, const UHTNWorldState* WorldState);
+
+	/**
+	 * Copy an agent's properties into a world state, replacing its own properties.
+	 * @param AgentIndex - The agent
+	 * @param WorldState - The world state to fill
+	 */
+	void CopyToWorldState(int32 AgentIndex, UHTNWorldState* WorldState) const;
+
+	/**
+	 * Get a hash of some of an agent's properties. Agents with equal values for the keys have equal fingerprints.
+	 * @param AgentIndex - The agent
+	 * @param Keys - The keys to hash
+	 * @return The fingerprint
+	 */
+	uint32 GetFingerprint(int32 AgentIndex, TConstArrayView<FName> Keys) const;
+
+	/**
+	 * Check whether two agents hold equal values for some keys.
+	 * @param AgentIndex - The first agent
+	 * @param OtherAgentIndex - The second agent
+	 * @param Keys - The keys to compare
+	 * @return True if both agents hold the same values, or both lack them
+	 */
+	bool HasEqualProperties(int32 AgentIndex, int32 OtherAgentIndex, TConstArrayView<FName> Keys) const;
+
+	/**
+	 * Evaluate the boolean part of a compiled condition list for all agents.
+	 * @param Mask - The compiled conditions
+	 * @param OutAgentBits - Overwritten with one bit per agent, set where all boolean conditions hold
+	 * @return True if the result is exact, false if the mask has conditions that must still be checked per agent
+	 */
+	bool EvaluateBoolMask(const FHTNBoolConditionMask& Mask, TArray<uint64>& OutAgentBits) const;
+
+private:
+	/** One key slot across all agents */
+	struct FColumn
+	{
+		/** Agents holding the key */
+		TArray<uint64> PresentBits;
+
+		/** Agents holding a boolean */
+		TArray<uint64> BoolBits;
+
+		/** Agents holding true */
+		TArray<uint64> TrueBits;
+
+		/** Non-boolean values, per agent; empty until a non-boolean value is set */
+		TArray<FHTNProperty> Values;
+	};
+
+	/**
+	 * Get the column of a key slot, creating it if needed.
+	 * @param Slot - The key slot
+	 * @return The column, sized for all agents
+	 */
+	FColumn& GetOrAddColumn(int32 Slot);
+
+	/** Key names by slot, for copying back to world states */
+	TArray<FName> ColumnKeys;
+
+	/** Columns by key slot */
+	TArray<FColumn> Columns;
+
+	/** Number of agents */
+	int32 NumAgents = 0;
+};
@@ -0,0 +1,109 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HTNProperty.h"
+
+struct FHTNWorldStateStruct;
+
+/**
+ * Immutable-by-sharing view of a world state's properties.
+ * Properties are spread over a fixed number of chunks by key hash, and chunks are shared between
+ * snapshots through thread-safe reference counting. Copying a snapshot only copies the chunk
+ * references; writing to a snapshot copies just the chunk holding the key, and only if another
+ * snapshot still shares it. A snapshot is never changed by writes to other snapshots or to the
+ * live world state, so it can be read from any thread while the game thread keeps going.
+ */
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNWorldStateSnapshot
+{
+public:
+	/** Number of chunks the properties are spread over */
+	static constexpr int32 NumChunks = 16;
+
+	FHTNWorldStateSnapshot() = default;
+
+	/**
+	 * Create a snapshot holding a copy of a world state's properties.
+	 * @param WorldState - The world state to copy
+	 */
+	explicit FHTNWorldStateSnapshot(const FHTNWorldStateStruct& WorldState);
+
+	/**
+	 * Find a property without copying it.
+	 * @param Key - The name of the property
+	 * @return The property, or nullptr if the snapshot doesn't hold it
+	 */
+	const FHTNProperty* FindProperty(FName Key) const;
+
+	/**
+	 * Get a property value by name.
+	 * @param Key - The name of the property
+	 * @param OutValue - The value of the property if found
+	 * @return True if the property was found
+	 */
+	bool GetProperty(FName Key, FHTNProperty& OutValue) const;
+
+	/**
+	 * Check if a property exists.
+	 * @param Key - The name of the property
+	 * @return True if the property exists
+	 */
+	bool HasProperty(FName Key) const { return FindProperty(Key) != nullptr; }
+
+	/**
+	 * Set a property, copying the chunk holding it if the chunk is shared.
+	 * @param Key - The name of the property
+	 * @param Value - The value to set
+	 */
+	void SetProperty(FName Key, const FHTNProperty& Value);
+
+	/**
+	 * Remove a property, copying the chunk holding it if the chunk is shared.
+	 * @param Key - The name of the property
+	 * @return True if the property was removed
+	 */
+	bool RemoveProperty(FName Key);
+
+	/**
+	 * Get the number of properties.
+	 * @return The number of properties
+	 */
+	int32 Num() const;
+
+	/**
+	 * Get the names of all properties.
+	 * @return Array of property names
+	 */
+	TArray<FName> GetPropertyNames() const;
+
+	/**
+	 * Copy the properties into a world state struct, replacing its properties.
+	 * @param OutWorldState - The world state to fill
+	 */
+	void ToWorldState(FHTNWorldStateStruct& OutWorldState) const;
+
+	/**
+	 * Check whether two snapshots share all their chunks, and so hold the same properties.
+	 * Snapshots with different chunks may still hold equal properties.
+	 * @param Other - The snapshot to compare with
+	 * @return True if all chunks are shared
+	 */
+	bool SharesAllChunks(const FHTNWorldStateSnapshot& Other) const;
+
+private:
+	typedef TMap<FName, FHTNProperty> FChunk;
+
+	/** Get the chunk a key belongs to */
+	static int32 GetChunkIndex(FName Key) { return GetTypeHash(Key) % NumChunks; }
+
+	/**
+	 * Get a chunk for writing, copying it first if another snapshot shares it.
+	 * @param ChunkIndex - The chunk to write
+	 * @return The chunk, owned by this snapshot only
+	 */
+	FChunk& GetMutableChunk(int32 ChunkIndex);
+
+	/** The property chunks; null chunks are empty */
+	TSharedPtr<FChunk, ESPMode::ThreadSafe> Chunks[NumChunks];
+};
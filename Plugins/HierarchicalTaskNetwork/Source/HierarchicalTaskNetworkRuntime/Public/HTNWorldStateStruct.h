@@ -3,9 +3,34 @@
 #include "CoreMinimal.h"
 #include "HTNProperty.h"
 #include "HTNPlanner.h"
+#include "HTNWorldStateSnapshot.h"
 #include "HTNWorldStateStruct.generated.h"
 
 class UHTNExecutionContext;
+
+/**
+ * Process-wide slot numbering of world state keys.
+ * Every key gets a fixed bit position the first time it is stored in any world state, so boolean values
+ * can be packed into 64-bit words and tested against condition masks (see FHTNBoolConditionMask).
+ * Thread-safe.
+ */
+struct HIERARCHICALTASKNETWORKRUNTIME_API FHTNKeySlots
+{
+	/**
+	 * Find the slot of a key.
+	 * @param Key - The key to look up
+	 * @return The slot, or INDEX_NONE if no world state ever held the key
+	 */
+	static int32 Find(FName Key);
+
+	/**
+	 * Find the slot of a key, assigning the next free slot if it has none.
+	 * @param Key - The key to look up
+	 * @return The slot
+	 */
+	static int32 FindOrAdd(FName Key);
+};
+
 /**
  * Concrete implementation of the HTN world state.
  * Represents the current state of the world for HTN planning.
@@ -75,6 +100,33 @@ public:
 	 */
 	bool RemoveProperty(FName Key);
 
+	/**
+	 * Remove a property and mark the key removed, so the state hides any value its parent layers hold for it
+	 * (see UHTNWorldState). Setting the key again clears the mark.
+	 * @param Key - The name of the property to remove
+	 * @return true if the key was newly marked removed, false if it already was
+	 */
+	bool MarkPropertyRemoved(FName Key);
+
+	/**
+	 * Check if a key is marked removed.
+	 * @param Key - The name of the property to check
+	 * @return true if the key was removed with MarkPropertyRemoved and not set since
+	 */
+	bool IsPropertyMarkedRemoved(FName Key) const { return RemovedKeys.Contains(Key); }
+
+	/**
+	 * Get the keys marked removed.
+	 * @return The keys removed with MarkPropertyRemoved and not set since
+	 */
+	const TSet<FName>& GetRemovedKeys() const { return RemovedKeys; }
+
+	/**
+	 * Forget which keys were marked removed, for a state that no longer resolves through parent layers.
+	 * Not a change to the properties, so the version is left alone.
+	 */
+	void ClearRemovedMarks();
+
 	/**
 	 * Create a clone of this world state.
 	 * @return A new world state with the same properties as this one
@@ -120,6 +172,55 @@ public:
 	 */
 	void SetOwner(AActor* InOwnerActor) { OwnerActor = InOwnerActor; }
 
+	/**
+	 * Get the change version of this world state.
+	 * The version increases every time a property is added, changed or removed,
+	 * so an unchanged version means an unchanged world state.
+	 * @return The current version
+	 */
+	uint32 GetVersion() const { return Version; }
+
+	/**
+	 * Get the keys that were added, changed or removed after a version.
+	 * @param SinceVersion - Version returned by an earlier call to GetVersion
+	 * @param OutKeys - Array the changed keys are appended to
+	 */
+	void GetChangedKeysSince(uint32 SinceVersion, TArray<FName>& OutKeys) const;
+
+	/**
+	 * Get a hash of all keys and values, independent of insertion order.
+	 * Identical world states have identical fingerprints; the owner actor is not included.
+	 * @return The fingerprint
+	 */
+	uint32 GetFingerprint() const;
+
+	/**
+	 * Get a fingerprint like GetFingerprint that is the same in every process, for matching data computed offline.
+	 * Slower, since keys are hashed by their text.
+	 * @return The fingerprint
+	 */
+	uint32 GetStableFingerprint() const;
+
+	/**
+	 * Get one 64-bit word of the packed key bits, covering slots WordIndex * 64 to WordIndex * 64 + 63 (see FHTNKeySlots).
+	 * @param WordIndex - The word to get
+	 * @param OutPresentBits - Set for keys this state holds
+	 * @param OutBoolBits - Set for keys holding a boolean
+	 * @param OutTrueBits - Set for keys holding true
+	 * @param OutRemovedBits - Set for keys marked removed
+	 */
+	void GetKeyBits(int32 WordIndex, uint64& OutPresentBits, uint64& OutBoolBits, uint64& OutTrueBits, uint64& OutRemovedBits) const
+	{
+		const bool bValidWord = PresentBits.IsValidIndex(WordIndex);
+		OutPresentBits = bValidWord ? PresentBits[WordIndex] : 0;
+		OutBoolBits = bValidWord ? BoolBits[WordIndex] : 0;
+		OutTrueBits = bValidWord ? TrueBits[WordIndex] : 0;
+		OutRemovedBits = RemovedBits.IsValidIndex(WordIndex) ? RemovedBits[WordIndex] : 0;
+	}
+
+	/** Rebuild the packed key bits after the properties were loaded */
+	void PostSerialize(const FArchive& Ar);
+
 	// Template methods for type-safe property access
 
 	/**
@@ -147,11 +248,79 @@ private:
 	/** The owner actor of this world state */
 	UPROPERTY()
 	AActor* OwnerActor;
+
+	/** Keys marked removed, hiding the values parent layers hold for them */
+	UPROPERTY()
+	TSet<FName> RemovedKeys;
+
+	/** Change version, incremented by every property change */
+	uint32 Version = 0;
+
+	/** Version at which each key was last added, changed or removed */
+	TMap<FName, uint32> KeyVersions;
+
+	/** Packed bits per key slot: key held, key holds a boolean, key holds true */
+	TArray<uint64> PresentBits;
+	TArray<uint64> BoolBits;
+	TArray<uint64> TrueBits;
+
+	/** Packed bits per key slot: key marked removed */
+	TArray<uint64> RemovedBits;
+
+	/**
+	 * Update the packed bits of a key.
+	 * @param Key - The key that was set or removed
+	 * @param Value - The new value, or nullptr if the key was removed
+	 */
+	void UpdateKeyBits(FName Key, const FHTNProperty* Value);
+
+	/**
+	 * Update the packed removal bit of a key.
+	 * @param Key - The key that was marked removed or set again
+	 * @param bRemoved - Whether the key is marked removed
+	 */
+	void UpdateRemovedBit(FName Key, bool bRemoved);
+
+	/** Rebuild the packed bits of all keys */
+	void RebuildKeyBits();
+
+	/**
+	 * Record a change to a key.
+	 * @param Key - The key that was added, changed or removed
+	 */
+	void MarkKeyChanged(FName Key);
+
+	/**
+	 * Record the keys that were added, changed or removed when the properties were replaced as a whole.
+	 * The version is left alone if no value changed.
+	 * @param PreviousProperties - Properties held before the replacement
+	 * @param PreviousRemovedKeys - Keys marked removed before the replacement
+	 * @param MinVersion - The new version will be greater than this
+	 */
+	void MarkReplacedKeysChanged(const TMap<FName, FHTNProperty>& PreviousProperties, const TSet<FName>& PreviousRemovedKeys, uint32 MinVersion);
+};
+
+template<>
+struct TStructOpsTypeTraits<FHTNWorldStateStruct> : public TStructOpsTypeTraitsBase2<FHTNWorldStateStruct>
+{
+	enum
+	{
+		WithPostSerialize = true,
+	};
 };
 
+/** Delegate for changes to a world state key */
+DECLARE_MULTICAST_DELEGATE_OneParam(FHTNWorldStateKeyChangedDelegate, FName /* Key */);
+
 /**
  * UObject wrapper for FHTNWorldState.
  * This allows the world state to be used in Blueprints.
+ * 
+ * World states can be layered: a state with a parent layer resolves keys it doesn't hold through
+ * its parent chain, so facts shared by many agents (e.g. squad or global facts) are stored once.
+ * Writes go to this layer, or, for agent states attached with bWriteToOwningLayer, to the nearest
+ * layer already holding the key. Removing a key a parent layer holds marks it removed in the writing layer,
+ * which hides it from that layer and every state resolving through it, without changing the parent.
  */
 UCLASS(BlueprintType)
 class HIERARCHICALTASKNETWORKRUNTIME_API UHTNWorldState : public UObject
@@ -188,6 +357,7 @@ public:
 
 	/**
 	 * Remove a property from the world state.
+	 * A key held by a parent layer is marked removed in the write layer rather than removed from the parent.
 	 * @param Key - The name of the property to remove
 	 * @return true if the property was removed, false if it didn't exist
 	 */
@@ -240,6 +410,99 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "HTN|WorldState")
 	static UHTNWorldState* CreateFromStruct(const FHTNWorldStateStruct& InWorldState);
 
+	/**
+	 * Get the layer keys not held by this state are resolved through.
+	 * @return The parent layer, or nullptr
+	 */
+	UFUNCTION(BlueprintCallable, Category = "HTN|WorldState")
+	UHTNWorldState* GetParentLayer() const { return ParentLayer; }
+
+	/**
+	 * Set the layer keys not held by this state are resolved through.
+	 * @param InParentLayer - The parent layer, or nullptr to detach
+	 * @param bInWriteToOwningLayer - Whether writes to keys held by a parent layer go to that layer
+	 */
+	UFUNCTION(BlueprintCallable, Category = "HTN|WorldState")
+	void SetParentLayer(UHTNWorldState* InParentLayer, bool bInWriteToOwningLayer = true);
+
+	/**
+	 * Make this state a private overlay of another state: copies its own properties and shares its parent layers,
+	 * with all writes kept in this state. Used for planning and simulation.
+	 * @param Source - The state to copy
+	 */
+	void CopyFrom(const UHTNWorldState* Source);
+
+	/**
+	 * Flatten this state and its parent layers into one struct.
+	 * @param OutWorldState - Overwritten with the resolved properties
+	 */
+	void GetResolvedWorldState(FHTNWorldStateStruct& OutWorldState) const;
+
+	/**
+	 * Get the change version of every layer, starting with this one.
+	 * @param OutLayerVersions - Overwritten with the versions
+	 */
+	void GetLayerVersions(TArray<uint32>& OutLayerVersions) const;
+
+	/**
+	 * Get every layer, starting with this one.
+	 * @param OutLayers - Overwritten with the layers
+	 */
+	void GetLayers(TArray<TWeakObjectPtr<const UHTNWorldState>>& OutLayers) const;
+
+	/**
+	 * Check whether this state is still resolved through the given layers.
+	 * @param Layers - Layers returned by an earlier call to GetLayers
+	 * @return True if no layer was attached, detached or replaced since
+	 */
+	bool HasLayers(TConstArrayView<TWeakObjectPtr<const UHTNWorldState>> Layers) const;
+
+	/**
+	 * Check whether this state is still resolved through the given layers, each at the given version.
+	 * Unlike comparing GetVersion, changes in one layer can't be masked by another layer being replaced.
+	 * @param Layers - Layers returned by an earlier call to GetLayers
+	 * @param LayerVersions - Versions returned by an earlier call to GetLayerVersions
+	 * @return True if neither the layers nor their properties changed since
+	 */
+	bool IsUnchangedSince(TConstArrayView<TWeakObjectPtr<const UHTNWorldState>> Layers, TConstArrayView<uint32> LayerVersions) const;
+
+	/**
+	 * Get the keys changed in any layer since the given layer versions.
+	 * @param LayerVersions - Versions returned by an earlier call to GetLayerVersions
+	 * @param OutKeys - Array the changed keys are appended to
+	 */
+	void GetChangedKeysSince(TConstArrayView<uint32> LayerVersions, TArray<FName>& OutKeys) const;
+
+	/**
+	 * Get a fingerprint of this state's properties and the versions of its parent layers.
+	 * @return The fingerprint
+	 */
+	uint32 GetFingerprint() const;
+
+	/**
+	 * Get a fingerprint of this state resolved through its parent layers that is the same in every process.
+	 * @return The fingerprint
+	 */
+	uint32 GetStableFingerprint() const;
+
+	/**
+	 * Check packed boolean requirements against this state resolved through its parent layers.
+	 * Bit N of word W stands for key slot W * 64 + N (see FHTNKeySlots).
+	 * @param RequiredBits - Keys that must hold a boolean
+	 * @param ExpectedTrueBits - Which of the required keys must be true; the others must be false. At least as many words as RequiredBits.
+	 * @return True if every required key holds its expected boolean, false if ExpectedTrueBits is too short
+	 */
+	bool MatchesBoolBits(TConstArrayView<uint64> RequiredBits, TConstArrayView<uint64> ExpectedTrueBits) const;
+
+	/**
+	 * Take a snapshot of this state resolved through its parent layers.
+	 * The snapshot shares its chunks with the previous one, so only chunks holding keys changed since then are copied,
+	 * and an unchanged state is snapshotted in constant time. Must be called on the thread that writes this state;
+	 * the returned snapshot can then be read from any thread.
+	 * @return The snapshot
+	 */
+	FHTNWorldStateSnapshot GetSnapshot() const;
+
 	/**
 	 * Get the underlying FHTNWorldState struct.
 	 * @return The world state struct
@@ -250,7 +513,7 @@ public:
 	 * Set the underlying FHTNWorldState struct.
 	 * @param InWorldState - The world state struct to set
 	 */
-	void SetWorldState(const FHTNWorldStateStruct& InWorldState) { WorldState = InWorldState; }
+	void SetWorldState(const FHTNWorldStateStruct& InWorldState);
 
 	/**
 	 * Get the owner actor of this world state.
@@ -266,6 +529,28 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "HTN|WorldState")
 	void SetOwner(AActor* InOwnerActor) { WorldState.SetOwner(InOwnerActor); }
 
+	/**
+	 * Get the change version of this world state and its parent layers (see FHTNWorldStateStruct::GetVersion).
+	 * @return The current version
+	 */
+	uint32 GetVersion() const;
+
+	/**
+	 * Get the delegate broadcast when a key is added, changed or removed.
+	 * Only subscribers of the changed key are called; setting a key to its current value broadcasts nothing.
+	 * Subscribing to other keys from inside a broadcast is not supported.
+	 * @param Key - The key to watch
+	 * @return The delegate for the key
+	 */
+	FHTNWorldStateKeyChangedDelegate& OnKeyChanged(FName Key) { return KeyChangedDelegates.FindOrAdd(Key); }
+
+	/**
+	 * Get the delegate broadcast when any key is added, changed or removed.
+	 * For subscribers that cannot tell which keys they depend on.
+	 * @return The delegate for all keys
+	 */
+	FHTNWorldStateKeyChangedDelegate& OnAnyKeyChanged() { return AnyKeyChangedDelegate; }
+
 	// Template methods for type-safe property access
 
 	/**
@@ -277,7 +562,8 @@ public:
 	template<typename T>
 	T GetPropertyValue(FName Key, const T& DefaultValue) const
 	{
-		return WorldState.GetPropertyValue<T>(Key, DefaultValue);
+		const UHTNWorldState* Layer = FindLayerWithKey(Key);
+		return Layer ? Layer->WorldState.GetPropertyValue<T>(Key, DefaultValue) : DefaultValue;
 	}
 
 	/**
@@ -288,13 +574,59 @@ public:
 	template<typename T>
 	void SetPropertyValue(FName Key, const T& Value)
 	{
-		WorldState.SetPropertyValue<T>(Key, Value);
+		UHTNWorldState* Layer = GetWriteLayer(Key);
+		const uint32 PreviousVersion = Layer->WorldState.GetVersion();
+		Layer->WorldState.SetPropertyValue<T>(Key, Value);
+		Layer->BroadcastKeyChanged(Key, PreviousVersion);
 	}
 
 private:
+	/**
+	 * Find the nearest layer holding a key.
+	 * @param Key - The key to look up
+	 * @return This state or one of its parent layers, or nullptr if no layer holds the key or a nearer layer marked it removed
+	 */
+	const UHTNWorldState* FindLayerWithKey(FName Key) const;
+
+	/**
+	 * Get the layer a write to a key goes to.
+	 * @param Key - The key being written
+	 * @return This state, or the parent layer owning the key when writing to owning layers
+	 */
+	UHTNWorldState* GetWriteLayer(FName Key);
+
+	/**
+	 * Broadcast a key change if a write changed the version.
+	 * @param Key - The key that was written
+	 * @param PreviousVersion - The version before the write
+	 */
+	void BroadcastKeyChanged(FName Key, uint32 PreviousVersion);
+
 	/** The actual world state data */
 	UPROPERTY()
 	FHTNWorldStateStruct WorldState;
+
+	/** Layer keys not held by this state are resolved through */
+	UPROPERTY()
+	UHTNWorldState* ParentLayer = nullptr;
+
+	/** Whether writes to keys held by a parent layer go to that layer instead of this one */
+	bool bWriteToOwningLayer = false;
+
+	/** Change delegates of individual keys */
+	TMap<FName, FHTNWorldStateKeyChangedDelegate> KeyChangedDelegates;
+
+	/** Change delegate of all keys */
+	FHTNWorldStateKeyChangedDelegate AnyKeyChangedDelegate;
+
+	/** Last snapshot taken, updated incrementally by the next one */
+	mutable FHTNWorldStateSnapshot CachedSnapshot;
+
+	/** Layers the cached snapshot was resolved through, starting with this one */
+	mutable TArray<TWeakObjectPtr<const UHTNWorldState>> CachedSnapshotLayers;
+
+	/** Layer versions the cached snapshot was taken at */
+	mutable TArray<uint32> CachedSnapshotLayerVersions;
 };
 
 // Template specializations for FHTNWorldState
@@ -0,0 +1,91 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "HTNWorldStateStruct.h"
+#include "HTNSensor.generated.h"
+
+class UHTNSensor;
+
+/**
+ * One agent's sensor that is due for an update.
+ * The sensor fills Values; the scheduler commits them to the agent's world state afterwards.
+ */
+struct FHTNSensorUpdate
+{
+	/** The agent's sensor instance, holding its per-agent settings */
+	const UHTNSensor* Sensor = nullptr;
+
+	/** The agent the sensor belongs to */
+	AActor* Owner = nullptr;
+
+	/** The agent's world state, read-only while sensing */
+	const UHTNWorldState* WorldState = nullptr;
+
+	/** Values sensed this update, keyed by world state key */
+	TMap<FName, FHTNProperty> Values;
+};
+
+/**
+ * Base class for HTN sensors.
+ * Sensors write world state keys at a fixed interval. They are updated by the world's
+ * UHTNSensorScheduler, which staggers them across frames and batches sensors of the same
+ * class from all agents into one SenseBatch call.
+ */
+UCLASS(Abstract, BlueprintType, Blueprintable, EditInlineNew)
+class HIERARCHICALTASKNETWORKRUNTIME_API UHTNSensor : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UHTNSensor();
+
+	/**
+	 * Senses the world for a batch of agents.
+	 * Called on the first sensor of the batch; every update carries its own sensor for per-agent settings.
+	 * The default implementation calls Sense for each update. Override to share work between
+	 * agents, e.g. one spatial query for all "nearest enemy" sensors.
+	 * 
+	 * @param Updates - One update per agent, all with sensors of this class
+	 */
+	virtual void SenseBatch(TArrayView<FHTNSensorUpdate> Updates) const;
+
+	/**
+	 * Senses the world for one agent.
+	 * 
+	 * @param Owner - The agent the sensor belongs to
+	 * @param WorldState - The agent's current world state
+	 * @param OutValues - Sensed values, keyed by world state key; only OutputKeys are committed
+	 */
+	UFUNCTION(BlueprintNativeEvent, Category = "HTN|Sensor")
+	void Sense(AActor* Owner, const UHTNWorldState* WorldState, TMap<FName, FHTNProperty>& OutValues) const;
+	virtual void Sense_Implementation(AActor* Owner, const UHTNWorldState* WorldState, TMap<FName, FHTNProperty>& OutValues) const;
+
+	/**
+	 * Gets a human-readable description of this sensor.
+	 * 
+	 * @return String description of the sensor
+	 */
+	UFUNCTION(BlueprintNativeEvent, Category = "HTN|Sensor")
+	FString GetDescription() const;
+	virtual FString GetDescription_Implementation() const;
+
+	/**
+	 * Validates that this sensor is set up correctly.
+	 * 
+	 * @return True if the sensor is valid, false otherwise
+	 */
+	UFUNCTION(BlueprintNativeEvent, Category = "HTN|Sensor")
+	bool ValidateSensor() const;
+	virtual bool ValidateSensor_Implementation() const;
+
+	/** Seconds between updates (0 = every frame) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sensor", meta = (ClampMin = "0.0"))
+	float UpdateInterval;
+
+	/** World state keys this sensor writes; sensed values for other keys are ignored */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sensor")
+	TArray<FName> OutputKeys;
+};
@@ -6,6 +6,30 @@
 #include "Navigation/PathFollowingComponent.h"
 #include "HTNMoveToTask.generated.h"
 
+/**
+ * Per-agent instance memory for UHTNMoveToTask.
+ */
+struct FHTNMoveToTaskMemory : public FHTNPrimitiveTaskMemory
+{
+    /** Current move request ID */
+    FAIRequestID MoveRequestID = FAIRequestID::InvalidRequest;
+
+    /** Time waiting for path computation */
+    float PathComputationWaitTime = 0.0f;
+
+    /** Path following component the request finished binding was added to; unbinding always goes through it */
+    TWeakObjectPtr<UPathFollowingComponent> PathFollowingComponent;
+
+    /** Binding to the path following component's request finished event */
+    FDelegateHandle MoveFinishedHandle;
+
+    /** Whether the move request has reported completion */
+    bool bDidFinish = false;
+
+    /** Result reported by the path following component */
+    EPathFollowingResult::Type ResultOfPathing = EPathFollowingResult::Invalid;
+};
+
 /**
  * HTN primitive task that moves an agent to a specified location.
  * Uses the AIMoveTo functionality to navigate through the environment.
@@ -19,11 +43,14 @@ public:
     UHTNMoveToTask();
 
     //~ Begin UHTNPrimitiveTask Interface
-    virtual EHTNTaskStatus ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) override;
-    virtual EHTNTaskStatus TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime) override;
-    virtual void EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus) override;
+    virtual EHTNTaskStatus ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) const override;
+    virtual EHTNTaskStatus TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime) const override;
+    virtual void EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus) const override;
     virtual bool IsApplicable(const UHTNWorldState* WorldState) const override;
     virtual bool ValidateTask_Implementation() const override;
+    virtual uint16 GetInstanceMemorySize() const override;
+    virtual void InitializeMemory(uint8* NodeMemory) const override;
+    virtual void CleanupMemory(uint8* NodeMemory) const override;
     //~ End UHTNPrimitiveTask Interface
 
     /** How to specify the destination */
@@ -63,12 +90,6 @@ public:
     float MovementSpeed;
 
 private:
-    /** Current move request ID */
-    FAIRequestID MoveRequestID;
-
-    /** Time waiting for path computation */
-    float PathComputationWaitTime;
-
     /** Get AI controller from world state */
     AAIController* GetController(const UHTNWorldState* WorldState) const;
 
@@ -78,9 +99,6 @@ private:
     /** Get the destination from world state during planning/validation */
     bool GetDestination(const UHTNWorldState* WorldState, FVector& OutDestination) const;
 
-    bool DidFinish = false;
-    EPathFollowingResult::Type ResultOfPathing;
-    
-    UFUNCTION()
-    void OnMoveFinished(FAIRequestID RequestID, EPathFollowingResult::Type Result);
+    /** Remove this agent's request finished binding from the component it was added to */
+    static void UnbindMoveFinished(FHTNMoveToTaskMemory& Memory);
 };
\ No newline at end of file
@@ -9,6 +9,24 @@
 class USkeletalMeshComponent;
 class UAnimInstance;
 
+/**
+ * Per-agent instance memory for UHTNPlayMontageTask.
+ */
+struct FHTNPlayMontageTaskMemory : public FHTNPrimitiveTaskMemory
+{
+    /** The montage currently being played */
+    TWeakObjectPtr<UAnimMontage> ActiveMontage;
+
+    /** Anim instance playing the montage, which holds the end delegate bound to this memory */
+    TWeakObjectPtr<UAnimInstance> ActiveAnimInstance;
+
+    /** Whether the montage has started playing */
+    bool bMontageStarted = false;
+
+    /** Whether the montage has completed naturally */
+    bool bMontageCompleted = false;
+};
+
 /**
  * HTN primitive task that plays an animation montage.
  * This task plays a specified montage on a character and waits for completion.
@@ -22,11 +40,14 @@ public:
     UHTNPlayMontageTask();
 
     //~ Begin UHTNPrimitiveTask Interface
-    virtual EHTNTaskStatus ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) override;
-    virtual EHTNTaskStatus TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime) override;
-    virtual void EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus) override;
+    virtual EHTNTaskStatus ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) const override;
+    virtual EHTNTaskStatus TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime) const override;
+    virtual void EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus) const override;
     virtual bool IsApplicable(const UHTNWorldState* WorldState) const override;
     virtual bool ValidateTask_Implementation() const override;
+    virtual uint16 GetInstanceMemorySize() const override;
+    virtual void InitializeMemory(uint8* NodeMemory) const override;
+    virtual void CleanupMemory(uint8* NodeMemory) const override;
     //~ End UHTNPrimitiveTask Interface
 
     /** The animation montage to play */
@@ -82,29 +103,12 @@ public:
     FName MontageLengthKey;
 
 private:
-    /** Saving this so we can use it when the delegate for the animation ending triggers*/
-    UPROPERTY()
-    UHTNExecutionContext* SavedExecutionContext;
-    
-    /** The montage currently being played */
-    UAnimMontage* ActiveMontage;
-
-    /** Whether the montage has started playing */
-    bool bMontageStarted;
-
-    /** Whether the montage has completed naturally */
-    bool bMontageCompleted;
-
     /** Find the anim instance to use */
     UAnimInstance* GetAnimInstance(const AActor* TargetActor) const;
 
-    /** Register a delegate to handle montage end */
-    void RegisterMontageEndDelegate(UAnimInstance* AnimInstance);
-
-    /** Unregister the montage end delegate */
-    void UnregisterMontageEndDelegate(UAnimInstance* AnimInstance);
+    /** Bind this agent's montage end delegate to the montage instance that was just started */
+    void BindMontageEndDelegate(UAnimInstance* AnimInstance, UAnimMontage* InMontage, FHTNPlayMontageTaskMemory* Memory) const;
 
-    /** Callback for when a montage ends */
-    UFUNCTION()
-    void OnMontageEnded(UAnimMontage* InMontage, bool bInterrupted);
+    /** Unbind this agent's montage end delegate from the anim instance it was bound on */
+    static void UnbindMontageEndDelegate(FHTNPlayMontageTaskMemory& Memory);
 };
\ No newline at end of file
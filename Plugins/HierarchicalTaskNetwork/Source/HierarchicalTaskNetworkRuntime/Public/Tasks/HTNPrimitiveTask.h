@@ -5,18 +5,40 @@
 #include "CoreMinimal.h"
 #include "HTNTask.h"
 #include "Conditions/HTNCondition.h"
+#include "Conditions/HTNBoolConditionMask.h"
 #include "Effects/HTNEffect.h"
 #include "HTNPrimitiveTask.generated.h"
 
+class UHTNExecutionContext;
+
+/**
+ * Delegate for task execution events, with the execution context of the agent running the task
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FHTNTaskExecutionDelegate, UHTNPrimitiveTask*, Task, UHTNExecutionContext*, ExecutionContext);
+
 /**
- * Delegate for task execution events
+ * Per-agent runtime state of a primitive task.
+ * Task objects are shared, immutable definitions; everything that changes while a task
+ * runs lives in instance memory allocated by the plan executor.
  */
-DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FHTNTaskExecutionDelegate, UHTNPrimitiveTask*, Task);
+struct FHTNPrimitiveTaskMemory
+{
+    /** Current execution status */
+    EHTNTaskStatus Status = EHTNTaskStatus::Invalid;
+
+    /** Time when execution began */
+    double ExecutionStartTime = 0.0;
+
+    /** Whether this task is currently executing */
+    bool bIsExecuting = false;
+};
 
 /**
  * Base class for primitive (directly executable) HTN tasks.
  * Primitive tasks represent atomic actions that can be executed directly,
  * without further decomposition.
+ * Task objects hold no per-agent runtime state, so one domain can be shared by many agents;
+ * runtime state is kept in instance memory (see FHTNPrimitiveTaskMemory).
  */
 UCLASS(BlueprintType, Blueprintable)
 class HIERARCHICALTASKNETWORKRUNTIME_API UHTNPrimitiveTask : public UHTNTask
@@ -28,6 +50,10 @@ public:
 
     //~ Begin UObject Interface
     virtual void PostInitProperties() override;
+    virtual void PostLoad() override;
+#if WITH_EDITOR
+    virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
     //~ End UObject Interface
 
     //~ Begin UHTNTask Interface
@@ -37,40 +63,124 @@ public:
     //~ End UHTNTask Interface
 
     /**
-     * Begin execution of this primitive task.
+     * Begin execution of this primitive task for one agent.
      * 
      * @param ExecutionContext - The current world state to use during execution
+     * @param NodeMemory - The agent's instance memory for this task
      * @return True if execution started successfully, false if it failed immediately
      */
-    UFUNCTION(BlueprintCallable, Category = "HTN|Task")
-    virtual bool Execute(UHTNExecutionContext* ExecutionContext);
+    virtual bool Execute(UHTNExecutionContext* ExecutionContext, uint8* NodeMemory) const;
 
     /**
-     * Check if this task has completed execution.
+     * Tick this task for one agent, updating the status stored in its instance memory.
      * 
+     * @param ExecutionContext - The current execution context
+     * @param NodeMemory - The agent's instance memory for this task
+     * @param DeltaTime - Time in seconds since the last tick
+     * @return The status of the task after the tick
+     */
+    virtual EHTNTaskStatus Tick(UHTNExecutionContext* ExecutionContext, uint8* NodeMemory, float DeltaTime) const;
+
+    /**
+     * Check if this task ticks through TickTaskThreadSafe instead of the TickTask event.
+     * Thread-safe ticks of tasks running in parallel and dependency-based plans are batched
+     * across all agents and run on worker threads by the plan executor manager.
+     * 
+     * @return True if the task class opted in to thread-safe ticking
+     */
+    FORCEINLINE bool HasThreadSafeTick() const { return bThreadSafeTick; }
+
+    /**
+     * Tick this task for one agent without touching the execution context, delegates or any other UObject state.
+     * Only used when bThreadSafeTick is set, and may run on a worker thread. The world state may be read but not written.
+     * Status changes are applied by the plan executor on the game thread afterwards.
+     * 
+     * @param WorldState - The agent's world state (read-only)
+     * @param NodeMemory - The agent's instance memory for this task
+     * @param DeltaTime - Time in seconds since the last tick
+     * @return The status of the task after the tick
+     */
+    virtual EHTNTaskStatus TickTaskThreadSafe(const UHTNWorldState* WorldState, uint8* NodeMemory, float DeltaTime) const;
+
+    /**
+     * Finish execution of this task for one agent, either through completion or failure.
+     * 
+     * @param ExecutionContext - The current execution context
+     * @param NodeMemory - The agent's instance memory for this task
+     * @param FinalStatus - The final status of the task
+     */
+    virtual void Finish(UHTNExecutionContext* ExecutionContext, uint8* NodeMemory, EHTNTaskStatus FinalStatus) const;
+
+    /**
+     * Check if this task has completed execution for one agent.
+     * 
+     * @param NodeMemory - The agent's instance memory for this task
      * @return True if the task has finished (either succeeded or failed), false if still in progress
      */
-    UFUNCTION(BlueprintCallable, Category = "HTN|Task")
-    virtual bool IsComplete() const;
+    virtual bool IsComplete(const uint8* NodeMemory) const;
 
     /**
-     * Get the current execution status of this task.
+     * Get the current execution status of this task for one agent.
      * 
+     * @param NodeMemory - The agent's instance memory for this task
      * @return Current status (InProgress, Succeeded, Failed, or Invalid)
      */
-    UFUNCTION(BlueprintCallable, Category = "HTN|Task")
-    virtual EHTNTaskStatus GetStatus() const;
+    virtual EHTNTaskStatus GetStatus(const uint8* NodeMemory) const;
+
+    /**
+     * Gets the size of the per-agent instance memory this task needs.
+     * Subclasses with runtime state declare a struct deriving from FHTNPrimitiveTaskMemory
+     * and return its size here.
+     * 
+     * @return Size of the instance memory in bytes
+     */
+    virtual uint16 GetInstanceMemorySize() const;
+
+    /**
+     * Constructs the instance memory for one agent.
+     * 
+     * @param NodeMemory - The uninitialized memory block of GetInstanceMemorySize() bytes
+     */
+    virtual void InitializeMemory(uint8* NodeMemory) const;
+
+    /**
+     * Destroys the instance memory for one agent.
+     * 
+     * @param NodeMemory - The memory block previously passed to InitializeMemory
+     */
+    virtual void CleanupMemory(uint8* NodeMemory) const;
+
+    /**
+     * Casts raw instance memory to a task memory struct.
+     * 
+     * @param NodeMemory - The raw instance memory
+     * @return The typed instance memory
+     */
+    template<typename TMemory>
+    static TMemory* CastInstanceMemory(uint8* NodeMemory)
+    {
+        static_assert(TIsDerivedFrom<TMemory, FHTNPrimitiveTaskMemory>::Value, "Task memory must derive from FHTNPrimitiveTaskMemory");
+        return reinterpret_cast<TMemory*>(NodeMemory);
+    }
+
+    template<typename TMemory>
+    static const TMemory* CastInstanceMemory(const uint8* NodeMemory)
+    {
+        static_assert(TIsDerivedFrom<TMemory, FHTNPrimitiveTaskMemory>::Value, "Task memory must derive from FHTNPrimitiveTaskMemory");
+        return reinterpret_cast<const TMemory*>(NodeMemory);
+    }
 
     /**
      * Called when the task is executed.
      * This is where the actual implementation of the task should go.
+     * Per-agent state belongs in instance memory, available through ExecutionContext->GetTaskMemory().
      * 
      * @param ExecutionContext
      * @return EHTNTaskStatus - The result of the execution
      */
     UFUNCTION(BlueprintNativeEvent, Category = "HTN|Task")
-    EHTNTaskStatus ExecuteTask(UHTNExecutionContext* ExecutionContext);
-    virtual EHTNTaskStatus ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext);
+    EHTNTaskStatus ExecuteTask(UHTNExecutionContext* ExecutionContext) const;
+    virtual EHTNTaskStatus ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) const;
 
     /**
      * Called every tick while the task is executing.
@@ -81,8 +191,8 @@ public:
      * @return EHTNTaskStatus - The current status of the task
      */
     UFUNCTION(BlueprintNativeEvent, Category = "HTN|Task")
-    EHTNTaskStatus TickTask(UHTNExecutionContext* ExecutionContext, float DeltaTime);
-    virtual EHTNTaskStatus TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime);
+    EHTNTaskStatus TickTask(UHTNExecutionContext* ExecutionContext, float DeltaTime) const;
+    virtual EHTNTaskStatus TickTask_Implementation(UHTNExecutionContext* ExecutionContext, float DeltaTime) const;
 
     /**
      * Called when the task is ended, either through completion or abortion.
@@ -92,16 +202,16 @@ public:
      * @param FinalStatus - The final status of the task
      */
     UFUNCTION(BlueprintNativeEvent, Category = "HTN|Task")
-    void EndTask(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus);
-    virtual void EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus);
+    void EndTask(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus) const;
+    virtual void EndTask_Implementation(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus FinalStatus) const;
 
     /**
-     * Aborts the execution of this task.
+     * Aborts the execution of this task for one agent.
      * 
      * @param ExecutionContext - The current world state
+     * @param NodeMemory - The agent's instance memory for this task
      */
-    UFUNCTION(BlueprintCallable, Category = "HTN|Task")
-    virtual void AbortTask(UHTNExecutionContext* ExecutionContext);
+    virtual void AbortTask(UHTNExecutionContext* ExecutionContext, uint8* NodeMemory) const;
 
     /**
      * Applies the expected effects of this task to the world state.
@@ -113,12 +223,65 @@ public:
     virtual void ApplyEffects(UHTNExecutionContext* ExecutionContext) const;
 
     /**
-     * Sets the status of this task.
+     * Applies the expected effects of this task directly to a world state, without allocating.
+     * Used by the planner; subclasses overriding GetExpectedEffects should override this to match.
+     * 
+     * @param WorldState - The world state to modify
+     */
+    virtual void ApplyExpectedEffects(UHTNWorldState* WorldState) const;
+
+    /**
+     * Gets the world state keys read by this task's preconditions.
+     * 
+     * @param OutKeys - Array the keys are appended to
+     * @return True if the keys are known, false if a precondition may read any key
+     */
+    bool GetPreconditionReadKeys(TArray<FName>& OutKeys) const;
+
+    /**
+     * Gets the world state keys written by this task's effects.
+     * 
+     * @param OutKeys - Array the keys are appended to
+     * @return True if the keys are known, false if an effect may write any key
+     */
+    bool GetEffectWriteKeys(TArray<FName>& OutKeys) const;
+
+    /**
+     * Gets the world state keys read by this task's effects while they are applied.
      * 
+     * @param OutKeys - Array the keys are appended to
+     * @return True if the keys are known, false if an effect may read any key
+     */
+    bool GetEffectReadKeys(TArray<FName>& OutKeys) const;
+
+    /**
+     * Sets the status of this task for one agent.
+     * 
+     * @param NodeMemory - The agent's instance memory for this task
      * @param NewStatus - The new status
      */
-    UFUNCTION(BlueprintCallable, Category = "HTN|Task")
-    void SetStatus(EHTNTaskStatus NewStatus);
+    void SetStatus(uint8* NodeMemory, EHTNTaskStatus NewStatus) const;
+
+    /**
+     * Deprecated Blueprint versions of Execute, IsComplete, GetStatus, SetStatus and AbortTask from before
+     * runtime state moved into instance memory. They act on the instance memory the execution context has
+     * bound while one of this task's events runs, so they only work when called from ExecuteTask, TickTask
+     * or EndTask with that event's execution context.
+     */
+    UFUNCTION(BlueprintCallable, Category = "HTN|Task", meta = (DisplayName = "Execute", DeprecatedFunction, DeprecationMessage = "Tasks are started by the plan executor; runtime state lives in instance memory."))
+    bool K2_Execute(UHTNExecutionContext* ExecutionContext);
+
+    UFUNCTION(BlueprintCallable, Category = "HTN|Task", meta = (DisplayName = "Is Complete", DeprecatedFunction, DeprecationMessage = "Runtime state lives in instance memory; pass the execution context of the running event."))
+    bool K2_IsComplete(UHTNExecutionContext* ExecutionContext) const;
+
+    UFUNCTION(BlueprintCallable, Category = "HTN|Task", meta = (DisplayName = "Get Status", DeprecatedFunction, DeprecationMessage = "Runtime state lives in instance memory; pass the execution context of the running event."))
+    EHTNTaskStatus K2_GetStatus(UHTNExecutionContext* ExecutionContext) const;
+
+    UFUNCTION(BlueprintCallable, Category = "HTN|Task", meta = (DisplayName = "Set Status", DeprecatedFunction, DeprecationMessage = "Return the new status from ExecuteTask or TickTask instead."))
+    void K2_SetStatus(UHTNExecutionContext* ExecutionContext, EHTNTaskStatus NewStatus);
+
+    UFUNCTION(BlueprintCallable, Category = "HTN|Task", meta = (DisplayName = "Abort Task", DeprecatedFunction, DeprecationMessage = "Tasks are aborted by the plan executor; runtime state lives in instance memory."))
+    void K2_AbortTask(UHTNExecutionContext* ExecutionContext);
 
     /**
      * Validates that the task is set up correctly.
@@ -127,22 +290,32 @@ public:
     virtual bool ValidateTask_Implementation() const override;
 
 public:
-    /** Called when the task starts execution */
+    /**
+     * Called when any agent's plan executor starts the task. The task is shared by every agent running it,
+     * so listeners tell agents apart by the execution context.
+     */
     UPROPERTY(BlueprintAssignable, Category = "HTN|Task")
     FHTNTaskExecutionDelegate OnTaskStarted;
 
-    /** Called when the task completes successfully */
+    /** Called when the task completes successfully for any agent (see OnTaskStarted) */
     UPROPERTY(BlueprintAssignable, Category = "HTN|Task")
     FHTNTaskExecutionDelegate OnTaskSucceeded;
 
-    /** Called when the task fails */
+    /** Called when the task fails for any agent (see OnTaskStarted) */
     UPROPERTY(BlueprintAssignable, Category = "HTN|Task")
     FHTNTaskExecutionDelegate OnTaskFailed;
 
-    /** Called when the task is aborted */
+    /** Called when the task is aborted for any agent (see OnTaskStarted) */
     UPROPERTY(BlueprintAssignable, Category = "HTN|Task")
     FHTNTaskExecutionDelegate OnTaskAborted;
 
+    /**
+     * Compile Preconditions for checking (see FHTNBoolConditionMask).
+     * Call on the game thread after changing Preconditions, before the task is planned with again.
+     * Until then the task checks its preconditions one by one.
+     */
+    void CompilePreconditions();
+
     /** Preconditions that must be satisfied for this task to be applicable */
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Instanced, Category = "Task|Preconditions")
     TArray<UHTNCondition*> Preconditions;
@@ -151,27 +324,26 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Instanced, Category = "Task|Effects")
     TArray<UHTNEffect*> Effects;
 
-   protected:
-    /** Current execution status */
-    UPROPERTY(BlueprintReadOnly, Category = "Task")
-    EHTNTaskStatus Status;
-
-    /** Time when execution began */
-    UPROPERTY(BlueprintReadOnly, Category = "Task")
-    float ExecutionStartTime;
-
+protected:
     /** Maximum time this task should take to execute (in seconds, 0 = no limit) */
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Task", meta = (ClampMin = "0.0"))
     float MaxExecutionTime;
 
-    /** Whether this task is currently executing */
-    UPROPERTY(BlueprintReadOnly, Category = "Task")
-    uint8 bIsExecuting : 1;
+    /**
+     * Set in the constructor of task classes whose tick touches no UObjects.
+     * The task is then ticked through TickTaskThreadSafe (see HasThreadSafeTick).
+     */
+    bool bThreadSafeTick;
 
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Task")
-    UHTNExecutionContext* ActiveExecutionContext;
+    /**
+     * Check whether a task has been executing for longer than MaxExecutionTime.
+     * 
+     * @param Memory - The agent's instance memory for this task
+     * @return True if the task timed out
+     */
+    bool HasExecutionTimedOut(const FHTNPrimitiveTaskMemory& Memory) const;
 
 private:
-    /** Helper function to broadcast execution events */
-    void BroadcastTaskEvent(EHTNTaskStatus NewStatus);
+    /** Preconditions compiled for checking, see CompilePreconditions */
+    FHTNBoolConditionMask PreconditionMask;
 };
\ No newline at end of file
@@ -49,7 +49,7 @@ public:
     UHTNPrintLogTask();
 
     //~ Begin UHTNPrimitiveTask Interface
-    virtual EHTNTaskStatus ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) override;
+    virtual EHTNTaskStatus ExecuteTask_Implementation(UHTNExecutionContext* ExecutionContext) const override;
     virtual bool ValidateTask_Implementation() const override;
     //~ End UHTNPrimitiveTask Interface
 
@@ -52,8 +52,35 @@ void UTestHTNComponent::CreateGetFoodPlan()
     State->SetPropertyValue<UObject*>("UseTableAnimation", UseTableAnimation);
     State->SetPropertyValue<UObject*>("UseDoorAnimation", UseDoorAnimation);
     
+    // Create a list of goal tasks. The task graph holds no per-agent state,
+    // so every actor using this component shares the same domain.
+    TArray<UHTNTask*> GoalTasks;
+    GoalTasks.Add(GetOrCreateGetFoodDomain());
+    
+    // Generate the plan
+    if (GeneratePlan(GoalTasks))
+    {
+        UE_LOG(LogTemp, Display, TEXT("Successfully generated Get Food plan! Fridge has food: %s"), 
+               State->GetPropertyValue<bool>("FridgeHasFood", false) ? TEXT("Yes") : TEXT("No"));
+    }
+    else
+    {
+        UE_LOG(LogTemp, Error, TEXT("Failed to generate Get Food plan"));
+    }
+}
+
+UHTNCompoundTask* UTestHTNComponent::GetOrCreateGetFoodDomain()
+{
+	// Shared by all instances; the components' goal task references keep it alive while in use
+	static TWeakObjectPtr<UHTNCompoundTask> SharedGetFoodTask;
+	if (SharedGetFoodTask.IsValid())
+	{
+		return SharedGetFoodTask.Get();
+	}
+	
     // Create the main compound task for getting food
-    UHTNCompoundTask* GetFoodTask = UHTNTaskFactory::Get()->CreateCompoundTask(UHTNCompoundTask::StaticClass(), this, "GetFood");
+    UHTNCompoundTask* GetFoodTask = UHTNTaskFactory::Get()->CreateCompoundTask(UHTNCompoundTask::StaticClass(), GetTransientPackage(), "GetFood");
+    SharedGetFoodTask = GetFoodTask;
     
     // === METHOD 1: Get food from fridge ===
     UHTNMethod* FridgeMethod = NewObject<UHTNMethod>(GetFoodTask);
@@ -183,19 +210,5 @@ void UTestHTNComponent::CreateGetFoodPlan()
     GetFoodTask->Methods.Add(FridgeMethod);
     GetFoodTask->Methods.Add(OrderFoodMethod);
     
-    // Create a list of goal tasks
-    TArray<UHTNTask*> GoalTasks;
-    GoalTasks.Add(GetFoodTask);
-    
-    // Generate the plan
-    if (GeneratePlan(GoalTasks))
-    {
-        UE_LOG(LogTemp, Display, TEXT("Successfully generated Get Food plan! Fridge has food: %s"), 
-               State->GetPropertyValue<bool>("FridgeHasFood", false) ? TEXT("Yes") : TEXT("No"));
-    }
-    else
-    {
-        UE_LOG(LogTemp, Error, TEXT("Failed to generate Get Food plan"));
-    }
+    return GetFoodTask;
 }
-
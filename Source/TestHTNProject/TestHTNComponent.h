@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "HTNComponent.h"
+#include "Tasks/HTNCompoundTask.h"
 
 #include "TestHTNComponent.generated.h"
 
@@ -42,4 +43,7 @@ protected:
 
 private:
 	void CreateGetFoodPlan();
+
+	/** Builds the Get Food task graph once and returns the instance shared by all components */
+	static UHTNCompoundTask* GetOrCreateGetFoodDomain();
 };